@@ -0,0 +1,873 @@
+#include "AsyncIO.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+namespace
+{
+	// Maior trecho lido de uma vez pelo pool. Entre um trecho e outro o pedido
+	// confere se foi cancelado
+	constexpr std::size_t PoolReadChunk = 1024 * 1024;
+
+	// Acesso a arquivos com leitura posicional, sem estado de posicao compartilhado
+	// entre threads. Erros voltam como errno
+#ifdef _WIN32
+	std::intptr_t OpenFile(const std::string& Path, int& Error)
+	{
+		HANDLE File = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+		{
+			Error = GetLastError() == ERROR_FILE_NOT_FOUND || GetLastError() == ERROR_PATH_NOT_FOUND ? ENOENT : EIO;
+			return -1;
+		}
+		return reinterpret_cast<std::intptr_t>(File);
+	}
+
+	bool GetFileSize(std::intptr_t File, std::uint64_t& Size)
+	{
+		LARGE_INTEGER FileSize;
+		if (!GetFileSizeEx(reinterpret_cast<HANDLE>(File), &FileSize))
+		{
+			return false;
+		}
+		Size = static_cast<std::uint64_t>(FileSize.QuadPart);
+		return true;
+	}
+
+	long long ReadAt(std::intptr_t File, void* Buffer, std::size_t Size, std::uint64_t Offset)
+	{
+		OVERLAPPED Overlapped{};
+		Overlapped.Offset = static_cast<DWORD>(Offset);
+		Overlapped.OffsetHigh = static_cast<DWORD>(Offset >> 32);
+		DWORD BytesRead = 0;
+		if (!ReadFile(reinterpret_cast<HANDLE>(File), Buffer, static_cast<DWORD>(std::min<std::size_t>(Size, 1u << 30)), &BytesRead, &Overlapped))
+		{
+			return GetLastError() == ERROR_HANDLE_EOF ? 0 : -EIO;
+		}
+		return BytesRead;
+	}
+
+	void CloseFile(std::intptr_t File)
+	{
+		CloseHandle(reinterpret_cast<HANDLE>(File));
+	}
+#else
+	std::intptr_t OpenFile(const std::string& Path, int& Error)
+	{
+		const int File = open(Path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (File < 0)
+		{
+			Error = errno;
+		}
+		return File;
+	}
+
+	bool GetFileSize(std::intptr_t File, std::uint64_t& Size)
+	{
+		struct stat FileStat;
+		if (fstat(static_cast<int>(File), &FileStat) != 0)
+		{
+			return false;
+		}
+		Size = static_cast<std::uint64_t>(FileStat.st_size);
+		return true;
+	}
+
+	long long ReadAt(std::intptr_t File, void* Buffer, std::size_t Size, std::uint64_t Offset)
+	{
+		const ssize_t BytesRead = pread(static_cast<int>(File), Buffer, Size, static_cast<off_t>(Offset));
+		return BytesRead < 0 ? -errno : BytesRead;
+	}
+
+	void CloseFile(std::intptr_t File)
+	{
+		close(static_cast<int>(File));
+	}
+#endif
+}
+
+#ifdef __linux__
+// Ponteiros para dentro dos aneis de submissao e de conclusao mapeados do kernel
+struct AsyncIO::UringState
+{
+	int RingFd = -1;
+	unsigned NumEntries = 0;
+
+	void* SqRing = nullptr;
+	std::size_t SqRingSize = 0;
+	void* CqRing = nullptr;
+	std::size_t CqRingSize = 0;
+	io_uring_sqe* Sqes = nullptr;
+	std::size_t SqesSize = 0;
+
+	unsigned* SqHead = nullptr;
+	unsigned* SqTail = nullptr;
+	unsigned* SqMask = nullptr;
+	unsigned* SqArray = nullptr;
+	unsigned* CqHead = nullptr;
+	unsigned* CqTail = nullptr;
+	unsigned* CqMask = nullptr;
+	io_uring_cqe* Cqes = nullptr;
+};
+#else
+struct AsyncIO::UringState
+{
+};
+#endif
+
+AsyncIO::AsyncIO() = default;
+
+AsyncIO::~AsyncIO() = default;
+
+AsyncIO& AsyncIO::Get()
+{
+	static AsyncIO Instance;
+	return Instance;
+}
+
+void AsyncIO::Init(int QueueDepth, int NumPoolThreads, bool ForceThreadPool)
+{
+	if (ActiveBackend != Backend::Synchronous)
+	{
+		return;
+	}
+
+	StopRequested = false;
+	NumSubmitted = 0;
+	NumCompleted = 0;
+	NumCancelled = 0;
+	NumFailed = 0;
+	NumBytesRead = 0;
+	this->NumPoolThreads = std::max(1, NumPoolThreads);
+
+	if (!ForceThreadPool && InitUring(QueueDepth))
+	{
+		ActiveBackend = Backend::IoUring;
+		Threads.emplace_back(&AsyncIO::UringLoop, this);
+		return;
+	}
+
+	ActiveBackend = Backend::ThreadPool;
+	for (int ThreadIndex = 0; ThreadIndex < this->NumPoolThreads; ++ThreadIndex)
+	{
+		Threads.emplace_back(&AsyncIO::PoolLoop, this);
+	}
+}
+
+void AsyncIO::Shutdown()
+{
+	if (ActiveBackend == Backend::Synchronous)
+	{
+		Flush();
+		return;
+	}
+
+	// O que nao comecou a ser lido e cancelado; as leituras em voo terminam normalmente
+	std::vector<std::unique_ptr<Request>> Dropped;
+	{
+		std::lock_guard<std::mutex> Lock{QueueMutex};
+		StopRequested = true;
+		for (std::deque<std::unique_ptr<Request>>& Queue : Pending)
+		{
+			for (std::unique_ptr<Request>& Queued : Queue)
+			{
+				Queued->Cancelled = true;
+				Dropped.push_back(std::move(Queued));
+			}
+			Queue.clear();
+		}
+	}
+	QueueCondition.notify_all();
+
+	for (std::unique_ptr<Request>& Queued : Dropped)
+	{
+		Complete(std::move(Queued));
+	}
+
+	for (std::thread& Thread : Threads)
+	{
+		Thread.join();
+	}
+	Threads.clear();
+
+	// O anel tambem fica aberto ate aqui quando a thread de I/O caiu para o pool
+	ShutdownUring();
+	ActiveBackend = Backend::Synchronous;
+
+	Flush();
+}
+
+IORequestId AsyncIO::Read(const std::string& Path, IOPriority Priority, IOCallback OnComplete, std::uint64_t Offset, std::size_t Size)
+{
+	std::unique_ptr<Request> NewRequest{new Request};
+	NewRequest->Id = NextId++;
+	NewRequest->Path = Path;
+	NewRequest->Priority = Priority;
+	NewRequest->Offset = Offset;
+	NewRequest->Size = Size;
+	NewRequest->Callback = std::move(OnComplete);
+	NewRequest->StartTime = std::chrono::steady_clock::now();
+
+	const IORequestId Id = NewRequest->Id;
+	NumSubmitted++;
+	NumOutstanding++;
+
+	if (ActiveBackend == Backend::Synchronous)
+	{
+		ReadBlocking(*NewRequest);
+		Complete(std::move(NewRequest));
+		return Id;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock{QueueMutex};
+		Pending[static_cast<int>(Priority)].push_back(std::move(NewRequest));
+	}
+	QueueCondition.notify_one();
+	return Id;
+}
+
+bool AsyncIO::Cancel(IORequestId Id)
+{
+	std::unique_ptr<Request> Removed;
+	{
+		std::lock_guard<std::mutex> Lock{QueueMutex};
+		for (std::deque<std::unique_ptr<Request>>& Queue : Pending)
+		{
+			auto Found = std::find_if(Queue.begin(), Queue.end(), [Id](const std::unique_ptr<Request>& Queued)
+			{
+				return Queued->Id == Id;
+			});
+			if (Found != Queue.end())
+			{
+				Removed = std::move(*Found);
+				Queue.erase(Found);
+				break;
+			}
+		}
+
+		if (!Removed)
+		{
+			auto Found = InFlight.find(Id);
+			if (Found == InFlight.end())
+			{
+				return false;
+			}
+			Found->second->Cancelled = true;
+			return true;
+		}
+	}
+
+	Removed->Cancelled = true;
+	Complete(std::move(Removed));
+	return true;
+}
+
+void AsyncIO::DispatchCompletions()
+{
+	std::vector<std::unique_ptr<Request>> Ready;
+	{
+		std::lock_guard<std::mutex> Lock{CompletionMutex};
+		Ready.swap(Completed);
+	}
+
+	// Sem threads de trabalho ninguem mais executaria os jobs ate a proxima espera
+	// da thread principal, entao os callbacks rodam aqui mesmo
+	const bool RunInline = JobSystem::Get().GetNumThreads() <= 1;
+
+	for (std::unique_ptr<Request>& Done : Ready)
+	{
+		auto RunCallback = [this, Done = Done.release()]
+		{
+			if (Done->Callback)
+			{
+				Done->Callback(Done->Result);
+			}
+			delete Done;
+			NumOutstanding--;
+		};
+
+		if (RunInline)
+		{
+			RunCallback();
+		}
+		else
+		{
+			JobSystem::Get().Run(CallbackJobs, RunCallback);
+		}
+	}
+}
+
+void AsyncIO::Flush()
+{
+	while (true)
+	{
+		DispatchCompletions();
+		JobSystem::Get().Wait(CallbackJobs);
+		if (NumOutstanding.load() == 0)
+		{
+			break;
+		}
+
+		std::unique_lock<std::mutex> Lock{CompletionMutex};
+		CompletionCondition.wait(Lock, [this]
+		{
+			return !Completed.empty();
+		});
+	}
+}
+
+AsyncIO::Stats AsyncIO::GetStats() const
+{
+	Stats Current;
+	Current.Submitted = NumSubmitted;
+	Current.Completed = NumCompleted;
+	Current.Cancelled = NumCancelled;
+	Current.Failed = NumFailed;
+	Current.BytesRead = NumBytesRead;
+	Current.Outstanding = NumOutstanding;
+	return Current;
+}
+
+std::unique_ptr<AsyncIO::Request> AsyncIO::PopPending()
+{
+	// QueueMutex ja esta travado por quem chamou
+	for (std::deque<std::unique_ptr<Request>>& Queue : Pending)
+	{
+		if (!Queue.empty())
+		{
+			std::unique_ptr<Request> Next = std::move(Queue.front());
+			Queue.pop_front();
+			InFlight[Next->Id] = Next.get();
+			return Next;
+		}
+	}
+	return nullptr;
+}
+
+void AsyncIO::ReadBlocking(Request& Pending)
+{
+	IOResult& Result = Pending.Result;
+
+	int Error = 0;
+	const std::intptr_t File = OpenFile(Pending.Path, Error);
+	if (File < 0)
+	{
+		Result.Error = Error;
+		return;
+	}
+
+	std::uint64_t FileSize = 0;
+	if (!GetFileSize(File, FileSize))
+	{
+		Result.Error = EIO;
+		CloseFile(File);
+		return;
+	}
+
+	const std::uint64_t Available = FileSize > Pending.Offset ? FileSize - Pending.Offset : 0;
+	const std::size_t Size = Pending.Size == 0 ? static_cast<std::size_t>(Available) : static_cast<std::size_t>(std::min<std::uint64_t>(Pending.Size, Available));
+	Result.Data.resize(Size);
+
+	std::size_t BytesDone = 0;
+	while (BytesDone < Size && !Pending.Cancelled)
+	{
+		const long long BytesRead = ReadAt(File, Result.Data.data() + BytesDone, std::min(PoolReadChunk, Size - BytesDone), Pending.Offset + BytesDone);
+		if (BytesRead < 0)
+		{
+			if (BytesRead == -EINTR)
+			{
+				continue;
+			}
+			Result.Error = static_cast<int>(-BytesRead);
+			break;
+		}
+		if (BytesRead == 0)
+		{
+			break;
+		}
+		BytesDone += static_cast<std::size_t>(BytesRead);
+	}
+	Result.Data.resize(BytesDone);
+
+	CloseFile(File);
+}
+
+void AsyncIO::Complete(std::unique_ptr<Request> Done)
+{
+	if (Done->File >= 0)
+	{
+		CloseFile(Done->File);
+		Done->File = -1;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock{QueueMutex};
+		InFlight.erase(Done->Id);
+	}
+
+	IOResult& Result = Done->Result;
+	Result.Id = Done->Id;
+	Result.Path = Done->Path;
+	Result.Cancelled = Done->Cancelled;
+	Result.LatencySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Done->StartTime).count();
+
+	if (Result.Cancelled)
+	{
+		Result.Data.clear();
+		Result.Data.shrink_to_fit();
+		NumCancelled++;
+	}
+	else if (Result.Error != 0)
+	{
+		Result.Data.clear();
+		NumFailed++;
+	}
+	else
+	{
+		NumCompleted++;
+		NumBytesRead += Result.Data.size();
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock{CompletionMutex};
+		Completed.push_back(std::move(Done));
+	}
+	CompletionCondition.notify_all();
+}
+
+void AsyncIO::PoolLoop()
+{
+	while (true)
+	{
+		std::unique_ptr<Request> Next;
+		{
+			std::unique_lock<std::mutex> Lock{QueueMutex};
+			QueueCondition.wait(Lock, [this]
+			{
+				return StopRequested || !Pending[0].empty() || !Pending[1].empty() || !Pending[2].empty();
+			});
+			Next = PopPending();
+			if (!Next)
+			{
+				break;
+			}
+		}
+
+		ReadBlocking(*Next);
+		Complete(std::move(Next));
+	}
+}
+
+void AsyncIO::Requeue(std::unique_ptr<Request> Again)
+{
+	// O pool le de novo do inicio, com o seu proprio descritor
+	if (Again->File >= 0)
+	{
+		CloseFile(Again->File);
+		Again->File = -1;
+	}
+	Again->BytesDone = 0;
+	Again->Result.Data.clear();
+
+	std::lock_guard<std::mutex> Lock{QueueMutex};
+	InFlight.erase(Again->Id);
+	Pending[static_cast<int>(Again->Priority)].push_front(std::move(Again));
+}
+
+#ifdef __linux__
+bool AsyncIO::InitUring(int QueueDepth)
+{
+	io_uring_params Params;
+	std::memset(&Params, 0, sizeof(Params));
+
+	const int RingFd = static_cast<int>(syscall(__NR_io_uring_setup, static_cast<unsigned>(std::max(1, QueueDepth)), &Params));
+	if (RingFd < 0)
+	{
+		return false;
+	}
+
+	std::unique_ptr<UringState> State{new UringState};
+	State->RingFd = RingFd;
+	State->NumEntries = Params.sq_entries;
+	State->SqRingSize = Params.sq_off.array + Params.sq_entries * sizeof(unsigned);
+	State->CqRingSize = Params.cq_off.cqes + Params.cq_entries * sizeof(io_uring_cqe);
+
+	// Desde o 5.4 os dois aneis podem vir no mesmo mapeamento
+	const bool SingleMap = (Params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if (SingleMap)
+	{
+		State->SqRingSize = State->CqRingSize = std::max(State->SqRingSize, State->CqRingSize);
+	}
+
+	State->SqRing = mmap(nullptr, State->SqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingFd, IORING_OFF_SQ_RING);
+	if (State->SqRing == MAP_FAILED)
+	{
+		close(RingFd);
+		return false;
+	}
+
+	State->CqRing = SingleMap ? State->SqRing : mmap(nullptr, State->CqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingFd, IORING_OFF_CQ_RING);
+	State->SqesSize = Params.sq_entries * sizeof(io_uring_sqe);
+	void* Sqes = mmap(nullptr, State->SqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, RingFd, IORING_OFF_SQES);
+	if (State->CqRing == MAP_FAILED || Sqes == MAP_FAILED)
+	{
+		if (Sqes != MAP_FAILED)
+		{
+			munmap(Sqes, State->SqesSize);
+		}
+		if (!SingleMap && State->CqRing != MAP_FAILED)
+		{
+			munmap(State->CqRing, State->CqRingSize);
+		}
+		munmap(State->SqRing, State->SqRingSize);
+		close(RingFd);
+		return false;
+	}
+
+	unsigned char* SqBase = static_cast<unsigned char*>(State->SqRing);
+	unsigned char* CqBase = static_cast<unsigned char*>(State->CqRing);
+	State->Sqes = static_cast<io_uring_sqe*>(Sqes);
+	State->SqHead = reinterpret_cast<unsigned*>(SqBase + Params.sq_off.head);
+	State->SqTail = reinterpret_cast<unsigned*>(SqBase + Params.sq_off.tail);
+	State->SqMask = reinterpret_cast<unsigned*>(SqBase + Params.sq_off.ring_mask);
+	State->SqArray = reinterpret_cast<unsigned*>(SqBase + Params.sq_off.array);
+	State->CqHead = reinterpret_cast<unsigned*>(CqBase + Params.cq_off.head);
+	State->CqTail = reinterpret_cast<unsigned*>(CqBase + Params.cq_off.tail);
+	State->CqMask = reinterpret_cast<unsigned*>(CqBase + Params.cq_off.ring_mask);
+	State->Cqes = reinterpret_cast<io_uring_cqe*>(CqBase + Params.cq_off.cqes);
+
+	Uring = std::move(State);
+	return true;
+}
+
+void AsyncIO::ShutdownUring()
+{
+	if (!Uring)
+	{
+		return;
+	}
+
+	munmap(Uring->Sqes, Uring->SqesSize);
+	if (Uring->CqRing != Uring->SqRing)
+	{
+		munmap(Uring->CqRing, Uring->CqRingSize);
+	}
+	munmap(Uring->SqRing, Uring->SqRingSize);
+	close(Uring->RingFd);
+	Uring.reset();
+}
+
+void AsyncIO::UringLoop()
+{
+	UringState& State = *Uring;
+
+	// Pedidos com leitura a enviar (novos ou continuacao de uma leitura curta).
+	// Enquanto estao no anel o ponteiro cru e o dono do pedido; InRing guarda todos
+	// eles para que um erro fatal do anel consiga terminar cada um
+	std::vector<Request*> ToSubmit;
+	std::vector<Request*> InRing;
+	unsigned NumInFlight = 0;
+	unsigned NumUnsubmitted = 0;
+	auto LeaveRing = [&InRing](Request* Done)
+	{
+		InRing.erase(std::find(InRing.begin(), InRing.end(), Done));
+		return std::unique_ptr<Request>{Done};
+	};
+
+	while (true)
+	{
+		std::vector<std::unique_ptr<Request>> NewRequests;
+		bool MorePending = false;
+		{
+			std::unique_lock<std::mutex> Lock{QueueMutex};
+			auto HasPending = [this]
+			{
+				return !Pending[0].empty() || !Pending[1].empty() || !Pending[2].empty();
+			};
+			if (NumInFlight == 0 && ToSubmit.empty())
+			{
+				QueueCondition.wait(Lock, [this, &HasPending]
+				{
+					return StopRequested || HasPending();
+				});
+				if (!HasPending())
+				{
+					break;
+				}
+			}
+
+			// Nunca mais leituras no anel que entradas de submissao
+			while (NumInFlight + ToSubmit.size() + NewRequests.size() < State.NumEntries && HasPending())
+			{
+				NewRequests.push_back(PopPending());
+			}
+			MorePending = HasPending();
+		}
+
+		// Abrir o arquivo e alocar o destino. Arquivos vazios ou com erro terminam aqui
+		for (std::unique_ptr<Request>& Next : NewRequests)
+		{
+			int Error = 0;
+			Next->File = OpenFile(Next->Path, Error);
+			std::uint64_t FileSize = 0;
+			if (Next->File < 0 || !GetFileSize(Next->File, FileSize))
+			{
+				Next->Result.Error = Error != 0 ? Error : EIO;
+				Complete(std::move(Next));
+				continue;
+			}
+
+			const std::uint64_t Available = FileSize > Next->Offset ? FileSize - Next->Offset : 0;
+			Next->Size = Next->Size == 0 ? static_cast<std::size_t>(Available) : static_cast<std::size_t>(std::min<std::uint64_t>(Next->Size, Available));
+			Next->Result.Data.resize(Next->Size);
+			if (Next->Size == 0 || Next->Cancelled)
+			{
+				Complete(std::move(Next));
+				continue;
+			}
+			InRing.push_back(Next.get());
+			ToSubmit.push_back(Next.release());
+		}
+
+		// Preencher as entradas de submissao. O kernel so ve as novas quando o tail e publicado
+		unsigned Tail = *State.SqTail;
+		for (Request* Next : ToSubmit)
+		{
+			if (Next->Cancelled)
+			{
+				Complete(LeaveRing(Next));
+				continue;
+			}
+
+			const unsigned Index = Tail & *State.SqMask;
+			io_uring_sqe& Sqe = State.Sqes[Index];
+			std::memset(&Sqe, 0, sizeof(Sqe));
+			Sqe.opcode = IORING_OP_READ;
+			Sqe.fd = static_cast<int>(Next->File);
+			Sqe.off = Next->Offset + Next->BytesDone;
+			Sqe.addr = reinterpret_cast<std::uint64_t>(Next->Result.Data.data() + Next->BytesDone);
+			Sqe.len = static_cast<unsigned>(std::min<std::size_t>(Next->Size - Next->BytesDone, 1u << 30));
+			Sqe.user_data = reinterpret_cast<std::uint64_t>(Next);
+			State.SqArray[Index] = Index;
+			++Tail;
+			++NumInFlight;
+			++NumUnsubmitted;
+		}
+		ToSubmit.clear();
+		__atomic_store_n(State.SqTail, Tail, __ATOMIC_RELEASE);
+
+		// Um unico io_uring_enter envia o lote inteiro. So espera uma conclusao se nao
+		// houver mais pedidos na fila para enviar, ou se o anel ja estiver cheio
+		const bool RingFull = NumInFlight >= State.NumEntries;
+		const unsigned MinComplete = NumInFlight > 0 && (!MorePending || RingFull) ? 1u : 0u;
+		const long Submitted = syscall(__NR_io_uring_enter, State.RingFd, NumUnsubmitted, MinComplete, IORING_ENTER_GETEVENTS, nullptr, 0);
+		int RingError = 0;
+		if (Submitted > 0)
+		{
+			NumUnsubmitted -= static_cast<unsigned>(Submitted);
+		}
+		else if (Submitted < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+		{
+			RingError = errno;
+		}
+
+		// Colher as conclusoes
+		unsigned Head = *State.CqHead;
+		const unsigned CqTail = __atomic_load_n(State.CqTail, __ATOMIC_ACQUIRE);
+		for (; Head != CqTail; ++Head)
+		{
+			const io_uring_cqe& Cqe = State.Cqes[Head & *State.CqMask];
+			Request* Done = reinterpret_cast<Request*>(Cqe.user_data);
+			--NumInFlight;
+
+			if (Cqe.res == -EINTR || Cqe.res == -EAGAIN)
+			{
+				ToSubmit.push_back(Done);
+			}
+			else if (Cqe.res == -EINVAL)
+			{
+				// Kernel sem IORING_OP_READ (anterior ao 5.6): le do jeito antigo
+				Done->Result.Data.clear();
+				CloseFile(Done->File);
+				Done->File = -1;
+				ReadBlocking(*Done);
+				Complete(LeaveRing(Done));
+			}
+			else if (Cqe.res < 0)
+			{
+				Done->Result.Error = -Cqe.res;
+				Complete(LeaveRing(Done));
+			}
+			else
+			{
+				// Leitura curta: continua de onde parou, a menos que o arquivo tenha acabado
+				Done->BytesDone += static_cast<std::size_t>(Cqe.res);
+				if (Cqe.res > 0 && Done->BytesDone < Done->Size && !Done->Cancelled)
+				{
+					ToSubmit.push_back(Done);
+				}
+				else
+				{
+					Done->Result.Data.resize(Done->BytesDone);
+					Complete(LeaveRing(Done));
+				}
+			}
+		}
+		__atomic_store_n(State.CqHead, Head, __ATOMIC_RELEASE);
+
+		if (RingError != 0)
+		{
+			FallBackToThreadPool(InRing, ToSubmit, RingError);
+			return;
+		}
+	}
+}
+
+void AsyncIO::FallBackToThreadPool(std::vector<Request*>& InRing, std::vector<Request*>& Retry, int Error)
+{
+	UringState& State = *Uring;
+
+	// Com a fila trocada de dono, os novos pedidos ja esperam pelo pool
+	{
+		std::lock_guard<std::mutex> Lock{QueueMutex};
+		ActiveBackend = Backend::ThreadPool;
+	}
+	std::cerr << "AsyncIO: io_uring falhou (" << std::strerror(Error) << "), usando o pool de threads" << std::endl;
+
+	// Entradas publicadas que o kernel nao consumiu sao retiradas do anel. Sem
+	// SQPOLL so o io_uring_enter desta thread as consumiria
+	const unsigned SqHead = __atomic_load_n(State.SqHead, __ATOMIC_ACQUIRE);
+	for (unsigned Index = SqHead; Index != *State.SqTail; ++Index)
+	{
+		const io_uring_sqe& Sqe = State.Sqes[State.SqArray[Index & *State.SqMask]];
+		Retry.push_back(reinterpret_cast<Request*>(Sqe.user_data));
+	}
+	__atomic_store_n(State.SqTail, SqHead, __ATOMIC_RELEASE);
+
+	// O que nao esta com o kernel volta para a fila e sera lido pelo pool
+	for (Request* Again : Retry)
+	{
+		InRing.erase(std::find(InRing.begin(), InRing.end(), Again));
+		Requeue(std::unique_ptr<Request>{Again});
+	}
+	Retry.clear();
+
+	// As leituras em voo sao canceladas e esperadas antes de liberar o destino.
+	// Cada conclusao (lida, cancelada ou com erro) tira o pedido do anel
+	unsigned Tail = *State.SqTail;
+	unsigned NumCancels = 0;
+	for (Request* InKernel : InRing)
+	{
+		io_uring_sqe& Sqe = State.Sqes[Tail & *State.SqMask];
+		std::memset(&Sqe, 0, sizeof(Sqe));
+		Sqe.opcode = IORING_OP_ASYNC_CANCEL;
+		Sqe.addr = reinterpret_cast<std::uint64_t>(InKernel);
+		Sqe.user_data = 0;
+		State.SqArray[Tail & *State.SqMask] = Tail & *State.SqMask;
+		++Tail;
+		++NumCancels;
+	}
+	__atomic_store_n(State.SqTail, Tail, __ATOMIC_RELEASE);
+
+	int NumFailedEnters = 0;
+	while (!InRing.empty() && NumFailedEnters < 3)
+	{
+		const long Submitted = syscall(__NR_io_uring_enter, State.RingFd, NumCancels, 1u, IORING_ENTER_GETEVENTS, nullptr, 0);
+		if (Submitted < 0)
+		{
+			NumFailedEnters += errno == EINTR ? 0 : 1;
+		}
+		else
+		{
+			NumCancels -= std::min<unsigned>(NumCancels, static_cast<unsigned>(Submitted));
+		}
+
+		unsigned Head = *State.CqHead;
+		const unsigned CqTail = __atomic_load_n(State.CqTail, __ATOMIC_ACQUIRE);
+		for (; Head != CqTail; ++Head)
+		{
+			const io_uring_cqe& Cqe = State.Cqes[Head & *State.CqMask];
+			Request* Done = reinterpret_cast<Request*>(Cqe.user_data);
+			if (Done == nullptr)
+			{
+				continue;
+			}
+			InRing.erase(std::find(InRing.begin(), InRing.end(), Done));
+
+			Done->BytesDone += Cqe.res > 0 ? static_cast<std::size_t>(Cqe.res) : 0;
+			if (Done->Cancelled || Done->BytesDone == Done->Size)
+			{
+				Done->Result.Data.resize(Done->BytesDone);
+				Complete(std::unique_ptr<Request>{Done});
+			}
+			else
+			{
+				Requeue(std::unique_ptr<Request>{Done});
+			}
+		}
+		__atomic_store_n(State.CqHead, Head, __ATOMIC_RELEASE);
+	}
+
+	// O anel nao responde mais: o destino fica para sempre com o kernel e o pedido
+	// termina com o erro do anel
+	for (Request* Lost : InRing)
+	{
+		AbandonedBuffers.push_back(std::move(Lost->Result.Data));
+		Lost->Result.Data.clear();
+		Lost->Result.Error = Error;
+		Complete(std::unique_ptr<Request>{Lost});
+	}
+	InRing.clear();
+	QueueCondition.notify_all();
+
+	// Esta thread vira uma das threads do pool e cuida das outras ate o Shutdown
+	std::vector<std::thread> Workers;
+	for (int ThreadIndex = 1; ThreadIndex < NumPoolThreads; ++ThreadIndex)
+	{
+		Workers.emplace_back(&AsyncIO::PoolLoop, this);
+	}
+	PoolLoop();
+	for (std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+}
+
+#else
+bool AsyncIO::InitUring(int)
+{
+	return false;
+}
+
+void AsyncIO::ShutdownUring()
+{
+}
+
+void AsyncIO::UringLoop()
+{
+}
+
+void AsyncIO::FallBackToThreadPool(std::vector<Request*>&, std::vector<Request*>&, int)
+{
+}
+
+#endif
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "JobSystem.h"
+
+using IORequestId = std::uint64_t;
+
+// Ordem de atendimento dos pedidos pendentes: tiles na tela, vizinhos, pre-carga
+enum class IOPriority
+{
+	High = 0,
+	Normal = 1,
+	Low = 2,
+};
+
+struct IOResult
+{
+	IORequestId Id = 0;
+	std::string Path;
+	std::vector<unsigned char> Data;
+	int Error = 0;                  // 0 ou o errno da falha
+	bool Cancelled = false;
+	double LatencySeconds = 0.0;    // Do pedido ate a leitura terminar
+};
+
+// Executado como job do JobSystem depois que a leitura termina, falha ou e cancelada
+using IOCallback = std::function<void(IOResult&)>;
+
+// Servico de leitura assincrona de arquivos. No Linux os pedidos sao enviados em
+// lotes para um anel io_uring por uma thread de I/O; sem io_uring (kernel antigo,
+// seccomp, outros sistemas) um pool de threads faz leituras posicionais (pread).
+// As conclusoes sao entregues ao JobSystem por DispatchCompletions
+class AsyncIO
+{
+public:
+	enum class Backend
+	{
+		Synchronous,    // Sem Init: le na hora, na thread que chamou Read
+		IoUring,
+		ThreadPool,
+	};
+
+	struct Stats
+	{
+		std::uint64_t Submitted = 0;
+		std::uint64_t Completed = 0;
+		std::uint64_t Cancelled = 0;
+		std::uint64_t Failed = 0;
+		std::uint64_t BytesRead = 0;
+		int Outstanding = 0;            // Pendentes + em voo + aguardando entrega
+	};
+
+	static AsyncIO& Get();
+
+	// QueueDepth limita as leituras em voo no io_uring; NumPoolThreads e o tamanho
+	// do pool usado quando o io_uring nao esta disponivel ou ForceThreadPool e true
+	void Init(int QueueDepth = 64, int NumPoolThreads = 4, bool ForceThreadPool = false);
+
+	// Cancela o que ainda esta na fila, espera as leituras em voo e entrega tudo
+	void Shutdown();
+
+	// Le Size bytes a partir de Offset (Size 0 le ate o fim do arquivo)
+	IORequestId Read(const std::string& Path, IOPriority Priority, IOCallback OnComplete, std::uint64_t Offset = 0, std::size_t Size = 0);
+
+	// Pedidos ainda na fila saem dela na hora; leituras em voo sao interrompidas
+	// (pool) ou descartadas ao terminar (io_uring). Em ambos os casos o callback
+	// recebe Cancelled = true. Retorna false se o pedido ja tinha terminado
+	bool Cancel(IORequestId Id);
+
+	// Envia os callbacks das leituras concluidas para o JobSystem. Chamar uma vez
+	// por frame na thread principal
+	void DispatchCompletions();
+
+	// Espera todos os pedidos feitos ate agora e os seus callbacks terminarem
+	void Flush();
+
+	Backend GetBackend() const { return ActiveBackend; }
+	Stats GetStats() const;
+
+private:
+	struct Request
+	{
+		IORequestId Id = 0;
+		std::string Path;
+		IOPriority Priority = IOPriority::Normal;
+		std::uint64_t Offset = 0;
+		std::size_t Size = 0;
+		IOCallback Callback;
+		std::chrono::steady_clock::time_point StartTime;
+
+		std::atomic<bool> Cancelled{false};
+		std::intptr_t File = -1;
+		std::size_t BytesDone = 0;
+		IOResult Result;
+	};
+
+	AsyncIO();
+	~AsyncIO();
+
+	std::unique_ptr<Request> PopPending();
+	void ReadBlocking(Request& Pending);
+	void Complete(std::unique_ptr<Request> Done);
+
+	void PoolLoop();
+
+	bool InitUring(int QueueDepth);
+	void ShutdownUring();
+	void UringLoop();
+
+	// Depois de um erro fatal do anel: cancela e espera as leituras que o kernel ja
+	// recebeu, devolve para a fila o que ele nunca viu e segue com o pool de threads
+	// ate o Shutdown. Retry sao os pedidos do anel que aguardam reenvio
+	void FallBackToThreadPool(std::vector<Request*>& InRing, std::vector<Request*>& Retry, int Error);
+	void Requeue(std::unique_ptr<Request> Again);
+
+	// Muda de IoUring para ThreadPool se o anel falhar
+	std::atomic<Backend> ActiveBackend{Backend::Synchronous};
+	int NumPoolThreads = 4;
+	std::atomic<IORequestId> NextId{1};
+
+	// Pedidos na fila, um deque por prioridade, e os que ja estao em leitura
+	mutable std::mutex QueueMutex;
+	std::condition_variable QueueCondition;
+	std::deque<std::unique_ptr<Request>> Pending[3];
+	std::unordered_map<IORequestId, Request*> InFlight;
+	bool StopRequested = false;
+
+	// Leituras concluidas aguardando DispatchCompletions
+	std::mutex CompletionMutex;
+	std::condition_variable CompletionCondition;
+	std::vector<std::unique_ptr<Request>> Completed;
+	JobCounter CallbackJobs;
+
+	std::vector<std::thread> Threads;
+
+	std::atomic<std::uint64_t> NumSubmitted{0};
+	std::atomic<std::uint64_t> NumCompleted{0};
+	std::atomic<std::uint64_t> NumCancelled{0};
+	std::atomic<std::uint64_t> NumFailed{0};
+	std::atomic<std::uint64_t> NumBytesRead{0};
+	std::atomic<int> NumOutstanding{0};
+
+	// Anel io_uring (so Linux), mapeado a partir do descritor do anel
+	struct UringState;
+	std::unique_ptr<UringState> Uring;
+
+	// Destinos de leituras que o kernel nao devolveu nem depois de canceladas. Nunca
+	// sao liberados, porque ele ainda pode escrever neles
+	std::vector<std::vector<unsigned char>> AbandonedBuffers;
+};
@@ -0,0 +1,770 @@
+#include "Atmosphere.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include <glm/gtc/constants.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include "FileReader.h"
+#include "JobSystem.h"
+#include "UniformBuffers.h"
+
+// Arquivo das tabelas: cabecalho e as tres texturas em RGBA meio float, na ordem
+// transmitancia, espalhamento e irradiancia, prontas para o glTexImage
+constexpr char AtmosphereCacheMagic[4] = {'B', 'M', 'A', 'T'};
+constexpr std::uint32_t AtmosphereCacheVersion = 1;
+
+struct AtmosphereCacheHeader
+{
+	char Magic[4];
+	std::uint32_t Version;
+	std::uint64_t ParametersHash;
+	std::int32_t TransmittanceWidth;
+	std::int32_t TransmittanceHeight;
+	std::int32_t ScatteringWidth;
+	std::int32_t ScatteringHeight;
+	std::int32_t ScatteringDepth;
+	std::int32_t IrradianceWidth;
+	std::int32_t IrradianceHeight;
+	std::int32_t Reserved;
+};
+
+constexpr int ScatteringTextureWidth = ScatteringTextureNuSize * ScatteringTextureMuSSize;
+constexpr std::size_t NumTransmittanceTexels = std::size_t(TransmittanceTextureWidth) * TransmittanceTextureHeight;
+constexpr std::size_t NumScatteringTexels = std::size_t(ScatteringTextureWidth) * ScatteringTextureMuSize * ScatteringTextureRSize;
+constexpr std::size_t NumIrradianceTexels = std::size_t(IrradianceTextureWidth) * IrradianceTextureHeight;
+constexpr std::size_t AtmosphereCacheSize = sizeof(AtmosphereCacheHeader) +
+	(NumTransmittanceTexels + NumScatteringTexels + NumIrradianceTexels) * sizeof(std::uint64_t);
+
+// Amostras das integrais. A profundidade otica vai para a textura e precisa de mais;
+// o espalhamento integra sobre a transmitancia ja tabelada
+constexpr int TransmittanceSampleCount = 500;
+constexpr int ScatteringSampleCount = 50;
+constexpr int IrradianceSampleCount = 32;   // Passos de angulo em meia volta
+
+// Espalhamento multiplo de Hillaire (2020): para cada altura e angulo do sol, a luz
+// de segunda ordem e a fracao re-espalhada, somadas em direcoes uniformes na esfera
+constexpr int MultipleScatteringTextureSize = 32;
+constexpr int MultipleScatteringDirectionSteps = 8;     // 8 x 8 direcoes
+constexpr int MultipleScatteringSampleCount = 20;
+
+// Tabelas intermediarias e os parametros derivados usados pelas integrais
+struct AtmosphereModel
+{
+	AtmosphereParameters Parameters;
+	float HorizonDistance = 0.0f;   // Do chao ao topo na tangente: sqrt(top^2 - bottom^2)
+	float MuSMin = 0.0f;
+
+	std::vector<glm::vec3> Transmittance;
+	std::vector<glm::vec3> MultipleScattering;
+	std::vector<glm::vec4> Scattering;
+	std::vector<glm::vec3> Irradiance;
+};
+
+// Hash dos parametros, para tabelas de outra atmosfera serem recalculadas
+static std::uint64_t HashParameters(const AtmosphereParameters& Parameters)
+{
+	static_assert(sizeof(AtmosphereParameters) % sizeof(float) == 0, "AtmosphereParameters deve conter so floats");
+	unsigned char Bytes[sizeof(AtmosphereParameters)];
+	std::memcpy(Bytes, &Parameters, sizeof(Bytes));
+
+	std::uint64_t Hash = 0xcbf29ce484222325ull;
+	for (unsigned char Byte : Bytes)
+	{
+		Hash = (Hash ^ Byte) * 0x100000001b3ull;
+	}
+	return Hash;
+}
+
+static float ClampCosine(float Mu)
+{
+	return glm::clamp(Mu, -1.0f, 1.0f);
+}
+
+static float SafeSqrt(float Value)
+{
+	return std::sqrt(std::max(Value, 0.0f));
+}
+
+static float ClampRadius(const AtmosphereModel& Model, float R)
+{
+	return glm::clamp(R, Model.Parameters.BottomRadius, Model.Parameters.TopRadius);
+}
+
+static float DistanceToTopAtmosphereBoundary(const AtmosphereModel& Model, float R, float Mu)
+{
+	const float Discriminant = R * R * (Mu * Mu - 1.0f) + Model.Parameters.TopRadius * Model.Parameters.TopRadius;
+	return std::max(-R * Mu + SafeSqrt(Discriminant), 0.0f);
+}
+
+static float DistanceToBottomAtmosphereBoundary(const AtmosphereModel& Model, float R, float Mu)
+{
+	const float Discriminant = R * R * (Mu * Mu - 1.0f) + Model.Parameters.BottomRadius * Model.Parameters.BottomRadius;
+	return std::max(-R * Mu - SafeSqrt(Discriminant), 0.0f);
+}
+
+static bool RayIntersectsGround(const AtmosphereModel& Model, float R, float Mu)
+{
+	return Mu < 0.0f && R * R * (Mu * Mu - 1.0f) + Model.Parameters.BottomRadius * Model.Parameters.BottomRadius >= 0.0f;
+}
+
+static float DistanceToNearestAtmosphereBoundary(const AtmosphereModel& Model, float R, float Mu, bool IntersectsGround)
+{
+	return IntersectsGround ? DistanceToBottomAtmosphereBoundary(Model, R, Mu) : DistanceToTopAtmosphereBoundary(Model, R, Mu);
+}
+
+// Coordenada de textura que cai no centro do primeiro e do ultimo texel nos extremos
+static float GetTextureCoordFromUnitRange(float X, int Size)
+{
+	return 0.5f / Size + X * (1.0f - 1.0f / Size);
+}
+
+static float GetUnitRangeFromTextureCoord(float U, int Size)
+{
+	return (U - 0.5f / Size) / (1.0f - 1.0f / Size);
+}
+
+static float RayleighPhaseFunction(float Nu)
+{
+	return 3.0f / (16.0f * glm::pi<float>()) * (1.0f + Nu * Nu);
+}
+
+static float MiePhaseFunction(float G, float Nu)
+{
+	const float K = 3.0f / (8.0f * glm::pi<float>()) * (1.0f - G * G) / (2.0f + G * G);
+	return K * (1.0f + Nu * Nu) / std::pow(1.0f + G * G - 2.0f * G * Nu, 1.5f);
+}
+
+static float GetRayleighDensity(const AtmosphereModel& Model, float Altitude)
+{
+	return std::exp(-Altitude / Model.Parameters.RayleighScaleHeight);
+}
+
+static float GetMieDensity(const AtmosphereModel& Model, float Altitude)
+{
+	return std::exp(-Altitude / Model.Parameters.MieScaleHeight);
+}
+
+static float GetOzoneDensity(const AtmosphereModel& Model, float Altitude)
+{
+	return std::max(1.0f - std::abs(Altitude - Model.Parameters.OzoneCenterAltitude) / Model.Parameters.OzoneHalfWidth, 0.0f);
+}
+
+static glm::vec3 GetScatteringCoefficient(const AtmosphereModel& Model, float Altitude)
+{
+	return Model.Parameters.RayleighScattering * GetRayleighDensity(Model, Altitude) + Model.Parameters.MieScattering * GetMieDensity(Model, Altitude);
+}
+
+static glm::vec3 GetExtinctionCoefficient(const AtmosphereModel& Model, float Altitude)
+{
+	return Model.Parameters.RayleighScattering * GetRayleighDensity(Model, Altitude) +
+		Model.Parameters.MieExtinction * GetMieDensity(Model, Altitude) +
+		Model.Parameters.OzoneAbsorption * GetOzoneDensity(Model, Altitude);
+}
+
+// Leitura bilinear com clamp na borda, como o GL_LINEAR da textura
+static glm::vec3 SampleTable(const std::vector<glm::vec3>& Table, int Width, int Height, float U, float V)
+{
+	const float X = glm::clamp(U * Width - 0.5f, 0.0f, float(Width - 1));
+	const float Y = glm::clamp(V * Height - 0.5f, 0.0f, float(Height - 1));
+	const int X0 = std::min(int(X), Width - 2);
+	const int Y0 = std::min(int(Y), Height - 2);
+	const float FracX = X - X0;
+	const float FracY = Y - Y0;
+	const glm::vec3* Row0 = Table.data() + std::size_t(Y0) * Width + X0;
+	const glm::vec3* Row1 = Row0 + Width;
+	return glm::mix(glm::mix(Row0[0], Row0[1], FracX), glm::mix(Row1[0], Row1[1], FracX), FracY);
+}
+
+// Transmitancia: u pela distancia ao topo entre a minima e a maxima possiveis na
+// altura, v pela distancia ao horizonte. Concentra a resolucao perto do horizonte
+static glm::vec2 GetTransmittanceTextureUvFromRMu(const AtmosphereModel& Model, float R, float Mu)
+{
+	const float H = Model.HorizonDistance;
+	const float Rho = SafeSqrt(R * R - Model.Parameters.BottomRadius * Model.Parameters.BottomRadius);
+	const float D = DistanceToTopAtmosphereBoundary(Model, R, Mu);
+	const float DMin = Model.Parameters.TopRadius - R;
+	const float DMax = Rho + H;
+	const float XMu = (D - DMin) / (DMax - DMin);
+	const float XR = Rho / H;
+	return glm::vec2{GetTextureCoordFromUnitRange(XMu, TransmittanceTextureWidth), GetTextureCoordFromUnitRange(XR, TransmittanceTextureHeight)};
+}
+
+static void GetRMuFromTransmittanceTextureUv(const AtmosphereModel& Model, const glm::vec2& UV, float& R, float& Mu)
+{
+	const float XMu = GetUnitRangeFromTextureCoord(UV.x, TransmittanceTextureWidth);
+	const float XR = GetUnitRangeFromTextureCoord(UV.y, TransmittanceTextureHeight);
+	const float H = Model.HorizonDistance;
+	const float Rho = H * XR;
+	R = std::sqrt(Rho * Rho + Model.Parameters.BottomRadius * Model.Parameters.BottomRadius);
+	const float DMin = Model.Parameters.TopRadius - R;
+	const float DMax = Rho + H;
+	const float D = DMin + XMu * (DMax - DMin);
+	Mu = D == 0.0f ? 1.0f : ClampCosine((H * H - Rho * Rho - D * D) / (2.0f * R * D));
+}
+
+static glm::vec3 ComputeTransmittanceToTopAtmosphereBoundary(const AtmosphereModel& Model, float R, float Mu)
+{
+	const float Dx = DistanceToTopAtmosphereBoundary(Model, R, Mu) / TransmittanceSampleCount;
+	glm::vec3 OpticalDepth{0.0f};
+	for (int Sample = 0; Sample <= TransmittanceSampleCount; ++Sample)
+	{
+		const float D = Sample * Dx;
+		const float Ri = std::sqrt(D * D + 2.0f * R * Mu * D + R * R);
+		const float Weight = Sample == 0 || Sample == TransmittanceSampleCount ? 0.5f : 1.0f;
+		OpticalDepth += GetExtinctionCoefficient(Model, Ri - Model.Parameters.BottomRadius) * (Weight * Dx);
+	}
+	return glm::exp(-OpticalDepth);
+}
+
+static glm::vec3 GetTransmittanceToTopAtmosphereBoundary(const AtmosphereModel& Model, float R, float Mu)
+{
+	const glm::vec2 UV = GetTransmittanceTextureUvFromRMu(Model, R, Mu);
+	return SampleTable(Model.Transmittance, TransmittanceTextureWidth, TransmittanceTextureHeight, UV.x, UV.y);
+}
+
+// Transmitancia do sol ate a altura R, com a sombra do planeta suavizada pelo disco do sol
+static glm::vec3 GetTransmittanceToSun(const AtmosphereModel& Model, float R, float MuS)
+{
+	const float SinThetaH = Model.Parameters.BottomRadius / R;
+	const float CosThetaH = -SafeSqrt(1.0f - SinThetaH * SinThetaH);
+	const float Edge = SinThetaH * Model.Parameters.SunAngularRadius;
+	return GetTransmittanceToTopAtmosphereBoundary(Model, R, MuS) * glm::smoothstep(-Edge, Edge, MuS - CosThetaH);
+}
+
+static glm::vec3 GetMultipleScattering(const AtmosphereModel& Model, float R, float MuS)
+{
+	const float U = GetTextureCoordFromUnitRange(MuS * 0.5f + 0.5f, MultipleScatteringTextureSize);
+	const float V = GetTextureCoordFromUnitRange((R - Model.Parameters.BottomRadius) / (Model.Parameters.TopRadius - Model.Parameters.BottomRadius), MultipleScatteringTextureSize);
+	return SampleTable(Model.MultipleScattering, MultipleScatteringTextureSize, MultipleScatteringTextureSize, U, V);
+}
+
+// Fator de espalhamento multiplo em um ponto (Hillaire 2020, secao 5.5): a luz de
+// segunda ordem L2 que chega de todas as direcoes, supondo fase isotropica, dividida
+// por 1 - f, onde f e a fracao dessa luz espalhada de novo. A serie geometrica soma
+// todas as ordens de uma vez, no lugar do laco por ordem de Bruneton
+static glm::vec3 ComputeMultipleScattering(const AtmosphereModel& Model, float R, float MuS)
+{
+	const glm::vec3 SunDirection{SafeSqrt(1.0f - MuS * MuS), 0.0f, MuS};
+	const float IsotropicPhase = 1.0f / (4.0f * glm::pi<float>());
+	const float DirectionWeight = 1.0f / (MultipleScatteringDirectionSteps * MultipleScatteringDirectionSteps);
+
+	glm::vec3 SecondOrder{0.0f};
+	glm::vec3 Transfer{0.0f};
+	for (int ThetaStep = 0; ThetaStep < MultipleScatteringDirectionSteps; ++ThetaStep)
+	{
+		const float Mu = 1.0f - 2.0f * (ThetaStep + 0.5f) / MultipleScatteringDirectionSteps;
+		const float SinTheta = SafeSqrt(1.0f - Mu * Mu);
+		for (int PhiStep = 0; PhiStep < MultipleScatteringDirectionSteps; ++PhiStep)
+		{
+			const float Phi = glm::two_pi<float>() * (PhiStep + 0.5f) / MultipleScatteringDirectionSteps;
+			const float Nu = SinTheta * std::cos(Phi) * SunDirection.x + Mu * SunDirection.z;
+
+			const bool IntersectsGround = RayIntersectsGround(Model, R, Mu);
+			const float Distance = DistanceToNearestAtmosphereBoundary(Model, R, Mu, IntersectsGround);
+			const float Dt = Distance / MultipleScatteringSampleCount;
+
+			// Cada passo integrado com extincao constante: (1 - exp(-sigma dt)) / sigma
+			glm::vec3 PathTransmittance{1.0f};
+			glm::vec3 Luminance{0.0f};
+			glm::vec3 Fraction{0.0f};
+			for (int Sample = 0; Sample < MultipleScatteringSampleCount; ++Sample)
+			{
+				const float T = (Sample + 0.5f) * Dt;
+				const float Rt = ClampRadius(Model, std::sqrt(T * T + 2.0f * R * Mu * T + R * R));
+				const float MuSt = ClampCosine((R * MuS + T * Nu) / Rt);
+				const float Altitude = Rt - Model.Parameters.BottomRadius;
+
+				const glm::vec3 Scattering = GetScatteringCoefficient(Model, Altitude);
+				const glm::vec3 Extinction = glm::max(GetExtinctionCoefficient(Model, Altitude), glm::vec3{1e-9f});
+				const glm::vec3 StepTransmittance = glm::exp(-Extinction * Dt);
+				const glm::vec3 StepIntegral = (1.0f - StepTransmittance) / Extinction;
+
+				Luminance += PathTransmittance * GetTransmittanceToSun(Model, Rt, MuSt) * Scattering * IsotropicPhase * StepIntegral;
+				Fraction += PathTransmittance * Scattering * StepIntegral;
+				PathTransmittance *= StepTransmittance;
+			}
+
+			// Luz do sol refletida pelo chao, lambertiano
+			if (IntersectsGround)
+			{
+				const float MuSGround = ClampCosine((R * MuS + Distance * Nu) / Model.Parameters.BottomRadius);
+				Luminance += PathTransmittance * GetTransmittanceToSun(Model, Model.Parameters.BottomRadius, MuSGround) *
+					std::max(MuSGround, 0.0f) * Model.Parameters.GroundAlbedo / glm::pi<float>();
+			}
+
+			SecondOrder += Luminance * DirectionWeight;
+			Transfer += Fraction * DirectionWeight;
+		}
+	}
+	return SecondOrder / (1.0f - Transfer);
+}
+
+// Espalhamento: (r, mu, mu_s, nu) nas coordenadas de Bruneton (2017). A metade de
+// baixo do eixo mu e dos raios que atingem o chao e a de cima dos que chegam ao topo
+static glm::vec4 GetScatteringTextureUvwzFromRMuMuSNu(const AtmosphereModel& Model, float R, float Mu, float MuS, float Nu, bool IntersectsGround)
+{
+	const AtmosphereParameters& Parameters = Model.Parameters;
+	const float H = Model.HorizonDistance;
+	const float Rho = SafeSqrt(R * R - Parameters.BottomRadius * Parameters.BottomRadius);
+	const float UR = GetTextureCoordFromUnitRange(Rho / H, ScatteringTextureRSize);
+
+	const float RMu = R * Mu;
+	const float Discriminant = RMu * RMu - R * R + Parameters.BottomRadius * Parameters.BottomRadius;
+	float UMu = 0.0f;
+	if (IntersectsGround)
+	{
+		const float D = -RMu - SafeSqrt(Discriminant);
+		const float DMin = R - Parameters.BottomRadius;
+		const float DMax = Rho;
+		UMu = 0.5f - 0.5f * GetTextureCoordFromUnitRange(DMax == DMin ? 0.0f : (D - DMin) / (DMax - DMin), ScatteringTextureMuSize / 2);
+	}
+	else
+	{
+		const float D = -RMu + SafeSqrt(Discriminant + H * H);
+		const float DMin = Parameters.TopRadius - R;
+		const float DMax = Rho + H;
+		UMu = 0.5f + 0.5f * GetTextureCoordFromUnitRange((D - DMin) / (DMax - DMin), ScatteringTextureMuSize / 2);
+	}
+
+	const float D = DistanceToTopAtmosphereBoundary(Model, Parameters.BottomRadius, MuS);
+	const float DMin = Parameters.TopRadius - Parameters.BottomRadius;
+	const float DMax = H;
+	const float A = (D - DMin) / (DMax - DMin);
+	const float DMuSMin = DistanceToTopAtmosphereBoundary(Model, Parameters.BottomRadius, Model.MuSMin);
+	const float AMax = (DMuSMin - DMin) / (DMax - DMin);
+	const float UMuS = GetTextureCoordFromUnitRange(std::max(1.0f - A / AMax, 0.0f) / (1.0f + A), ScatteringTextureMuSSize);
+
+	const float UNu = (Nu + 1.0f) * 0.5f;
+	return glm::vec4{UNu, UMuS, UMu, UR};
+}
+
+static void GetRMuMuSNuFromScatteringTextureUvwz(const AtmosphereModel& Model, const glm::vec4& Uvwz, float& R, float& Mu, float& MuS, float& Nu, bool& IntersectsGround)
+{
+	const AtmosphereParameters& Parameters = Model.Parameters;
+	const float H = Model.HorizonDistance;
+	const float Rho = H * GetUnitRangeFromTextureCoord(Uvwz.w, ScatteringTextureRSize);
+	R = std::sqrt(Rho * Rho + Parameters.BottomRadius * Parameters.BottomRadius);
+
+	if (Uvwz.z < 0.5f)
+	{
+		const float DMin = R - Parameters.BottomRadius;
+		const float DMax = Rho;
+		const float D = DMin + (DMax - DMin) * GetUnitRangeFromTextureCoord(1.0f - 2.0f * Uvwz.z, ScatteringTextureMuSize / 2);
+		Mu = D == 0.0f ? -1.0f : ClampCosine(-(Rho * Rho + D * D) / (2.0f * R * D));
+		IntersectsGround = true;
+	}
+	else
+	{
+		const float DMin = Parameters.TopRadius - R;
+		const float DMax = Rho + H;
+		const float D = DMin + (DMax - DMin) * GetUnitRangeFromTextureCoord(2.0f * Uvwz.z - 1.0f, ScatteringTextureMuSize / 2);
+		Mu = D == 0.0f ? 1.0f : ClampCosine((H * H - Rho * Rho - D * D) / (2.0f * R * D));
+		IntersectsGround = false;
+	}
+
+	const float XMuS = GetUnitRangeFromTextureCoord(Uvwz.y, ScatteringTextureMuSSize);
+	const float DMin = Parameters.TopRadius - Parameters.BottomRadius;
+	const float DMax = H;
+	const float DMuSMin = DistanceToTopAtmosphereBoundary(Model, Parameters.BottomRadius, Model.MuSMin);
+	const float AMax = (DMuSMin - DMin) / (DMax - DMin);
+	const float A = (AMax - XMuS * AMax) / (1.0f + XMuS * AMax);
+	const float D = DMin + std::min(A, AMax) * (DMax - DMin);
+	MuS = D == 0.0f ? 1.0f : ClampCosine((H * H - D * D) / (2.0f * Parameters.BottomRadius * D));
+
+	Nu = ClampCosine(Uvwz.x * 2.0f - 1.0f);
+}
+
+// Uma linha da textura 3D: r e mu sao fixos e so mu_s e nu mudam ao longo dela.
+// Cada texel guarda Rayleigh mais o multiplo (ja dividido pela fase de Rayleigh, que
+// o shader aplica a soma) em RGB e o Mie simples em vermelho no alfa; as outras
+// cores do Mie sao extrapoladas no shader
+static void ComputeScatteringRow(const AtmosphereModel& Model, int Y, int Z, glm::vec4* Row)
+{
+	const AtmosphereParameters& Parameters = Model.Parameters;
+
+	// Amostras do raio da camera, iguais para todos os texels da linha: altura,
+	// densidades e a transmitancia ate a camera, pela razao de duas leituras da tabela
+	struct ViewSample
+	{
+		float D;
+		float Rd;
+		float RayleighDensity;
+		float MieDensity;
+		glm::vec3 Transmittance;    // Ja multiplicada pelo peso da regra do trapezio
+	};
+	ViewSample Samples[ScatteringSampleCount + 1];
+
+	float R = 0.0f;
+	float Mu = 0.0f;
+	float MuS = 0.0f;
+	float Nu = 0.0f;
+	bool IntersectsGround = false;
+	const float V = (Y + 0.5f) / ScatteringTextureMuSize;
+	const float W = (Z + 0.5f) / ScatteringTextureRSize;
+	GetRMuMuSNuFromScatteringTextureUvwz(Model, glm::vec4{0.0f, 0.0f, V, W}, R, Mu, MuS, Nu, IntersectsGround);
+
+	const glm::vec3 CameraTransmittance = GetTransmittanceToTopAtmosphereBoundary(Model, R, IntersectsGround ? -Mu : Mu);
+	const float Dx = DistanceToNearestAtmosphereBoundary(Model, R, Mu, IntersectsGround) / ScatteringSampleCount;
+	for (int Sample = 0; Sample <= ScatteringSampleCount; ++Sample)
+	{
+		ViewSample& Current = Samples[Sample];
+		Current.D = Sample * Dx;
+		Current.Rd = ClampRadius(Model, std::sqrt(Current.D * Current.D + 2.0f * R * Mu * Current.D + R * R));
+		const float MuD = ClampCosine((R * Mu + Current.D) / Current.Rd);
+		const float Altitude = Current.Rd - Parameters.BottomRadius;
+		Current.RayleighDensity = GetRayleighDensity(Model, Altitude);
+		Current.MieDensity = GetMieDensity(Model, Altitude);
+
+		const float Weight = Sample == 0 || Sample == ScatteringSampleCount ? 0.5f : 1.0f;
+		Current.Transmittance = Weight * glm::min(IntersectsGround ?
+			GetTransmittanceToTopAtmosphereBoundary(Model, Current.Rd, -MuD) / CameraTransmittance :
+			CameraTransmittance / GetTransmittanceToTopAtmosphereBoundary(Model, Current.Rd, MuD), glm::vec3{1.0f});
+	}
+
+	for (int X = 0; X < ScatteringTextureWidth; ++X)
+	{
+		const float FragCoordNu = std::floor((X + 0.5f) / ScatteringTextureMuSSize);
+		const float FragCoordMuS = std::fmod(X + 0.5f, float(ScatteringTextureMuSSize));
+		GetRMuMuSNuFromScatteringTextureUvwz(Model, glm::vec4{FragCoordNu / (ScatteringTextureNuSize - 1), FragCoordMuS / ScatteringTextureMuSSize, V, W},
+			R, Mu, MuS, Nu, IntersectsGround);
+
+		// Nem toda combinacao de angulos existe: nu fica entre os limites dados por mu e mu_s
+		const float Spread = std::sqrt((1.0f - Mu * Mu) * (1.0f - MuS * MuS));
+		Nu = glm::clamp(Nu, Mu * MuS - Spread, Mu * MuS + Spread);
+
+		glm::vec3 Rayleigh{0.0f};
+		glm::vec3 Mie{0.0f};
+		glm::vec3 Multiple{0.0f};
+		for (const ViewSample& Current : Samples)
+		{
+			const float MuSd = ClampCosine((R * MuS + Current.D * Nu) / Current.Rd);
+			const glm::vec3 Transmittance = Current.Transmittance * GetTransmittanceToSun(Model, Current.Rd, MuSd);
+			Rayleigh += Transmittance * Current.RayleighDensity;
+			Mie += Transmittance * Current.MieDensity;
+			Multiple += Current.Transmittance * (Parameters.RayleighScattering * Current.RayleighDensity + Parameters.MieScattering * Current.MieDensity) *
+				GetMultipleScattering(Model, Current.Rd, MuSd);
+		}
+		Rayleigh *= Parameters.SolarIrradiance * Parameters.RayleighScattering * Dx;
+		Mie *= Parameters.SolarIrradiance * Parameters.MieScattering * Dx;
+		Multiple *= Parameters.SolarIrradiance * Dx;
+
+		Row[X] = glm::vec4{Rayleigh + Multiple / RayleighPhaseFunction(Nu), Mie.r};
+	}
+}
+
+// Leitura trilinear da textura 3D com clamp na borda
+static glm::vec4 SampleScatteringTable(const std::vector<glm::vec4>& Table, const glm::vec3& Uvw)
+{
+	const int Sizes[3] = {ScatteringTextureWidth, ScatteringTextureMuSize, ScatteringTextureRSize};
+	int Base[3];
+	float Frac[3];
+	for (int Axis = 0; Axis < 3; ++Axis)
+	{
+		const float Coord = glm::clamp(Uvw[Axis] * Sizes[Axis] - 0.5f, 0.0f, float(Sizes[Axis] - 1));
+		Base[Axis] = std::min(int(Coord), Sizes[Axis] - 2);
+		Frac[Axis] = Coord - Base[Axis];
+	}
+
+	glm::vec4 Result{0.0f};
+	for (int Corner = 0; Corner < 8; ++Corner)
+	{
+		const int DX = Corner & 1;
+		const int DY = (Corner >> 1) & 1;
+		const int DZ = (Corner >> 2) & 1;
+		const float Weight = (DX ? Frac[0] : 1.0f - Frac[0]) * (DY ? Frac[1] : 1.0f - Frac[1]) * (DZ ? Frac[2] : 1.0f - Frac[2]);
+		const std::size_t Index = (std::size_t(Base[2] + DZ) * ScatteringTextureMuSize + Base[1] + DY) * ScatteringTextureWidth + Base[0] + DX;
+		Result += Table[Index] * Weight;
+	}
+	return Result;
+}
+
+// Radiancia do ceu com as fases aplicadas, a mesma leitura de GetScattering no shader
+static glm::vec3 GetScatteredRadiance(const AtmosphereModel& Model, float R, float Mu, float MuS, float Nu, bool IntersectsGround)
+{
+	const glm::vec4 Uvwz = GetScatteringTextureUvwzFromRMuMuSNu(Model, R, Mu, MuS, Nu, IntersectsGround);
+	const float TexCoordX = Uvwz.x * (ScatteringTextureNuSize - 1);
+	const float TexX = std::floor(TexCoordX);
+	const float Lerp = TexCoordX - TexX;
+	const glm::vec3 Uvw0{(TexX + Uvwz.y) / ScatteringTextureNuSize, Uvwz.z, Uvwz.w};
+	const glm::vec3 Uvw1{(TexX + 1.0f + Uvwz.y) / ScatteringTextureNuSize, Uvwz.z, Uvwz.w};
+	const glm::vec4 Combined = glm::mix(SampleScatteringTable(Model.Scattering, Uvw0), SampleScatteringTable(Model.Scattering, Uvw1), Lerp);
+
+	const AtmosphereParameters& Parameters = Model.Parameters;
+	glm::vec3 Mie{0.0f};
+	if (Combined.r > 0.0f)
+	{
+		Mie = glm::vec3{Combined} * (Combined.a / Combined.r) * (Parameters.RayleighScattering.r / Parameters.MieScattering.r) *
+			(Parameters.MieScattering / Parameters.RayleighScattering);
+	}
+	return glm::vec3{Combined} * RayleighPhaseFunction(Nu) + Mie * MiePhaseFunction(Parameters.MiePhaseG, Nu);
+}
+
+// Irradiancia indireta (so a luz do ceu) num plano horizontal: a radiancia da tabela
+// de espalhamento integrada no hemisferio de cima, ponderada pelo cosseno
+static glm::vec3 ComputeIndirectIrradiance(const AtmosphereModel& Model, int X, int Y)
+{
+	const AtmosphereParameters& Parameters = Model.Parameters;
+	const float XMuS = GetUnitRangeFromTextureCoord((X + 0.5f) / IrradianceTextureWidth, IrradianceTextureWidth);
+	const float XR = GetUnitRangeFromTextureCoord((Y + 0.5f) / IrradianceTextureHeight, IrradianceTextureHeight);
+	const float R = Parameters.BottomRadius + XR * (Parameters.TopRadius - Parameters.BottomRadius);
+	const float MuS = ClampCosine(2.0f * XMuS - 1.0f);
+	const glm::vec3 SunDirection{SafeSqrt(1.0f - MuS * MuS), 0.0f, MuS};
+
+	const float DPhi = glm::pi<float>() / IrradianceSampleCount;
+	const float DTheta = glm::pi<float>() / IrradianceSampleCount;
+	glm::vec3 Result{0.0f};
+	for (int ThetaStep = 0; ThetaStep < IrradianceSampleCount / 2; ++ThetaStep)
+	{
+		const float Theta = (ThetaStep + 0.5f) * DTheta;
+		for (int PhiStep = 0; PhiStep < 2 * IrradianceSampleCount; ++PhiStep)
+		{
+			const float Phi = (PhiStep + 0.5f) * DPhi;
+			const glm::vec3 Omega{std::cos(Phi) * std::sin(Theta), std::sin(Phi) * std::sin(Theta), std::cos(Theta)};
+			const float DOmega = DTheta * DPhi * std::sin(Theta);
+			const float Nu = glm::dot(Omega, SunDirection);
+			Result += GetScatteredRadiance(Model, R, Omega.z, MuS, Nu, false) * (Omega.z * DOmega);
+		}
+	}
+	return Result;
+}
+
+// Calcula as tabelas na ordem em que dependem umas das outras, cada uma com as
+// linhas divididas entre as threads
+static void PrecomputeTables(AtmosphereModel& Model)
+{
+	Model.Transmittance.resize(NumTransmittanceTexels);
+	JobSystem::Get().ParallelFor(0, TransmittanceTextureHeight, 1, [&Model](int RowBegin, int RowEnd)
+	{
+		for (int Y = RowBegin; Y < RowEnd; ++Y)
+		{
+			for (int X = 0; X < TransmittanceTextureWidth; ++X)
+			{
+				float R = 0.0f;
+				float Mu = 0.0f;
+				GetRMuFromTransmittanceTextureUv(Model, glm::vec2{(X + 0.5f) / TransmittanceTextureWidth, (Y + 0.5f) / TransmittanceTextureHeight}, R, Mu);
+				Model.Transmittance[std::size_t(Y) * TransmittanceTextureWidth + X] = ComputeTransmittanceToTopAtmosphereBoundary(Model, R, Mu);
+			}
+		}
+	});
+
+	Model.MultipleScattering.resize(std::size_t(MultipleScatteringTextureSize) * MultipleScatteringTextureSize);
+	JobSystem::Get().ParallelFor(0, MultipleScatteringTextureSize, 1, [&Model](int RowBegin, int RowEnd)
+	{
+		for (int Y = RowBegin; Y < RowEnd; ++Y)
+		{
+			for (int X = 0; X < MultipleScatteringTextureSize; ++X)
+			{
+				const float MuS = GetUnitRangeFromTextureCoord((X + 0.5f) / MultipleScatteringTextureSize, MultipleScatteringTextureSize) * 2.0f - 1.0f;
+				const float XR = GetUnitRangeFromTextureCoord((Y + 0.5f) / MultipleScatteringTextureSize, MultipleScatteringTextureSize);
+				const float R = Model.Parameters.BottomRadius + XR * (Model.Parameters.TopRadius - Model.Parameters.BottomRadius);
+				Model.MultipleScattering[std::size_t(Y) * MultipleScatteringTextureSize + X] = ComputeMultipleScattering(Model, R, MuS);
+			}
+		}
+	});
+
+	// Linhas da textura 3D com (mu, r) achatados
+	Model.Scattering.resize(NumScatteringTexels);
+	JobSystem::Get().ParallelFor(0, ScatteringTextureMuSize * ScatteringTextureRSize, 4, [&Model](int RowBegin, int RowEnd)
+	{
+		for (int Row = RowBegin; Row < RowEnd; ++Row)
+		{
+			ComputeScatteringRow(Model, Row % ScatteringTextureMuSize, Row / ScatteringTextureMuSize, Model.Scattering.data() + std::size_t(Row) * ScatteringTextureWidth);
+		}
+	});
+
+	Model.Irradiance.resize(NumIrradianceTexels);
+	JobSystem::Get().ParallelFor(0, IrradianceTextureHeight, 1, [&Model](int RowBegin, int RowEnd)
+	{
+		for (int Y = RowBegin; Y < RowEnd; ++Y)
+		{
+			for (int X = 0; X < IrradianceTextureWidth; ++X)
+			{
+				Model.Irradiance[std::size_t(Y) * IrradianceTextureWidth + X] = ComputeIndirectIrradiance(Model, X, Y);
+			}
+		}
+	});
+}
+
+static void AppendHalfTexels(const std::vector<glm::vec4>& Table, std::vector<std::uint64_t>& Output)
+{
+	for (const glm::vec4& Texel : Table)
+	{
+		Output.push_back(glm::packHalf4x16(Texel));
+	}
+}
+
+static void AppendHalfTexels(const std::vector<glm::vec3>& Table, std::vector<std::uint64_t>& Output)
+{
+	for (const glm::vec3& Texel : Table)
+	{
+		Output.push_back(glm::packHalf4x16(glm::vec4{Texel, 1.0f}));
+	}
+}
+
+static void CreateTable(GLuint& TextureId, GLenum Target, int Width, int Height, int Depth, const void* Pixels)
+{
+	glGenTextures(1, &TextureId);
+	glBindTexture(Target, TextureId);
+	if (Target == GL_TEXTURE_3D)
+	{
+		glTexImage3D(Target, 0, GL_RGBA16F, Width, Height, Depth, 0, GL_RGBA, GL_HALF_FLOAT, Pixels);
+		glTexParameteri(Target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	}
+	else
+	{
+		glTexImage2D(Target, 0, GL_RGBA16F, Width, Height, 0, GL_RGBA, GL_HALF_FLOAT, Pixels);
+	}
+	glTexParameteri(Target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(Target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(Target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(Target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(Target, 0);
+}
+
+bool Atmosphere::InitCached(const AtmosphereParameters& Parameters, const std::string& CacheFile, const glm::dvec3& EllipsoidRadii, float Exposure)
+{
+	Destroy();
+
+	const auto StartTime = std::chrono::steady_clock::now();
+	const std::uint64_t ParametersHash = HashParameters(Parameters);
+
+	// As tabelas do arquivo vao direto do mapeamento para as texturas
+	FileContents Contents;
+	const unsigned char* Texels = nullptr;
+	if (std::filesystem::exists(CacheFile))
+	{
+		Contents = ReadWholeFile(CacheFile);
+		AtmosphereCacheHeader Header;
+		if (Contents.IsValid() && Contents.Size() >= sizeof(Header))
+		{
+			std::memcpy(&Header, Contents.Data(), sizeof(Header));
+			if (std::memcmp(Header.Magic, AtmosphereCacheMagic, sizeof(Header.Magic)) != 0 || Header.Version != AtmosphereCacheVersion ||
+				Contents.Size() != AtmosphereCacheSize)
+			{
+				std::cerr << "Tabelas da atmosfera invalidas: " << CacheFile << std::endl;
+			}
+			else if (Header.ParametersHash == ParametersHash && Header.TransmittanceWidth == TransmittanceTextureWidth &&
+				Header.TransmittanceHeight == TransmittanceTextureHeight && Header.ScatteringWidth == ScatteringTextureWidth &&
+				Header.ScatteringHeight == ScatteringTextureMuSize && Header.ScatteringDepth == ScatteringTextureRSize &&
+				Header.IrradianceWidth == IrradianceTextureWidth && Header.IrradianceHeight == IrradianceTextureHeight)
+			{
+				Texels = Contents.Data() + sizeof(Header);
+			}
+		}
+	}
+
+	// Primeira execucao ou parametros trocados: calcular e gravar
+	std::vector<std::uint64_t> Computed;
+	CurrentStats.LoadedFromCache = Texels != nullptr;
+	if (Texels == nullptr)
+	{
+		std::cout << "Calculando as tabelas da atmosfera em " << CacheFile << std::endl;
+
+		AtmosphereModel Model;
+		Model.Parameters = Parameters;
+		Model.HorizonDistance = std::sqrt(Parameters.TopRadius * Parameters.TopRadius - Parameters.BottomRadius * Parameters.BottomRadius);
+		Model.MuSMin = std::cos(Parameters.MaxSunZenithAngle);
+		PrecomputeTables(Model);
+
+		Computed.reserve(NumTransmittanceTexels + NumScatteringTexels + NumIrradianceTexels);
+		AppendHalfTexels(Model.Transmittance, Computed);
+		AppendHalfTexels(Model.Scattering, Computed);
+		AppendHalfTexels(Model.Irradiance, Computed);
+		Texels = reinterpret_cast<const unsigned char*>(Computed.data());
+
+		// Gravar em um temporario e renomear, para outra instancia nunca ler um arquivo pela metade
+		AtmosphereCacheHeader Header{};
+		std::memcpy(Header.Magic, AtmosphereCacheMagic, sizeof(Header.Magic));
+		Header.Version = AtmosphereCacheVersion;
+		Header.ParametersHash = ParametersHash;
+		Header.TransmittanceWidth = TransmittanceTextureWidth;
+		Header.TransmittanceHeight = TransmittanceTextureHeight;
+		Header.ScatteringWidth = ScatteringTextureWidth;
+		Header.ScatteringHeight = ScatteringTextureMuSize;
+		Header.ScatteringDepth = ScatteringTextureRSize;
+		Header.IrradianceWidth = IrradianceTextureWidth;
+		Header.IrradianceHeight = IrradianceTextureHeight;
+
+		const std::string TemporaryFile = CacheFile + ".tmp";
+		bool Saved = false;
+		{
+			std::ofstream File{TemporaryFile, std::ios::binary | std::ios::trunc};
+			File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+			File.write(reinterpret_cast<const char*>(Computed.data()), Computed.size() * sizeof(std::uint64_t));
+			Saved = static_cast<bool>(File);
+		}
+		std::error_code Error;
+		if (Saved)
+		{
+			std::filesystem::rename(TemporaryFile, CacheFile, Error);
+			Saved = !Error;
+		}
+		if (!Saved)
+		{
+			std::filesystem::remove(TemporaryFile, Error);
+			std::cerr << "Falha ao gravar as tabelas da atmosfera: " << CacheFile << std::endl;
+		}
+	}
+
+	const unsigned char* ScatteringTexels = Texels + NumTransmittanceTexels * sizeof(std::uint64_t);
+	const unsigned char* IrradianceTexels = ScatteringTexels + NumScatteringTexels * sizeof(std::uint64_t);
+	CreateTable(TransmittanceTexture, GL_TEXTURE_2D, TransmittanceTextureWidth, TransmittanceTextureHeight, 1, Texels);
+	CreateTable(ScatteringTexture, GL_TEXTURE_3D, ScatteringTextureWidth, ScatteringTextureMuSize, ScatteringTextureRSize, ScatteringTexels);
+	CreateTable(IrradianceTexture, GL_TEXTURE_2D, IrradianceTextureWidth, IrradianceTextureHeight, 1, IrradianceTexels);
+
+	// O modelo e uma esfera: cada eixo do elipsoide e escalado para o raio do chao
+	AtmosphereUniforms Uniforms{};
+	Uniforms.RayleighScattering = glm::vec4{Parameters.RayleighScattering, Parameters.MiePhaseG};
+	Uniforms.MieScattering = glm::vec4{Parameters.MieScattering, Parameters.SunAngularRadius};
+	Uniforms.SolarIrradiance = glm::vec4{Parameters.SolarIrradiance, Exposure};
+	Uniforms.ModelScale = glm::vec4{glm::vec3{double(Parameters.BottomRadius) / EllipsoidRadii}, 0.0f};
+	Uniforms.ScatteringSize = glm::ivec4{ScatteringTextureNuSize, ScatteringTextureMuSSize, ScatteringTextureMuSize, ScatteringTextureRSize};
+	Uniforms.BottomRadius = Parameters.BottomRadius;
+	Uniforms.TopRadius = Parameters.TopRadius;
+	Uniforms.MuSMin = std::cos(Parameters.MaxSunZenithAngle);
+
+	glGenBuffers(1, &UniformBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, UniformBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(Uniforms), &Uniforms, GL_STATIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+	CurrentStats.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+	return true;
+}
+
+void Atmosphere::Destroy()
+{
+	glDeleteTextures(1, &TransmittanceTexture);
+	glDeleteTextures(1, &ScatteringTexture);
+	glDeleteTextures(1, &IrradianceTexture);
+	glDeleteBuffers(1, &UniformBuffer);
+	TransmittanceTexture = 0;
+	ScatteringTexture = 0;
+	IrradianceTexture = 0;
+	UniformBuffer = 0;
+}
+
+void Atmosphere::Bind(GLuint ProgramId) const
+{
+	glBindBufferBase(GL_UNIFORM_BUFFER, AtmosphereBlockBinding, UniformBuffer);
+
+	glActiveTexture(GL_TEXTURE0 + AtmosphereFirstTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, TransmittanceTexture);
+	glActiveTexture(GL_TEXTURE0 + AtmosphereFirstTextureUnit + 1);
+	glBindTexture(GL_TEXTURE_3D, ScatteringTexture);
+	glActiveTexture(GL_TEXTURE0 + AtmosphereFirstTextureUnit + 2);
+	glBindTexture(GL_TEXTURE_2D, IrradianceTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUniform1i(glGetUniformLocation(ProgramId, "TransmittanceSampler"), AtmosphereFirstTextureUnit);
+	glUniform1i(glGetUniformLocation(ProgramId, "ScatteringSampler"), AtmosphereFirstTextureUnit + 1);
+	glUniform1i(glGetUniformLocation(ProgramId, "IrradianceSampler"), AtmosphereFirstTextureUnit + 2);
+}
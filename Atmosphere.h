@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Atmosfera de espalhamento fisico no modelo de Bruneton e Neyret (2008), na forma da
+// implementacao de referencia de 2017: transmitancia, espalhamento (4D guardado em
+// uma textura 3D) e irradiancia pre-calculados em tabelas. Os shaders so fazem
+// algumas leituras dessas texturas, ver shaders/include/atmosphere.glsl.
+// Distancias em km; o planeta do modelo e uma esfera de raio BottomRadius, e os
+// shaders escalam o elipsoide do globo para ela
+struct AtmosphereParameters
+{
+	float BottomRadius = 6360.0f;
+	float TopRadius = 6420.0f;
+
+	// Irradiancia do sol no topo da atmosfera. Unitaria: o brilho final e
+	// ajustado pela exposicao no shader
+	glm::vec3 SolarIrradiance{1.0f};
+	float SunAngularRadius = 0.004675f;
+
+	// Moleculas (Rayleigh), em 1/km ao nivel do solo, com densidade exponencial
+	glm::vec3 RayleighScattering{5.802e-3f, 13.558e-3f, 33.1e-3f};
+	float RayleighScaleHeight = 8.0f;
+
+	// Aerossois (Mie)
+	glm::vec3 MieScattering{3.996e-3f};
+	glm::vec3 MieExtinction{4.440e-3f};
+	float MieScaleHeight = 1.2f;
+	float MiePhaseG = 0.8f;
+
+	// Camada de ozonio: so absorve, com densidade em tenda de 10 a 40 km
+	glm::vec3 OzoneAbsorption{0.650e-3f, 1.881e-3f, 0.085e-3f};
+	float OzoneCenterAltitude = 25.0f;
+	float OzoneHalfWidth = 15.0f;
+
+	float GroundAlbedo = 0.1f;
+
+	// Maior angulo zenital do sol guardado nas tabelas; abaixo disso o ceu ja esta
+	// escuro. 102 graus cabem na precisao das texturas em meio float
+	float MaxSunZenithAngle = glm::radians(102.0f);
+};
+
+// Tamanho das tabelas. O espalhamento e indexado por (r, mu, mu_s, nu) e os eixos nu
+// e mu_s dividem a largura da textura 3D
+constexpr int TransmittanceTextureWidth = 256;
+constexpr int TransmittanceTextureHeight = 64;
+constexpr int ScatteringTextureRSize = 32;
+constexpr int ScatteringTextureMuSize = 128;
+constexpr int ScatteringTextureMuSSize = 32;
+constexpr int ScatteringTextureNuSize = 8;
+constexpr int IrradianceTextureWidth = 64;
+constexpr int IrradianceTextureHeight = 16;
+
+// Primeira unidade de textura das tabelas; as duas primeiras sao das imagens do globo
+constexpr GLuint AtmosphereFirstTextureUnit = 2;
+
+// Bloco "AtmosphereBlock" (std140), fixo enquanto a atmosfera existir. Ligado em
+// AtmosphereBlockBinding (UniformBuffers.h)
+struct AtmosphereUniforms
+{
+	glm::vec4 RayleighScattering;   // w = MiePhaseG
+	glm::vec4 MieScattering;        // w = SunAngularRadius
+	glm::vec4 SolarIrradiance;      // w = Exposure
+	glm::vec4 ModelScale;           // km do modelo por metro do mundo, por eixo
+	glm::ivec4 ScatteringSize;      // Nu, MuS, Mu, R
+	float BottomRadius;
+	float TopRadius;
+	float MuSMin;
+	float Padding;
+};
+
+class Atmosphere
+{
+public:
+	struct Stats
+	{
+		bool LoadedFromCache = false;
+		double Seconds = 0.0;   // Calculo das tabelas ou leitura do arquivo
+	};
+
+	// Le as tabelas de CacheFile ou, se o arquivo nao existir ou for de outros
+	// parametros, as calcula na CPU dividindo as linhas entre as threads do JobSystem
+	// e grava o arquivo para as proximas execucoes. Cria as texturas e o bloco
+	// uniforme, entao precisa do contexto OpenGL. EllipsoidRadii em metros
+	bool InitCached(const AtmosphereParameters& Parameters, const std::string& CacheFile, const glm::dvec3& EllipsoidRadii, float Exposure);
+	void Destroy();
+
+	// Liga as tres texturas a partir de AtmosphereFirstTextureUnit e aponta os
+	// samplers do programa para elas
+	void Bind(GLuint ProgramId) const;
+
+	bool IsValid() const { return ScatteringTexture != 0; }
+	Stats GetStats() const { return CurrentStats; }
+
+private:
+	GLuint TransmittanceTexture = 0;
+	GLuint ScatteringTexture = 0;
+	GLuint IrradianceTexture = 0;
+	GLuint UniformBuffer = 0;
+	Stats CurrentStats;
+};
@@ -0,0 +1,51 @@
+#include "Camera.h"
+
+#include <algorithm>
+
+#include <glm/ext.hpp>
+
+void Camera::FitClipPlanes(double DistanceToSurface, double SceneRadius)
+{
+	// O near acompanha a altitude; o far alcanca o horizonte do outro lado da cena
+	Near = std::max(0.1, DistanceToSurface * 0.01);
+	Far = DistanceToSurface + 2.0 * SceneRadius;
+}
+
+glm::mat4 Camera::GetViewRotation() const
+{
+	const glm::dvec3 Forward = Target - Position;
+	return glm::mat4{glm::lookAt(glm::dvec3{0.0}, Forward, Up)};
+}
+
+glm::mat4 Camera::GetProjection() const
+{
+	return glm::mat4{glm::perspective(FieldOfView, AspectRatio, Near, Far)};
+}
+
+glm::mat4 Camera::GetViewProjection() const
+{
+	return GetProjection() * GetViewRotation();
+}
+
+glm::dmat4 Camera::GetViewProjectionPrecise() const
+{
+	return glm::perspective(FieldOfView, AspectRatio, Near, Far) * glm::lookAt(glm::dvec3{0.0}, Target - Position, Up);
+}
+
+glm::vec3 Camera::ToEyeRelative(const glm::dvec3& WorldPosition) const
+{
+	return glm::vec3{WorldPosition - Position};
+}
+
+glm::mat4 Camera::GetModelRTE(const glm::dmat4& Model) const
+{
+	glm::dmat4 Result = Model;
+	Result[3] = glm::dvec4{glm::dvec3{Model[3]} - Position, 1.0};
+	return glm::mat4{Result};
+}
+
+void SplitDouble(const glm::dvec3& Value, glm::vec3& High, glm::vec3& Low)
+{
+	High = glm::vec3{Value};
+	Low = glm::vec3{Value - glm::dvec3{High}};
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Camera em precisao dupla. Posicoes do olho e dos objetos ficam em glm::dvec3 e
+// a translacao entre eles e calculada na CPU em double (relative-to-eye, RTE);
+// a GPU so recebe matrizes sem translacao e offsets pequenos em float, entao a
+// precisao nao depende da distancia ate a origem (6.371e6 m para a Terra)
+class Camera
+{
+public:
+	glm::dvec3 Position{0.0, 0.0, 5.0};
+	glm::dvec3 Target{0.0, 0.0, 0.0};
+	glm::dvec3 Up{0.0, 1.0, 0.0};
+
+	double FieldOfView = glm::radians(45.0);
+	double AspectRatio = 4.0 / 3.0;
+	double Near = 0.001;
+	double Far = 1000.0;
+
+	// Ajusta near/far a distancia ate a superficie para manter a precisao do depth buffer
+	void FitClipPlanes(double DistanceToSurface, double SceneRadius);
+
+	// Vista somente com a rotacao (olho na origem)
+	glm::mat4 GetViewRotation() const;
+	glm::mat4 GetProjection() const;
+	glm::mat4 GetViewProjection() const;
+
+	// GetViewProjection em double, para desprojetar o cursor sem perder precisao
+	glm::dmat4 GetViewProjectionPrecise() const;
+
+	// Posicao relativa ao olho, subtraida em double e so depois convertida para float
+	glm::vec3 ToEyeRelative(const glm::dvec3& WorldPosition) const;
+
+	// Matriz de modelo relativa ao olho: a translacao do modelo menos o olho, em double
+	glm::mat4 GetModelRTE(const glm::dmat4& Model) const;
+};
+
+// Divide um valor em double em dois floats (High + Low ~= Value) para os shaders
+// que precisam emular a subtracao em precisao dupla: (P.High - Eye.High) + (P.Low - Eye.Low)
+void SplitDouble(const glm::dvec3& Value, glm::vec3& High, glm::vec3& Low);
@@ -0,0 +1,146 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <stb_perlin.h>
+
+#include "JobSystem.h"
+#include "CloudNoise.h"
+
+const int DefaultNumPoints = 1000000;
+const int NumRepetitions = 3;
+
+// Pontos conferidos contra o stb_perlin, espalhados pelo array
+const int NumCheckedPoints = 100000;
+
+// Campo completo e tile com os tamanhos padrao de CloudSettings
+const int FieldWidth = 4096;
+const int FieldHeight = 2048;
+const int TileSize = 128;
+
+// Menor tempo entre algumas repeticoes, em segundos
+double Measure(const std::function<void()>& Work)
+{
+	double Best = 1e30;
+	for (int Repetition = 0; Repetition < NumRepetitions; ++Repetition)
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		Work();
+		const auto End = std::chrono::steady_clock::now();
+		Best = std::min(Best, std::chrono::duration<double>(End - Start).count());
+	}
+	return Best;
+}
+
+void PrintHeader(const std::string& Title)
+{
+	std::cout << std::endl;
+	std::cout << "==================" << std::endl;
+	std::cout << Title << std::endl;
+	std::cout << "==================" << std::endl;
+}
+
+struct Operation
+{
+	std::string Name;
+	NoiseOctaves Octaves;
+	std::function<void(const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count)> Run;
+	std::function<float(float X, float Y, float Z)> Reference;
+};
+
+int main(int argc, char* argv[])
+{
+	const std::size_t NumPoints = argc > 1 ? std::size_t(std::atoll(argv[1])) : DefaultNumPoints;
+
+	JobSystem::Get().Init();
+	const CloudFieldSettings Field;
+
+	// Pontos no cubo que as oitavas das nuvens percorrem, incluindo coordenadas
+	// negativas e acima da repeticao de 256 celulas das tabelas
+	std::mt19937 Random{42};
+	std::uniform_real_distribution<float> Uniform{-300.0f, 300.0f};
+	std::vector<float> X(NumPoints), Y(NumPoints), Z(NumPoints), Noise(NumPoints);
+	for (std::size_t Index = 0; Index < NumPoints; ++Index)
+	{
+		X[Index] = Uniform(Random);
+		Y[Index] = Uniform(Random);
+		Z[Index] = Uniform(Random);
+	}
+
+	const std::vector<Operation> Operations = {
+		{"fBm", Field.Shape,
+			[&](const float* PX, const float* PY, const float* PZ, float* Out, std::size_t Count) { FbmNoiseBatch(PX, PY, PZ, Out, Count, Field.Shape); },
+			[&](float PX, float PY, float PZ) { return stb_perlin_fbm_noise3(PX, PY, PZ, Field.Shape.Lacunarity, Field.Shape.Gain, Field.Shape.Count); }},
+		{"turbulencia", Field.Detail,
+			[&](const float* PX, const float* PY, const float* PZ, float* Out, std::size_t Count) { TurbulenceNoiseBatch(PX, PY, PZ, Out, Count, Field.Detail); },
+			[&](float PX, float PY, float PZ) { return stb_perlin_turbulence_noise3(PX, PY, PZ, Field.Detail.Lacunarity, Field.Detail.Gain, Field.Detail.Count); }},
+	};
+
+	PrintHeader("Ruido do stb_perlin em lote com " + std::to_string(NumPoints) + " pontos (1 thread)");
+	std::cout << std::setw(14) << "ruido" << std::setw(10) << "oitavas" << std::setw(10) << "backend"
+		<< std::setw(12) << "Mpontos/s" << std::setw(14) << "ns/oitava" << std::setw(14) << "erro max" << std::endl;
+
+	for (const Operation& Current : Operations)
+	{
+		for (CloudNoiseBackend Backend : {CloudNoiseBackend::Scalar, CloudNoiseBackend::AVX2})
+		{
+			if (!SetCloudNoiseBackend(Backend))
+			{
+				continue;
+			}
+			const double Seconds = Measure([&] { Current.Run(X.data(), Y.data(), Z.data(), Noise.data(), NumPoints); });
+
+			float MaxError = 0.0f;
+			const std::size_t Stride = std::max<std::size_t>(1, NumPoints / NumCheckedPoints);
+			for (std::size_t Index = 0; Index < NumPoints; Index += Stride)
+			{
+				MaxError = std::max(MaxError, std::abs(Noise[Index] - Current.Reference(X[Index], Y[Index], Z[Index])));
+			}
+
+			std::cout << std::setw(14) << Current.Name << std::setw(10) << Current.Octaves.Count << std::setw(10) << GetCloudNoiseBackendName(Backend)
+				<< std::setw(12) << std::fixed << std::setprecision(1) << NumPoints / Seconds * 1e-6
+				<< std::setw(14) << std::setprecision(2) << Seconds * 1e9 / (double(NumPoints) * Current.Octaves.Count)
+				<< std::setw(14) << std::scientific << std::setprecision(2) << MaxError << std::endl;
+		}
+	}
+
+	// Custo real das nuvens: um tile como os calculados durante a animacao e o campo
+	// inteiro, dividido entre as threads como no inicio do programa
+	PrintHeader("Campo de nuvens " + std::to_string(FieldWidth) + "x" + std::to_string(FieldHeight) + " (" +
+		std::to_string(JobSystem::Get().GetNumThreads()) + " threads)");
+	std::cout << std::setw(10) << "backend" << std::setw(14) << "tile ms" << std::setw(14) << "campo ms" << std::endl;
+
+	std::vector<std::uint8_t> Pixels(std::size_t(FieldWidth) * FieldHeight);
+	for (CloudNoiseBackend Backend : {CloudNoiseBackend::Scalar, CloudNoiseBackend::AVX2})
+	{
+		if (!SetCloudNoiseBackend(Backend))
+		{
+			continue;
+		}
+		const double TileSeconds = Measure([&]
+		{
+			GenerateCloudCoverage(Field, 0.0, FieldWidth, FieldHeight, 0, 0, TileSize, TileSize, Pixels.data(), FieldWidth);
+		});
+		const double FieldSeconds = Measure([&]
+		{
+			JobSystem::Get().ParallelFor(0, FieldHeight, 16, [&](int SliceBegin, int SliceEnd)
+			{
+				GenerateCloudCoverage(Field, 0.0, FieldWidth, FieldHeight, 0, SliceBegin, FieldWidth, SliceEnd - SliceBegin,
+					Pixels.data() + std::size_t(SliceBegin) * FieldWidth, FieldWidth);
+			});
+		});
+		std::cout << std::setw(10) << GetCloudNoiseBackendName(Backend) << std::fixed << std::setprecision(2)
+			<< std::setw(14) << TileSeconds * 1000.0 << std::setw(14) << FieldSeconds * 1000.0 << std::endl;
+	}
+
+	JobSystem::Get().Shutdown();
+
+	return 0;
+}
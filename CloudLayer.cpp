@@ -0,0 +1,226 @@
+#include "CloudLayer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+#include "TextureManager.h"
+
+namespace
+{
+	// Fracao do intervalo entre campos em que o proximo deve ficar pronto. A folga
+	// absorve frames lentos e os tiles que ainda estao na fila
+	constexpr double BuildFraction = 0.75;
+
+	// Linhas por fatia no calculo dos dois primeiros campos
+	constexpr int InitRowsPerSlice = 16;
+}
+
+bool CloudLayer::Init(const CloudSettings& NewSettings)
+{
+	const auto Start = std::chrono::steady_clock::now();
+
+	Settings = NewSettings;
+	TilesX = (Settings.Width + Settings.TileSize - 1) / Settings.TileSize;
+	TilesY = (Settings.Height + Settings.TileSize - 1) / Settings.TileSize;
+	NumTiles = TilesX * TilesY;
+	Time = 0.0;
+	Keyframe = 0;
+	NumScheduledTiles = 0;
+	NumTakenTiles = 0;
+
+	glGenTextures(3, Textures);
+	for (GLuint Texture : Textures)
+	{
+		glBindTexture(GL_TEXTURE_2D, Texture);
+		glTexStorage2D(GL_TEXTURE_2D, CountMipLevels(Settings.Width, Settings.Height), GL_R8, Settings.Width, Settings.Height);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		// O deslocamento para leste passa da longitude 180 e volta pela -180
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	// Os campos 0 e 1 aparecem desde o primeiro frame, entao nao da para espalha-los
+	std::vector<std::uint8_t> Pixels(std::size_t(Settings.Width) * Settings.Height);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (int InitialKeyframe = 0; InitialKeyframe < 2; ++InitialKeyframe)
+	{
+		JobSystem::Get().ParallelFor(0, Settings.Height, InitRowsPerSlice, [&](int SliceBegin, int SliceEnd)
+		{
+			GenerateCloudCoverage(Settings.Field, InitialKeyframe * Settings.KeyframeSeconds, Settings.Width, Settings.Height,
+				0, SliceBegin, Settings.Width, SliceEnd - SliceBegin, Pixels.data() + std::size_t(SliceBegin) * Settings.Width, Settings.Width);
+		});
+		glBindTexture(GL_TEXTURE_2D, Textures[InitialKeyframe]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, Settings.Width, Settings.Height, GL_RED, GL_UNSIGNED_BYTE, Pixels.data());
+		glGenerateMipmap(GL_TEXTURE_2D);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	CurrentStats = Stats{};
+	TileSeconds = 0.0;
+	NumBuiltTiles = 0;
+	CurrentStats.InitSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	return true;
+}
+
+void CloudLayer::Destroy()
+{
+	JobSystem::Get().Wait(TileJobs);
+	PendingUploads.clear();
+	FinishedTiles.clear();
+
+	glDeleteTextures(3, Textures);
+	for (GLuint& Texture : Textures)
+	{
+		Texture = 0;
+	}
+}
+
+void CloudLayer::Update(double DeltaTime)
+{
+	if (!IsValid())
+	{
+		return;
+	}
+
+	// Tiles terminados pelos jobs. Quando o ultimo chega, o envio dele gera os mipmaps
+	{
+		std::lock_guard<std::mutex> Lock{FinishedMutex};
+		for (TileUpload& Tile : FinishedTiles)
+		{
+			PendingUploads.push_back(std::move(Tile));
+			if (++NumTakenTiles == NumTiles)
+			{
+				PendingUploads.back().CompletesKeyframe = true;
+			}
+		}
+		FinishedTiles.clear();
+	}
+
+	// Passar para o proximo intervalo so quando o campo k + 2 estiver todo a caminho
+	// da GPU. Os envios vao no buffer de comandos antes dos desenhos que o usam
+	const double Period = Settings.KeyframeSeconds;
+	double NextTime = Time + DeltaTime;
+	if (NextTime >= (Keyframe + 1) * Period)
+	{
+		if (NumTakenTiles == NumTiles)
+		{
+			++Keyframe;
+			NumScheduledTiles = 0;
+			NumTakenTiles = 0;
+			++CurrentStats.NumKeyframes;
+		}
+		else
+		{
+			++CurrentStats.NumStalledFrames;
+		}
+	}
+	Time = std::min(NextTime, (Keyframe + 1) * Period);
+
+	// Tiles comecados em proporcao ao tempo passado no intervalo, para terminar em
+	// BuildFraction dele sem concentrar o trabalho em poucos frames
+	const double Progress = (Time - Keyframe * Period) / Period;
+	const int TargetTiles = std::min(NumTiles, static_cast<int>(NumTiles * Progress / BuildFraction) + 1);
+	const int NumToStart = std::min(TargetTiles - NumScheduledTiles, Settings.MaxTilesPerFrame);
+
+	// Sem threads de trabalho os jobs so rodariam na proxima espera da thread
+	// principal, entao os tiles sao calculados aqui mesmo, como no AsyncIO
+	const bool RunInline = JobSystem::Get().GetNumThreads() <= 1;
+	const int BuildKeyframe = Keyframe + 2;
+	for (int Count = 0; Count < NumToStart; ++Count)
+	{
+		const int TileIndex = NumScheduledTiles++;
+		if (RunInline)
+		{
+			BuildTile(BuildKeyframe, TileIndex);
+		}
+		else
+		{
+			JobSystem::Get().Run(TileJobs, [this, BuildKeyframe, TileIndex] { BuildTile(BuildKeyframe, TileIndex); });
+		}
+	}
+}
+
+std::vector<CloudLayer::TileUpload> CloudLayer::TakeTileUploads()
+{
+	std::vector<TileUpload> Uploads;
+	Uploads.swap(PendingUploads);
+	return Uploads;
+}
+
+CloudDrawState CloudLayer::GetDrawState() const
+{
+	const double Period = Settings.KeyframeSeconds;
+	CloudDrawState State;
+	State.Current = Keyframe % 3;
+	State.Next = (Keyframe + 1) % 3;
+	State.Blend = static_cast<float>((Time - Keyframe * Period) / Period);
+	State.Drift = static_cast<float>(std::fmod(Time * Settings.DriftSpeed, 1.0));
+	return State;
+}
+
+void CloudLayer::UploadTiles(const std::vector<TileUpload>& Uploads)
+{
+	if (Uploads.empty())
+	{
+		return;
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (const TileUpload& Upload : Uploads)
+	{
+		glBindTexture(GL_TEXTURE_2D, Textures[Upload.Texture]);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, Upload.X, Upload.Y, Upload.Width, Upload.Height, GL_RED, GL_UNSIGNED_BYTE, Upload.Pixels.data());
+		if (Upload.CompletesKeyframe)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void CloudLayer::Bind(GLuint ProgramId, const CloudDrawState& State) const
+{
+	glActiveTexture(GL_TEXTURE0 + CloudFirstTextureUnit);
+	glBindTexture(GL_TEXTURE_2D, Textures[State.Current]);
+	glActiveTexture(GL_TEXTURE0 + CloudFirstTextureUnit + 1);
+	glBindTexture(GL_TEXTURE_2D, Textures[State.Next]);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUniform1i(glGetUniformLocation(ProgramId, "CloudSampler0"), CloudFirstTextureUnit);
+	glUniform1i(glGetUniformLocation(ProgramId, "CloudSampler1"), CloudFirstTextureUnit + 1);
+	glUniform1f(glGetUniformLocation(ProgramId, "CloudBlend"), State.Blend);
+	glUniform1f(glGetUniformLocation(ProgramId, "CloudDrift"), State.Drift);
+}
+
+CloudLayer::Stats CloudLayer::GetStats() const
+{
+	std::lock_guard<std::mutex> Lock{FinishedMutex};
+	Stats Result = CurrentStats;
+	Result.NumTiles = NumBuiltTiles;
+	Result.TileMilliseconds = NumBuiltTiles > 0 ? TileSeconds * 1000.0 / NumBuiltTiles : 0.0;
+	return Result;
+}
+
+void CloudLayer::BuildTile(int BuildKeyframe, int TileIndex)
+{
+	const auto Start = std::chrono::steady_clock::now();
+
+	TileUpload Tile;
+	Tile.Texture = BuildKeyframe % 3;
+	Tile.X = (TileIndex % TilesX) * Settings.TileSize;
+	Tile.Y = (TileIndex / TilesX) * Settings.TileSize;
+	Tile.Width = std::min(Settings.TileSize, Settings.Width - Tile.X);
+	Tile.Height = std::min(Settings.TileSize, Settings.Height - Tile.Y);
+	Tile.Pixels.resize(std::size_t(Tile.Width) * Tile.Height);
+	GenerateCloudCoverage(Settings.Field, BuildKeyframe * Settings.KeyframeSeconds, Settings.Width, Settings.Height,
+		Tile.X, Tile.Y, Tile.Width, Tile.Height, Tile.Pixels.data(), Tile.Width);
+
+	const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	std::lock_guard<std::mutex> Lock{FinishedMutex};
+	FinishedTiles.push_back(std::move(Tile));
+	TileSeconds += Seconds;
+	++NumBuiltTiles;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "CloudNoise.h"
+#include "JobSystem.h"
+
+// Unidades de textura dos dois campos de nuvens, depois das tabelas da atmosfera
+constexpr GLuint CloudFirstTextureUnit = 5;
+
+struct CloudSettings
+{
+	// Textura equiretangular de cobertura, com um canal, e o tamanho dos tiles em que
+	// ela e recalculada
+	int Width = 4096;
+	int Height = 2048;
+	int TileSize = 128;
+
+	// Segundos entre dois campos completos; o shader interpola entre eles. Intervalos
+	// menores mudam as nuvens mais depressa e gastam mais CPU
+	double KeyframeSeconds = 8.0;
+
+	// Tiles comecados por frame, no maximo. Se o proximo campo nao ficar pronto a
+	// tempo a animacao espera por ele
+	int MaxTilesPerFrame = 4;
+
+	// Deslocamento das nuvens para leste, em voltas por segundo, feito no shader
+	float DriftSpeed = 1.0f / 900.0f;
+
+	CloudFieldSettings Field;
+};
+
+// O que o shader do globo precisa em um frame: os dois campos entre os quais ele
+// interpola. Copiado para o comando do frame
+struct CloudDrawState
+{
+	int Current = 0;
+	int Next = 1;
+	float Blend = 0.0f;
+	float Drift = 0.0f;     // Deslocamento em u
+};
+
+// Nuvens animadas em um anel de tres texturas R8. O shader do globo mistura os campos
+// k e k + 1 enquanto o campo k + 2 e calculado em tiles nas threads do JobSystem,
+// espalhados pelo intervalo entre os dois, e enviado tile a tile com glTexSubImage2D.
+// Update, TakeTileUploads e GetDrawState rodam na thread principal; UploadTiles e
+// Bind na thread dona do contexto
+class CloudLayer
+{
+public:
+	struct TileUpload
+	{
+		int Texture = 0;        // Indice no anel
+		int X = 0;
+		int Y = 0;
+		int Width = 0;
+		int Height = 0;
+		std::vector<std::uint8_t> Pixels;
+		bool CompletesKeyframe = false;     // Ultimo tile do campo: gerar os mipmaps
+	};
+
+	struct Stats
+	{
+		double InitSeconds = 0.0;           // Dois primeiros campos, calculados no Init
+		int NumKeyframes = 0;               // Campos calculados em tiles desde entao
+		int NumTiles = 0;
+		double TileMilliseconds = 0.0;      // Media por tile
+		int NumStalledFrames = 0;           // Frames em que a animacao esperou o proximo campo
+	};
+
+	// Cria as texturas e calcula os dois primeiros campos na hora, dividindo as linhas
+	// entre as threads. Precisa do contexto OpenGL
+	bool Init(const CloudSettings& NewSettings);
+
+	// Espera os tiles em andamento e apaga as texturas
+	void Destroy();
+
+	// Avanca o relogio das nuvens e comeca os tiles que o proximo campo precisa neste
+	// frame para ficar pronto a tempo
+	void Update(double DeltaTime);
+
+	// Tiles terminados desde a ultima chamada, na ordem em que devem ser enviados
+	std::vector<TileUpload> TakeTileUploads();
+
+	CloudDrawState GetDrawState() const;
+
+	void UploadTiles(const std::vector<TileUpload>& Uploads);
+
+	// Liga os dois campos a partir de CloudFirstTextureUnit e envia a mistura
+	void Bind(GLuint ProgramId, const CloudDrawState& State) const;
+
+	bool IsValid() const { return Textures[0] != 0; }
+	Stats GetStats() const;
+
+private:
+	void BuildTile(int BuildKeyframe, int TileIndex);
+
+	CloudSettings Settings;
+	GLuint Textures[3] = {};
+	int TilesX = 0;
+	int TilesY = 0;
+	int NumTiles = 0;
+
+	// Estado da thread principal
+	double Time = 0.0;
+	int Keyframe = 0;           // Campo atual; o k + 2 esta sendo calculado
+	int NumScheduledTiles = 0;
+	int NumTakenTiles = 0;
+	std::vector<TileUpload> PendingUploads;
+	JobCounter TileJobs;
+
+	// Tiles terminados pelos jobs
+	mutable std::mutex FinishedMutex;
+	std::vector<TileUpload> FinishedTiles;
+	double TileSeconds = 0.0;
+	int NumBuiltTiles = 0;
+
+	Stats CurrentStats;
+};
@@ -0,0 +1,172 @@
+#include "CloudNoise.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#define STB_PERLIN_IMPLEMENTATION
+#include <stb_perlin.h>
+
+#include "CpuFeatures.h"
+
+namespace
+{
+	constexpr double Pi = 3.14159265358979323846;
+
+	// Eixo (normalizado) ao longo do qual o dominio do ruido desliza com o tempo.
+	// Inclinado para que nenhuma regiao do globo veja so um deslocamento lateral
+	constexpr double EvolutionAxis[3] = {0.62, 0.47, 0.63};
+
+	// Deslocamento fixo do ruido dos detalhes, para nao coincidir com a forma na origem
+	constexpr float DetailOffset = 37.5f;
+
+	std::atomic<const CloudNoiseKernels*> ActiveKernels{nullptr};
+
+	const PerlinTables& GetPerlinTables()
+	{
+		static const PerlinTables Tables = []
+		{
+			PerlinTables Result;
+			for (int Index = 0; Index < 512; ++Index)
+			{
+				Result.Permutation[Index] = stb__perlin_randtab[Index];
+				Result.GradientIndex[Index] = stb__perlin_randtab_grad_idx[Index];
+			}
+			return Result;
+		}();
+		return Tables;
+	}
+
+	const CloudNoiseKernels& GetActiveKernels()
+	{
+		const CloudNoiseKernels* Kernels = ActiveKernels.load(std::memory_order_acquire);
+		if (!Kernels)
+		{
+			Kernels = IsCloudNoiseBackendSupported(CloudNoiseBackend::AVX2) ? GetAVX2CloudNoiseKernels() : &GetScalarCloudNoiseKernels();
+			ActiveKernels.store(Kernels, std::memory_order_release);
+		}
+		return *Kernels;
+	}
+
+	void ScalarFbmNoise(const PerlinTables&, const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count,
+		float Lacunarity, float Gain, int Octaves)
+	{
+		for (std::size_t Index = 0; Index < Count; ++Index)
+		{
+			Noise[Index] = stb_perlin_fbm_noise3(X[Index], Y[Index], Z[Index], Lacunarity, Gain, Octaves);
+		}
+	}
+
+	void ScalarTurbulenceNoise(const PerlinTables&, const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count,
+		float Lacunarity, float Gain, int Octaves)
+	{
+		for (std::size_t Index = 0; Index < Count; ++Index)
+		{
+			Noise[Index] = stb_perlin_turbulence_noise3(X[Index], Y[Index], Z[Index], Lacunarity, Gain, Octaves);
+		}
+	}
+}
+
+const CloudNoiseKernels& GetScalarCloudNoiseKernels()
+{
+	static const CloudNoiseKernels Kernels{
+		ScalarFbmNoise,
+		ScalarTurbulenceNoise,
+	};
+	return Kernels;
+}
+
+void FbmNoiseBatch(const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count, const NoiseOctaves& Octaves)
+{
+	GetActiveKernels().FbmNoise(GetPerlinTables(), X, Y, Z, Noise, Count, Octaves.Lacunarity, Octaves.Gain, Octaves.Count);
+}
+
+void TurbulenceNoiseBatch(const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count, const NoiseOctaves& Octaves)
+{
+	GetActiveKernels().TurbulenceNoise(GetPerlinTables(), X, Y, Z, Noise, Count, Octaves.Lacunarity, Octaves.Gain, Octaves.Count);
+}
+
+bool IsCloudNoiseBackendSupported(CloudNoiseBackend Backend)
+{
+	if (Backend == CloudNoiseBackend::AVX2)
+	{
+		return GetAVX2CloudNoiseKernels() != nullptr && CpuSupportsAVX2();
+	}
+	return true;
+}
+
+bool SetCloudNoiseBackend(CloudNoiseBackend Backend)
+{
+	if (!IsCloudNoiseBackendSupported(Backend))
+	{
+		return false;
+	}
+	ActiveKernels.store(Backend == CloudNoiseBackend::AVX2 ? GetAVX2CloudNoiseKernels() : &GetScalarCloudNoiseKernels(), std::memory_order_release);
+	return true;
+}
+
+CloudNoiseBackend GetCloudNoiseBackend()
+{
+	return &GetActiveKernels() == &GetScalarCloudNoiseKernels() ? CloudNoiseBackend::Scalar : CloudNoiseBackend::AVX2;
+}
+
+const char* GetCloudNoiseBackendName(CloudNoiseBackend Backend)
+{
+	return Backend == CloudNoiseBackend::AVX2 ? "AVX2" : "escalar";
+}
+
+void GenerateCloudCoverage(const CloudFieldSettings& Settings, double Time, int ImageWidth, int ImageHeight,
+	int X, int Y, int Width, int Height, std::uint8_t* Pixels, std::size_t RowPitch)
+{
+	// Cosseno e seno da longitude de cada coluna, iguais em todas as linhas
+	std::vector<float> CosLongitude(Width);
+	std::vector<float> SinLongitude(Width);
+	for (int Column = 0; Column < Width; ++Column)
+	{
+		const double Longitude = ((X + Column + 0.5) / ImageWidth * 2.0 - 1.0) * Pi;
+		CosLongitude[Column] = static_cast<float>(std::cos(Longitude));
+		SinLongitude[Column] = static_cast<float>(std::sin(Longitude));
+	}
+
+	// Deslocamento do dominio no instante Time, em double porque o tempo cresce sem limite
+	float Offset[3];
+	for (int Axis = 0; Axis < 3; ++Axis)
+	{
+		Offset[Axis] = static_cast<float>(EvolutionAxis[Axis] * Time * Settings.EvolutionSpeed);
+	}
+
+	std::vector<float> ShapeX(Width), ShapeY(Width), ShapeZ(Width);
+	std::vector<float> DetailX(Width), DetailY(Width), DetailZ(Width);
+	std::vector<float> Shape(Width), Detail(Width);
+	const float InverseSoftness = 1.0f / std::max(Settings.Softness, 1e-6f);
+
+	for (int Row = 0; Row < Height; ++Row)
+	{
+		const double Latitude = ((Y + Row + 0.5) / ImageHeight - 0.5) * Pi;
+		const float CosLatitude = static_cast<float>(std::cos(Latitude));
+		const float SinLatitude = static_cast<float>(std::sin(Latitude));
+		for (int Column = 0; Column < Width; ++Column)
+		{
+			const float DirectionX = CosLatitude * CosLongitude[Column];
+			const float DirectionY = CosLatitude * SinLongitude[Column];
+			ShapeX[Column] = DirectionX * Settings.Frequency + Offset[0];
+			ShapeY[Column] = DirectionY * Settings.Frequency + Offset[1];
+			ShapeZ[Column] = SinLatitude * Settings.Frequency + Offset[2];
+			DetailX[Column] = DirectionX * Settings.DetailFrequency + Offset[0] * 2.0f + DetailOffset;
+			DetailY[Column] = DirectionY * Settings.DetailFrequency + Offset[1] * 2.0f + DetailOffset;
+			DetailZ[Column] = SinLatitude * Settings.DetailFrequency + Offset[2] * 2.0f + DetailOffset;
+		}
+
+		FbmNoiseBatch(ShapeX.data(), ShapeY.data(), ShapeZ.data(), Shape.data(), Width, Settings.Shape);
+		TurbulenceNoiseBatch(DetailX.data(), DetailY.data(), DetailZ.data(), Detail.data(), Width, Settings.Detail);
+
+		std::uint8_t* Line = Pixels + Row * RowPitch;
+		for (int Column = 0; Column < Width; ++Column)
+		{
+			const float Value = Shape[Column] + Settings.DetailWeight * Detail[Column];
+			const float T = std::min(std::max((Value - Settings.Coverage) * InverseSoftness, 0.0f), 1.0f);
+			Line[Column] = static_cast<std::uint8_t>(T * T * (3.0f - 2.0f * T) * 255.0f + 0.5f);
+		}
+	}
+}
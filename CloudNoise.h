@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CloudNoiseKernels.h"
+
+// Oitavas somadas por um ruido fBm ou de turbulencia: a cada oitava a frequencia
+// e multiplicada por Lacunarity e a amplitude por Gain
+struct NoiseOctaves
+{
+	int Count = 6;
+	float Lacunarity = 2.0f;
+	float Gain = 0.5f;
+};
+
+// Ruido do stb_perlin em lote, no kernel escolhido (AVX2 quando a CPU suporta). Nao
+// divide o trabalho entre threads: quem chama ja trabalha por tile
+void FbmNoiseBatch(const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count, const NoiseOctaves& Octaves);
+void TurbulenceNoiseBatch(const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count, const NoiseOctaves& Octaves);
+
+enum class CloudNoiseBackend
+{
+	Scalar,
+	AVX2,
+};
+
+// Mesmo esquema da geodesia: o backend e escolhido na primeira chamada e
+// SetCloudNoiseBackend permite forcar o escalar para comparacao
+bool IsCloudNoiseBackendSupported(CloudNoiseBackend Backend);
+bool SetCloudNoiseBackend(CloudNoiseBackend Backend);
+CloudNoiseBackend GetCloudNoiseBackend();
+const char* GetCloudNoiseBackendName(CloudNoiseBackend Backend);
+
+// Campo de cobertura das nuvens. O ruido e amostrado na direcao do texel na esfera
+// unitaria, e nao no UV, para nao ter costura na longitude 180 nem esticar nos polos:
+// fBm nas formas grandes mais turbulencia nos detalhes, cortados por um limiar suave.
+// Com o tempo o dominio do ruido desliza ao longo de um eixo inclinado, e as nuvens
+// se formam e se desfazem
+struct CloudFieldSettings
+{
+	float Frequency = 3.5f;                 // Celulas do ruido por raio na primeira oitava
+	NoiseOctaves Shape{6, 2.0f, 0.5f};
+	float DetailFrequency = 16.0f;
+	NoiseOctaves Detail{3, 2.0f, 0.5f};
+	float DetailWeight = 0.5f;
+	float Coverage = 0.05f;                 // Valor do ruido onde a nuvem comeca
+	float Softness = 0.6f;                  // Largura da borda ate a cobertura total
+	float EvolutionSpeed = 0.01f;           // Unidades do ruido por segundo
+};
+
+// Cobertura de 0 a 255 no instante Time (segundos) do retangulo [X, X + Width) x
+// [Y, Y + Height) de uma imagem equiretangular ImageWidth x ImageHeight no UV dos
+// tiles do globo: u = (longitude + 180) / 360, v = (latitude + 90) / 180. Pixels
+// aponta para o texel (X, Y) e RowPitch e a distancia entre linhas em bytes
+void GenerateCloudCoverage(const CloudFieldSettings& Settings, double Time, int ImageWidth, int ImageHeight,
+	int X, int Y, int Width, int Height, std::uint8_t* Pixels, std::size_t RowPitch);
@@ -0,0 +1,188 @@
+#include "CloudNoiseKernels.h"
+
+// Compilado com AVX2 e FMA habilitados (ver CMakeLists.txt), como GeodesyAVX2.cpp:
+// so e chamado depois que CloudNoise.cpp confirma o suporte da CPU
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace
+{
+	inline __m256 Set(float Value)
+	{
+		return _mm256_set1_ps(Value);
+	}
+
+	// Curva 6t^5 - 15t^4 + 10t^3 na mesma ordem de operacoes do stb
+	inline __m256 Ease(__m256 T)
+	{
+		const __m256 Polynomial = _mm256_fmadd_ps(_mm256_fmsub_ps(T, Set(6.0f), Set(15.0f)), T, Set(10.0f));
+		return _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(Polynomial, T), T), T);
+	}
+
+	inline __m256 Lerp(__m256 A, __m256 B, __m256 T)
+	{
+		return _mm256_fmadd_ps(_mm256_sub_ps(B, A), T, A);
+	}
+
+	// Produto com um dos 12 gradientes do stb sem ler a tabela: os indices 0-3 sao
+	// (+-1, +-1, 0), 4-7 (+-1, 0, +-1) e 8-11 (0, +-1, +-1). O bit 0 do indice troca o
+	// sinal do primeiro termo e o bit 1 o do segundo
+	inline __m256 Gradient(__m256i Index, __m256 X, __m256 Y, __m256 Z)
+	{
+		const __m256 FirstIsY = _mm256_castsi256_ps(_mm256_cmpgt_epi32(Index, _mm256_set1_epi32(7)));
+		const __m256 SecondIsZ = _mm256_castsi256_ps(_mm256_cmpgt_epi32(Index, _mm256_set1_epi32(3)));
+		const __m256 First = _mm256_blendv_ps(X, Y, FirstIsY);
+		const __m256 Second = _mm256_blendv_ps(Y, Z, SecondIsZ);
+		const __m256 FirstSign = _mm256_castsi256_ps(_mm256_slli_epi32(Index, 31));
+		const __m256 SecondSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_srli_epi32(Index, 1), 31));
+		return _mm256_add_ps(_mm256_xor_ps(First, FirstSign), _mm256_xor_ps(Second, SecondSign));
+	}
+
+	inline __m256i Lookup(const std::int32_t* Table, __m256i Index)
+	{
+		return _mm256_i32gather_epi32(reinterpret_cast<const int*>(Table), Index, 4);
+	}
+
+	// stb_perlin_noise3_internal com repeticao 0 (mascara 255) em oito pontos
+	inline __m256 Perlin(const PerlinTables& Tables, __m256 X, __m256 Y, __m256 Z, __m256i Seed)
+	{
+		const __m256 FloorX = _mm256_floor_ps(X);
+		const __m256 FloorY = _mm256_floor_ps(Y);
+		const __m256 FloorZ = _mm256_floor_ps(Z);
+		const __m256i Mask = _mm256_set1_epi32(255);
+		const __m256i One = _mm256_set1_epi32(1);
+		const __m256i PX = _mm256_cvttps_epi32(FloorX);
+		const __m256i PY = _mm256_cvttps_epi32(FloorY);
+		const __m256i PZ = _mm256_cvttps_epi32(FloorZ);
+		const __m256i X0 = _mm256_and_si256(PX, Mask);
+		const __m256i X1 = _mm256_and_si256(_mm256_add_epi32(PX, One), Mask);
+		const __m256i Y0 = _mm256_and_si256(PY, Mask);
+		const __m256i Y1 = _mm256_and_si256(_mm256_add_epi32(PY, One), Mask);
+		const __m256i Z0 = _mm256_and_si256(PZ, Mask);
+		const __m256i Z1 = _mm256_and_si256(_mm256_add_epi32(PZ, One), Mask);
+
+		// Posicao dentro da celula e os pesos da interpolacao
+		X = _mm256_sub_ps(X, FloorX);
+		Y = _mm256_sub_ps(Y, FloorY);
+		Z = _mm256_sub_ps(Z, FloorZ);
+		const __m256 U = Ease(X);
+		const __m256 V = Ease(Y);
+		const __m256 W = Ease(Z);
+		const __m256 XM1 = _mm256_sub_ps(X, Set(1.0f));
+		const __m256 YM1 = _mm256_sub_ps(Y, Set(1.0f));
+		const __m256 ZM1 = _mm256_sub_ps(Z, Set(1.0f));
+
+		const __m256i R0 = Lookup(Tables.Permutation, _mm256_add_epi32(X0, Seed));
+		const __m256i R1 = Lookup(Tables.Permutation, _mm256_add_epi32(X1, Seed));
+		const __m256i R00 = Lookup(Tables.Permutation, _mm256_add_epi32(R0, Y0));
+		const __m256i R01 = Lookup(Tables.Permutation, _mm256_add_epi32(R0, Y1));
+		const __m256i R10 = Lookup(Tables.Permutation, _mm256_add_epi32(R1, Y0));
+		const __m256i R11 = Lookup(Tables.Permutation, _mm256_add_epi32(R1, Y1));
+
+		const __m256 N000 = Gradient(Lookup(Tables.GradientIndex, _mm256_add_epi32(R00, Z0)), X, Y, Z);
+		const __m256 N001 = Gradient(Lookup(Tables.GradientIndex, _mm256_add_epi32(R00, Z1)), X, Y, ZM1);
+		const __m256 N010 = Gradient(Lookup(Tables.GradientIndex, _mm256_add_epi32(R01, Z0)), X, YM1, Z);
+		const __m256 N011 = Gradient(Lookup(Tables.GradientIndex, _mm256_add_epi32(R01, Z1)), X, YM1, ZM1);
+		const __m256 N100 = Gradient(Lookup(Tables.GradientIndex, _mm256_add_epi32(R10, Z0)), XM1, Y, Z);
+		const __m256 N101 = Gradient(Lookup(Tables.GradientIndex, _mm256_add_epi32(R10, Z1)), XM1, Y, ZM1);
+		const __m256 N110 = Gradient(Lookup(Tables.GradientIndex, _mm256_add_epi32(R11, Z0)), XM1, YM1, Z);
+		const __m256 N111 = Gradient(Lookup(Tables.GradientIndex, _mm256_add_epi32(R11, Z1)), XM1, YM1, ZM1);
+
+		const __m256 N0 = Lerp(Lerp(N000, N001, W), Lerp(N010, N011, W), V);
+		const __m256 N1 = Lerp(Lerp(N100, N101, W), Lerp(N110, N111, W), V);
+		return Lerp(N0, N1, U);
+	}
+
+	// Chama Func em blocos de oito pontos. O resto do array vai em um bloco
+	// completado com zeros, e so os pontos validos sao escritos
+	template <typename FuncType>
+	void ForEachBlock(const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count, const FuncType& Func)
+	{
+		std::size_t Index = 0;
+		for (; Index + 8 <= Count; Index += 8)
+		{
+			_mm256_storeu_ps(Noise + Index, Func(_mm256_loadu_ps(X + Index), _mm256_loadu_ps(Y + Index), _mm256_loadu_ps(Z + Index)));
+		}
+		if (Index == Count)
+		{
+			return;
+		}
+
+		alignas(32) float TailX[8] = {};
+		alignas(32) float TailY[8] = {};
+		alignas(32) float TailZ[8] = {};
+		alignas(32) float TailNoise[8];
+		const std::size_t TailCount = Count - Index;
+		for (std::size_t Lane = 0; Lane < TailCount; ++Lane)
+		{
+			TailX[Lane] = X[Index + Lane];
+			TailY[Lane] = Y[Index + Lane];
+			TailZ[Lane] = Z[Index + Lane];
+		}
+		_mm256_store_ps(TailNoise, Func(_mm256_load_ps(TailX), _mm256_load_ps(TailY), _mm256_load_ps(TailZ)));
+		for (std::size_t Lane = 0; Lane < TailCount; ++Lane)
+		{
+			Noise[Index + Lane] = TailNoise[Lane];
+		}
+	}
+
+	void AVX2FbmNoise(const PerlinTables& Tables, const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count,
+		float Lacunarity, float Gain, int Octaves)
+	{
+		ForEachBlock(X, Y, Z, Noise, Count, [&](__m256 PX, __m256 PY, __m256 PZ)
+		{
+			float Frequency = 1.0f;
+			float Amplitude = 1.0f;
+			__m256 Sum = _mm256_setzero_ps();
+			for (int Octave = 0; Octave < Octaves; ++Octave)
+			{
+				const __m256 F = Set(Frequency);
+				const __m256 Value = Perlin(Tables, _mm256_mul_ps(PX, F), _mm256_mul_ps(PY, F), _mm256_mul_ps(PZ, F), _mm256_set1_epi32(Octave & 255));
+				Sum = _mm256_fmadd_ps(Value, Set(Amplitude), Sum);
+				Frequency *= Lacunarity;
+				Amplitude *= Gain;
+			}
+			return Sum;
+		});
+	}
+
+	void AVX2TurbulenceNoise(const PerlinTables& Tables, const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count,
+		float Lacunarity, float Gain, int Octaves)
+	{
+		ForEachBlock(X, Y, Z, Noise, Count, [&](__m256 PX, __m256 PY, __m256 PZ)
+		{
+			float Frequency = 1.0f;
+			float Amplitude = 1.0f;
+			__m256 Sum = _mm256_setzero_ps();
+			for (int Octave = 0; Octave < Octaves; ++Octave)
+			{
+				const __m256 F = Set(Frequency);
+				const __m256 Value = Perlin(Tables, _mm256_mul_ps(PX, F), _mm256_mul_ps(PY, F), _mm256_mul_ps(PZ, F), _mm256_set1_epi32(Octave & 255));
+				Sum = _mm256_add_ps(Sum, _mm256_andnot_ps(Set(-0.0f), _mm256_mul_ps(Value, Set(Amplitude))));
+				Frequency *= Lacunarity;
+				Amplitude *= Gain;
+			}
+			return Sum;
+		});
+	}
+}
+
+const CloudNoiseKernels* GetAVX2CloudNoiseKernels()
+{
+	static const CloudNoiseKernels Kernels{
+		AVX2FbmNoise,
+		AVX2TurbulenceNoise,
+	};
+	return &Kernels;
+}
+
+#else
+
+const CloudNoiseKernels* GetAVX2CloudNoiseKernels()
+{
+	return nullptr;
+}
+
+#endif
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Tabelas do stb_perlin ja expandidas para int, no formato lido pelos gathers do
+// AVX2. O stb as declara static, entao CloudNoise.cpp (o unico arquivo com
+// STB_PERLIN_IMPLEMENTATION) as copia para ca. Como GeodesyKernels.h, este cabecalho
+// e compartilhado com o arquivo compilado com AVX2 e nao inclui outras bibliotecas
+struct PerlinTables
+{
+	std::int32_t Permutation[512];      // stb__perlin_randtab
+	std::int32_t GradientIndex[512];    // stb__perlin_randtab_grad_idx, de 0 a 11
+};
+
+// Ruido de varias oitavas sobre arrays SoA, com os mesmos resultados de
+// stb_perlin_fbm_noise3 e stb_perlin_turbulence_noise3 (sem repeticao): a oitava i
+// usa a semente i
+struct CloudNoiseKernels
+{
+	void (*FbmNoise)(const PerlinTables& Tables, const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count,
+		float Lacunarity, float Gain, int Octaves);
+	void (*TurbulenceNoise)(const PerlinTables& Tables, const float* X, const float* Y, const float* Z, float* Noise, std::size_t Count,
+		float Lacunarity, float Gain, int Octaves);
+};
+
+const CloudNoiseKernels& GetScalarCloudNoiseKernels();
+
+// nullptr quando o compilador nao gerou a versao AVX2 (fora de x86-64)
+const CloudNoiseKernels* GetAVX2CloudNoiseKernels();
@@ -0,0 +1,41 @@
+#include "CpuFeatures.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+namespace
+{
+	bool DetectAVX2()
+	{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+		int Info[4];
+		__cpuid(Info, 0);
+		if (Info[0] < 7)
+		{
+			return false;
+		}
+		__cpuid(Info, 1);
+		const bool HasFMA = (Info[2] & (1 << 12)) != 0;
+		const bool HasOSXSAVE = (Info[2] & (1 << 27)) != 0;
+		// O sistema tambem precisa salvar os registradores YMM nas trocas de contexto
+		if (!HasFMA || !HasOSXSAVE || (_xgetbv(0) & 0x6) != 0x6)
+		{
+			return false;
+		}
+		__cpuidex(Info, 7, 0);
+		return (Info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+		__builtin_cpu_init();
+		return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+		return false;
+#endif
+	}
+}
+
+bool CpuSupportsAVX2()
+{
+	static const bool Supported = DetectAVX2();
+	return Supported;
+}
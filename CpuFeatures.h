@@ -0,0 +1,6 @@
+#pragma once
+
+// AVX2 e FMA disponiveis na CPU e habilitados pelo sistema (registradores YMM salvos
+// nas trocas de contexto). Falso fora de x86. Os modulos com kernels AVX2 so os
+// chamam quando isto e verdadeiro
+bool CpuSupportsAVX2();
@@ -0,0 +1,260 @@
+#include "Culling.h"
+
+#include <algorithm>
+
+#include "JobSystem.h"
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define BLUEMARBLE_SSE 1
+#include <xmmintrin.h>
+#else
+#define BLUEMARBLE_SSE 0
+#endif
+
+// Nivel do quadtree a partir do qual as subarvores viram tarefas independentes
+constexpr int ParallelSplitLevel = 2;
+
+Frustum ExtractFrustumPlanes(const glm::mat4& ViewProjection)
+{
+	// glm guarda as matrizes por coluna, entao a linha i e (M[0][i], M[1][i], M[2][i], M[3][i])
+	const glm::mat4 Rows = glm::transpose(ViewProjection);
+
+	Frustum Result;
+	Result.Planes[0] = Rows[3] + Rows[0];  // Esquerda
+	Result.Planes[1] = Rows[3] - Rows[0];  // Direita
+	Result.Planes[2] = Rows[3] + Rows[1];  // Baixo
+	Result.Planes[3] = Rows[3] - Rows[1];  // Cima
+	Result.Planes[4] = Rows[3] + Rows[2];  // Perto
+	Result.Planes[5] = Rows[3] - Rows[2];  // Longe
+
+	for (glm::vec4& Plane : Result.Planes)
+	{
+		Plane /= glm::length(glm::vec3{Plane});
+	}
+	return Result;
+}
+
+bool IsSphereInFrustum(const Frustum& ViewFrustum, const glm::vec3& Center, float Radius)
+{
+	for (const glm::vec4& Plane : ViewFrustum.Planes)
+	{
+		if (glm::dot(glm::vec3{Plane}, Center) + Plane.w < -Radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Testa quatro esferas contra os seis planos. Bit i de OutsideMask indica esfera
+// totalmente fora; bit i de IntersectMask indica esfera cruzando algum plano
+static void TestSpheres(const Frustum& ViewFrustum, const float* X, const float* Y, const float* Z, const float* R,
+	int& OutsideMask, int& IntersectMask)
+{
+#if BLUEMARBLE_SSE
+	const __m128 CenterX = _mm_loadu_ps(X);
+	const __m128 CenterY = _mm_loadu_ps(Y);
+	const __m128 CenterZ = _mm_loadu_ps(Z);
+	const __m128 Radius = _mm_loadu_ps(R);
+	const __m128 NegativeRadius = _mm_sub_ps(_mm_setzero_ps(), Radius);
+
+	__m128 Outside = _mm_setzero_ps();
+	__m128 Intersect = _mm_setzero_ps();
+	for (const glm::vec4& Plane : ViewFrustum.Planes)
+	{
+		__m128 Distance = _mm_mul_ps(CenterX, _mm_set1_ps(Plane.x));
+		Distance = _mm_add_ps(Distance, _mm_mul_ps(CenterY, _mm_set1_ps(Plane.y)));
+		Distance = _mm_add_ps(Distance, _mm_mul_ps(CenterZ, _mm_set1_ps(Plane.z)));
+		Distance = _mm_add_ps(Distance, _mm_set1_ps(Plane.w));
+
+		Outside = _mm_or_ps(Outside, _mm_cmplt_ps(Distance, NegativeRadius));
+		Intersect = _mm_or_ps(Intersect, _mm_cmplt_ps(Distance, Radius));
+	}
+
+	OutsideMask = _mm_movemask_ps(Outside);
+	IntersectMask = _mm_movemask_ps(Intersect);
+#else
+	OutsideMask = 0;
+	IntersectMask = 0;
+	for (int i = 0; i < 4; ++i)
+	{
+		for (const glm::vec4& Plane : ViewFrustum.Planes)
+		{
+			const float Distance = Plane.x * X[i] + Plane.y * Y[i] + Plane.z * Z[i] + Plane.w;
+			if (Distance < -R[i])
+			{
+				OutsideMask |= 1 << i;
+			}
+			if (Distance < R[i])
+			{
+				IntersectMask |= 1 << i;
+			}
+		}
+	}
+#endif
+}
+
+struct CullTask
+{
+	int NodeIndex;
+	bool InsideFrustum;
+};
+
+struct CullContext
+{
+	const GlobeQuadtree* Quadtree;
+	Frustum ViewFrustum;
+	glm::dvec3 Eye;
+	glm::dvec3 ScaledEye;
+	double HorizonDistanceSquared;
+};
+
+static int CountLeaves(const CullContext& Context, const GlobeNode& Node)
+{
+	return 1 << (2 * (Context.Quadtree->LeafLevel - Node.Level));
+}
+
+// Teste de oclusao pelo horizonte no espaco escalado pelo elipsoide (onde ele vira uma esfera unitaria)
+static bool IsBelowHorizon(const CullContext& Context, const GlobeNode& Node)
+{
+	if (!Node.HasHorizonPoint)
+	{
+		return false;
+	}
+
+	const glm::dvec3 ToPoint = Node.HorizonPoint - Context.ScaledEye;
+	const double ToPointDotEye = -glm::dot(ToPoint, Context.ScaledEye);
+
+	if (Context.HorizonDistanceSquared < 0.0)
+	{
+		// Camera dentro do elipsoide
+		return ToPointDotEye > 0.0;
+	}
+
+	return ToPointDotEye > Context.HorizonDistanceSquared &&
+		ToPointDotEye * ToPointDotEye / glm::dot(ToPoint, ToPoint) > Context.HorizonDistanceSquared;
+}
+
+// Visita Count nos contiguos a partir de FirstNode. Os nos que chegam ao nivel de
+// divisao vao para Tasks em vez de serem visitados (quando Tasks nao e nulo)
+static void VisitNodes(const CullContext& Context, int FirstNode, int Count, bool InsideFrustum,
+	std::vector<CullTask>* Tasks, std::vector<int>& VisibleTiles, CullStats& Stats)
+{
+	const std::vector<GlobeNode>& Nodes = Context.Quadtree->Nodes;
+
+	int OutsideMask = 0;
+	int IntersectMask = 0;
+	if (!InsideFrustum)
+	{
+		// Centros relativos ao olho, subtraidos em double antes de virar float
+		alignas(16) float X[4] = {};
+		alignas(16) float Y[4] = {};
+		alignas(16) float Z[4] = {};
+		alignas(16) float R[4] = {};
+		for (int i = 0; i < Count; ++i)
+		{
+			const GlobeNode& Node = Nodes[FirstNode + i];
+			const glm::vec3 Center{Node.Center - Context.Eye};
+			X[i] = Center.x;
+			Y[i] = Center.y;
+			Z[i] = Center.z;
+			R[i] = static_cast<float>(Node.Radius);
+		}
+
+		TestSpheres(Context.ViewFrustum, X, Y, Z, R, OutsideMask, IntersectMask);
+		Stats.NodesTested += Count;
+	}
+
+	for (int i = 0; i < Count; ++i)
+	{
+		const int NodeIndex = FirstNode + i;
+		const GlobeNode& Node = Nodes[NodeIndex];
+
+		if (OutsideMask & (1 << i))
+		{
+			Stats.FrustumCulled += CountLeaves(Context, Node);
+			continue;
+		}
+
+		if (IsBelowHorizon(Context, Node))
+		{
+			Stats.HorizonCulled += CountLeaves(Context, Node);
+			continue;
+		}
+
+		// Se o no esta inteiro dentro do frustum, os descendentes nao precisam ser testados de novo
+		const bool ChildInsideFrustum = InsideFrustum || !(IntersectMask & (1 << i));
+
+		if (Tasks && Node.Level >= ParallelSplitLevel)
+		{
+			Tasks->push_back(CullTask{NodeIndex, ChildInsideFrustum});
+		}
+		else if (Node.FirstChild < 0)
+		{
+			VisibleTiles.push_back(Node.TileIndex);
+			++Stats.Visible;
+		}
+		else
+		{
+			VisitNodes(Context, Node.FirstChild, 4, ChildInsideFrustum, Tasks, VisibleTiles, Stats);
+		}
+	}
+}
+
+static void RunTask(const CullContext& Context, const CullTask& Task, std::vector<int>& VisibleTiles, CullStats& Stats)
+{
+	const GlobeNode& Node = Context.Quadtree->Nodes[Task.NodeIndex];
+	if (Node.FirstChild < 0)
+	{
+		VisibleTiles.push_back(Node.TileIndex);
+		++Stats.Visible;
+	}
+	else
+	{
+		VisitNodes(Context, Node.FirstChild, 4, Task.InsideFrustum, nullptr, VisibleTiles, Stats);
+	}
+}
+
+void CullGlobeQuadtree(const GlobeQuadtree& Quadtree, const Frustum& ViewFrustum, const glm::dvec3& Eye,
+	const glm::dvec3& Radii, bool Parallel, std::vector<int>& VisibleTiles, CullStats& Stats)
+{
+	CullContext Context;
+	Context.Quadtree = &Quadtree;
+	Context.ViewFrustum = ViewFrustum;
+	Context.Eye = Eye;
+	Context.ScaledEye = Eye / Radii;
+	Context.HorizonDistanceSquared = glm::dot(Context.ScaledEye, Context.ScaledEye) - 1.0;
+
+	Stats = CullStats{};
+
+	// Os niveis de cima sao poucos e rapidos, entao sao visitados aqui mesmo
+	std::vector<CullTask> Tasks;
+	VisitNodes(Context, 0, Quadtree.NumRoots, false, Parallel ? &Tasks : nullptr, VisibleTiles, Stats);
+
+	if (Tasks.empty())
+	{
+		return;
+	}
+
+	// Cada subarvore vira um job do agendador e acumula resultados proprios,
+	// juntados depois na ordem das tarefas
+	const int NumTasks = static_cast<int>(Tasks.size());
+	std::vector<std::vector<int>> TaskTiles(NumTasks);
+	std::vector<CullStats> TaskStats(NumTasks);
+	JobSystem::Get().ParallelFor(0, NumTasks, 1, [&](int TaskBegin, int TaskEnd)
+	{
+		for (int TaskIndex = TaskBegin; TaskIndex < TaskEnd; ++TaskIndex)
+		{
+			RunTask(Context, Tasks[TaskIndex], TaskTiles[TaskIndex], TaskStats[TaskIndex]);
+		}
+	});
+
+	for (int TaskIndex = 0; TaskIndex < NumTasks; ++TaskIndex)
+	{
+		VisibleTiles.insert(VisibleTiles.end(), TaskTiles[TaskIndex].begin(), TaskTiles[TaskIndex].end());
+		Stats.Visible += TaskStats[TaskIndex].Visible;
+		Stats.FrustumCulled += TaskStats[TaskIndex].FrustumCulled;
+		Stats.HorizonCulled += TaskStats[TaskIndex].HorizonCulled;
+		Stats.NodesTested += TaskStats[TaskIndex].NodesTested;
+	}
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GlobeTiles.h"
+
+// Planos do frustum no formato ax + by + cz + d >= 0 para pontos dentro, normalizados
+struct Frustum
+{
+	glm::vec4 Planes[6];
+};
+
+// Extrai os seis planos de ProjectionMatrix * ViewMatrix (Gribb/Hartmann). Com uma
+// matriz relativa ao olho os planos tambem ficam no espaco relativo ao olho
+Frustum ExtractFrustumPlanes(const glm::mat4& ViewProjection);
+
+// Teste escalar de uma esfera contra o frustum, usado como referencia
+bool IsSphereInFrustum(const Frustum& ViewFrustum, const glm::vec3& Center, float Radius);
+
+// Contagens por frame, em numero de tiles folha
+struct CullStats
+{
+	int Visible = 0;
+	int FrustumCulled = 0;
+	int HorizonCulled = 0;
+	int NodesTested = 0;
+};
+
+// Percorre o quadtree do globo descartando os nos fora do frustum (quatro esferas
+// por instrucao SIMD) e os nos escondidos atras do horizonte do elipsoide. Os
+// indices dos tiles visiveis sao adicionados a VisibleTiles. Com Parallel as
+// subarvores viram jobs do JobSystem
+void CullGlobeQuadtree(const GlobeQuadtree& Quadtree, const Frustum& ViewFrustum, const glm::dvec3& Eye,
+	const glm::dvec3& Radii, bool Parallel, std::vector<int>& VisibleTiles, CullStats& Stats);
@@ -0,0 +1,212 @@
+#include "FileReader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <iostream>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "JobSystem.h"
+
+// A partir deste tamanho mapear sai mais barato que copiar para um buffer
+constexpr std::size_t MapThreshold = 4 * 1024 * 1024;
+
+FileContents::FileContents(FileContents&& Other) noexcept
+{
+	*this = std::move(Other);
+}
+
+FileContents& FileContents::operator=(FileContents&& Other) noexcept
+{
+	if (this != &Other)
+	{
+		Release();
+
+		// Mover o vector preserva o ponteiro dos dados, entao Bytes continua valido
+		Buffer = std::move(Other.Buffer);
+		Bytes = Other.Bytes;
+		NumBytes = Other.NumBytes;
+		Valid = Other.Valid;
+		Mapping = Other.Mapping;
+		MappingSize = Other.MappingSize;
+
+		Other.Bytes = nullptr;
+		Other.NumBytes = 0;
+		Other.Valid = false;
+		Other.Mapping = nullptr;
+		Other.MappingSize = 0;
+	}
+	return *this;
+}
+
+FileContents::~FileContents()
+{
+	Release();
+}
+
+void FileContents::Release()
+{
+	if (Mapping)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(Mapping);
+#else
+		munmap(Mapping, MappingSize);
+#endif
+	}
+	Mapping = nullptr;
+	MappingSize = 0;
+	Buffer.clear();
+	Bytes = nullptr;
+	NumBytes = 0;
+	Valid = false;
+}
+
+#ifdef _WIN32
+FileContents ReadWholeFile(const std::string& FilePath)
+{
+	FileContents Contents;
+
+	HANDLE File = CreateFileA(FilePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (File == INVALID_HANDLE_VALUE)
+	{
+		std::cerr << "Falha ao abrir o arquivo: " << FilePath << std::endl;
+		return Contents;
+	}
+
+	LARGE_INTEGER FileSize;
+	if (!GetFileSizeEx(File, &FileSize))
+	{
+		CloseHandle(File);
+		return Contents;
+	}
+	const std::size_t Size = static_cast<std::size_t>(FileSize.QuadPart);
+
+	if (Size >= MapThreshold)
+	{
+		HANDLE MappingHandle = CreateFileMappingA(File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		void* View = MappingHandle ? MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (MappingHandle)
+		{
+			// A vista mantem o mapeamento vivo depois que o handle fecha
+			CloseHandle(MappingHandle);
+		}
+		if (View)
+		{
+			CloseHandle(File);
+			Contents.Mapping = View;
+			Contents.MappingSize = Size;
+			Contents.Bytes = static_cast<const unsigned char*>(View);
+			Contents.NumBytes = Size;
+			Contents.Valid = true;
+			return Contents;
+		}
+	}
+
+	Contents.Buffer.resize(Size);
+	std::size_t BytesDone = 0;
+	while (BytesDone < Size)
+	{
+		DWORD BytesRead = 0;
+		const DWORD ToRead = static_cast<DWORD>(std::min<std::size_t>(Size - BytesDone, 1u << 30));
+		if (!ReadFile(File, Contents.Buffer.data() + BytesDone, ToRead, &BytesRead, nullptr) || BytesRead == 0)
+		{
+			break;
+		}
+		BytesDone += BytesRead;
+	}
+	CloseHandle(File);
+
+	Contents.Buffer.resize(BytesDone);
+	Contents.Bytes = Contents.Buffer.data();
+	Contents.NumBytes = BytesDone;
+	Contents.Valid = BytesDone == Size;
+	return Contents;
+}
+#else
+FileContents ReadWholeFile(const std::string& FilePath)
+{
+	FileContents Contents;
+
+	const int File = open(FilePath.c_str(), O_RDONLY | O_CLOEXEC);
+	if (File < 0)
+	{
+		std::cerr << "Falha ao abrir o arquivo: " << FilePath << std::endl;
+		return Contents;
+	}
+
+	struct stat FileStat;
+	if (fstat(File, &FileStat) != 0)
+	{
+		close(File);
+		return Contents;
+	}
+	const std::size_t Size = static_cast<std::size_t>(FileStat.st_size);
+
+	if (Size >= MapThreshold)
+	{
+		void* View = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, File, 0);
+		if (View != MAP_FAILED)
+		{
+			// Os dados sao lidos do inicio ao fim logo em seguida. Os conselhos sao
+			// valores, nao bits, entao vao em chamadas separadas
+			madvise(View, Size, MADV_SEQUENTIAL);
+			madvise(View, Size, MADV_WILLNEED);
+			close(File);
+			Contents.Mapping = View;
+			Contents.MappingSize = Size;
+			Contents.Bytes = static_cast<const unsigned char*>(View);
+			Contents.NumBytes = Size;
+			Contents.Valid = true;
+			return Contents;
+		}
+	}
+
+	// Uma alocacao do tamanho exato e, normalmente, uma unica chamada a read
+	Contents.Buffer.resize(Size);
+	std::size_t BytesDone = 0;
+	while (BytesDone < Size)
+	{
+		const ssize_t BytesRead = read(File, Contents.Buffer.data() + BytesDone, Size - BytesDone);
+		if (BytesRead < 0 && errno == EINTR)
+		{
+			continue;
+		}
+		if (BytesRead <= 0)
+		{
+			break;
+		}
+		BytesDone += static_cast<std::size_t>(BytesRead);
+	}
+	close(File);
+
+	Contents.Buffer.resize(BytesDone);
+	Contents.Bytes = Contents.Buffer.data();
+	Contents.NumBytes = BytesDone;
+	Contents.Valid = BytesDone == Size;
+	return Contents;
+}
+#endif
+
+std::vector<FileContents> ReadFiles(const std::vector<std::string>& FilePaths)
+{
+	std::vector<FileContents> Files(FilePaths.size());
+	JobSystem::Get().ParallelFor(0, static_cast<int>(FilePaths.size()), 1, [&](int FileBegin, int FileEnd)
+	{
+		for (int FileIndex = FileBegin; FileIndex < FileEnd; ++FileIndex)
+		{
+			Files[FileIndex] = ReadWholeFile(FilePaths[FileIndex]);
+		}
+	});
+	return Files;
+}
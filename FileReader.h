@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Conteudo de um arquivo inteiro em memoria. Arquivos grandes sao mapeados
+// (mmap / MapViewOfFile) e os pequenos lidos de uma vez em um buffer do tamanho
+// exato; nos dois casos o conteudo e acessado sem copias por View() ou Data()
+class FileContents
+{
+public:
+	FileContents() = default;
+	FileContents(FileContents&& Other) noexcept;
+	FileContents& operator=(FileContents&& Other) noexcept;
+	FileContents(const FileContents&) = delete;
+	FileContents& operator=(const FileContents&) = delete;
+	~FileContents();
+
+	// Falso se o arquivo nao pode ser aberto ou lido. Um arquivo vazio e valido
+	bool IsValid() const { return Valid; }
+	bool IsMapped() const { return Mapping != nullptr; }
+
+	const unsigned char* Data() const { return Bytes; }
+	std::size_t Size() const { return NumBytes; }
+	std::string_view View() const { return std::string_view{reinterpret_cast<const char*>(Bytes), NumBytes}; }
+
+private:
+	friend FileContents ReadWholeFile(const std::string& FilePath);
+
+	void Release();
+
+	const unsigned char* Bytes = nullptr;
+	std::size_t NumBytes = 0;
+	bool Valid = false;
+
+	// Buffer proprio (leitura) ou regiao mapeada, nunca os dois
+	std::vector<unsigned char> Buffer;
+	void* Mapping = nullptr;
+	std::size_t MappingSize = 0;
+};
+
+// Descobre o tamanho com stat e le o arquivo com uma unica chamada de leitura, ou
+// o mapeia se passar de alguns megabytes
+FileContents ReadWholeFile(const std::string& FilePath);
+
+// Le varios arquivos de uma vez, distribuidos entre as threads do JobSystem.
+// O resultado segue a ordem de FilePaths
+std::vector<FileContents> ReadFiles(const std::vector<std::string>& FilePaths);
@@ -0,0 +1,145 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "FileReader.h"
+
+// Tamanhos de um shader, de uma biblioteca de shaders, de um arquivo de dados e
+// de uma textura grande (que passa do limite de mapeamento do FileReader)
+const std::size_t FileSizes[] = {4 * 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+
+// Bytes lidos em cada medicao, dividido entre quantos arquivos couberem
+const std::size_t BytesPerRun = 256 * 1024 * 1024;
+const int MaxFilesPerRun = 512;
+
+void PrintHeader(const std::string& Title)
+{
+	std::cout << std::endl;
+	std::cout << "==================" << std::endl;
+	std::cout << Title << std::endl;
+	std::cout << "==================" << std::endl;
+}
+
+// A implementacao antiga do main.cpp
+std::string ReadFileStream(const std::string& FilePath)
+{
+	std::string FileContents;
+	if (std::ifstream FileStream{FilePath, std::ios::in})
+	{
+		FileContents.assign(std::istreambuf_iterator<char>(FileStream), std::istreambuf_iterator<char>());
+	}
+	return FileContents;
+}
+
+std::vector<std::string> CreateFiles(const std::filesystem::path& Directory, std::size_t FileSize, int NumFiles)
+{
+	std::filesystem::create_directories(Directory);
+	std::string Contents(FileSize, 'x');
+	for (std::size_t CharIndex = 0; CharIndex < FileSize; CharIndex += 64)
+	{
+		Contents[CharIndex] = '\n';
+	}
+
+	std::vector<std::string> Paths;
+	for (int FileIndex = 0; FileIndex < NumFiles; ++FileIndex)
+	{
+		const std::filesystem::path FilePath = Directory / ("file_" + std::to_string(FileIndex) + ".txt");
+		std::ofstream File{FilePath, std::ios::binary};
+		File.write(Contents.data(), Contents.size());
+		Paths.push_back(FilePath.string());
+	}
+	return Paths;
+}
+
+// Soma todos os bytes, como faria quem usa o conteudo. Assim as tres colunas pagam
+// o mesmo custo por byte e o mapeamento nao sai na frente por so tocar as paginas
+std::uint64_t Checksum(const char* Data, std::size_t Size)
+{
+	std::uint64_t Sum = 0;
+	for (std::size_t ByteIndex = 0; ByteIndex < Size; ++ByteIndex)
+	{
+		Sum += static_cast<unsigned char>(Data[ByteIndex]);
+	}
+	return Sum;
+}
+
+template<typename Function>
+double Measure(Function&& Run)
+{
+	// Uma rodada de aquecimento para as duas versoes partirem do cache de paginas
+	Run();
+	const auto Start = std::chrono::steady_clock::now();
+	Run();
+	const auto End = std::chrono::steady_clock::now();
+	return std::chrono::duration<double>(End - Start).count();
+}
+
+int main()
+{
+	JobSystem::Get().Init();
+
+	const std::filesystem::path Directory = std::filesystem::temp_directory_path() / "bluemarble_file_benchmark";
+
+	PrintHeader("Leitura de arquivos inteiros (" + std::to_string(JobSystem::Get().GetNumThreads()) + " threads)");
+	std::cout << std::setw(10) << "tamanho" << std::setw(10) << "arquivos"
+		<< std::setw(14) << "stream MB/s" << std::setw(14) << "unico MB/s" << std::setw(14) << "lote MB/s"
+		<< std::setw(10) << "ganho" << std::endl;
+
+	for (std::size_t FileSize : FileSizes)
+	{
+		const int NumFiles = static_cast<int>(std::max<std::size_t>(1, std::min<std::size_t>(MaxFilesPerRun, BytesPerRun / FileSize)));
+		const std::vector<std::string> Paths = CreateFiles(Directory, FileSize, NumFiles);
+		const double TotalMB = static_cast<double>(FileSize) * NumFiles / (1024.0 * 1024.0);
+
+		std::uint64_t Total = 0;
+
+		const double StreamSeconds = Measure([&]
+		{
+			for (const std::string& Path : Paths)
+			{
+				const std::string Contents = ReadFileStream(Path);
+				Total += Checksum(Contents.data(), Contents.size());
+			}
+		});
+
+		const double SingleSeconds = Measure([&]
+		{
+			for (const std::string& Path : Paths)
+			{
+				const FileContents Contents = ReadWholeFile(Path);
+				Total += Checksum(Contents.View().data(), Contents.Size());
+			}
+		});
+
+		const double BatchSeconds = Measure([&]
+		{
+			const std::vector<FileContents> Files = ReadFiles(Paths);
+			for (const FileContents& Contents : Files)
+			{
+				Total += Checksum(Contents.View().data(), Contents.Size());
+			}
+		});
+
+		const std::string SizeLabel = FileSize >= 1024 * 1024 ? std::to_string(FileSize / (1024 * 1024)) + " MB" : std::to_string(FileSize / 1024) + " KB";
+		std::cout << std::setw(10) << SizeLabel << std::setw(10) << NumFiles
+			<< std::setw(14) << std::setprecision(0) << std::fixed << TotalMB / StreamSeconds
+			<< std::setw(14) << TotalMB / SingleSeconds
+			<< std::setw(14) << TotalMB / BatchSeconds
+			<< std::setw(9) << std::setprecision(1) << StreamSeconds / std::min(SingleSeconds, BatchSeconds) << "x"
+			<< (Total == 0 ? " (vazio)" : "") << std::endl;
+
+		std::filesystem::remove_all(Directory);
+	}
+
+	JobSystem::Get().Shutdown();
+
+	return 0;
+}
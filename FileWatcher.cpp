@@ -0,0 +1,247 @@
+#include "FileWatcher.h"
+
+#include <filesystem>
+#include <iostream>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+// Tempo maximo que a thread de observacao fica bloqueada antes de conferir StopRequested
+constexpr int WakeMilliseconds = 100;
+
+FileWatcher::~FileWatcher()
+{
+	Stop();
+}
+
+bool FileWatcher::Start(const std::vector<std::string>& Directories, double DebounceSeconds, double PollIntervalSeconds)
+{
+	Stop();
+
+	WatchedDirectories = Directories;
+	Debounce = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(DebounceSeconds));
+	PollInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(PollIntervalSeconds));
+	StopRequested = false;
+
+	if (StartInotify())
+	{
+		WatchThread = std::thread{&FileWatcher::InotifyLoop, this};
+	}
+	else
+	{
+		std::cout << "Observando arquivos por varredura a cada " << PollIntervalSeconds << " s" << std::endl;
+		WatchThread = std::thread{&FileWatcher::PollLoop, this};
+	}
+	return true;
+}
+
+void FileWatcher::Stop()
+{
+	StopRequested = true;
+	if (WatchThread.joinable())
+	{
+		WatchThread.join();
+	}
+
+#ifdef __linux__
+	if (InotifyFile >= 0)
+	{
+		close(InotifyFile);
+	}
+#endif
+	InotifyFile = -1;
+	WatchDirectories.clear();
+
+	std::lock_guard<std::mutex> Lock{ChangesMutex};
+	PendingChanges.clear();
+}
+
+std::vector<std::string> FileWatcher::TakeChanges()
+{
+	std::vector<std::string> Changes;
+	const Clock::time_point Now = Clock::now();
+
+	std::lock_guard<std::mutex> Lock{ChangesMutex};
+	for (auto It = PendingChanges.begin(); It != PendingChanges.end();)
+	{
+		if (Now - It->second >= Debounce)
+		{
+			Changes.push_back(It->first);
+			It = PendingChanges.erase(It);
+		}
+		else
+		{
+			++It;
+		}
+	}
+	return Changes;
+}
+
+void FileWatcher::AddChange(const std::string& FilePath)
+{
+	std::lock_guard<std::mutex> Lock{ChangesMutex};
+	PendingChanges[FilePath] = Clock::now();
+}
+
+#ifdef __linux__
+bool FileWatcher::StartInotify()
+{
+	InotifyFile = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (InotifyFile < 0)
+	{
+		return false;
+	}
+
+	for (const std::string& Directory : WatchedDirectories)
+	{
+		if (!AddInotifyWatch(Directory))
+		{
+			close(InotifyFile);
+			InotifyFile = -1;
+			WatchDirectories.clear();
+			return false;
+		}
+
+		std::error_code Error;
+		for (auto It = std::filesystem::recursive_directory_iterator{Directory, Error}; !Error && It != std::filesystem::recursive_directory_iterator{}; It.increment(Error))
+		{
+			if (It->is_directory())
+			{
+				AddInotifyWatch(It->path().generic_string());
+			}
+		}
+	}
+	return true;
+}
+
+bool FileWatcher::AddInotifyWatch(const std::string& Directory)
+{
+	// IN_CLOSE_WRITE pega quem salva no lugar; IN_MOVED_TO quem grava em um
+	// temporario e renomeia por cima (a maioria dos editores)
+	const int Watch = inotify_add_watch(InotifyFile, Directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF);
+	if (Watch < 0)
+	{
+		std::cerr << "Falha ao observar o diretorio: " << Directory << std::endl;
+		return false;
+	}
+	WatchDirectories[Watch] = Directory;
+	return true;
+}
+
+void FileWatcher::InotifyLoop()
+{
+	alignas(inotify_event) char Buffer[16 * 1024];
+
+	while (!StopRequested)
+	{
+		pollfd PollFile{InotifyFile, POLLIN, 0};
+		if (poll(&PollFile, 1, WakeMilliseconds) <= 0)
+		{
+			continue;
+		}
+
+		const ssize_t BytesRead = read(InotifyFile, Buffer, sizeof(Buffer));
+		for (ssize_t Offset = 0; Offset < BytesRead;)
+		{
+			const inotify_event* Event = reinterpret_cast<const inotify_event*>(Buffer + Offset);
+			Offset += sizeof(inotify_event) + Event->len;
+
+			auto DirectoryIt = WatchDirectories.find(Event->wd);
+			if (DirectoryIt == WatchDirectories.end())
+			{
+				continue;
+			}
+			if (Event->mask & (IN_DELETE_SELF | IN_IGNORED))
+			{
+				WatchDirectories.erase(DirectoryIt);
+				continue;
+			}
+			if (Event->len == 0)
+			{
+				continue;
+			}
+
+			const std::string FilePath = DirectoryIt->second + "/" + Event->name;
+			if (Event->mask & IN_ISDIR)
+			{
+				// Diretorio novo: observar tambem
+				if (Event->mask & (IN_CREATE | IN_MOVED_TO))
+				{
+					AddInotifyWatch(FilePath);
+				}
+			}
+			else if (Event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+			{
+				AddChange(FilePath);
+			}
+		}
+	}
+}
+#else
+bool FileWatcher::StartInotify()
+{
+	return false;
+}
+
+bool FileWatcher::AddInotifyWatch(const std::string&)
+{
+	return false;
+}
+
+void FileWatcher::InotifyLoop()
+{
+}
+#endif
+
+void FileWatcher::PollLoop()
+{
+	std::unordered_map<std::string, std::filesystem::file_time_type> KnownFiles;
+	bool FirstScan = true;
+
+	while (!StopRequested)
+	{
+		for (const std::string& Directory : WatchedDirectories)
+		{
+			std::error_code Error;
+			for (auto It = std::filesystem::recursive_directory_iterator{Directory, Error}; !Error && It != std::filesystem::recursive_directory_iterator{}; It.increment(Error))
+			{
+				// Erros de um arquivo (apagado no meio da varredura) nao param a varredura
+				std::error_code EntryError;
+				if (!It->is_regular_file(EntryError))
+				{
+					continue;
+				}
+
+				const std::filesystem::file_time_type WriteTime = It->last_write_time(EntryError);
+				if (EntryError)
+				{
+					continue;
+				}
+
+				// Mesmo formato de caminho do inotify: diretorio observado + "/" + relativo
+				const std::string FilePath = Directory + "/" + std::filesystem::relative(It->path(), Directory, EntryError).generic_string();
+				auto [KnownIt, IsNew] = KnownFiles.try_emplace(FilePath, WriteTime);
+				if (!IsNew && KnownIt->second != WriteTime)
+				{
+					KnownIt->second = WriteTime;
+					AddChange(FilePath);
+				}
+				else if (IsNew && !FirstScan)
+				{
+					AddChange(FilePath);
+				}
+			}
+		}
+		FirstScan = false;
+
+		// Dormir em fatias curtas para Stop nao esperar o intervalo inteiro
+		const Clock::time_point WakeTime = Clock::now() + PollInterval;
+		while (!StopRequested && Clock::now() < WakeTime)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(WakeMilliseconds));
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Observa diretorios (incluindo subdiretorios) e acumula os arquivos alterados.
+// No Linux usa inotify; nos demais sistemas, ou se o inotify falhar, uma thread
+// compara periodicamente as datas de modificacao. Um arquivo so e entregue depois
+// de ficar DebounceSeconds sem mudar, para nao pegar um arquivo escrito pela metade
+class FileWatcher
+{
+public:
+	FileWatcher() = default;
+	FileWatcher(const FileWatcher&) = delete;
+	FileWatcher& operator=(const FileWatcher&) = delete;
+	~FileWatcher();
+
+	bool Start(const std::vector<std::string>& Directories, double DebounceSeconds = 0.1, double PollIntervalSeconds = 0.5);
+	void Stop();
+
+	// Caminhos (diretorio observado + "/" + nome) alterados desde a ultima chamada,
+	// sem repeticao. Pode ser chamado de qualquer thread
+	std::vector<std::string> TakeChanges();
+
+	bool IsUsingInotify() const { return InotifyFile >= 0; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	void AddChange(const std::string& FilePath);
+
+	bool StartInotify();
+	bool AddInotifyWatch(const std::string& Directory);
+	void InotifyLoop();
+	void PollLoop();
+
+	std::vector<std::string> WatchedDirectories;
+	Clock::duration Debounce{};
+	Clock::duration PollInterval{};
+
+	std::thread WatchThread;
+	std::atomic<bool> StopRequested{false};
+
+	// Ultima mudanca de cada arquivo ainda nao entregue
+	std::mutex ChangesMutex;
+	std::unordered_map<std::string, Clock::time_point> PendingChanges;
+
+	// inotify: descritor e o diretorio de cada watch
+	int InotifyFile = -1;
+	std::unordered_map<int, std::string> WatchDirectories;
+};
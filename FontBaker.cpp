@@ -0,0 +1,108 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "JobSystem.h"
+#include "GlyphAtlas.h"
+
+// Cozinha o atlas SDF de uma fonte para as faixas pedidas. O arquivo gerado e o
+// mesmo que o LabelLayer grava na primeira execucao (fonte.ttf.glyphs) e carrega
+// sem rasterizar nada enquanto a fonte e os parametros nao mudarem
+//
+// Uso: FontBaker fonte.ttf saida.glyphs [--height 32] [--size 1024] [--range 4E00-9FFF]...
+// As faixas sao em hexadecimal; sem --range, latim basico e Latin-1
+
+bool ParseRange(const std::string& Text, CodepointRange& Range)
+{
+	const std::size_t Separator = Text.find('-');
+	char* End = nullptr;
+	Range.First = static_cast<int>(std::strtol(Text.c_str(), &End, 16));
+	Range.Last = Separator == std::string::npos ? Range.First : static_cast<int>(std::strtol(Text.c_str() + Separator + 1, &End, 16));
+	return Range.First >= 0 && Range.First <= Range.Last && Range.Last <= 0x10FFFF;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		std::cerr << "Uso: FontBaker fonte.ttf saida.glyphs [--height 32] [--size 1024] [--range 4E00-9FFF]..." << std::endl;
+		return 1;
+	}
+
+	const std::string FontFile = argv[1];
+	const std::string OutputFile = argv[2];
+	float PixelHeight = 32.0f;
+	int AtlasSize = 1024;
+	std::vector<CodepointRange> Ranges;
+	for (int ArgIndex = 3; ArgIndex < argc; ++ArgIndex)
+	{
+		const std::string Argument{argv[ArgIndex]};
+		if (Argument == "--height" && ArgIndex + 1 < argc)
+		{
+			PixelHeight = static_cast<float>(std::atof(argv[++ArgIndex]));
+		}
+		else if (Argument == "--size" && ArgIndex + 1 < argc)
+		{
+			AtlasSize = std::atoi(argv[++ArgIndex]);
+		}
+		else if (Argument == "--range" && ArgIndex + 1 < argc)
+		{
+			CodepointRange Range;
+			if (!ParseRange(argv[++ArgIndex], Range))
+			{
+				std::cerr << "Faixa invalida: " << argv[ArgIndex] << std::endl;
+				return 1;
+			}
+			Ranges.push_back(Range);
+		}
+	}
+	if (Ranges.empty())
+	{
+		Ranges = DefaultGlyphRanges;
+	}
+
+	JobSystem::Get().Init();
+
+	GlyphAtlas Atlas;
+	if (!Atlas.Init(FontFile, PixelHeight, AtlasSize))
+	{
+		JobSystem::Get().Shutdown();
+		return 1;
+	}
+
+	const auto BakeStart = std::chrono::steady_clock::now();
+	const bool Saved = Atlas.Bake(Ranges, OutputFile);
+	const double BakeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - BakeStart).count();
+
+	const GlyphAtlas::Stats BakeStats = Atlas.GetStats();
+	std::cout << std::fixed << std::setprecision(1);
+	std::cout << BakeStats.NumGlyphs << " glifos em " << BakeSeconds * 1000.0 << " ms (" << JobSystem::Get().GetNumThreads() << " threads), "
+		<< Atlas.GetBakedHeight() << " de " << AtlasSize << " linhas do atlas ocupadas";
+	if (BakeStats.NumRejected > 0)
+	{
+		std::cout << ", " << BakeStats.NumRejected << " nao couberam";
+	}
+	std::cout << std::endl;
+
+	if (!Saved)
+	{
+		JobSystem::Get().Shutdown();
+		return 1;
+	}
+
+	// Conferir o arquivo carregando-o como o programa faria
+	GlyphAtlas Loaded;
+	Loaded.Init(FontFile, PixelHeight, AtlasSize);
+	const auto LoadStart = std::chrono::steady_clock::now();
+	const bool LoadedOk = Loaded.LoadBaked(OutputFile);
+	const double LoadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - LoadStart).count();
+	std::cout << "Carregado em " << std::setprecision(2) << LoadSeconds * 1000.0 << " ms: "
+		<< Loaded.GetStats().NumBaked << " glifos" << (LoadedOk ? "" : " (FALHOU)") << std::endl;
+
+	JobSystem::Get().Shutdown();
+
+	return LoadedOk ? 0 : 1;
+}
@@ -0,0 +1,199 @@
+#include "FrameScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <thread>
+
+#include <GLFW/glfw3.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#endif
+
+namespace
+{
+	// Peso de cada nova amostra na estimativa movel do sleep
+	constexpr double SleepEstimateWeight = 0.05;
+
+	// Duracao de cada fatia de sono. Fatias curtas deixam a estimativa mais estavel
+	constexpr double SleepSlice = 1e-3;
+
+	double ToSeconds(std::chrono::steady_clock::duration Duration)
+	{
+		return std::chrono::duration<double>(Duration).count();
+	}
+}
+
+void FrameScheduler::Init(const Settings& NewSettings)
+{
+	Config = NewSettings;
+	TickDuration = 1.0 / std::max(1.0, Config.SimulationRate);
+	Accumulator = 0.0;
+	FrameTime = 0.0;
+
+#ifdef _WIN32
+	// O quantum padrao do agendador do Windows e de ~15.6 ms, grande demais para dormir por frame
+	HasTimerPeriod = timeBeginPeriod(1) == TIMERR_NOERROR;
+#endif
+
+	glfwSwapInterval(Config.SwapInterval);
+
+	FrameStart = Clock::now();
+	NextDeadline = FrameStart;
+	IntervalStart = FrameStart;
+	IntervalFrames = 0;
+}
+
+void FrameScheduler::Shutdown()
+{
+#ifdef _WIN32
+	if (HasTimerPeriod)
+	{
+		timeEndPeriod(1);
+	}
+#endif
+	HasTimerPeriod = false;
+}
+
+void FrameScheduler::SetTargetFrameRate(double FramesPerSecond)
+{
+	Config.TargetFrameRate = std::max(0.0, FramesPerSecond);
+	NextDeadline = Clock::now();
+}
+
+void FrameScheduler::SetSwapInterval(int Interval)
+{
+	Config.SwapInterval = Interval;
+	glfwSwapInterval(Interval);
+}
+
+int FrameScheduler::BeginFrame()
+{
+	const Clock::time_point Now = Clock::now();
+	FrameTime = ToSeconds(Now - FrameStart);
+	FrameStart = Now;
+
+	RecordFrame(FrameTime);
+
+	// Depois de uma travada (janela arrastada, breakpoint) descarta o tempo que
+	// nao cabe em MaxTicksPerFrame passos em vez de tentar alcanca-lo
+	Accumulator += std::min(FrameTime, TickDuration * Config.MaxTicksPerFrame);
+
+	int NumTicks = 0;
+	while (Accumulator >= TickDuration)
+	{
+		Accumulator -= TickDuration;
+		++NumTicks;
+	}
+	return NumTicks;
+}
+
+void FrameScheduler::EndFrame()
+{
+	if (Config.TargetFrameRate <= 0.0)
+	{
+		return;
+	}
+
+	const auto Period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / Config.TargetFrameRate));
+	NextDeadline += Period;
+
+	// Se o frame passou do prazo por mais de um periodo, recomeca a contagem a partir
+	// de agora, senao os proximos frames sairiam em rajada para recuperar o atraso
+	const Clock::time_point Now = Clock::now();
+	if (NextDeadline + Period < Now)
+	{
+		NextDeadline = Now;
+		return;
+	}
+
+	WaitUntil(NextDeadline);
+}
+
+void FrameScheduler::WaitUntil(Clock::time_point Deadline)
+{
+	// Dorme em fatias de 1 ms enquanto o restante for maior que o pior caso
+	// estimado de uma fatia, medindo quanto cada uma realmente durou
+	Clock::time_point Now = Clock::now();
+	while (true)
+	{
+		const double Remaining = ToSeconds(Deadline - Now);
+		const double SleepMargin = SleepMean + std::sqrt(SleepVariance);
+		if (Remaining <= SleepMargin)
+		{
+			break;
+		}
+
+		std::this_thread::sleep_for(std::chrono::duration<double>(SleepSlice));
+		const Clock::time_point AfterSleep = Clock::now();
+		const double Slept = ToSeconds(AfterSleep - Now);
+		IntervalSleep += Slept;
+		Now = AfterSleep;
+
+		const double Delta = Slept - SleepMean;
+		SleepMean += SleepEstimateWeight * Delta;
+		SleepVariance = (1.0 - SleepEstimateWeight) * (SleepVariance + SleepEstimateWeight * Delta * Delta);
+	}
+
+	// O resto, menor que uma fatia de sono, e girando
+	const Clock::time_point SpinStart = Now;
+	while (Now < Deadline)
+	{
+		std::this_thread::yield();
+		Now = Clock::now();
+	}
+	IntervalSpin += ToSeconds(Now - SpinStart);
+}
+
+void FrameScheduler::RecordFrame(double Seconds)
+{
+	if (IntervalFrames == 0)
+	{
+		IntervalMin = Seconds;
+		IntervalMax = Seconds;
+	}
+	++IntervalFrames;
+	IntervalSum += Seconds;
+	IntervalSumSquares += Seconds * Seconds;
+	IntervalMin = std::min(IntervalMin, Seconds);
+	IntervalMax = std::max(IntervalMax, Seconds);
+
+	if (ToSeconds(FrameStart - IntervalStart) >= Config.StatsInterval)
+	{
+		ReportStats();
+	}
+}
+
+void FrameScheduler::ReportStats()
+{
+	const double IntervalSeconds = ToSeconds(FrameStart - IntervalStart);
+	const double Mean = IntervalSum / IntervalFrames;
+	const double Variance = std::max(0.0, IntervalSumSquares / IntervalFrames - Mean * Mean);
+
+	LastStats.NumFrames = IntervalFrames;
+	LastStats.MeanFrameTime = Mean;
+	LastStats.StdDevFrameTime = std::sqrt(Variance);
+	LastStats.MinFrameTime = IntervalMin;
+	LastStats.MaxFrameTime = IntervalMax;
+	LastStats.SleepFraction = IntervalSleep / IntervalSeconds;
+	LastStats.SpinFraction = IntervalSpin / IntervalSeconds;
+
+	std::cout << "Frames: " << LastStats.NumFrames
+		<< " | media " << LastStats.MeanFrameTime * 1000.0 << " ms"
+		<< " | desvio " << LastStats.StdDevFrameTime * 1000.0 << " ms"
+		<< " | min " << LastStats.MinFrameTime * 1000.0 << " ms"
+		<< " | max " << LastStats.MaxFrameTime * 1000.0 << " ms"
+		<< " | dormindo " << LastStats.SleepFraction * 100.0 << "%"
+		<< " | girando " << LastStats.SpinFraction * 100.0 << "%" << std::endl;
+
+	IntervalStart = FrameStart;
+	IntervalFrames = 0;
+	IntervalSum = 0.0;
+	IntervalSumSquares = 0.0;
+	IntervalSleep = 0.0;
+	IntervalSpin = 0.0;
+}
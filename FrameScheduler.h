@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+
+// Controla o ritmo do loop principal: mede o tempo de cada frame, segura o frame
+// ate o prazo da taxa alvo (dormindo a maior parte e girando so no final, para
+// pouco jitter sem queimar um nucleo) e divide o tempo decorrido em passos fixos
+// de simulacao, independentes da taxa de renderizacao
+class FrameScheduler
+{
+public:
+	struct Settings
+	{
+		double TargetFrameRate = 60.0;      // Quadros por segundo. 0 = sem limite (so o vsync)
+		int SwapInterval = 1;               // Repassado para glfwSwapInterval
+		double SimulationRate = 120.0;      // Passos fixos de simulacao por segundo
+		int MaxTicksPerFrame = 8;           // Evita a espiral da morte depois de uma travada
+		double StatsInterval = 5.0;         // Segundos entre os relatorios de tempo de frame
+	};
+
+	struct Stats
+	{
+		int NumFrames = 0;
+		double MeanFrameTime = 0.0;         // Segundos
+		double StdDevFrameTime = 0.0;
+		double MinFrameTime = 0.0;
+		double MaxFrameTime = 0.0;
+		double SleepFraction = 0.0;         // Parte do intervalo gasta dormindo
+		double SpinFraction = 0.0;          // Parte do intervalo gasta girando
+	};
+
+	// Aplica o swap interval no contexto atual e zera os relogios
+	void Init(const Settings& NewSettings);
+	void Shutdown();
+
+	void SetTargetFrameRate(double FramesPerSecond);
+	void SetSwapInterval(int Interval);
+
+	// Inicio do frame: mede o frame anterior e devolve quantos passos fixos de
+	// simulacao devem rodar agora
+	int BeginFrame();
+
+	// Depois do glfwSwapBuffers: espera o prazo do proximo frame
+	void EndFrame();
+
+	double GetTickDuration() const { return TickDuration; }
+
+	// Fracao do passo seguinte ja decorrida, para interpolar o estado da simulacao
+	double GetInterpolationAlpha() const { return Accumulator / TickDuration; }
+
+	double GetFrameTime() const { return FrameTime; }
+
+	// Estatisticas do ultimo intervalo completo
+	const Stats& GetStats() const { return LastStats; }
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	void WaitUntil(Clock::time_point Deadline);
+	void RecordFrame(double Seconds);
+	void ReportStats();
+
+	Settings Config;
+	double TickDuration = 1.0 / 120.0;
+	double Accumulator = 0.0;
+	double FrameTime = 0.0;
+
+	Clock::time_point FrameStart;
+	Clock::time_point NextDeadline;
+
+	// Estimativa de quanto um sleep_for de 1 ms realmente dorme (media e variancia
+	// moveis). O sono para quando o restante fica abaixo de media + desvio
+	double SleepMean = 1e-3;
+	double SleepVariance = 0.0;
+
+	// Acumuladores do intervalo corrente
+	Clock::time_point IntervalStart;
+	int IntervalFrames = 0;
+	double IntervalSum = 0.0;
+	double IntervalSumSquares = 0.0;
+	double IntervalMin = 0.0;
+	double IntervalMax = 0.0;
+	double IntervalSleep = 0.0;
+	double IntervalSpin = 0.0;
+	Stats LastStats;
+
+	bool HasTimerPeriod = false;
+};
@@ -0,0 +1,713 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <charconv>
+#include <cstdlib>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "FileReader.h"
+#include "GeoData.h"
+
+// Converte GeoJSON e CSV no arquivo binario de dados vetoriais (GeoData.h), que o
+// visualizador mapeia e usa sem interpretar texto nenhum
+//
+// Uso: GeoConverter entrada.geojson [entrada.csv ...] saida.geodata [--index-level 5] [--name-field name]
+//
+// GeoJSON: FeatureCollection, Feature ou geometria solta, com todos os tipos de
+// geometria. MultiPolygon vira uma feicao com todos os aneis.
+// CSV: cabecalho com as colunas lat/latitude e lon/lng/longitude. Com uma coluna id,
+// linhas seguidas com o mesmo id formam uma polilinha; sem ela, cada linha e um ponto
+
+// Elipsoide do visualizador, usado nos erros de simplificacao gravados no arquivo
+const glm::dvec3 EllipsoidRadii{6378137.0, 6378137.0, 6356752.314245};
+
+// Documento JSON completo em memoria. A conversao e offline, entao simplicidade
+// vale mais que memoria aqui
+struct JsonValue
+{
+	enum class Kind
+	{
+		Null,
+		Bool,
+		Number,
+		String,
+		Array,
+		Object
+	};
+
+	Kind Type = Kind::Null;
+	double Number = 0.0;
+	std::string String;
+	std::vector<JsonValue> Elements;
+	std::vector<std::pair<std::string, JsonValue>> Members;
+
+	const JsonValue* Find(std::string_view Key) const
+	{
+		for (const auto& Member : Members)
+		{
+			if (Member.first == Key)
+			{
+				return &Member.second;
+			}
+		}
+		return nullptr;
+	}
+};
+
+class JsonParser
+{
+public:
+	explicit JsonParser(std::string_view InText) : Text{InText} {}
+
+	bool Parse(JsonValue& Value)
+	{
+		SkipWhitespace();
+		if (Text.substr(Position, 3) == "\xEF\xBB\xBF")
+		{
+			Position += 3;
+		}
+		return ParseValue(Value) && (SkipWhitespace(), Position == Text.size());
+	}
+
+	std::size_t GetPosition() const { return Position; }
+
+private:
+	void SkipWhitespace()
+	{
+		while (Position < Text.size() && (Text[Position] == ' ' || Text[Position] == '\n' || Text[Position] == '\r' || Text[Position] == '\t'))
+		{
+			++Position;
+		}
+	}
+
+	bool Consume(char Expected)
+	{
+		SkipWhitespace();
+		if (Position < Text.size() && Text[Position] == Expected)
+		{
+			++Position;
+			return true;
+		}
+		return false;
+	}
+
+	bool ParseLiteral(std::string_view Literal)
+	{
+		if (Text.substr(Position, Literal.size()) != Literal)
+		{
+			return false;
+		}
+		Position += Literal.size();
+		return true;
+	}
+
+	bool ParseValue(JsonValue& Value)
+	{
+		SkipWhitespace();
+		if (Position >= Text.size())
+		{
+			return false;
+		}
+
+		switch (Text[Position])
+		{
+		case '{':
+			return ParseObject(Value);
+		case '[':
+			return ParseArray(Value);
+		case '"':
+			Value.Type = JsonValue::Kind::String;
+			return ParseString(Value.String);
+		case 't':
+			Value.Type = JsonValue::Kind::Bool;
+			Value.Number = 1.0;
+			return ParseLiteral("true");
+		case 'f':
+			Value.Type = JsonValue::Kind::Bool;
+			return ParseLiteral("false");
+		case 'n':
+			return ParseLiteral("null");
+		default:
+			return ParseNumber(Value);
+		}
+	}
+
+	bool ParseNumber(JsonValue& Value)
+	{
+		const char* Begin = Text.data() + Position;
+		const char* End = Text.data() + Text.size();
+		// from_chars nao aceita o sinal de mais, que o JSON tambem nao permite
+		const std::from_chars_result Result = std::from_chars(Begin, End, Value.Number);
+		if (Result.ec != std::errc{})
+		{
+			return false;
+		}
+		Value.Type = JsonValue::Kind::Number;
+		Position += Result.ptr - Begin;
+		return true;
+	}
+
+	bool ParseString(std::string& Output)
+	{
+		++Position;
+		Output.clear();
+		while (Position < Text.size())
+		{
+			const char Character = Text[Position++];
+			if (Character == '"')
+			{
+				return true;
+			}
+			if (Character != '\\')
+			{
+				Output.push_back(Character);
+				continue;
+			}
+			if (Position >= Text.size())
+			{
+				return false;
+			}
+
+			const char Escape = Text[Position++];
+			switch (Escape)
+			{
+			case 'b': Output.push_back('\b'); break;
+			case 'f': Output.push_back('\f'); break;
+			case 'n': Output.push_back('\n'); break;
+			case 'r': Output.push_back('\r'); break;
+			case 't': Output.push_back('\t'); break;
+			case 'u':
+			{
+				unsigned int Codepoint = 0;
+				if (!ParseHex4(Codepoint))
+				{
+					return false;
+				}
+				// Par substituto UTF-16
+				if (Codepoint >= 0xD800 && Codepoint < 0xDC00 && Text.substr(Position, 2) == "\\u")
+				{
+					Position += 2;
+					unsigned int Low = 0;
+					if (!ParseHex4(Low))
+					{
+						return false;
+					}
+					Codepoint = 0x10000 + ((Codepoint - 0xD800) << 10) + (Low - 0xDC00);
+				}
+				AppendUtf8(Output, Codepoint);
+				break;
+			}
+			default:
+				Output.push_back(Escape);
+				break;
+			}
+		}
+		return false;
+	}
+
+	bool ParseHex4(unsigned int& Value)
+	{
+		if (Position + 4 > Text.size())
+		{
+			return false;
+		}
+		const std::from_chars_result Result = std::from_chars(Text.data() + Position, Text.data() + Position + 4, Value, 16);
+		Position += 4;
+		return Result.ec == std::errc{} && Result.ptr == Text.data() + Position;
+	}
+
+	static void AppendUtf8(std::string& Output, unsigned int Codepoint)
+	{
+		if (Codepoint < 0x80)
+		{
+			Output.push_back(static_cast<char>(Codepoint));
+		}
+		else if (Codepoint < 0x800)
+		{
+			Output.push_back(static_cast<char>(0xC0 | (Codepoint >> 6)));
+			Output.push_back(static_cast<char>(0x80 | (Codepoint & 0x3F)));
+		}
+		else if (Codepoint < 0x10000)
+		{
+			Output.push_back(static_cast<char>(0xE0 | (Codepoint >> 12)));
+			Output.push_back(static_cast<char>(0x80 | ((Codepoint >> 6) & 0x3F)));
+			Output.push_back(static_cast<char>(0x80 | (Codepoint & 0x3F)));
+		}
+		else
+		{
+			Output.push_back(static_cast<char>(0xF0 | (Codepoint >> 18)));
+			Output.push_back(static_cast<char>(0x80 | ((Codepoint >> 12) & 0x3F)));
+			Output.push_back(static_cast<char>(0x80 | ((Codepoint >> 6) & 0x3F)));
+			Output.push_back(static_cast<char>(0x80 | (Codepoint & 0x3F)));
+		}
+	}
+
+	bool ParseArray(JsonValue& Value)
+	{
+		++Position;
+		Value.Type = JsonValue::Kind::Array;
+		if (Consume(']'))
+		{
+			return true;
+		}
+		do
+		{
+			Value.Elements.emplace_back();
+			if (!ParseValue(Value.Elements.back()))
+			{
+				return false;
+			}
+		} while (Consume(','));
+		return Consume(']');
+	}
+
+	bool ParseObject(JsonValue& Value)
+	{
+		++Position;
+		Value.Type = JsonValue::Kind::Object;
+		if (Consume('}'))
+		{
+			return true;
+		}
+		do
+		{
+			SkipWhitespace();
+			Value.Members.emplace_back();
+			if (Position >= Text.size() || Text[Position] != '"' || !ParseString(Value.Members.back().first) ||
+				!Consume(':') || !ParseValue(Value.Members.back().second))
+			{
+				return false;
+			}
+		} while (Consume(','));
+		return Consume('}');
+	}
+
+	std::string_view Text;
+	std::size_t Position = 0;
+};
+
+// Posicao GeoJSON [longitude, latitude] em (latitude, longitude)
+static bool ReadPosition(const JsonValue& Value, glm::dvec2& LatLon)
+{
+	if (Value.Type != JsonValue::Kind::Array || Value.Elements.size() < 2 ||
+		Value.Elements[0].Type != JsonValue::Kind::Number || Value.Elements[1].Type != JsonValue::Kind::Number)
+	{
+		return false;
+	}
+	LatLon = glm::dvec2{Value.Elements[1].Number, Value.Elements[0].Number};
+	return true;
+}
+
+static void ReadPositions(const JsonValue& Value, std::vector<glm::dvec2>& Points)
+{
+	glm::dvec2 LatLon;
+	for (const JsonValue& Element : Value.Elements)
+	{
+		if (ReadPosition(Element, LatLon))
+		{
+			Points.push_back(LatLon);
+		}
+	}
+}
+
+struct ConversionStats
+{
+	int NumConverted = 0;
+	int NumSkipped = 0;
+};
+
+static void AddFeature(GeoDataWriter& Writer, GeoFeatureType Type, const std::vector<std::vector<glm::dvec2>>& Parts, const std::string& Name, ConversionStats& Stats)
+{
+	if (Writer.AddFeature(Type, Parts, Name))
+	{
+		++Stats.NumConverted;
+	}
+	else
+	{
+		++Stats.NumSkipped;
+	}
+}
+
+static void ConvertGeometry(const JsonValue& Geometry, const std::string& Name, GeoDataWriter& Writer, ConversionStats& Stats)
+{
+	const JsonValue* Type = Geometry.Find("type");
+	const JsonValue* Coordinates = Geometry.Find("coordinates");
+	if (Type == nullptr)
+	{
+		++Stats.NumSkipped;
+		return;
+	}
+
+	if (Type->String == "GeometryCollection")
+	{
+		if (const JsonValue* Geometries = Geometry.Find("geometries"))
+		{
+			for (const JsonValue& Child : Geometries->Elements)
+			{
+				ConvertGeometry(Child, Name, Writer, Stats);
+			}
+		}
+		return;
+	}
+	if (Coordinates == nullptr || Coordinates->Type != JsonValue::Kind::Array)
+	{
+		++Stats.NumSkipped;
+		return;
+	}
+
+	std::vector<std::vector<glm::dvec2>> Parts;
+	if (Type->String == "Point")
+	{
+		Parts.emplace_back();
+		glm::dvec2 LatLon;
+		if (ReadPosition(*Coordinates, LatLon))
+		{
+			Parts.back().push_back(LatLon);
+		}
+		AddFeature(Writer, GeoFeatureType::Point, Parts, Name, Stats);
+	}
+	else if (Type->String == "MultiPoint" || Type->String == "LineString")
+	{
+		Parts.emplace_back();
+		ReadPositions(*Coordinates, Parts.back());
+		AddFeature(Writer, Type->String == "LineString" ? GeoFeatureType::Line : GeoFeatureType::Point, Parts, Name, Stats);
+	}
+	else if (Type->String == "MultiLineString" || Type->String == "Polygon")
+	{
+		for (const JsonValue& Line : Coordinates->Elements)
+		{
+			Parts.emplace_back();
+			ReadPositions(Line, Parts.back());
+		}
+		AddFeature(Writer, Type->String == "Polygon" ? GeoFeatureType::Polygon : GeoFeatureType::Line, Parts, Name, Stats);
+	}
+	else if (Type->String == "MultiPolygon")
+	{
+		for (const JsonValue& Polygon : Coordinates->Elements)
+		{
+			for (const JsonValue& Ring : Polygon.Elements)
+			{
+				Parts.emplace_back();
+				ReadPositions(Ring, Parts.back());
+			}
+		}
+		AddFeature(Writer, GeoFeatureType::Polygon, Parts, Name, Stats);
+	}
+	else
+	{
+		++Stats.NumSkipped;
+	}
+}
+
+static void ConvertGeoJsonObject(const JsonValue& Object, const std::string& NameField, GeoDataWriter& Writer, ConversionStats& Stats)
+{
+	const JsonValue* Type = Object.Find("type");
+	if (Type == nullptr || Type->Type != JsonValue::Kind::String)
+	{
+		++Stats.NumSkipped;
+		return;
+	}
+
+	if (Type->String == "FeatureCollection")
+	{
+		if (const JsonValue* Features = Object.Find("features"))
+		{
+			for (const JsonValue& Feature : Features->Elements)
+			{
+				ConvertGeoJsonObject(Feature, NameField, Writer, Stats);
+			}
+		}
+	}
+	else if (Type->String == "Feature")
+	{
+		std::string Name;
+		const JsonValue* Properties = Object.Find("properties");
+		const JsonValue* NameValue = Properties != nullptr ? Properties->Find(NameField) : nullptr;
+		if (NameValue != nullptr && NameValue->Type == JsonValue::Kind::String)
+		{
+			Name = NameValue->String;
+		}
+
+		const JsonValue* Geometry = Object.Find("geometry");
+		if (Geometry != nullptr && Geometry->Type == JsonValue::Kind::Object)
+		{
+			ConvertGeometry(*Geometry, Name, Writer, Stats);
+		}
+		else
+		{
+			++Stats.NumSkipped;
+		}
+	}
+	else
+	{
+		ConvertGeometry(Object, std::string{}, Writer, Stats);
+	}
+}
+
+static bool ConvertGeoJson(std::string_view Text, const std::string& NameField, GeoDataWriter& Writer, ConversionStats& Stats)
+{
+	JsonValue Root;
+	JsonParser Parser{Text};
+	if (!Parser.Parse(Root))
+	{
+		std::cerr << "JSON invalido perto do byte " << Parser.GetPosition() << std::endl;
+		return false;
+	}
+	ConvertGeoJsonObject(Root, NameField, Writer, Stats);
+	return true;
+}
+
+// Campos de uma linha CSV, com suporte a campos entre aspas
+static void SplitCsvLine(std::string_view Line, std::vector<std::string>& Fields)
+{
+	Fields.clear();
+	Fields.emplace_back();
+	bool InQuotes = false;
+	for (std::size_t Index = 0; Index < Line.size(); ++Index)
+	{
+		const char Character = Line[Index];
+		if (InQuotes)
+		{
+			if (Character == '"' && Index + 1 < Line.size() && Line[Index + 1] == '"')
+			{
+				Fields.back().push_back('"');
+				++Index;
+			}
+			else if (Character == '"')
+			{
+				InQuotes = false;
+			}
+			else
+			{
+				Fields.back().push_back(Character);
+			}
+		}
+		else if (Character == '"')
+		{
+			InQuotes = true;
+		}
+		else if (Character == ',')
+		{
+			Fields.emplace_back();
+		}
+		else if (Character != '\r')
+		{
+			Fields.back().push_back(Character);
+		}
+	}
+}
+
+static int FindColumn(const std::vector<std::string>& Header, std::initializer_list<std::string_view> Names)
+{
+	for (std::size_t Column = 0; Column < Header.size(); ++Column)
+	{
+		for (std::string_view Name : Names)
+		{
+			if (Header[Column] == Name)
+			{
+				return static_cast<int>(Column);
+			}
+		}
+	}
+	return -1;
+}
+
+static bool ConvertCsv(std::string_view Text, const std::string& NameField, GeoDataWriter& Writer, ConversionStats& Stats)
+{
+	std::vector<std::string> Fields;
+	std::vector<std::string> Header;
+	int LatitudeColumn = -1;
+	int LongitudeColumn = -1;
+	int IdColumn = -1;
+	int NameColumn = -1;
+
+	std::vector<std::vector<glm::dvec2>> Parts(1);
+	std::string CurrentId;
+	std::string CurrentName;
+	auto FlushLine = [&]()
+	{
+		if (!Parts[0].empty())
+		{
+			AddFeature(Writer, GeoFeatureType::Line, Parts, CurrentName, Stats);
+			Parts[0].clear();
+		}
+	};
+
+	std::size_t LineStart = 0;
+	while (LineStart < Text.size())
+	{
+		std::size_t LineEnd = Text.find('\n', LineStart);
+		if (LineEnd == std::string_view::npos)
+		{
+			LineEnd = Text.size();
+		}
+		SplitCsvLine(Text.substr(LineStart, LineEnd - LineStart), Fields);
+		LineStart = LineEnd + 1;
+
+		if (Header.empty())
+		{
+			Header = Fields;
+			LatitudeColumn = FindColumn(Header, {"lat", "latitude", "Latitude"});
+			LongitudeColumn = FindColumn(Header, {"lon", "lng", "long", "longitude", "Longitude"});
+			IdColumn = FindColumn(Header, {"id", "line", "shape_id"});
+			NameColumn = FindColumn(Header, {NameField});
+			if (LatitudeColumn < 0 || LongitudeColumn < 0)
+			{
+				std::cerr << "CSV sem colunas de latitude e longitude" << std::endl;
+				return false;
+			}
+			continue;
+		}
+		if (Fields.size() <= static_cast<std::size_t>(std::max(LatitudeColumn, LongitudeColumn)))
+		{
+			continue;
+		}
+
+		glm::dvec2 LatLon;
+		const std::string& LatitudeText = Fields[LatitudeColumn];
+		const std::string& LongitudeText = Fields[LongitudeColumn];
+		if (std::from_chars(LatitudeText.data(), LatitudeText.data() + LatitudeText.size(), LatLon.x).ec != std::errc{} ||
+			std::from_chars(LongitudeText.data(), LongitudeText.data() + LongitudeText.size(), LatLon.y).ec != std::errc{})
+		{
+			++Stats.NumSkipped;
+			continue;
+		}
+		const std::string Name = NameColumn >= 0 && NameColumn < static_cast<int>(Fields.size()) ? Fields[NameColumn] : std::string{};
+
+		if (IdColumn < 0)
+		{
+			AddFeature(Writer, GeoFeatureType::Point, std::vector<std::vector<glm::dvec2>>(1, std::vector<glm::dvec2>{LatLon}), Name, Stats);
+			continue;
+		}
+
+		const std::string Id = IdColumn < static_cast<int>(Fields.size()) ? Fields[IdColumn] : std::string{};
+		if (Id != CurrentId)
+		{
+			FlushLine();
+			CurrentId = Id;
+			CurrentName = Name;
+		}
+		Parts[0].push_back(LatLon);
+	}
+	FlushLine();
+	return true;
+}
+
+static bool EndsWith(const std::string& Text, std::string_view Suffix)
+{
+	return Text.size() >= Suffix.size() && Text.compare(Text.size() - Suffix.size(), Suffix.size(), Suffix) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+	std::vector<std::string> Files;
+	int IndexLevel = 5;
+	std::string NameField = "name";
+	for (int ArgIndex = 1; ArgIndex < argc; ++ArgIndex)
+	{
+		const std::string Argument{argv[ArgIndex]};
+		if (Argument == "--index-level" && ArgIndex + 1 < argc)
+		{
+			IndexLevel = std::atoi(argv[++ArgIndex]);
+		}
+		else if (Argument == "--name-field" && ArgIndex + 1 < argc)
+		{
+			NameField = argv[++ArgIndex];
+		}
+		else
+		{
+			Files.push_back(Argument);
+		}
+	}
+	if (Files.size() < 2)
+	{
+		std::cerr << "Uso: GeoConverter entrada.geojson [entrada.csv ...] saida.geodata [--index-level 5] [--name-field name]" << std::endl;
+		return 1;
+	}
+	const std::string OutputFile = Files.back();
+	Files.pop_back();
+
+	const auto ConvertStart = std::chrono::steady_clock::now();
+	GeoDataWriter Writer{EllipsoidRadii};
+	std::size_t InputBytes = 0;
+	for (const std::string& InputFile : Files)
+	{
+		const FileContents Contents = ReadWholeFile(InputFile);
+		if (!Contents.IsValid())
+		{
+			std::cerr << "Falha ao abrir o arquivo: " << InputFile << std::endl;
+			return 1;
+		}
+		InputBytes += Contents.Size();
+
+		ConversionStats Stats;
+		const bool IsCsv = EndsWith(InputFile, ".csv") || EndsWith(InputFile, ".CSV");
+		const bool Converted = IsCsv ? ConvertCsv(Contents.View(), NameField, Writer, Stats) : ConvertGeoJson(Contents.View(), NameField, Writer, Stats);
+		if (!Converted)
+		{
+			std::cerr << "Falha ao converter: " << InputFile << std::endl;
+			return 1;
+		}
+		std::cout << InputFile << ": " << Stats.NumConverted << " feicoes";
+		if (Stats.NumSkipped > 0)
+		{
+			std::cout << ", " << Stats.NumSkipped << " ignoradas (vazias ou invalidas)";
+		}
+		std::cout << std::endl;
+	}
+
+	if (!Writer.Write(OutputFile, IndexLevel))
+	{
+		return 1;
+	}
+	const double ConvertSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - ConvertStart).count();
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << Writer.GetNumFeatures() << " feicoes, " << Writer.GetNumParts() << " partes, " << Writer.GetNumPoints() << " pontos em "
+		<< ConvertSeconds * 1000.0 << " ms; coordenadas com "
+		<< (Writer.GetNumPoints() > 0 ? double(Writer.GetCoordinateBytes()) / double(Writer.GetNumPoints()) : 0.0) << " bytes por ponto" << std::endl;
+
+	// Conferir o arquivo carregando-o e decodificando tudo como o programa faria
+	const auto LoadStart = std::chrono::steady_clock::now();
+	GeoDataFile Loaded;
+	const bool LoadedOk = Loaded.Load(OutputFile);
+	const double LoadSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - LoadStart).count();
+	if (!LoadedOk)
+	{
+		return 1;
+	}
+
+	const auto DecodeStart = std::chrono::steady_clock::now();
+	std::vector<glm::dvec2> LatLon;
+	std::uint64_t NumDecoded = 0;
+	bool DecodedOk = true;
+	for (std::uint32_t PartIndex = 0; PartIndex < Loaded.GetNumParts(); ++PartIndex)
+	{
+		DecodedOk = Loaded.DecodePart(PartIndex, LatLon) && DecodedOk;
+		NumDecoded += LatLon.size();
+	}
+	const double DecodeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - DecodeStart).count();
+	DecodedOk = DecodedOk && NumDecoded == Writer.GetNumPoints();
+
+	std::size_t MaxTileFeatures = 0;
+	std::vector<std::uint32_t> TileFeatures;
+	for (int Y = 0; Y < (1 << Loaded.GetIndexLevel()); ++Y)
+	{
+		for (int X = 0; X < (2 << Loaded.GetIndexLevel()); ++X)
+		{
+			Loaded.QueryTile(Loaded.GetIndexLevel(), X, Y, TileFeatures);
+			MaxTileFeatures = std::max(MaxTileFeatures, TileFeatures.size());
+		}
+	}
+
+	std::cout << "Carregado em " << LoadSeconds * 1000.0 << " ms, " << NumDecoded << " pontos decodificados em " << DecodeSeconds * 1000.0
+		<< " ms" << (DecodedOk ? "" : " (FALHOU)") << "; ate " << MaxTileFeatures << " feicoes por tile do nivel " << Loaded.GetIndexLevel()
+		<< " do indice" << std::endl;
+
+	return DecodedOk ? 0 : 1;
+}
@@ -0,0 +1,507 @@
+#include "GeoData.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#include "GlobeTiles.h"
+
+// Arquivo de dados vetoriais: cabecalho, feicoes, partes, inicio de cada balde do
+// indice, feicoes dos baldes, nomes, coordenadas e erros de simplificacao. Cada bloco
+// comeca alinhado em 8 bytes para as tabelas serem usadas direto do arquivo mapeado
+constexpr char GeoDataMagic[4] = {'B', 'M', 'G', 'D'};
+constexpr std::uint32_t GeoDataVersion = 2;
+
+// Unidades de coordenada por grau
+constexpr double CoordinateScale = 1e7;
+
+// Nivel maximo do indice: 2048 x 1024 baldes
+constexpr int MaxIndexLevel = 10;
+
+struct GeoDataHeader
+{
+	char Magic[4];
+	std::uint32_t Version;
+	std::uint32_t NumFeatures;
+	std::uint32_t NumParts;
+	std::uint64_t NumPoints;
+	std::int32_t IndexLevel;
+	std::uint32_t NumBucketFeatures;
+	std::uint64_t NamesSize;
+	std::uint64_t CoordinatesSize;
+};
+
+struct GeoDataLayout
+{
+	std::size_t NumBuckets = 0;
+	std::size_t FeaturesOffset = 0;
+	std::size_t PartsOffset = 0;
+	std::size_t BucketStartsOffset = 0;
+	std::size_t BucketFeaturesOffset = 0;
+	std::size_t NamesOffset = 0;
+	std::size_t CoordinatesOffset = 0;
+	std::size_t ErrorsOffset = 0;
+	std::size_t End = 0;
+};
+
+static std::size_t AlignTo8(std::size_t Offset)
+{
+	return (Offset + 7) & ~std::size_t{7};
+}
+
+static GeoDataLayout GetGeoDataLayout(const GeoDataHeader& Header)
+{
+	GeoDataLayout Layout;
+	Layout.NumBuckets = std::size_t(2 << Header.IndexLevel) * std::size_t(1 << Header.IndexLevel);
+	Layout.FeaturesOffset = AlignTo8(sizeof(GeoDataHeader));
+	Layout.PartsOffset = AlignTo8(Layout.FeaturesOffset + std::size_t(Header.NumFeatures) * sizeof(GeoFeature));
+	Layout.BucketStartsOffset = AlignTo8(Layout.PartsOffset + std::size_t(Header.NumParts) * sizeof(GeoPart));
+	Layout.BucketFeaturesOffset = AlignTo8(Layout.BucketStartsOffset + (Layout.NumBuckets + 1) * sizeof(std::uint32_t));
+	Layout.NamesOffset = AlignTo8(Layout.BucketFeaturesOffset + std::size_t(Header.NumBucketFeatures) * sizeof(std::uint32_t));
+	Layout.CoordinatesOffset = AlignTo8(Layout.NamesOffset + Header.NamesSize);
+	Layout.ErrorsOffset = AlignTo8(Layout.CoordinatesOffset + Header.CoordinatesSize);
+	Layout.End = Layout.ErrorsOffset + Header.NumPoints * sizeof(float);
+	return Layout;
+}
+
+// Tiles do nivel cobertos pelo retangulo (graus), no esquema de BuildGlobeTiles
+static void GetTileRange(int Level, double MinLatitude, double MinLongitude, double MaxLatitude, double MaxLongitude, int& MinX, int& MinY, int& MaxX, int& MaxY)
+{
+	const double TileSize = 180.0 / double(1 << Level);
+	const int NumTilesX = 2 << Level;
+	const int NumTilesY = 1 << Level;
+	MinX = std::clamp(static_cast<int>(std::floor((MinLongitude + 180.0) / TileSize)), 0, NumTilesX - 1);
+	MaxX = std::clamp(static_cast<int>(std::floor((MaxLongitude + 180.0) / TileSize)), 0, NumTilesX - 1);
+	MinY = std::clamp(static_cast<int>(std::floor((MinLatitude + 90.0) / TileSize)), 0, NumTilesY - 1);
+	MaxY = std::clamp(static_cast<int>(std::floor((MaxLatitude + 90.0) / TileSize)), 0, NumTilesY - 1);
+}
+
+static void WriteVarint(std::vector<unsigned char>& Output, std::uint64_t Value)
+{
+	while (Value >= 0x80)
+	{
+		Output.push_back(static_cast<unsigned char>(Value | 0x80));
+		Value >>= 7;
+	}
+	Output.push_back(static_cast<unsigned char>(Value));
+}
+
+static bool ReadVarint(const unsigned char*& Cursor, const unsigned char* End, std::uint64_t& Value)
+{
+	Value = 0;
+	for (int Shift = 0; Shift < 64 && Cursor < End; Shift += 7)
+	{
+		const unsigned char Byte = *Cursor++;
+		Value |= std::uint64_t(Byte & 0x7F) << Shift;
+		if ((Byte & 0x80) == 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+// Diferencas pequenas, positivas ou negativas, viram inteiros sem sinal pequenos
+static std::uint64_t EncodeZigZag(std::int64_t Value)
+{
+	return (static_cast<std::uint64_t>(Value) << 1) ^ static_cast<std::uint64_t>(Value >> 63);
+}
+
+static std::int64_t DecodeZigZag(std::uint64_t Value)
+{
+	return static_cast<std::int64_t>(Value >> 1) ^ -static_cast<std::int64_t>(Value & 1);
+}
+
+static double DistanceToSegment(const glm::dvec3& Point, const glm::dvec3& Start, const glm::dvec3& End)
+{
+	const glm::dvec3 Segment = End - Start;
+	const double LengthSquared = glm::dot(Segment, Segment);
+	const double T = LengthSquared > 0.0 ? glm::clamp(glm::dot(Point - Start, Segment) / LengthSquared, 0.0, 1.0) : 0.0;
+	return glm::length(Point - (Start + Segment * T));
+}
+
+std::vector<float> ComputeSimplificationErrors(const std::vector<glm::dvec3>& Points)
+{
+	constexpr float Infinity = std::numeric_limits<float>::infinity();
+
+	std::vector<float> Errors(Points.size(), 0.0f);
+	if (Points.empty())
+	{
+		return Errors;
+	}
+	Errors.front() = Infinity;
+	Errors.back() = Infinity;
+
+	// Pilha explicita: linhas de costa com milhoes de pontos estourariam a recursao
+	struct Span
+	{
+		std::size_t First;
+		std::size_t Last;
+		float ParentError;
+	};
+	std::vector<Span> Stack{Span{0, Points.size() - 1, Infinity}};
+	while (!Stack.empty())
+	{
+		const Span Current = Stack.back();
+		Stack.pop_back();
+		if (Current.Last <= Current.First + 1)
+		{
+			continue;
+		}
+
+		double MaxDistance = -1.0;
+		std::size_t MaxIndex = Current.First + 1;
+		for (std::size_t PointIndex = Current.First + 1; PointIndex < Current.Last; ++PointIndex)
+		{
+			const double Distance = DistanceToSegment(Points[PointIndex], Points[Current.First], Points[Current.Last]);
+			if (Distance > MaxDistance)
+			{
+				MaxDistance = Distance;
+				MaxIndex = PointIndex;
+			}
+		}
+
+		const float Error = std::min(static_cast<float>(MaxDistance), Current.ParentError);
+		Errors[MaxIndex] = Error;
+		Stack.push_back(Span{Current.First, MaxIndex, Error});
+		Stack.push_back(Span{MaxIndex, Current.Last, Error});
+	}
+
+	return Errors;
+}
+
+bool GeoDataWriter::AddFeature(GeoFeatureType Type, const std::vector<std::vector<glm::dvec2>>& InputParts, const std::string& Name)
+{
+	const std::size_t MinPoints = Type == GeoFeatureType::Point ? 1 : Type == GeoFeatureType::Line ? 2 : 4;
+
+	GeoFeature Feature{};
+	Feature.FirstPart = static_cast<std::uint32_t>(Parts.size());
+	Feature.Type = Type;
+
+	glm::ivec2 Min{std::numeric_limits<int>::max()};
+	glm::ivec2 Max{std::numeric_limits<int>::min()};
+	std::vector<glm::ivec2> Quantized;
+	std::vector<glm::dvec3> Positions;
+	for (const std::vector<glm::dvec2>& InputPart : InputParts)
+	{
+		Quantized.clear();
+		for (const glm::dvec2& LatLon : InputPart)
+		{
+			const glm::ivec2 Point{
+				static_cast<int>(std::lround(std::clamp(LatLon.x, -90.0, 90.0) * CoordinateScale)),
+				static_cast<int>(std::lround(std::clamp(LatLon.y, -180.0, 180.0) * CoordinateScale))};
+			if (Type == GeoFeatureType::Point || Quantized.empty() || Point != Quantized.back())
+			{
+				Quantized.push_back(Point);
+			}
+		}
+		if (Type == GeoFeatureType::Polygon && !Quantized.empty() && Quantized.front() != Quantized.back())
+		{
+			Quantized.push_back(Quantized.front());
+		}
+		if (Quantized.size() < MinPoints)
+		{
+			continue;
+		}
+
+		Parts.push_back(GeoPart{Coordinates.size(), NumPoints, static_cast<std::uint32_t>(Quantized.size()), 0});
+		glm::ivec2 Previous{0};
+		for (const glm::ivec2& Point : Quantized)
+		{
+			WriteVarint(Coordinates, EncodeZigZag(std::int64_t(Point.x) - Previous.x));
+			WriteVarint(Coordinates, EncodeZigZag(std::int64_t(Point.y) - Previous.y));
+			Previous = Point;
+			Min = glm::min(Min, Point);
+			Max = glm::max(Max, Point);
+		}
+		NumPoints += Quantized.size();
+
+		// Os erros sao medidos nos pontos ja quantizados, os mesmos que DecodePart devolve
+		if (Type == GeoFeatureType::Point)
+		{
+			Errors.resize(NumPoints, std::numeric_limits<float>::infinity());
+			continue;
+		}
+		Positions.clear();
+		for (const glm::ivec2& Point : Quantized)
+		{
+			Positions.push_back(GeodeticToECEF(glm::radians(Point.x / CoordinateScale), glm::radians(Point.y / CoordinateScale), Radii));
+		}
+		const std::vector<float> PartErrors = ComputeSimplificationErrors(Positions);
+		Errors.insert(Errors.end(), PartErrors.begin(), PartErrors.end());
+	}
+
+	Feature.NumParts = static_cast<std::uint32_t>(Parts.size()) - Feature.FirstPart;
+	if (Feature.NumParts == 0)
+	{
+		return false;
+	}
+
+	// O retangulo em float e arredondado para fora para nunca cortar a feicao
+	constexpr float Infinity = std::numeric_limits<float>::infinity();
+	Feature.MinLatitude = std::nextafter(static_cast<float>(Min.x / CoordinateScale), -Infinity);
+	Feature.MinLongitude = std::nextafter(static_cast<float>(Min.y / CoordinateScale), -Infinity);
+	Feature.MaxLatitude = std::nextafter(static_cast<float>(Max.x / CoordinateScale), Infinity);
+	Feature.MaxLongitude = std::nextafter(static_cast<float>(Max.y / CoordinateScale), Infinity);
+
+	Feature.NameOffset = static_cast<std::uint32_t>(Names.size());
+	Feature.NameLength = static_cast<std::uint32_t>(Name.size());
+	Names.insert(Names.end(), Name.begin(), Name.end());
+
+	Features.push_back(Feature);
+	return true;
+}
+
+bool GeoDataWriter::Write(const std::string& OutputFile, int IndexLevel) const
+{
+	IndexLevel = std::clamp(IndexLevel, 0, MaxIndexLevel);
+	const int NumTilesX = 2 << IndexLevel;
+
+	// Indice em dois passos: contar as feicoes de cada balde e depois preenche-los
+	auto ForEachTile = [IndexLevel, NumTilesX](const GeoFeature& Feature, auto&& Func)
+	{
+		int MinX, MinY, MaxX, MaxY;
+		GetTileRange(IndexLevel, Feature.MinLatitude, Feature.MinLongitude, Feature.MaxLatitude, Feature.MaxLongitude, MinX, MinY, MaxX, MaxY);
+		for (int Y = MinY; Y <= MaxY; ++Y)
+		{
+			for (int X = MinX; X <= MaxX; ++X)
+			{
+				Func(std::size_t(Y) * NumTilesX + X);
+			}
+		}
+	};
+
+	std::vector<std::uint32_t> BucketStarts(std::size_t(NumTilesX) * std::size_t(1 << IndexLevel) + 1, 0);
+	for (const GeoFeature& Feature : Features)
+	{
+		ForEachTile(Feature, [&BucketStarts](std::size_t BucketIndex) { ++BucketStarts[BucketIndex + 1]; });
+	}
+	for (std::size_t BucketIndex = 1; BucketIndex < BucketStarts.size(); ++BucketIndex)
+	{
+		BucketStarts[BucketIndex] += BucketStarts[BucketIndex - 1];
+	}
+
+	std::vector<std::uint32_t> BucketFeatures(BucketStarts.back());
+	std::vector<std::uint32_t> Cursors(BucketStarts.begin(), BucketStarts.end() - 1);
+	for (std::uint32_t FeatureIndex = 0; FeatureIndex < Features.size(); ++FeatureIndex)
+	{
+		ForEachTile(Features[FeatureIndex], [&BucketFeatures, &Cursors, FeatureIndex](std::size_t BucketIndex) { BucketFeatures[Cursors[BucketIndex]++] = FeatureIndex; });
+	}
+
+	GeoDataHeader Header{};
+	std::memcpy(Header.Magic, GeoDataMagic, sizeof(Header.Magic));
+	Header.Version = GeoDataVersion;
+	Header.NumFeatures = static_cast<std::uint32_t>(Features.size());
+	Header.NumParts = static_cast<std::uint32_t>(Parts.size());
+	Header.NumPoints = NumPoints;
+	Header.IndexLevel = IndexLevel;
+	Header.NumBucketFeatures = static_cast<std::uint32_t>(BucketFeatures.size());
+	Header.NamesSize = Names.size();
+	Header.CoordinatesSize = Coordinates.size();
+	const GeoDataLayout Layout = GetGeoDataLayout(Header);
+
+	const std::string TemporaryFile = OutputFile + ".tmp";
+	bool Saved = false;
+	{
+		std::ofstream File{TemporaryFile, std::ios::binary | std::ios::trunc};
+		auto WriteBlock = [&File](std::size_t Offset, const void* Data, std::size_t Size)
+		{
+			const std::vector<char> Alignment(Offset - static_cast<std::size_t>(File.tellp()), 0);
+			File.write(Alignment.data(), Alignment.size());
+			File.write(static_cast<const char*>(Data), Size);
+		};
+		WriteBlock(0, &Header, sizeof(Header));
+		WriteBlock(Layout.FeaturesOffset, Features.data(), Features.size() * sizeof(GeoFeature));
+		WriteBlock(Layout.PartsOffset, Parts.data(), Parts.size() * sizeof(GeoPart));
+		WriteBlock(Layout.BucketStartsOffset, BucketStarts.data(), BucketStarts.size() * sizeof(std::uint32_t));
+		WriteBlock(Layout.BucketFeaturesOffset, BucketFeatures.data(), BucketFeatures.size() * sizeof(std::uint32_t));
+		WriteBlock(Layout.NamesOffset, Names.data(), Names.size());
+		WriteBlock(Layout.CoordinatesOffset, Coordinates.data(), Coordinates.size());
+		WriteBlock(Layout.ErrorsOffset, Errors.data(), Errors.size() * sizeof(float));
+		Saved = static_cast<bool>(File);
+	}
+	std::error_code Error;
+	if (Saved)
+	{
+		std::filesystem::rename(TemporaryFile, OutputFile, Error);
+		Saved = !Error;
+	}
+	if (!Saved)
+	{
+		std::filesystem::remove(TemporaryFile, Error);
+		std::cerr << "Falha ao gravar os dados vetoriais: " << OutputFile << std::endl;
+	}
+	return Saved;
+}
+
+bool GeoDataFile::Load(const std::string& FilePath)
+{
+	*this = GeoDataFile{};
+
+	FileContents NewContents = ReadWholeFile(FilePath);
+	if (!NewContents.IsValid())
+	{
+		return false;
+	}
+
+	GeoDataHeader Header{};
+	if (NewContents.Size() >= sizeof(Header))
+	{
+		std::memcpy(&Header, NewContents.Data(), sizeof(Header));
+	}
+	if (std::memcmp(Header.Magic, GeoDataMagic, sizeof(Header.Magic)) != 0 || Header.IndexLevel < 0 || Header.IndexLevel > MaxIndexLevel)
+	{
+		std::cerr << "Arquivo de dados vetoriais invalido: " << FilePath << std::endl;
+		return false;
+	}
+	if (Header.Version != GeoDataVersion)
+	{
+		std::cerr << "Versao " << Header.Version << " de dados vetoriais nao suportada, gere o arquivo de novo com o GeoConverter: " << FilePath << std::endl;
+		return false;
+	}
+	// Cada ponto tem um erro de 4 bytes no arquivo; isso tambem evita que um NumPoints
+	// corrompido estoure o calculo do tamanho esperado
+	if (Header.NumPoints > NewContents.Size() / sizeof(float))
+	{
+		std::cerr << "Arquivo de dados vetoriais truncado: " << FilePath << std::endl;
+		return false;
+	}
+
+	const GeoDataLayout Layout = GetGeoDataLayout(Header);
+	if (NewContents.Size() < Layout.End)
+	{
+		std::cerr << "Arquivo de dados vetoriais truncado: " << FilePath << std::endl;
+		return false;
+	}
+
+	const unsigned char* Data = NewContents.Data();
+	const GeoFeature* NewFeatures = reinterpret_cast<const GeoFeature*>(Data + Layout.FeaturesOffset);
+	const GeoPart* NewParts = reinterpret_cast<const GeoPart*>(Data + Layout.PartsOffset);
+	const std::uint32_t* NewBucketStarts = reinterpret_cast<const std::uint32_t*>(Data + Layout.BucketStartsOffset);
+	const std::uint32_t* NewBucketFeatures = reinterpret_cast<const std::uint32_t*>(Data + Layout.BucketFeaturesOffset);
+
+	// So as tabelas sao conferidas aqui; os varints das coordenadas sao conferidos ao
+	// decodificar cada parte
+	bool Consistent = NewBucketStarts[Layout.NumBuckets] == Header.NumBucketFeatures;
+	for (std::size_t BucketIndex = 0; Consistent && BucketIndex < Layout.NumBuckets; ++BucketIndex)
+	{
+		Consistent = NewBucketStarts[BucketIndex] <= NewBucketStarts[BucketIndex + 1];
+	}
+	for (std::uint32_t EntryIndex = 0; Consistent && EntryIndex < Header.NumBucketFeatures; ++EntryIndex)
+	{
+		Consistent = NewBucketFeatures[EntryIndex] < Header.NumFeatures;
+	}
+	for (std::uint32_t FeatureIndex = 0; Consistent && FeatureIndex < Header.NumFeatures; ++FeatureIndex)
+	{
+		const GeoFeature& Feature = NewFeatures[FeatureIndex];
+		Consistent = std::uint64_t(Feature.FirstPart) + Feature.NumParts <= Header.NumParts &&
+			std::uint64_t(Feature.NameOffset) + Feature.NameLength <= Header.NamesSize;
+	}
+	for (std::uint32_t PartIndex = 0; Consistent && PartIndex < Header.NumParts; ++PartIndex)
+	{
+		// Cada ponto ocupa ao menos dois bytes (um varint por eixo), o que tambem
+		// limita a reserva feita em DecodePart
+		const GeoPart& Part = NewParts[PartIndex];
+		Consistent = Part.CoordinateOffset <= Header.CoordinatesSize &&
+			std::uint64_t(Part.NumPoints) * 2 <= Header.CoordinatesSize - Part.CoordinateOffset &&
+			Part.FirstPoint <= Header.NumPoints && Part.NumPoints <= Header.NumPoints - Part.FirstPoint;
+	}
+	if (!Consistent)
+	{
+		std::cerr << "Arquivo de dados vetoriais corrompido: " << FilePath << std::endl;
+		return false;
+	}
+
+	Contents = std::move(NewContents);
+	NumFeatures = Header.NumFeatures;
+	NumParts = Header.NumParts;
+	NumPoints = Header.NumPoints;
+	IndexLevel = Header.IndexLevel;
+	Features = NewFeatures;
+	Parts = NewParts;
+	BucketStarts = NewBucketStarts;
+	BucketFeatures = NewBucketFeatures;
+	Names = reinterpret_cast<const char*>(Data + Layout.NamesOffset);
+	NamesSize = Header.NamesSize;
+	Coordinates = Data + Layout.CoordinatesOffset;
+	CoordinatesSize = Header.CoordinatesSize;
+	Errors = reinterpret_cast<const float*>(Data + Layout.ErrorsOffset);
+	return true;
+}
+
+std::string_view GeoDataFile::GetName(const GeoFeature& Feature) const
+{
+	return std::string_view{Names + Feature.NameOffset, Feature.NameLength};
+}
+
+bool GeoDataFile::DecodePart(std::uint32_t PartIndex, std::vector<glm::dvec2>& LatLon) const
+{
+	LatLon.clear();
+	// Load ja garantiu que a parte comeca dentro do bloco de coordenadas
+	const GeoPart& Part = Parts[PartIndex];
+	const unsigned char* Cursor = Coordinates + Part.CoordinateOffset;
+	const unsigned char* End = Coordinates + CoordinatesSize;
+	std::int64_t Latitude = 0;
+	std::int64_t Longitude = 0;
+	LatLon.reserve(Part.NumPoints);
+	for (std::uint32_t PointIndex = 0; PointIndex < Part.NumPoints; ++PointIndex)
+	{
+		std::uint64_t LatitudeDelta;
+		std::uint64_t LongitudeDelta;
+		if (!ReadVarint(Cursor, End, LatitudeDelta) || !ReadVarint(Cursor, End, LongitudeDelta))
+		{
+			LatLon.clear();
+			return false;
+		}
+		Latitude += DecodeZigZag(LatitudeDelta);
+		Longitude += DecodeZigZag(LongitudeDelta);
+		LatLon.push_back(glm::dvec2{Latitude / CoordinateScale, Longitude / CoordinateScale});
+	}
+	return true;
+}
+
+void GeoDataFile::QueryRegion(double MinLatitude, double MinLongitude, double MaxLatitude, double MaxLongitude, std::vector<std::uint32_t>& Result) const
+{
+	Result.clear();
+	if (!IsValid())
+	{
+		return;
+	}
+
+	int MinX, MinY, MaxX, MaxY;
+	GetTileRange(IndexLevel, MinLatitude, MinLongitude, MaxLatitude, MaxLongitude, MinX, MinY, MaxX, MaxY);
+	const int NumTilesX = 2 << IndexLevel;
+	for (int Y = MinY; Y <= MaxY; ++Y)
+	{
+		for (int X = MinX; X <= MaxX; ++X)
+		{
+			const std::size_t BucketIndex = std::size_t(Y) * NumTilesX + X;
+			for (std::uint32_t EntryIndex = BucketStarts[BucketIndex]; EntryIndex < BucketStarts[BucketIndex + 1]; ++EntryIndex)
+			{
+				const std::uint32_t FeatureIndex = BucketFeatures[EntryIndex];
+				const GeoFeature& Feature = Features[FeatureIndex];
+				if (Feature.MaxLatitude >= MinLatitude && Feature.MinLatitude <= MaxLatitude &&
+					Feature.MaxLongitude >= MinLongitude && Feature.MinLongitude <= MaxLongitude)
+				{
+					Result.push_back(FeatureIndex);
+				}
+			}
+		}
+	}
+
+	// Feicoes grandes aparecem em varios baldes
+	std::sort(Result.begin(), Result.end());
+	Result.erase(std::unique(Result.begin(), Result.end()), Result.end());
+}
+
+void GeoDataFile::QueryTile(int Level, int X, int Y, std::vector<std::uint32_t>& Result) const
+{
+	const double TileSize = 180.0 / double(1 << Level);
+	const double MinLatitude = -90.0 + Y * TileSize;
+	const double MinLongitude = -180.0 + X * TileSize;
+	QueryRegion(MinLatitude, MinLongitude, MinLatitude + TileSize, MinLongitude + TileSize, Result);
+}
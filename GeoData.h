@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "FileReader.h"
+
+// Arquivo binario de dados vetoriais (fronteiras, estradas, pontos de interesse)
+// gerado pelo GeoConverter a partir de GeoJSON ou CSV. O arquivo e mapeado e usado
+// como esta: as tabelas de feicoes, partes e do indice espacial sao lidas direto da
+// memoria e so as coordenadas das feicoes pedidas sao decodificadas.
+//
+// As coordenadas sao quantizadas em 1e-7 grau (pouco mais de 1 cm) e cada parte e
+// uma sequencia de diferencas entre pontos consecutivos em varint zigzag. O indice
+// espacial divide o mundo nos tiles de um nivel do quadtree do globo (a mesma divisao
+// de BuildGlobeTiles) e guarda, para cada tile, as feicoes cujo retangulo o cruza.
+// O erro de simplificacao de cada ponto de linhas e poligonos tambem vai no arquivo,
+// para que os niveis de detalhe da camada de polilinhas nao sejam calculados a cada
+// execucao
+
+enum class GeoFeatureType : std::uint32_t
+{
+	Point = 0,      // Cada parte e um conjunto de pontos soltos
+	Line = 1,       // Cada parte e uma polilinha
+	Polygon = 2     // Cada parte e um anel fechado (o ultimo ponto repete o primeiro)
+};
+
+// Uma feicao, exatamente como fica no arquivo
+struct GeoFeature
+{
+	float MinLatitude;      // Retangulo envolvente, graus
+	float MinLongitude;
+	float MaxLatitude;
+	float MaxLongitude;
+	std::uint32_t FirstPart;
+	std::uint32_t NumParts;
+	GeoFeatureType Type;
+	std::uint32_t NameOffset;   // Na tabela de nomes, sem terminador
+	std::uint32_t NameLength;
+	std::uint32_t Reserved;
+};
+
+// Uma parte de uma feicao, exatamente como fica no arquivo
+struct GeoPart
+{
+	std::uint64_t CoordinateOffset; // Em bytes, no bloco de coordenadas
+	std::uint64_t FirstPoint;       // No bloco de erros de simplificacao
+	std::uint32_t NumPoints;
+	std::uint32_t Reserved;
+};
+
+// Erro de simplificacao de cada ponto pelo Douglas-Peucker: o ponto so e mantido
+// com tolerancias menores ou iguais ao seu erro (em metros). Os erros sao monotonicos
+// (um ponto nunca tem erro maior que o do ponto que o introduziu), entao os niveis
+// ficam encaixados. As pontas recebem infinito
+std::vector<float> ComputeSimplificationErrors(const std::vector<glm::dvec3>& Points);
+
+// Monta o arquivo na memoria e grava tudo de uma vez. Usado pelo GeoConverter
+class GeoDataWriter
+{
+public:
+	// Os erros de simplificacao sao medidos em ECEF sobre este elipsoide
+	explicit GeoDataWriter(const glm::dvec3& EllipsoidRadii) : Radii{EllipsoidRadii} {}
+
+	// Latitude e longitude em graus. Pontos repetidos depois da quantizacao sao
+	// descartados; partes que ficam degeneradas tambem. Falso se nada sobrou
+	bool AddFeature(GeoFeatureType Type, const std::vector<std::vector<glm::dvec2>>& Parts, const std::string& Name);
+
+	// IndexLevel e o nivel do quadtree do globo usado pelo indice espacial
+	bool Write(const std::string& OutputFile, int IndexLevel) const;
+
+	std::size_t GetNumFeatures() const { return Features.size(); }
+	std::size_t GetNumParts() const { return Parts.size(); }
+	std::uint64_t GetNumPoints() const { return NumPoints; }
+	std::size_t GetCoordinateBytes() const { return Coordinates.size(); }
+
+private:
+	glm::dvec3 Radii;
+
+	std::vector<GeoFeature> Features;
+	std::vector<GeoPart> Parts;
+	std::vector<char> Names;
+	std::vector<unsigned char> Coordinates;
+	std::vector<float> Errors;
+	std::uint64_t NumPoints = 0;
+};
+
+class GeoDataFile
+{
+public:
+	// Mapeia o arquivo e confere o cabecalho e o tamanho das tabelas
+	bool Load(const std::string& FilePath);
+	bool IsValid() const { return Features != nullptr; }
+
+	std::size_t GetNumFeatures() const { return NumFeatures; }
+	std::size_t GetNumParts() const { return NumParts; }
+	std::uint64_t GetNumPoints() const { return NumPoints; }
+	int GetIndexLevel() const { return IndexLevel; }
+
+	const GeoFeature& GetFeature(std::uint32_t FeatureIndex) const { return Features[FeatureIndex]; }
+	const GeoPart& GetPart(std::uint32_t PartIndex) const { return Parts[PartIndex]; }
+	std::string_view GetName(const GeoFeature& Feature) const;
+
+	// Decodifica os pontos de uma parte em graus (latitude, longitude). Falso se as
+	// coordenadas da parte estiverem corrompidas
+	bool DecodePart(std::uint32_t PartIndex, std::vector<glm::dvec2>& LatLon) const;
+
+	// Um erro por ponto da parte, na ordem de DecodePart (ver ComputeSimplificationErrors).
+	// Pontos soltos recebem infinito
+	const float* GetSimplificationErrors(std::uint32_t PartIndex) const { return Errors + Parts[PartIndex].FirstPoint; }
+
+	// Feicoes cujo retangulo cruza a regiao (graus), em ordem crescente e sem repeticao
+	void QueryRegion(double MinLatitude, double MinLongitude, double MaxLatitude, double MaxLongitude, std::vector<std::uint32_t>& Result) const;
+
+	// Feicoes que cruzam um tile do quadtree do globo, em qualquer nivel
+	void QueryTile(int Level, int X, int Y, std::vector<std::uint32_t>& Result) const;
+
+private:
+	FileContents Contents;
+
+	std::uint32_t NumFeatures = 0;
+	std::uint32_t NumParts = 0;
+	std::uint64_t NumPoints = 0;
+	int IndexLevel = 0;
+
+	const GeoFeature* Features = nullptr;
+	const GeoPart* Parts = nullptr;
+	const std::uint32_t* BucketStarts = nullptr;    // Um por tile do indice, mais o fim
+	const std::uint32_t* BucketFeatures = nullptr;
+	const char* Names = nullptr;
+	std::uint64_t NamesSize = 0;
+	const unsigned char* Coordinates = nullptr;
+	std::uint64_t CoordinatesSize = 0;
+	const float* Errors = nullptr;
+};
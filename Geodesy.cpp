@@ -0,0 +1,388 @@
+#include "Geodesy.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "CpuFeatures.h"
+#include "JobSystem.h"
+
+namespace
+{
+	// Pontos por fatia do JobSystem, multiplo da largura dos vetores AVX2
+	constexpr int SliceSize = 16384;
+
+	std::atomic<const GeodesyKernels*> ActiveKernels{nullptr};
+
+	const GeodesyKernels& GetActiveKernels()
+	{
+		const GeodesyKernels* Kernels = ActiveKernels.load(std::memory_order_acquire);
+		if (!Kernels)
+		{
+			Kernels = IsGeodesyBackendSupported(GeodesyBackend::AVX2) ? GetAVX2GeodesyKernels() : &GetScalarGeodesyKernels();
+			ActiveKernels.store(Kernels, std::memory_order_release);
+		}
+		return *Kernels;
+	}
+
+	// Chama Func(Offset, Count) para fatias de [0, Count) nas threads do JobSystem
+	template <typename FuncType>
+	void ForEachSlice(std::size_t Count, const FuncType& Func)
+	{
+		JobSystem::Get().ParallelFor(0, static_cast<int>(Count), SliceSize, [&Func](int SliceBegin, int SliceEnd)
+		{
+			Func(static_cast<std::size_t>(SliceBegin), static_cast<std::size_t>(SliceEnd - SliceBegin));
+		});
+	}
+
+	// Seno e cosseno normalizados da latitude reduzida: tan(U) = (1 - f) tan(Latitude)
+	void ReducedLatitude(const GeodesyEllipsoid& Shape, double Latitude, double& SinU, double& CosU)
+	{
+		const double Sin = (1.0 - Shape.Flattening) * std::sin(Latitude);
+		const double Cos = std::cos(Latitude);
+		const double Length = std::sqrt(Sin * Sin + Cos * Cos);
+		SinU = Sin / Length;
+		CosU = Cos / Length;
+	}
+
+	// Bowring: a latitude reduzida inicial vem da razao z/p corrigida pelos eixos e
+	// cada iteracao refina a latitude geodesica. So o atan2 final usa trigonometria
+	glm::dvec3 BowringECEFToGeodetic(const GeodesyEllipsoid& Shape, double X, double Y, double Z)
+	{
+		const double A = Shape.SemiMajorAxis;
+		const double B = Shape.SemiMinorAxis;
+		const double P = std::sqrt(X * X + Y * Y);
+
+		double SinBeta = Z * A;
+		double CosBeta = P * B;
+		double Numerator = 0.0;
+		double Denominator = 0.0;
+		double SinLatitude = 0.0;
+		double CosLatitude = 0.0;
+		for (int Iteration = 0; Iteration < BowringIterations; ++Iteration)
+		{
+			const double BetaLength = std::sqrt(SinBeta * SinBeta + CosBeta * CosBeta);
+			SinBeta /= BetaLength;
+			CosBeta /= BetaLength;
+
+			Numerator = Z + Shape.SecondEccentricitySquared * B * SinBeta * SinBeta * SinBeta;
+			Denominator = P - Shape.EccentricitySquared * A * CosBeta * CosBeta * CosBeta;
+			const double LatitudeLength = std::sqrt(Numerator * Numerator + Denominator * Denominator);
+			SinLatitude = Numerator / LatitudeLength;
+			CosLatitude = Denominator / LatitudeLength;
+
+			SinBeta = B * SinLatitude;
+			CosBeta = A * CosLatitude;
+		}
+
+		const double Height = P * CosLatitude + Z * SinLatitude - A * std::sqrt(1.0 - Shape.EccentricitySquared * SinLatitude * SinLatitude);
+		return glm::dvec3{std::atan2(Numerator, Denominator), std::atan2(Y, X), Height};
+	}
+
+	void ScalarGeodeticToECEF(const GeodesyEllipsoid& Shape, const double* Latitude, const double* Longitude, const double* Height,
+		double* X, double* Y, double* Z, std::size_t Count)
+	{
+		for (std::size_t Index = 0; Index < Count; ++Index)
+		{
+			const glm::dvec3 Position = ReferenceGeodeticToECEF(Shape, Latitude[Index], Longitude[Index], Height[Index]);
+			X[Index] = Position.x;
+			Y[Index] = Position.y;
+			Z[Index] = Position.z;
+		}
+	}
+
+	void ScalarECEFToGeodetic(const GeodesyEllipsoid& Shape, const double* X, const double* Y, const double* Z,
+		double* Latitude, double* Longitude, double* Height, std::size_t Count)
+	{
+		for (std::size_t Index = 0; Index < Count; ++Index)
+		{
+			const glm::dvec3 Geodetic = BowringECEFToGeodetic(Shape, X[Index], Y[Index], Z[Index]);
+			Latitude[Index] = Geodetic.x;
+			Longitude[Index] = Geodetic.y;
+			Height[Index] = Geodetic.z;
+		}
+	}
+
+	void ScalarHaversineDistance(const GeodesyEllipsoid& Shape, const double* Latitude1, const double* Longitude1,
+		const double* Latitude2, const double* Longitude2, double* Distance, std::size_t Count)
+	{
+		for (std::size_t Index = 0; Index < Count; ++Index)
+		{
+			Distance[Index] = ReferenceHaversineDistance(Shape, Latitude1[Index], Longitude1[Index], Latitude2[Index], Longitude2[Index]);
+		}
+	}
+
+	void ScalarVincentyDistance(const GeodesyEllipsoid& Shape, const double* Latitude1, const double* Longitude1,
+		const double* Latitude2, const double* Longitude2, double* Distance, std::size_t Count)
+	{
+		for (std::size_t Index = 0; Index < Count; ++Index)
+		{
+			Distance[Index] = ReferenceVincentyDistance(Shape, Latitude1[Index], Longitude1[Index], Latitude2[Index], Longitude2[Index]);
+		}
+	}
+
+	void ScalarInitialBearing(const GeodesyEllipsoid&, const double* Latitude1, const double* Longitude1,
+		const double* Latitude2, const double* Longitude2, double* Bearing, std::size_t Count)
+	{
+		for (std::size_t Index = 0; Index < Count; ++Index)
+		{
+			Bearing[Index] = ReferenceInitialBearing(Latitude1[Index], Longitude1[Index], Latitude2[Index], Longitude2[Index]);
+		}
+	}
+}
+
+GeodesyEllipsoid MakeGeodesyEllipsoid(double SemiMajorAxis, double SemiMinorAxis)
+{
+	const double A2 = SemiMajorAxis * SemiMajorAxis;
+	const double B2 = SemiMinorAxis * SemiMinorAxis;
+
+	GeodesyEllipsoid Shape;
+	Shape.SemiMajorAxis = SemiMajorAxis;
+	Shape.SemiMinorAxis = SemiMinorAxis;
+	Shape.Flattening = (SemiMajorAxis - SemiMinorAxis) / SemiMajorAxis;
+	Shape.EccentricitySquared = (A2 - B2) / A2;
+	Shape.SecondEccentricitySquared = (A2 - B2) / B2;
+	Shape.MeanRadius = (2.0 * SemiMajorAxis + SemiMinorAxis) / 3.0;
+	return Shape;
+}
+
+GeodesyEllipsoid MakeGeodesyEllipsoid(const glm::dvec3& Radii)
+{
+	return MakeGeodesyEllipsoid(Radii.x, Radii.z);
+}
+
+const GeodesyEllipsoid& GetWGS84Ellipsoid()
+{
+	static const GeodesyEllipsoid WGS84 = MakeGeodesyEllipsoid(6378137.0, 6378137.0 * (1.0 - 1.0 / 298.257223563));
+	return WGS84;
+}
+
+glm::dvec3 ReferenceGeodeticToECEF(const GeodesyEllipsoid& Shape, double Latitude, double Longitude, double Height)
+{
+	const double SinLatitude = std::sin(Latitude);
+	const double CosLatitude = std::cos(Latitude);
+
+	// Raio de curvatura no primeiro vertical
+	const double N = Shape.SemiMajorAxis / std::sqrt(1.0 - Shape.EccentricitySquared * SinLatitude * SinLatitude);
+	return glm::dvec3{
+		(N + Height) * CosLatitude * std::cos(Longitude),
+		(N + Height) * CosLatitude * std::sin(Longitude),
+		(N * (1.0 - Shape.EccentricitySquared) + Height) * SinLatitude};
+}
+
+glm::dvec3 ReferenceECEFToGeodetic(const GeodesyEllipsoid& Shape, const glm::dvec3& Position)
+{
+	// Vermeille, "Direct transformation from geocentric coordinates to geodetic
+	// coordinates" (2002). Exata fora de uma pequena regiao em volta do centro
+	const double A2 = Shape.SemiMajorAxis * Shape.SemiMajorAxis;
+	const double E2 = Shape.EccentricitySquared;
+	const double E4 = E2 * E2;
+	const double HorizontalSquared = Position.x * Position.x + Position.y * Position.y;
+
+	const double P = HorizontalSquared / A2;
+	const double Q = (1.0 - E2) * Position.z * Position.z / A2;
+	const double R = (P + Q - E4) / 6.0;
+	const double S = E4 * P * Q / (4.0 * R * R * R);
+	const double T = std::cbrt(1.0 + S + std::sqrt(S * (2.0 + S)));
+	const double U = R * (1.0 + T + 1.0 / T);
+	const double V = std::sqrt(U * U + E4 * Q);
+	const double W = E2 * (U + V - Q) / (2.0 * V);
+	const double K = std::sqrt(U + V + W * W) - W;
+	const double D = K * std::sqrt(HorizontalSquared) / (K + E2);
+	const double DZ = std::sqrt(D * D + Position.z * Position.z);
+
+	return glm::dvec3{2.0 * std::atan2(Position.z, D + DZ), std::atan2(Position.y, Position.x), (K + E2 - 1.0) / K * DZ};
+}
+
+double ReferenceHaversineDistance(const GeodesyEllipsoid& Shape, double Latitude1, double Longitude1, double Latitude2, double Longitude2)
+{
+	const double SinHalfLatitude = std::sin(0.5 * (Latitude2 - Latitude1));
+	const double SinHalfLongitude = std::sin(0.5 * (Longitude2 - Longitude1));
+	const double H = std::clamp(SinHalfLatitude * SinHalfLatitude + std::cos(Latitude1) * std::cos(Latitude2) * SinHalfLongitude * SinHalfLongitude, 0.0, 1.0);
+
+	// atan2 em vez de asin: continua preciso perto dos antipodas
+	return 2.0 * Shape.MeanRadius * std::atan2(std::sqrt(H), std::sqrt(1.0 - H));
+}
+
+double ReferenceVincentyDistance(const GeodesyEllipsoid& Shape, double Latitude1, double Longitude1, double Latitude2, double Longitude2)
+{
+	const double F = Shape.Flattening;
+	double SinU1 = 0.0;
+	double CosU1 = 0.0;
+	double SinU2 = 0.0;
+	double CosU2 = 0.0;
+	ReducedLatitude(Shape, Latitude1, SinU1, CosU1);
+	ReducedLatitude(Shape, Latitude2, SinU2, CosU2);
+
+	// Iteracao sobre a diferenca de longitude na esfera auxiliar
+	const double L = Longitude2 - Longitude1;
+	double Lambda = L;
+	double SinSigma = 0.0;
+	double CosSigma = 0.0;
+	double Sigma = 0.0;
+	double CosSquaredAlpha = 0.0;
+	double Cos2SigmaM = 0.0;
+	bool Converged = false;
+	for (int Iteration = 0; Iteration < VincentyMaxIterations && !Converged; ++Iteration)
+	{
+		const double SinLambda = std::sin(Lambda);
+		const double CosLambda = std::cos(Lambda);
+		const double T1 = CosU2 * SinLambda;
+		const double T2 = CosU1 * SinU2 - SinU1 * CosU2 * CosLambda;
+		SinSigma = std::sqrt(T1 * T1 + T2 * T2);
+		if (SinSigma == 0.0)
+		{
+			return 0.0;     // Pontos coincidentes
+		}
+		CosSigma = SinU1 * SinU2 + CosU1 * CosU2 * CosLambda;
+		Sigma = std::atan2(SinSigma, CosSigma);
+
+		const double SinAlpha = CosU1 * CosU2 * SinLambda / SinSigma;
+		CosSquaredAlpha = 1.0 - SinAlpha * SinAlpha;
+
+		// Sobre o equador cos^2(alpha) e zero e o termo nao contribui
+		Cos2SigmaM = CosSquaredAlpha != 0.0 ? CosSigma - 2.0 * SinU1 * SinU2 / CosSquaredAlpha : 0.0;
+
+		const double C = F / 16.0 * CosSquaredAlpha * (4.0 + F * (4.0 - 3.0 * CosSquaredAlpha));
+		const double PreviousLambda = Lambda;
+		Lambda = L + (1.0 - C) * F * SinAlpha * (Sigma + C * SinSigma * (Cos2SigmaM + C * CosSigma * (-1.0 + 2.0 * Cos2SigmaM * Cos2SigmaM)));
+		Converged = std::abs(Lambda - PreviousLambda) < VincentyTolerance;
+	}
+	if (!Converged)
+	{
+		return std::numeric_limits<double>::quiet_NaN();
+	}
+
+	const double USquared = CosSquaredAlpha * Shape.SecondEccentricitySquared;
+	const double A = 1.0 + USquared / 16384.0 * (4096.0 + USquared * (-768.0 + USquared * (320.0 - 175.0 * USquared)));
+	const double B = USquared / 1024.0 * (256.0 + USquared * (-128.0 + USquared * (74.0 - 47.0 * USquared)));
+	const double DeltaSigma = B * SinSigma * (Cos2SigmaM + B / 4.0 * (CosSigma * (-1.0 + 2.0 * Cos2SigmaM * Cos2SigmaM) -
+		B / 6.0 * Cos2SigmaM * (-3.0 + 4.0 * SinSigma * SinSigma) * (-3.0 + 4.0 * Cos2SigmaM * Cos2SigmaM)));
+	return Shape.SemiMinorAxis * A * (Sigma - DeltaSigma);
+}
+
+double ReferenceInitialBearing(double Latitude1, double Longitude1, double Latitude2, double Longitude2)
+{
+	const double DeltaLongitude = Longitude2 - Longitude1;
+	const double CosLatitude2 = std::cos(Latitude2);
+	return std::atan2(std::sin(DeltaLongitude) * CosLatitude2,
+		std::cos(Latitude1) * std::sin(Latitude2) - std::sin(Latitude1) * CosLatitude2 * std::cos(DeltaLongitude));
+}
+
+const GeodesyKernels& GetScalarGeodesyKernels()
+{
+	static const GeodesyKernels Kernels{
+		ScalarGeodeticToECEF,
+		ScalarECEFToGeodetic,
+		ScalarHaversineDistance,
+		ScalarVincentyDistance,
+		ScalarInitialBearing,
+	};
+	return Kernels;
+}
+
+void GeodeticArrays::Resize(std::size_t Count)
+{
+	Latitude.resize(Count);
+	Longitude.resize(Count);
+	Height.resize(Count);
+}
+
+void ECEFArrays::Resize(std::size_t Count)
+{
+	X.resize(Count);
+	Y.resize(Count);
+	Z.resize(Count);
+}
+
+void GeodeticToECEFBatch(const GeodesyEllipsoid& Shape, const GeodeticArrays& Points, ECEFArrays& Positions)
+{
+	assert(Points.Longitude.size() == Points.Size() && Points.Height.size() == Points.Size());
+	Positions.Resize(Points.Size());
+	const GeodesyKernels& Kernels = GetActiveKernels();
+	ForEachSlice(Points.Size(), [&](std::size_t Offset, std::size_t Count)
+	{
+		Kernels.GeodeticToECEF(Shape, Points.Latitude.data() + Offset, Points.Longitude.data() + Offset, Points.Height.data() + Offset,
+			Positions.X.data() + Offset, Positions.Y.data() + Offset, Positions.Z.data() + Offset, Count);
+	});
+}
+
+void ECEFToGeodeticBatch(const GeodesyEllipsoid& Shape, const ECEFArrays& Positions, GeodeticArrays& Points)
+{
+	assert(Positions.Y.size() == Positions.Size() && Positions.Z.size() == Positions.Size());
+	Points.Resize(Positions.Size());
+	const GeodesyKernels& Kernels = GetActiveKernels();
+	ForEachSlice(Positions.Size(), [&](std::size_t Offset, std::size_t Count)
+	{
+		Kernels.ECEFToGeodetic(Shape, Positions.X.data() + Offset, Positions.Y.data() + Offset, Positions.Z.data() + Offset,
+			Points.Latitude.data() + Offset, Points.Longitude.data() + Offset, Points.Height.data() + Offset, Count);
+	});
+}
+
+void HaversineDistanceBatch(const GeodesyEllipsoid& Shape, const GeodeticArrays& From, const GeodeticArrays& To, std::vector<double>& Distances)
+{
+	assert(From.Size() == To.Size());
+	Distances.resize(From.Size());
+	const GeodesyKernels& Kernels = GetActiveKernels();
+	ForEachSlice(From.Size(), [&](std::size_t Offset, std::size_t Count)
+	{
+		Kernels.HaversineDistance(Shape, From.Latitude.data() + Offset, From.Longitude.data() + Offset,
+			To.Latitude.data() + Offset, To.Longitude.data() + Offset, Distances.data() + Offset, Count);
+	});
+}
+
+void VincentyDistanceBatch(const GeodesyEllipsoid& Shape, const GeodeticArrays& From, const GeodeticArrays& To, std::vector<double>& Distances)
+{
+	assert(From.Size() == To.Size());
+	Distances.resize(From.Size());
+	const GeodesyKernels& Kernels = GetActiveKernels();
+	ForEachSlice(From.Size(), [&](std::size_t Offset, std::size_t Count)
+	{
+		Kernels.VincentyDistance(Shape, From.Latitude.data() + Offset, From.Longitude.data() + Offset,
+			To.Latitude.data() + Offset, To.Longitude.data() + Offset, Distances.data() + Offset, Count);
+	});
+}
+
+void InitialBearingBatch(const GeodeticArrays& From, const GeodeticArrays& To, std::vector<double>& Bearings)
+{
+	assert(From.Size() == To.Size());
+	Bearings.resize(From.Size());
+	const GeodesyKernels& Kernels = GetActiveKernels();
+	ForEachSlice(From.Size(), [&](std::size_t Offset, std::size_t Count)
+	{
+		Kernels.InitialBearing(GetWGS84Ellipsoid(), From.Latitude.data() + Offset, From.Longitude.data() + Offset,
+			To.Latitude.data() + Offset, To.Longitude.data() + Offset, Bearings.data() + Offset, Count);
+	});
+}
+
+bool IsGeodesyBackendSupported(GeodesyBackend Backend)
+{
+	if (Backend == GeodesyBackend::AVX2)
+	{
+		static const bool Supported = GetAVX2GeodesyKernels() != nullptr && CpuSupportsAVX2();
+		return Supported;
+	}
+	return true;
+}
+
+bool SetGeodesyBackend(GeodesyBackend Backend)
+{
+	if (!IsGeodesyBackendSupported(Backend))
+	{
+		return false;
+	}
+	ActiveKernels.store(Backend == GeodesyBackend::AVX2 ? GetAVX2GeodesyKernels() : &GetScalarGeodesyKernels(), std::memory_order_release);
+	return true;
+}
+
+GeodesyBackend GetGeodesyBackend()
+{
+	return &GetActiveKernels() == &GetScalarGeodesyKernels() ? GeodesyBackend::Scalar : GeodesyBackend::AVX2;
+}
+
+const char* GetGeodesyBackendName(GeodesyBackend Backend)
+{
+	return Backend == GeodesyBackend::AVX2 ? "AVX2" : "escalar";
+}
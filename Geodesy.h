@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GeodesyKernels.h"
+
+// Elipsoide a partir dos raios usados pelo resto do programa (x = y = a, z = b)
+GeodesyEllipsoid MakeGeodesyEllipsoid(double SemiMajorAxis, double SemiMinorAxis);
+GeodesyEllipsoid MakeGeodesyEllipsoid(const glm::dvec3& Radii);
+
+const GeodesyEllipsoid& GetWGS84Ellipsoid();
+
+// Referencia escalar em double, um ponto por vez e com std::sin/std::atan2. A
+// conversao de ECEF para geodesica usa a forma fechada de Vermeille (2002), e nao a
+// iteracao de Bowring dos kernels, para que a validacao compare metodos diferentes.
+// Angulos em radianos, alturas e distancias em metros
+glm::dvec3 ReferenceGeodeticToECEF(const GeodesyEllipsoid& Shape, double Latitude, double Longitude, double Height);
+glm::dvec3 ReferenceECEFToGeodetic(const GeodesyEllipsoid& Shape, const glm::dvec3& Position); // Latitude, longitude, altura
+double ReferenceHaversineDistance(const GeodesyEllipsoid& Shape, double Latitude1, double Longitude1, double Latitude2, double Longitude2);
+double ReferenceVincentyDistance(const GeodesyEllipsoid& Shape, double Latitude1, double Longitude1, double Latitude2, double Longitude2);
+double ReferenceInitialBearing(double Latitude1, double Longitude1, double Latitude2, double Longitude2);
+
+// Pontos geodesicos em SoA: latitude e longitude em radianos, altura em metros
+struct GeodeticArrays
+{
+	std::vector<double> Latitude;
+	std::vector<double> Longitude;
+	std::vector<double> Height;
+
+	void Resize(std::size_t Count);
+	std::size_t Size() const { return Latitude.size(); }
+};
+
+// Posicoes ECEF em SoA, em metros
+struct ECEFArrays
+{
+	std::vector<double> X;
+	std::vector<double> Y;
+	std::vector<double> Z;
+
+	void Resize(std::size_t Count);
+	std::size_t Size() const { return X.size(); }
+};
+
+// Conversoes e medidas em lote. Os arrays sao divididos em fatias entre as threads
+// do JobSystem e cada fatia roda no kernel escolhido (AVX2 quando a CPU suporta).
+// As saidas sao redimensionadas para o tamanho da entrada
+void GeodeticToECEFBatch(const GeodesyEllipsoid& Shape, const GeodeticArrays& Points, ECEFArrays& Positions);
+void ECEFToGeodeticBatch(const GeodesyEllipsoid& Shape, const ECEFArrays& Positions, GeodeticArrays& Points);
+
+// Entre From[i] e To[i], ignorando as alturas. Vincenty da NaN quando nao converge
+void HaversineDistanceBatch(const GeodesyEllipsoid& Shape, const GeodeticArrays& From, const GeodeticArrays& To, std::vector<double>& Distances);
+void VincentyDistanceBatch(const GeodesyEllipsoid& Shape, const GeodeticArrays& From, const GeodeticArrays& To, std::vector<double>& Distances);
+
+// Rumo inicial do circulo maximo, de -pi a pi a partir do norte, no sentido horario
+void InitialBearingBatch(const GeodeticArrays& From, const GeodeticArrays& To, std::vector<double>& Bearings);
+
+enum class GeodesyBackend
+{
+	Scalar,
+	AVX2,
+};
+
+// O backend e escolhido na primeira chamada pelo que a CPU suporta; SetGeodesyBackend
+// permite forcar o escalar para comparacao e falha se o pedido nao for suportado
+bool IsGeodesyBackendSupported(GeodesyBackend Backend);
+bool SetGeodesyBackend(GeodesyBackend Backend);
+GeodesyBackend GetGeodesyBackend();
+const char* GetGeodesyBackendName(GeodesyBackend Backend);
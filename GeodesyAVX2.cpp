@@ -0,0 +1,366 @@
+#include "GeodesyKernels.h"
+
+// Compilado com AVX2 e FMA habilitados (ver CMakeLists.txt). So e chamado depois
+// que Geodesy.cpp confirma o suporte da CPU, entao nada alem dos kernels deve morar
+// aqui: nenhuma funcao inline de outros cabecalhos pode ser gerada com AVX2
+
+#if defined(__AVX2__)
+
+#include <immintrin.h>
+
+namespace
+{
+	// Reducao de Cody-Waite por pi/2 em duas partes; com FMA o resto sai exato para
+	// os angulos pequenos (algumas voltas) usados aqui
+	constexpr double TwoOverPi = 0.63661977236758134308;
+	constexpr double PiOverTwoHigh = 1.5707963267948965580;
+	constexpr double PiOverTwoLow = 6.1232339957367658861e-17;
+	constexpr double PiOverTwo = 1.5707963267948966192;
+	constexpr double PiOverFour = 0.78539816339744830962;
+	constexpr double Pi = 3.1415926535897932385;
+
+	inline __m256d Set(double Value)
+	{
+		return _mm256_set1_pd(Value);
+	}
+
+	inline __m256d Abs(__m256d X)
+	{
+		return _mm256_andnot_pd(Set(-0.0), X);
+	}
+
+	// Seno e cosseno juntos: polinomios do fdlibm em [-pi/4, pi/4] e troca pelo quadrante
+	inline void SinCos(__m256d X, __m256d& Sin, __m256d& Cos)
+	{
+		const __m256d N = _mm256_round_pd(_mm256_mul_pd(X, Set(TwoOverPi)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+		__m256d R = _mm256_fnmadd_pd(N, Set(PiOverTwoHigh), X);
+		R = _mm256_fnmadd_pd(N, Set(PiOverTwoLow), R);
+		const __m256d R2 = _mm256_mul_pd(R, R);
+
+		__m256d S = Set(1.58969099521155010221e-10);
+		S = _mm256_fmadd_pd(S, R2, Set(-2.50507602534068634195e-08));
+		S = _mm256_fmadd_pd(S, R2, Set(2.75573137070700676789e-06));
+		S = _mm256_fmadd_pd(S, R2, Set(-1.98412698298579493134e-04));
+		S = _mm256_fmadd_pd(S, R2, Set(8.33333333332248946124e-03));
+		S = _mm256_fmadd_pd(S, R2, Set(-1.66666666666666324348e-01));
+		S = _mm256_fmadd_pd(_mm256_mul_pd(R, R2), S, R);
+
+		__m256d C = Set(-1.13596475577881948265e-11);
+		C = _mm256_fmadd_pd(C, R2, Set(2.08757232129817482790e-09));
+		C = _mm256_fmadd_pd(C, R2, Set(-2.75573143513906633035e-07));
+		C = _mm256_fmadd_pd(C, R2, Set(2.48015872894767294178e-05));
+		C = _mm256_fmadd_pd(C, R2, Set(-1.38888888888741095749e-03));
+		C = _mm256_fmadd_pd(C, R2, Set(4.16666666666666019037e-02));
+		C = _mm256_fmadd_pd(_mm256_mul_pd(R2, R2), C, _mm256_fnmadd_pd(Set(0.5), R2, Set(1.0)));
+
+		// Quadrante q = N mod 4: os impares trocam seno e cosseno, e o bit 1 de q
+		// (de q + 1 para o cosseno) vai direto para o bit de sinal
+		const __m256i Quadrant = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(N));
+		const __m256d Swap = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(Quadrant, _mm256_set1_epi64x(1)), _mm256_set1_epi64x(1)));
+		const __m256i SinSign = _mm256_slli_epi64(_mm256_and_si256(Quadrant, _mm256_set1_epi64x(2)), 62);
+		const __m256i CosSign = _mm256_slli_epi64(_mm256_and_si256(_mm256_add_epi64(Quadrant, _mm256_set1_epi64x(1)), _mm256_set1_epi64x(2)), 62);
+		Sin = _mm256_xor_pd(_mm256_blendv_pd(S, C, Swap), _mm256_castsi256_pd(SinSign));
+		Cos = _mm256_xor_pd(_mm256_blendv_pd(C, S, Swap), _mm256_castsi256_pd(CosSign));
+	}
+
+	// Arco tangente em [0, 1] pela aproximacao racional do Cephes. Acima de 0.66 usa
+	// atan(t) = pi/4 + atan((t - 1) / (t + 1))
+	inline __m256d AtanUnit(__m256d T)
+	{
+		const __m256d Reduce = _mm256_cmp_pd(T, Set(0.66), _CMP_GT_OQ);
+		const __m256d X = _mm256_blendv_pd(T, _mm256_div_pd(_mm256_sub_pd(T, Set(1.0)), _mm256_add_pd(T, Set(1.0))), Reduce);
+		const __m256d Z = _mm256_mul_pd(X, X);
+
+		__m256d P = Set(-8.750608600031904122785e-01);
+		P = _mm256_fmadd_pd(P, Z, Set(-1.615753718733365076637e+01));
+		P = _mm256_fmadd_pd(P, Z, Set(-7.500855792314704667340e+01));
+		P = _mm256_fmadd_pd(P, Z, Set(-1.228866684490136173410e+02));
+		P = _mm256_fmadd_pd(P, Z, Set(-6.485021904942025371773e+01));
+
+		__m256d Q = _mm256_add_pd(Z, Set(2.485846490142306297962e+01));
+		Q = _mm256_fmadd_pd(Q, Z, Set(1.650270098316988542046e+02));
+		Q = _mm256_fmadd_pd(Q, Z, Set(4.328810604912902668951e+02));
+		Q = _mm256_fmadd_pd(Q, Z, Set(4.853903996359136964868e+02));
+		Q = _mm256_fmadd_pd(Q, Z, Set(1.945506571482613964425e+02));
+
+		const __m256d Y = _mm256_fmadd_pd(_mm256_mul_pd(X, Z), _mm256_div_pd(P, Q), X);
+		const __m256d Offset = _mm256_and_pd(Reduce, Set(PiOverFour));
+		return _mm256_add_pd(Offset, _mm256_add_pd(Y, _mm256_and_pd(Reduce, Set(0.5 * PiOverTwoLow))));
+	}
+
+	inline __m256d Atan2(__m256d Y, __m256d X)
+	{
+		const __m256d AbsY = Abs(Y);
+		const __m256d AbsX = Abs(X);
+		const __m256d Numerator = _mm256_min_pd(AbsY, AbsX);
+		const __m256d Denominator = _mm256_max_pd(AbsY, AbsX);
+
+		// 0/0 fica 0, como no atan2 da biblioteca
+		const __m256d Zero = _mm256_cmp_pd(Denominator, _mm256_setzero_pd(), _CMP_EQ_OQ);
+		const __m256d T = _mm256_andnot_pd(Zero, _mm256_div_pd(Numerator, _mm256_blendv_pd(Denominator, Set(1.0), Zero)));
+
+		__m256d Angle = AtanUnit(T);
+		Angle = _mm256_blendv_pd(Angle, _mm256_sub_pd(Set(PiOverTwo), Angle), _mm256_cmp_pd(AbsY, AbsX, _CMP_GT_OQ));
+		Angle = _mm256_blendv_pd(Angle, _mm256_sub_pd(Set(Pi), Angle), X);
+		return _mm256_or_pd(Angle, _mm256_and_pd(Y, Set(-0.0)));
+	}
+
+	// Aplica Func a blocos de quatro pontos. O ultimo bloco incompleto e copiado para
+	// buffers locais com as lanes que sobram repetindo o primeiro ponto restante
+	template <int NumInputs, int NumOutputs, typename FuncType>
+	void ForEachBlock(const double* const (&Inputs)[NumInputs], double* const (&Outputs)[NumOutputs], std::size_t Count, const FuncType& Func)
+	{
+		__m256d In[NumInputs];
+		__m256d Out[NumOutputs];
+		std::size_t Index = 0;
+		for (; Index + 4 <= Count; Index += 4)
+		{
+			for (int Input = 0; Input < NumInputs; ++Input)
+			{
+				In[Input] = _mm256_loadu_pd(Inputs[Input] + Index);
+			}
+			Func(In, Out);
+			for (int Output = 0; Output < NumOutputs; ++Output)
+			{
+				_mm256_storeu_pd(Outputs[Output] + Index, Out[Output]);
+			}
+		}
+
+		const std::size_t Remaining = Count - Index;
+		if (Remaining == 0)
+		{
+			return;
+		}
+		alignas(32) double Buffer[4];
+		for (int Input = 0; Input < NumInputs; ++Input)
+		{
+			for (std::size_t Lane = 0; Lane < 4; ++Lane)
+			{
+				Buffer[Lane] = Inputs[Input][Index + (Lane < Remaining ? Lane : 0)];
+			}
+			In[Input] = _mm256_load_pd(Buffer);
+		}
+		Func(In, Out);
+		for (int Output = 0; Output < NumOutputs; ++Output)
+		{
+			_mm256_store_pd(Buffer, Out[Output]);
+			for (std::size_t Lane = 0; Lane < Remaining; ++Lane)
+			{
+				Outputs[Output][Index + Lane] = Buffer[Lane];
+			}
+		}
+	}
+
+	void AVX2GeodeticToECEF(const GeodesyEllipsoid& Shape, const double* Latitude, const double* Longitude, const double* Height,
+		double* X, double* Y, double* Z, std::size_t Count)
+	{
+		const __m256d A = Set(Shape.SemiMajorAxis);
+		const __m256d E2 = Set(Shape.EccentricitySquared);
+		const __m256d OneMinusE2 = Set(1.0 - Shape.EccentricitySquared);
+		ForEachBlock({Latitude, Longitude, Height}, {X, Y, Z}, Count, [&](const __m256d* In, __m256d* Out)
+		{
+			__m256d SinLatitude, CosLatitude, SinLongitude, CosLongitude;
+			SinCos(In[0], SinLatitude, CosLatitude);
+			SinCos(In[1], SinLongitude, CosLongitude);
+
+			const __m256d N = _mm256_div_pd(A, _mm256_sqrt_pd(_mm256_fnmadd_pd(E2, _mm256_mul_pd(SinLatitude, SinLatitude), Set(1.0))));
+			const __m256d Horizontal = _mm256_mul_pd(_mm256_add_pd(N, In[2]), CosLatitude);
+			Out[0] = _mm256_mul_pd(Horizontal, CosLongitude);
+			Out[1] = _mm256_mul_pd(Horizontal, SinLongitude);
+			Out[2] = _mm256_mul_pd(_mm256_fmadd_pd(N, OneMinusE2, In[2]), SinLatitude);
+		});
+	}
+
+	void AVX2ECEFToGeodetic(const GeodesyEllipsoid& Shape, const double* X, const double* Y, const double* Z,
+		double* Latitude, double* Longitude, double* Height, std::size_t Count)
+	{
+		const __m256d A = Set(Shape.SemiMajorAxis);
+		const __m256d B = Set(Shape.SemiMinorAxis);
+		const __m256d E2 = Set(Shape.EccentricitySquared);
+		const __m256d E2A = Set(Shape.EccentricitySquared * Shape.SemiMajorAxis);
+		const __m256d EP2B = Set(Shape.SecondEccentricitySquared * Shape.SemiMinorAxis);
+		ForEachBlock({X, Y, Z}, {Latitude, Longitude, Height}, Count, [&](const __m256d* In, __m256d* Out)
+		{
+			const __m256d P = _mm256_sqrt_pd(_mm256_fmadd_pd(In[0], In[0], _mm256_mul_pd(In[1], In[1])));
+
+			// Mesma iteracao de Bowring da versao escalar
+			__m256d SinBeta = _mm256_mul_pd(In[2], A);
+			__m256d CosBeta = _mm256_mul_pd(P, B);
+			__m256d Numerator = _mm256_setzero_pd();
+			__m256d Denominator = _mm256_setzero_pd();
+			__m256d SinLatitude = _mm256_setzero_pd();
+			__m256d CosLatitude = _mm256_setzero_pd();
+			for (int Iteration = 0; Iteration < BowringIterations; ++Iteration)
+			{
+				const __m256d BetaLength = _mm256_sqrt_pd(_mm256_fmadd_pd(SinBeta, SinBeta, _mm256_mul_pd(CosBeta, CosBeta)));
+				SinBeta = _mm256_div_pd(SinBeta, BetaLength);
+				CosBeta = _mm256_div_pd(CosBeta, BetaLength);
+
+				Numerator = _mm256_fmadd_pd(_mm256_mul_pd(EP2B, SinBeta), _mm256_mul_pd(SinBeta, SinBeta), In[2]);
+				Denominator = _mm256_fnmadd_pd(_mm256_mul_pd(E2A, CosBeta), _mm256_mul_pd(CosBeta, CosBeta), P);
+				const __m256d LatitudeLength = _mm256_sqrt_pd(_mm256_fmadd_pd(Numerator, Numerator, _mm256_mul_pd(Denominator, Denominator)));
+				SinLatitude = _mm256_div_pd(Numerator, LatitudeLength);
+				CosLatitude = _mm256_div_pd(Denominator, LatitudeLength);
+
+				SinBeta = _mm256_mul_pd(B, SinLatitude);
+				CosBeta = _mm256_mul_pd(A, CosLatitude);
+			}
+
+			const __m256d SurfaceDistance = _mm256_mul_pd(A, _mm256_sqrt_pd(_mm256_fnmadd_pd(E2, _mm256_mul_pd(SinLatitude, SinLatitude), Set(1.0))));
+			Out[0] = Atan2(Numerator, Denominator);
+			Out[1] = Atan2(In[1], In[0]);
+			Out[2] = _mm256_sub_pd(_mm256_fmadd_pd(P, CosLatitude, _mm256_mul_pd(In[2], SinLatitude)), SurfaceDistance);
+		});
+	}
+
+	void AVX2HaversineDistance(const GeodesyEllipsoid& Shape, const double* Latitude1, const double* Longitude1,
+		const double* Latitude2, const double* Longitude2, double* Distance, std::size_t Count)
+	{
+		const __m256d Diameter = Set(2.0 * Shape.MeanRadius);
+		ForEachBlock({Latitude1, Longitude1, Latitude2, Longitude2}, {Distance}, Count, [&](const __m256d* In, __m256d* Out)
+		{
+			__m256d SinHalfLatitude, SinHalfLongitude, SinLatitude, CosLatitude1, CosLatitude2, Unused;
+			SinCos(_mm256_mul_pd(Set(0.5), _mm256_sub_pd(In[2], In[0])), SinHalfLatitude, Unused);
+			SinCos(_mm256_mul_pd(Set(0.5), _mm256_sub_pd(In[3], In[1])), SinHalfLongitude, Unused);
+			SinCos(In[0], SinLatitude, CosLatitude1);
+			SinCos(In[2], SinLatitude, CosLatitude2);
+
+			__m256d H = _mm256_mul_pd(_mm256_mul_pd(CosLatitude1, CosLatitude2), _mm256_mul_pd(SinHalfLongitude, SinHalfLongitude));
+			H = _mm256_fmadd_pd(SinHalfLatitude, SinHalfLatitude, H);
+			H = _mm256_min_pd(_mm256_max_pd(H, _mm256_setzero_pd()), Set(1.0));
+			Out[0] = _mm256_mul_pd(Diameter, Atan2(_mm256_sqrt_pd(H), _mm256_sqrt_pd(_mm256_sub_pd(Set(1.0), H))));
+		});
+	}
+
+	// Seno e cosseno normalizados da latitude reduzida: tan(U) = (1 - f) tan(Latitude)
+	inline void ReducedLatitude(__m256d Latitude, __m256d OneMinusF, __m256d& SinU, __m256d& CosU)
+	{
+		__m256d Sin, Cos;
+		SinCos(Latitude, Sin, Cos);
+		Sin = _mm256_mul_pd(Sin, OneMinusF);
+		const __m256d Length = _mm256_sqrt_pd(_mm256_fmadd_pd(Sin, Sin, _mm256_mul_pd(Cos, Cos)));
+		SinU = _mm256_div_pd(Sin, Length);
+		CosU = _mm256_div_pd(Cos, Length);
+	}
+
+	void AVX2VincentyDistance(const GeodesyEllipsoid& Shape, const double* Latitude1, const double* Longitude1,
+		const double* Latitude2, const double* Longitude2, double* Distance, std::size_t Count)
+	{
+		const __m256d F = Set(Shape.Flattening);
+		const __m256d OneMinusF = Set(1.0 - Shape.Flattening);
+		const __m256d EP2 = Set(Shape.SecondEccentricitySquared);
+		const __m256d One = Set(1.0);
+		const __m256d Zero = _mm256_setzero_pd();
+		ForEachBlock({Latitude1, Longitude1, Latitude2, Longitude2}, {Distance}, Count, [&](const __m256d* In, __m256d* Out)
+		{
+			__m256d SinU1, CosU1, SinU2, CosU2;
+			ReducedLatitude(In[0], OneMinusF, SinU1, CosU1);
+			ReducedLatitude(In[2], OneMinusF, SinU2, CosU2);
+			const __m256d SinU1SinU2 = _mm256_mul_pd(SinU1, SinU2);
+			const __m256d CosU1CosU2 = _mm256_mul_pd(CosU1, CosU2);
+
+			// Cada lane para quando converge; o bloco itera ate a mais lenta e as
+			// lanes ja convergidas mantem o estado da sua ultima iteracao
+			const __m256d L = _mm256_sub_pd(In[3], In[1]);
+			__m256d Lambda = L;
+			__m256d SinSigma = Zero, CosSigma = Zero, Sigma = Zero, CosSquaredAlpha = Zero, Cos2SigmaM = Zero;
+			__m256d Active = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+			__m256d Converged = Zero;
+			for (int Iteration = 0; Iteration < VincentyMaxIterations && _mm256_movemask_pd(Active) != 0; ++Iteration)
+			{
+				__m256d SinLambda, CosLambda;
+				SinCos(Lambda, SinLambda, CosLambda);
+				const __m256d T1 = _mm256_mul_pd(CosU2, SinLambda);
+				const __m256d T2 = _mm256_fnmadd_pd(_mm256_mul_pd(SinU1, CosU2), CosLambda, _mm256_mul_pd(CosU1, SinU2));
+				const __m256d NewSinSigma = _mm256_sqrt_pd(_mm256_fmadd_pd(T1, T1, _mm256_mul_pd(T2, T2)));
+				const __m256d NewCosSigma = _mm256_fmadd_pd(CosU1CosU2, CosLambda, SinU1SinU2);
+				const __m256d NewSigma = Atan2(NewSinSigma, NewCosSigma);
+
+				const __m256d SinAlpha = _mm256_div_pd(_mm256_mul_pd(CosU1CosU2, SinLambda), NewSinSigma);
+				const __m256d NewCosSquaredAlpha = _mm256_fnmadd_pd(SinAlpha, SinAlpha, One);
+				const __m256d Equatorial = _mm256_cmp_pd(NewCosSquaredAlpha, Zero, _CMP_EQ_OQ);
+				const __m256d NewCos2SigmaM = _mm256_andnot_pd(Equatorial,
+					_mm256_sub_pd(NewCosSigma, _mm256_div_pd(_mm256_mul_pd(Set(2.0), SinU1SinU2), NewCosSquaredAlpha)));
+
+				const __m256d C = _mm256_mul_pd(_mm256_mul_pd(_mm256_div_pd(F, Set(16.0)), NewCosSquaredAlpha),
+					_mm256_fmadd_pd(F, _mm256_fnmadd_pd(Set(3.0), NewCosSquaredAlpha, Set(4.0)), Set(4.0)));
+				const __m256d Inner = _mm256_fmadd_pd(_mm256_mul_pd(C, NewCosSigma), _mm256_fmadd_pd(Set(2.0), _mm256_mul_pd(NewCos2SigmaM, NewCos2SigmaM), Set(-1.0)), NewCos2SigmaM);
+				const __m256d Series = _mm256_fmadd_pd(_mm256_mul_pd(C, NewSinSigma), Inner, NewSigma);
+				const __m256d NewLambda = _mm256_fmadd_pd(_mm256_mul_pd(_mm256_mul_pd(_mm256_sub_pd(One, C), F), SinAlpha), Series, L);
+
+				// Pontos coincidentes (seno de sigma zero) tambem param, com distancia zero
+				const __m256d Done = _mm256_or_pd(
+					_mm256_cmp_pd(Abs(_mm256_sub_pd(NewLambda, Lambda)), Set(VincentyTolerance), _CMP_LT_OQ),
+					_mm256_cmp_pd(NewSinSigma, Zero, _CMP_EQ_OQ));
+
+				SinSigma = _mm256_blendv_pd(SinSigma, NewSinSigma, Active);
+				CosSigma = _mm256_blendv_pd(CosSigma, NewCosSigma, Active);
+				Sigma = _mm256_blendv_pd(Sigma, NewSigma, Active);
+				CosSquaredAlpha = _mm256_blendv_pd(CosSquaredAlpha, NewCosSquaredAlpha, Active);
+				Cos2SigmaM = _mm256_blendv_pd(Cos2SigmaM, NewCos2SigmaM, Active);
+				Lambda = _mm256_blendv_pd(Lambda, NewLambda, Active);
+				Converged = _mm256_or_pd(Converged, _mm256_and_pd(Active, Done));
+				Active = _mm256_andnot_pd(Done, Active);
+			}
+
+			const __m256d USquared = _mm256_mul_pd(CosSquaredAlpha, EP2);
+			__m256d A = _mm256_fmadd_pd(USquared, Set(-175.0), Set(320.0));
+			A = _mm256_fmadd_pd(USquared, A, Set(-768.0));
+			A = _mm256_fmadd_pd(USquared, A, Set(4096.0));
+			A = _mm256_fmadd_pd(_mm256_div_pd(USquared, Set(16384.0)), A, One);
+			__m256d B = _mm256_fmadd_pd(USquared, Set(-47.0), Set(74.0));
+			B = _mm256_fmadd_pd(USquared, B, Set(-128.0));
+			B = _mm256_fmadd_pd(USquared, B, Set(256.0));
+			B = _mm256_mul_pd(_mm256_div_pd(USquared, Set(1024.0)), B);
+
+			const __m256d Cos2SigmaMSquared = _mm256_mul_pd(Cos2SigmaM, Cos2SigmaM);
+			const __m256d Term1 = _mm256_mul_pd(CosSigma, _mm256_fmadd_pd(Set(2.0), Cos2SigmaMSquared, Set(-1.0)));
+			const __m256d Term2 = _mm256_mul_pd(_mm256_mul_pd(_mm256_div_pd(B, Set(6.0)), Cos2SigmaM),
+				_mm256_mul_pd(_mm256_fmadd_pd(Set(4.0), _mm256_mul_pd(SinSigma, SinSigma), Set(-3.0)), _mm256_fmadd_pd(Set(4.0), Cos2SigmaMSquared, Set(-3.0))));
+			const __m256d DeltaSigma = _mm256_mul_pd(_mm256_mul_pd(B, SinSigma),
+				_mm256_fmadd_pd(_mm256_div_pd(B, Set(4.0)), _mm256_sub_pd(Term1, Term2), Cos2SigmaM));
+			__m256d Result = _mm256_mul_pd(_mm256_mul_pd(Set(Shape.SemiMinorAxis), A), _mm256_sub_pd(Sigma, DeltaSigma));
+
+			Result = _mm256_blendv_pd(Result, Zero, _mm256_cmp_pd(SinSigma, Zero, _CMP_EQ_OQ));
+			const __m256d NaN = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FF8000000000000));
+			Out[0] = _mm256_blendv_pd(NaN, Result, Converged);
+		});
+	}
+
+	void AVX2InitialBearing(const GeodesyEllipsoid&, const double* Latitude1, const double* Longitude1,
+		const double* Latitude2, const double* Longitude2, double* Bearing, std::size_t Count)
+	{
+		ForEachBlock({Latitude1, Longitude1, Latitude2, Longitude2}, {Bearing}, Count, [&](const __m256d* In, __m256d* Out)
+		{
+			__m256d SinLatitude1, CosLatitude1, SinLatitude2, CosLatitude2, SinDelta, CosDelta;
+			SinCos(In[0], SinLatitude1, CosLatitude1);
+			SinCos(In[2], SinLatitude2, CosLatitude2);
+			SinCos(_mm256_sub_pd(In[3], In[1]), SinDelta, CosDelta);
+
+			const __m256d East = _mm256_mul_pd(SinDelta, CosLatitude2);
+			const __m256d North = _mm256_fnmadd_pd(_mm256_mul_pd(SinLatitude1, CosLatitude2), CosDelta, _mm256_mul_pd(CosLatitude1, SinLatitude2));
+			Out[0] = Atan2(East, North);
+		});
+	}
+}
+
+const GeodesyKernels* GetAVX2GeodesyKernels()
+{
+	static const GeodesyKernels Kernels{
+		AVX2GeodeticToECEF,
+		AVX2ECEFToGeodetic,
+		AVX2HaversineDistance,
+		AVX2VincentyDistance,
+		AVX2InitialBearing,
+	};
+	return &Kernels;
+}
+
+#else
+
+const GeodesyKernels* GetAVX2GeodesyKernels()
+{
+	return nullptr;
+}
+
+#endif
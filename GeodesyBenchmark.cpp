@@ -0,0 +1,181 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include "JobSystem.h"
+#include "Geodesy.h"
+
+const int DefaultNumPoints = 4000000;
+const int NumRepetitions = 3;
+
+// Pontos conferidos contra a referencia escalar, espalhados pelo array
+const int NumCheckedPoints = 100000;
+
+// Menor tempo entre algumas repeticoes, em segundos
+double Measure(const std::function<void()>& Work)
+{
+	double Best = 1e30;
+	for (int Repetition = 0; Repetition < NumRepetitions; ++Repetition)
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		Work();
+		const auto End = std::chrono::steady_clock::now();
+		Best = std::min(Best, std::chrono::duration<double>(End - Start).count());
+	}
+	return Best;
+}
+
+void PrintHeader(const std::string& Title)
+{
+	std::cout << std::endl;
+	std::cout << "==================" << std::endl;
+	std::cout << Title << std::endl;
+	std::cout << "==================" << std::endl;
+}
+
+// Diferenca entre dois angulos, em radianos, considerando a volta
+double AngleDifference(double First, double Second)
+{
+	return std::abs(std::remainder(First - Second, glm::two_pi<double>()));
+}
+
+struct Operation
+{
+	std::string Name;
+	std::string ErrorUnit;
+	std::function<void()> Run;
+	std::function<double(std::size_t Index)> Error;     // Erro do ponto Index contra a referencia
+};
+
+int main(int argc, char* argv[])
+{
+	const std::size_t NumPoints = argc > 1 ? std::size_t(std::atoll(argv[1])) : DefaultNumPoints;
+
+	JobSystem::Get().Init();
+	const GeodesyEllipsoid& WGS84 = GetWGS84Ellipsoid();
+
+	// Pontos uniformes na esfera com alturas de 1 m a 40 mil km em escala logaritmica,
+	// para cobrir do solo ate acima da orbita geoestacionaria
+	std::mt19937 Random{42};
+	std::uniform_real_distribution<double> Uniform{0.0, 1.0};
+	GeodeticArrays From;
+	GeodeticArrays To;
+	From.Resize(NumPoints);
+	To.Resize(NumPoints);
+	for (std::size_t Index = 0; Index < NumPoints; ++Index)
+	{
+		From.Latitude[Index] = std::asin(2.0 * Uniform(Random) - 1.0);
+		From.Longitude[Index] = (2.0 * Uniform(Random) - 1.0) * glm::pi<double>();
+		From.Height[Index] = std::pow(10.0, Uniform(Random) * 7.6) - 1000.0;
+		To.Latitude[Index] = std::asin(2.0 * Uniform(Random) - 1.0);
+		To.Longitude[Index] = (2.0 * Uniform(Random) - 1.0) * glm::pi<double>();
+		To.Height[Index] = 0.0;
+	}
+
+	// Posicoes de entrada da conversao inversa, pela referencia
+	ECEFArrays Positions;
+	Positions.Resize(NumPoints);
+	for (std::size_t Index = 0; Index < NumPoints; ++Index)
+	{
+		const glm::dvec3 Position = ReferenceGeodeticToECEF(WGS84, From.Latitude[Index], From.Longitude[Index], From.Height[Index]);
+		Positions.X[Index] = Position.x;
+		Positions.Y[Index] = Position.y;
+		Positions.Z[Index] = Position.z;
+	}
+
+	ECEFArrays ConvertedPositions;
+	GeodeticArrays ConvertedPoints;
+	std::vector<double> HaversineDistances;
+	std::vector<double> VincentyDistances;
+	std::vector<double> Bearings;
+
+	const std::vector<Operation> Operations = {
+		{"geodesica -> ECEF", "m",
+			[&] { GeodeticToECEFBatch(WGS84, From, ConvertedPositions); },
+			[&](std::size_t Index)
+			{
+				const glm::dvec3 Expected = ReferenceGeodeticToECEF(WGS84, From.Latitude[Index], From.Longitude[Index], From.Height[Index]);
+				return glm::length(glm::dvec3{ConvertedPositions.X[Index], ConvertedPositions.Y[Index], ConvertedPositions.Z[Index]} - Expected);
+			}},
+		{"ECEF -> geodesica", "m",
+			[&] { ECEFToGeodeticBatch(WGS84, Positions, ConvertedPoints); },
+			[&](std::size_t Index)
+			{
+				// Erro de posicao equivalente: angulos convertidos em metros no raio do ponto
+				const glm::dvec3 Expected = ReferenceECEFToGeodetic(WGS84, glm::dvec3{Positions.X[Index], Positions.Y[Index], Positions.Z[Index]});
+				const double Radius = WGS84.SemiMajorAxis + std::max(Expected.z, 0.0);
+				const double Horizontal = Radius * std::hypot(AngleDifference(ConvertedPoints.Latitude[Index], Expected.x),
+					std::cos(Expected.x) * AngleDifference(ConvertedPoints.Longitude[Index], Expected.y));
+				return std::hypot(Horizontal, ConvertedPoints.Height[Index] - Expected.z);
+			}},
+		{"haversine", "relativo",
+			[&] { HaversineDistanceBatch(WGS84, From, To, HaversineDistances); },
+			[&](std::size_t Index)
+			{
+				const double Expected = ReferenceHaversineDistance(WGS84, From.Latitude[Index], From.Longitude[Index], To.Latitude[Index], To.Longitude[Index]);
+				return std::abs(HaversineDistances[Index] - Expected) / std::max(Expected, 1.0);
+			}},
+		{"Vincenty", "m",
+			[&] { VincentyDistanceBatch(WGS84, From, To, VincentyDistances); },
+			[&](std::size_t Index)
+			{
+				const double Expected = ReferenceVincentyDistance(WGS84, From.Latitude[Index], From.Longitude[Index], To.Latitude[Index], To.Longitude[Index]);
+				if (std::isnan(Expected) || std::isnan(VincentyDistances[Index]))
+				{
+					// Os dois precisam concordar que nao convergiu
+					return std::isnan(Expected) == std::isnan(VincentyDistances[Index]) ? 0.0 : 1e30;
+				}
+				return std::abs(VincentyDistances[Index] - Expected);
+			}},
+		{"rumo inicial", "rad",
+			[&] { InitialBearingBatch(From, To, Bearings); },
+			[&](std::size_t Index)
+			{
+				return AngleDifference(Bearings[Index], ReferenceInitialBearing(From.Latitude[Index], From.Longitude[Index], To.Latitude[Index], To.Longitude[Index]));
+			}},
+	};
+
+	PrintHeader("Geodesia em lote com " + std::to_string(NumPoints) + " pontos (" + std::to_string(JobSystem::Get().GetNumThreads()) + " threads)");
+	std::cout << std::setw(20) << "operacao" << std::setw(10) << "backend" << std::setw(12) << "Mpontos/s"
+		<< std::setw(14) << "erro max" << std::setw(10) << "unidade" << std::endl;
+
+	for (const Operation& Current : Operations)
+	{
+		for (GeodesyBackend Backend : {GeodesyBackend::Scalar, GeodesyBackend::AVX2})
+		{
+			if (!SetGeodesyBackend(Backend))
+			{
+				continue;
+			}
+			const double Seconds = Measure(Current.Run);
+
+			double MaxError = 0.0;
+			const std::size_t Stride = std::max<std::size_t>(1, NumPoints / NumCheckedPoints);
+			for (std::size_t Index = 0; Index < NumPoints; Index += Stride)
+			{
+				MaxError = std::max(MaxError, Current.Error(Index));
+			}
+
+			std::cout << std::setw(20) << Current.Name << std::setw(10) << GetGeodesyBackendName(Backend)
+				<< std::setw(12) << std::fixed << std::setprecision(1) << NumPoints / Seconds * 1e-6
+				<< std::setw(14) << std::scientific << std::setprecision(2) << MaxError
+				<< std::setw(10) << Current.ErrorUnit << std::endl;
+		}
+	}
+
+	const std::size_t NumNotConverged = std::count_if(VincentyDistances.begin(), VincentyDistances.end(), [](double Distance) { return std::isnan(Distance); });
+	std::cout << "Vincenty nao convergiu em " << NumNotConverged << " pares (pontos quase antipodas)" << std::endl;
+
+	JobSystem::Get().Shutdown();
+
+	return 0;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+
+// Parametros do elipsoide usados pelos kernels de geodesia, ja derivados dos dois
+// semieixos. Este cabecalho nao inclui a glm de proposito: ele e compartilhado com
+// GeodesyAVX2.cpp, que e compilado com AVX2 habilitado, e funcoes inline de outras
+// bibliotecas geradas la poderiam ser escolhidas pelo linker para o programa todo
+struct GeodesyEllipsoid
+{
+	double SemiMajorAxis = 0.0;         // a, metros
+	double SemiMinorAxis = 0.0;         // b
+	double Flattening = 0.0;            // f = (a - b) / a
+	double EccentricitySquared = 0.0;   // e^2 = (a^2 - b^2) / a^2
+	double SecondEccentricitySquared = 0.0; // e'^2 = (a^2 - b^2) / b^2
+	double MeanRadius = 0.0;            // (2a + b) / 3, usado pela haversine
+};
+
+// Limite de iteracoes de Vincenty; pontos quase antipodas podem nao convergir e
+// recebem NaN
+constexpr int VincentyMaxIterations = 200;
+constexpr double VincentyTolerance = 1e-12;
+
+// Iteracoes de Bowring na conversao ECEF para geodesica. Com uma o erro chega a
+// 0.3 m nas alturas de orbita; com duas fica abaixo de 0.1 um do solo ate acima da
+// orbita geoestacionaria
+constexpr int BowringIterations = 2;
+
+// Uma implementacao de cada operacao sobre arrays SoA. Latitudes, longitudes e
+// rumos em radianos; alturas e distancias em metros
+struct GeodesyKernels
+{
+	void (*GeodeticToECEF)(const GeodesyEllipsoid& Shape, const double* Latitude, const double* Longitude, const double* Height,
+		double* X, double* Y, double* Z, std::size_t Count);
+	void (*ECEFToGeodetic)(const GeodesyEllipsoid& Shape, const double* X, const double* Y, const double* Z,
+		double* Latitude, double* Longitude, double* Height, std::size_t Count);
+	void (*HaversineDistance)(const GeodesyEllipsoid& Shape, const double* Latitude1, const double* Longitude1,
+		const double* Latitude2, const double* Longitude2, double* Distance, std::size_t Count);
+	void (*VincentyDistance)(const GeodesyEllipsoid& Shape, const double* Latitude1, const double* Longitude1,
+		const double* Latitude2, const double* Longitude2, double* Distance, std::size_t Count);
+	void (*InitialBearing)(const GeodesyEllipsoid& Shape, const double* Latitude1, const double* Longitude1,
+		const double* Latitude2, const double* Longitude2, double* Bearing, std::size_t Count);
+};
+
+const GeodesyKernels& GetScalarGeodesyKernels();
+
+// nullptr quando o compilador nao gerou a versao AVX2 (fora de x86-64)
+const GeodesyKernels* GetAVX2GeodesyKernels();
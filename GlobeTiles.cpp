@@ -0,0 +1,211 @@
+#include "GlobeTiles.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Camera.h"
+#include "JobSystem.h"
+
+glm::dvec3 GeodeticToECEF(double Latitude, double Longitude, const glm::dvec3& Radii)
+{
+	const glm::dvec3 Normal{std::cos(Latitude) * std::cos(Longitude), std::cos(Latitude) * std::sin(Longitude), std::sin(Latitude)};
+	const glm::dvec3 K = Radii * Radii * Normal;
+	const double Gamma = std::sqrt(glm::dot(K, Normal));
+	return K / Gamma;
+}
+
+glm::dvec3 GeodeticSurfaceNormal(const glm::dvec3& Position, const glm::dvec3& Radii)
+{
+	return glm::normalize(Position / (Radii * Radii));
+}
+
+static GlobeTile BuildTile(int Level, int X, int Y, int Resolution, const glm::dvec3& Radii)
+{
+	const double TileSize = 180.0 / double(1 << Level);
+
+	GlobeTile Tile;
+	Tile.Level = Level;
+	Tile.X = X;
+	Tile.Y = Y;
+	Tile.MinLongitude = -180.0 + X * TileSize;
+	Tile.MaxLongitude = Tile.MinLongitude + TileSize;
+	Tile.MinLatitude = -90.0 + Y * TileSize;
+	Tile.MaxLatitude = Tile.MinLatitude + TileSize;
+
+	const double CenterLatitude = glm::radians(0.5 * (Tile.MinLatitude + Tile.MaxLatitude));
+	const double CenterLongitude = glm::radians(0.5 * (Tile.MinLongitude + Tile.MaxLongitude));
+	Tile.Center = GeodeticToECEF(CenterLatitude, CenterLongitude, Radii);
+
+	Tile.Vertices.reserve((Resolution + 1) * (Resolution + 1));
+	for (int j = 0; j <= Resolution; ++j)
+	{
+		const double Latitude = Tile.MinLatitude + TileSize * j / Resolution;
+		for (int i = 0; i <= Resolution; ++i)
+		{
+			const double Longitude = Tile.MinLongitude + TileSize * i / Resolution;
+			const glm::dvec3 Position = GeodeticToECEF(glm::radians(Latitude), glm::radians(Longitude), Radii);
+
+			TileVertex Vertex;
+			SplitDouble(Position, Vertex.Position, Vertex.PositionLow);
+			Vertex.Normal = glm::vec3(GeodeticSurfaceNormal(Position, Radii));
+			Vertex.UV = glm::vec2((Longitude + 180.0) / 360.0, (Latitude + 90.0) / 180.0);
+			Tile.Vertices.push_back(Vertex);
+
+			Tile.Radius = std::max(Tile.Radius, glm::length(Position - Tile.Center));
+		}
+	}
+
+	Tile.Indices.reserve(Resolution * Resolution * 6);
+	for (int j = 0; j < Resolution; ++j)
+	{
+		for (int i = 0; i < Resolution; ++i)
+		{
+			const GLuint V0 = j * (Resolution + 1) + i;
+			const GLuint V1 = V0 + 1;
+			const GLuint V2 = V0 + (Resolution + 1);
+			const GLuint V3 = V2 + 1;
+
+			Tile.Indices.insert(Tile.Indices.end(), {V0, V1, V2, V2, V1, V3});
+		}
+	}
+
+	return Tile;
+}
+
+std::vector<GlobeTile> BuildGlobeTiles(int Level, int Resolution, const glm::dvec3& Radii)
+{
+	const int NumTilesX = 2 << Level;
+	const int NumTilesY = 1 << Level;
+
+	// Cada tile e independente, entao as malhas sao geradas em paralelo
+	std::vector<GlobeTile> Tiles(NumTilesX * NumTilesY);
+	JobSystem::Get().ParallelFor(0, NumTilesX * NumTilesY, 0, [&](int TileBegin, int TileEnd)
+	{
+		for (int TileIndex = TileBegin; TileIndex < TileEnd; ++TileIndex)
+		{
+			Tiles[TileIndex] = BuildTile(Level, TileIndex % NumTilesX, TileIndex / NumTilesX, Resolution, Radii);
+		}
+	});
+	return Tiles;
+}
+
+// Calcula a magnitude que o ponto de oclusao precisa ter na direcao escalada
+// Direction para que Position fique escondida sempre que o ponto estiver
+static double HorizonPointMagnitude(const glm::dvec3& Position, const glm::dvec3& Direction, const glm::dvec3& Radii)
+{
+	const glm::dvec3 ScaledPosition = Position / Radii;
+
+	// Pontos abaixo do elipsoide sao tratados como se estivessem sobre ele
+	const double MagnitudeSquared = std::max(1.0, glm::dot(ScaledPosition, ScaledPosition));
+	const double Magnitude = std::sqrt(MagnitudeSquared);
+	const glm::dvec3 PositionDirection = ScaledPosition / glm::length(ScaledPosition);
+
+	const double CosAlpha = glm::dot(PositionDirection, Direction);
+	const double SinAlpha = glm::length(glm::cross(PositionDirection, Direction));
+	const double CosBeta = 1.0 / Magnitude;
+	const double SinBeta = std::sqrt(MagnitudeSquared - 1.0) * CosBeta;
+
+	return 1.0 / (CosAlpha * CosBeta - SinAlpha * SinBeta);
+}
+
+static void ComputeNodeBounds(GlobeNode& Node, const glm::dvec3& Radii)
+{
+	// Amostrar uma grade sobre a extensao do no; o raio ganha uma pequena folga
+	// para cobrir a curvatura entre as amostras
+	constexpr int NumSamples = 16;
+	constexpr double RadiusPadding = 1.005;
+
+	const double NodeSize = 180.0 / double(1 << Node.Level);
+	const double MinLongitude = -180.0 + Node.X * NodeSize;
+	const double MinLatitude = -90.0 + Node.Y * NodeSize;
+
+	Node.Center = GeodeticToECEF(glm::radians(MinLatitude + 0.5 * NodeSize), glm::radians(MinLongitude + 0.5 * NodeSize), Radii);
+
+	std::vector<glm::dvec3> Samples;
+	Samples.reserve((NumSamples + 1) * (NumSamples + 1));
+	for (int j = 0; j <= NumSamples; ++j)
+	{
+		for (int i = 0; i <= NumSamples; ++i)
+		{
+			const double Latitude = MinLatitude + NodeSize * j / NumSamples;
+			const double Longitude = MinLongitude + NodeSize * i / NumSamples;
+			Samples.push_back(GeodeticToECEF(glm::radians(Latitude), glm::radians(Longitude), Radii));
+		}
+	}
+
+	Node.Radius = 0.0;
+	for (const glm::dvec3& Sample : Samples)
+	{
+		Node.Radius = std::max(Node.Radius, glm::length(Sample - Node.Center));
+	}
+	Node.Radius *= RadiusPadding;
+
+	const glm::dvec3 Direction = glm::normalize(Node.Center / Radii);
+	double MaxMagnitude = 0.0;
+	Node.HasHorizonPoint = true;
+	for (const glm::dvec3& Sample : Samples)
+	{
+		const double Magnitude = HorizonPointMagnitude(Sample, Direction, Radii);
+		if (Magnitude <= 0.0)
+		{
+			// O no cobre mais de um hemisferio visivel, nao ha ponto de oclusao
+			Node.HasHorizonPoint = false;
+			break;
+		}
+		MaxMagnitude = std::max(MaxMagnitude, Magnitude);
+	}
+	Node.HorizonPoint = Direction * MaxMagnitude;
+}
+
+static int AddNode(GlobeQuadtree& Quadtree, int Level, int X, int Y, const glm::dvec3& Radii)
+{
+	const int NodeIndex = static_cast<int>(Quadtree.Nodes.size());
+	Quadtree.Nodes.emplace_back();
+
+	GlobeNode& Node = Quadtree.Nodes.back();
+	Node.Level = Level;
+	Node.X = X;
+	Node.Y = Y;
+	ComputeNodeBounds(Node, Radii);
+
+	if (Level == Quadtree.LeafLevel)
+	{
+		Node.TileIndex = Y * (2 << Level) + X;
+	}
+	return NodeIndex;
+}
+
+static void AddChildren(GlobeQuadtree& Quadtree, int NodeIndex, const glm::dvec3& Radii)
+{
+	const GlobeNode Parent = Quadtree.Nodes[NodeIndex];
+	if (Parent.Level == Quadtree.LeafLevel)
+	{
+		return;
+	}
+
+	// Os quatro filhos sao criados juntos para ficarem contiguos
+	const int FirstChild = AddNode(Quadtree, Parent.Level + 1, 2 * Parent.X, 2 * Parent.Y, Radii);
+	AddNode(Quadtree, Parent.Level + 1, 2 * Parent.X + 1, 2 * Parent.Y, Radii);
+	AddNode(Quadtree, Parent.Level + 1, 2 * Parent.X, 2 * Parent.Y + 1, Radii);
+	AddNode(Quadtree, Parent.Level + 1, 2 * Parent.X + 1, 2 * Parent.Y + 1, Radii);
+	Quadtree.Nodes[NodeIndex].FirstChild = FirstChild;
+
+	for (int Child = 0; Child < 4; ++Child)
+	{
+		AddChildren(Quadtree, FirstChild + Child, Radii);
+	}
+}
+
+GlobeQuadtree BuildGlobeQuadtree(int LeafLevel, const glm::dvec3& Radii)
+{
+	GlobeQuadtree Quadtree;
+	Quadtree.LeafLevel = LeafLevel;
+	Quadtree.NumRoots = 2;
+
+	AddNode(Quadtree, 0, 0, 0, Radii);
+	AddNode(Quadtree, 0, 1, 0, Radii);
+	AddChildren(Quadtree, 0, Radii);
+	AddChildren(Quadtree, 1, Radii);
+
+	return Quadtree;
+}
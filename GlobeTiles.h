@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+struct TileVertex
+{
+	glm::vec3 Position;     // ECEF dividido em alto/baixo (SplitDouble em Camera.h)
+	glm::vec3 PositionLow;
+	glm::vec3 Normal;
+	glm::vec2 UV;
+};
+
+// Um tile geografico do globo. Os vertices guardam a posicao ECEF em duas partes
+// em float; o vertex shader subtrai o olho de cada parte separadamente, entao a
+// posicao relativa ao olho nao perde precisao nem perto da superficie
+struct GlobeTile
+{
+	int Level = 0;
+	int X = 0;
+	int Y = 0;
+
+	double MinLatitude = 0.0;   // Graus
+	double MaxLatitude = 0.0;
+	double MinLongitude = 0.0;
+	double MaxLongitude = 0.0;
+
+	glm::dvec3 Center{0.0};     // ECEF
+	double Radius = 0.0;        // Raio da esfera envolvente
+
+	std::vector<TileVertex> Vertices;
+	std::vector<GLuint> Indices;
+};
+
+// No do quadtree do globo, usado pela selecao de visibilidade. Os filhos de um
+// no sao sempre quatro e ficam contiguos em GlobeQuadtree::Nodes
+struct GlobeNode
+{
+	int Level = 0;
+	int X = 0;
+	int Y = 0;
+
+	glm::dvec3 Center{0.0};             // Centro da esfera envolvente (ECEF)
+	double Radius = 0.0;
+
+	// Ponto de oclusao pelo horizonte no espaco escalado pelo elipsoide. Se este
+	// ponto estiver abaixo do horizonte, todo o no tambem esta
+	glm::dvec3 HorizonPoint{0.0};
+	bool HasHorizonPoint = false;
+
+	int FirstChild = -1;                // -1 nas folhas
+	int TileIndex = -1;                 // Indice no vetor de BuildGlobeTiles(LeafLevel), so nas folhas
+};
+
+struct GlobeQuadtree
+{
+	int LeafLevel = 0;
+	int NumRoots = 0;                   // As raizes sao os primeiros nos
+	std::vector<GlobeNode> Nodes;
+};
+
+// Converte latitude/longitude geodeticas (radianos) em ECEF sobre o elipsoide
+glm::dvec3 GeodeticToECEF(double Latitude, double Longitude, const glm::dvec3& Radii);
+
+// Normal da superficie do elipsoide em um ponto ECEF
+glm::dvec3 GeodeticSurfaceNormal(const glm::dvec3& Position, const glm::dvec3& Radii);
+
+// Gera todos os tiles de um nivel do quadtree geografico. O nivel 0 tem dois
+// tiles (hemisferios oeste e leste) e cada nivel divide os tiles em quatro.
+// Resolution e o numero de segmentos em cada lado do tile
+std::vector<GlobeTile> BuildGlobeTiles(int Level, int Resolution, const glm::dvec3& Radii);
+
+// Gera a hierarquia de volumes do nivel 0 ate LeafLevel. As folhas apontam para
+// os tiles gerados por BuildGlobeTiles(LeafLevel, ...)
+GlobeQuadtree BuildGlobeQuadtree(int LeafLevel, const glm::dvec3& Radii);
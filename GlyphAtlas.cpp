@@ -0,0 +1,521 @@
+#include "GlyphAtlas.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#define STB_RECT_PACK_IMPLEMENTATION
+#include <stb_rect_pack.h>
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include <stb_truetype.h>
+
+#include "JobSystem.h"
+
+// Valor do SDF exatamente sobre o contorno; acima e dentro do glifo
+constexpr unsigned char SdfOnEdgeValue = 128;
+
+// Espaco entre glifos no atlas para a filtragem bilinear nao misturar vizinhos
+constexpr int GlyphSpacing = 1;
+
+const std::vector<CodepointRange> DefaultGlyphRanges = {{0x20, 0x7E}, {0xA0, 0xFF}};
+
+// Arquivo do atlas cozido: cabecalho, tabela de glifos e as linhas ocupadas do
+// atlas, alinhadas em 16 bytes para serem enviadas direto do arquivo mapeado
+constexpr char BakedAtlasMagic[4] = {'B', 'M', 'G', 'A'};
+constexpr std::uint32_t BakedAtlasVersion = 1;
+
+struct BakedAtlasHeader
+{
+	char Magic[4];
+	std::uint32_t Version;
+	std::uint64_t FontHash;
+	float PixelHeight;
+	float SdfRange;
+	std::int32_t AtlasSize;
+	std::int32_t BakedHeight;
+	std::uint32_t NumGlyphs;
+	std::uint32_t Reserved;
+};
+
+struct BakedGlyph
+{
+	std::int32_t Codepoint;
+	std::uint32_t HasBitmap;
+	float U0;
+	float V0;
+	float U1;
+	float V1;
+	float OffsetX;
+	float OffsetY;
+	float Width;
+	float Height;
+	float Advance;
+};
+
+static std::size_t GetBakedPixelsOffset(std::uint32_t NumGlyphs)
+{
+	const std::size_t TableEnd = sizeof(BakedAtlasHeader) + std::size_t(NumGlyphs) * sizeof(BakedGlyph);
+	return (TableEnd + 15) & ~std::size_t{15};
+}
+
+// Hash do arquivo da fonte, para o atlas cozido de outra versao da fonte ser descartado
+static std::uint64_t HashFontData(const unsigned char* Data, std::size_t Size)
+{
+	std::uint64_t Hash = 0xcbf29ce484222325ull ^ Size;
+	std::size_t Offset = 0;
+	for (; Offset + sizeof(std::uint64_t) <= Size; Offset += sizeof(std::uint64_t))
+	{
+		std::uint64_t Word;
+		std::memcpy(&Word, Data + Offset, sizeof(Word));
+		Hash = (Hash ^ Word) * 0x100000001b3ull;
+	}
+	for (; Offset < Size; ++Offset)
+	{
+		Hash = (Hash ^ Data[Offset]) * 0x100000001b3ull;
+	}
+	return Hash;
+}
+
+// SDF de um glifo antes de ir para o atlas. So le a fonte, entao roda em qualquer thread
+struct RasterizedGlyph
+{
+	int Codepoint = 0;
+	GlyphInfo Info;
+	unsigned char* Bitmap = nullptr;    // Liberar com stbtt_FreeSDF
+	int Width = 0;
+	int Height = 0;
+};
+
+static RasterizedGlyph RasterizeGlyph(const stbtt_fontinfo& Font, float Scale, int Padding, int Codepoint)
+{
+	RasterizedGlyph Result;
+	Result.Codepoint = Codepoint;
+
+	const int GlyphIndex = stbtt_FindGlyphIndex(&Font, Codepoint);
+
+	int AdvanceWidth = 0;
+	int LeftSideBearing = 0;
+	stbtt_GetGlyphHMetrics(&Font, GlyphIndex, &AdvanceWidth, &LeftSideBearing);
+	Result.Info.Advance = AdvanceWidth * Scale;
+
+	// A borda do campo vai de -Padding a +Padding pixels em torno do contorno
+	const float PixelDistanceScale = 127.0f / Padding;
+
+	int OffsetX = 0;
+	int OffsetY = 0;
+	Result.Bitmap = stbtt_GetGlyphSDF(&Font, Scale, GlyphIndex, Padding, SdfOnEdgeValue, PixelDistanceScale, &Result.Width, &Result.Height, &OffsetX, &OffsetY);
+	Result.Info.OffsetX = float(OffsetX);
+	Result.Info.OffsetY = float(OffsetY);
+	Result.Info.Width = float(Result.Width);
+	Result.Info.Height = float(Result.Height);
+
+	return Result;
+}
+
+bool GlyphAtlas::Init(const std::string& FontFile, float InPixelHeight, int InAtlasSize)
+{
+	Glyphs.clear();
+	PendingUploads.clear();
+	BakedData = FileContents{};
+	CurrentStats = Stats{};
+	Scale = 0.0f;
+
+	// O stb_truetype le a fonte direto do arquivo, que precisa continuar em memoria
+	FontData = ReadWholeFile(FontFile);
+	if (!FontData.IsValid())
+	{
+		std::cerr << "Falha ao ler a fonte: " << FontFile << std::endl;
+		return false;
+	}
+
+	const int FontOffset = stbtt_GetFontOffsetForIndex(FontData.Data(), 0);
+	if (FontOffset < 0 || !stbtt_InitFont(&Font, FontData.Data(), FontOffset))
+	{
+		std::cerr << "Fonte invalida: " << FontFile << std::endl;
+		return false;
+	}
+
+	FontHash = HashFontData(FontData.Data(), FontData.Size());
+
+	PixelHeight = InPixelHeight;
+	Scale = stbtt_ScaleForPixelHeight(&Font, PixelHeight);
+
+	int FontAscent = 0;
+	int FontDescent = 0;
+	int FontLineGap = 0;
+	stbtt_GetFontVMetrics(&Font, &FontAscent, &FontDescent, &FontLineGap);
+	Ascent = FontAscent * Scale;
+	Descent = FontDescent * Scale;
+
+	AtlasSize = InAtlasSize;
+	ResetPacker(0);
+
+	return true;
+}
+
+bool GlyphAtlas::InitCached(const std::string& FontFile, const std::string& CacheFile, const std::vector<CodepointRange>& Ranges, float InPixelHeight, int InAtlasSize)
+{
+	if (!Init(FontFile, InPixelHeight, InAtlasSize))
+	{
+		return false;
+	}
+
+	// Primeira execucao ou fonte trocada: cozinhar de novo
+	if (!std::filesystem::exists(CacheFile) || !LoadBaked(CacheFile))
+	{
+		std::cout << "Cozinhando o atlas de glifos em " << CacheFile << std::endl;
+		Bake(Ranges, CacheFile);
+	}
+	return true;
+}
+
+void GlyphAtlas::ResetPacker(int OffsetY)
+{
+	PackOffsetY = std::min(OffsetY, AtlasSize);
+	PackerNodes.resize(AtlasSize);
+	stbrp_init_target(&Packer, AtlasSize, AtlasSize - PackOffsetY, PackerNodes.data(), static_cast<int>(PackerNodes.size()));
+}
+
+bool GlyphAtlas::Bake(const std::vector<CodepointRange>& Ranges, const std::string& OutputFile)
+{
+	if (!IsValid() || !Glyphs.empty())
+	{
+		return false;
+	}
+
+	const auto StartTime = std::chrono::steady_clock::now();
+
+	// Codepoints que a fonte realmente tem; os demais ficam para o glifo .notdef sob demanda
+	std::vector<int> Codepoints;
+	for (const CodepointRange& Range : Ranges)
+	{
+		for (int Codepoint = Range.First; Codepoint <= Range.Last; ++Codepoint)
+		{
+			if (stbtt_FindGlyphIndex(&Font, Codepoint) != 0)
+			{
+				Codepoints.push_back(Codepoint);
+			}
+		}
+	}
+	std::sort(Codepoints.begin(), Codepoints.end());
+	Codepoints.erase(std::unique(Codepoints.begin(), Codepoints.end()), Codepoints.end());
+
+	// A rasterizacao e o custo dominante e cada glifo e independente
+	const int Padding = static_cast<int>(GetSdfRange());
+	std::vector<RasterizedGlyph> Rasterized(Codepoints.size());
+	JobSystem::Get().ParallelFor(0, static_cast<int>(Codepoints.size()), 0, [this, Padding, &Codepoints, &Rasterized](int SliceBegin, int SliceEnd)
+	{
+		for (int GlyphIndex = SliceBegin; GlyphIndex < SliceEnd; ++GlyphIndex)
+		{
+			Rasterized[GlyphIndex] = RasterizeGlyph(Font, Scale, Padding, Codepoints[GlyphIndex]);
+		}
+	});
+
+	// Empacotar todos juntos: o stb_rect_pack ordena por altura e aproveita melhor o espaco
+	std::vector<stbrp_rect> Rects;
+	for (std::size_t GlyphIndex = 0; GlyphIndex < Rasterized.size(); ++GlyphIndex)
+	{
+		if (Rasterized[GlyphIndex].Bitmap != nullptr)
+		{
+			stbrp_rect Rect{};
+			Rect.id = static_cast<int>(GlyphIndex);
+			Rect.w = Rasterized[GlyphIndex].Width + GlyphSpacing;
+			Rect.h = Rasterized[GlyphIndex].Height + GlyphSpacing;
+			Rects.push_back(Rect);
+		}
+	}
+	if (!Rects.empty())
+	{
+		stbrp_pack_rects(&Packer, Rects.data(), static_cast<int>(Rects.size()));
+	}
+
+	std::vector<unsigned char> Pixels(std::size_t(AtlasSize) * AtlasSize, 0);
+	int BakedHeight = 0;
+	for (const stbrp_rect& Rect : Rects)
+	{
+		RasterizedGlyph& Glyph = Rasterized[Rect.id];
+		if (!Rect.was_packed)
+		{
+			CurrentStats.NumRejected++;
+			continue;
+		}
+
+		for (int Row = 0; Row < Glyph.Height; ++Row)
+		{
+			std::memcpy(&Pixels[std::size_t(Rect.y + Row) * AtlasSize + Rect.x], Glyph.Bitmap + std::size_t(Row) * Glyph.Width, Glyph.Width);
+		}
+		Glyph.Info.U0 = float(Rect.x) / AtlasSize;
+		Glyph.Info.V0 = float(Rect.y) / AtlasSize;
+		Glyph.Info.U1 = float(Rect.x + Glyph.Width) / AtlasSize;
+		Glyph.Info.V1 = float(Rect.y + Glyph.Height) / AtlasSize;
+		Glyph.Info.HasBitmap = true;
+		BakedHeight = std::max(BakedHeight, Rect.y + Rect.h);
+	}
+	if (CurrentStats.NumRejected > 0)
+	{
+		std::cerr << CurrentStats.NumRejected << " glifos nao couberam no atlas (" << AtlasSize << "x" << AtlasSize << ")" << std::endl;
+	}
+
+	for (RasterizedGlyph& Glyph : Rasterized)
+	{
+		Glyphs[Glyph.Codepoint] = Glyph.Info;
+		stbtt_FreeSDF(Glyph.Bitmap, nullptr);
+	}
+	CurrentStats.NumGlyphs += static_cast<int>(Rasterized.size());
+	CurrentStats.RasterSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+
+	// Os glifos rasterizados depois ficam abaixo da regiao cozida
+	ResetPacker(BakedHeight);
+	Pixels.resize(std::size_t(BakedHeight) * AtlasSize);
+
+	// Gravar em um temporario e renomear, para outra instancia nunca ler um arquivo pela metade
+	BakedAtlasHeader Header{};
+	std::memcpy(Header.Magic, BakedAtlasMagic, sizeof(Header.Magic));
+	Header.Version = BakedAtlasVersion;
+	Header.FontHash = FontHash;
+	Header.PixelHeight = PixelHeight;
+	Header.SdfRange = GetSdfRange();
+	Header.AtlasSize = AtlasSize;
+	Header.BakedHeight = BakedHeight;
+	Header.NumGlyphs = static_cast<std::uint32_t>(Glyphs.size());
+
+	std::vector<BakedGlyph> Table;
+	Table.reserve(Glyphs.size());
+	for (const auto& [Codepoint, Info] : Glyphs)
+	{
+		Table.push_back(BakedGlyph{Codepoint, Info.HasBitmap ? 1u : 0u, Info.U0, Info.V0, Info.U1, Info.V1, Info.OffsetX, Info.OffsetY, Info.Width, Info.Height, Info.Advance});
+	}
+
+	const std::string TemporaryFile = OutputFile + ".tmp";
+	bool Saved = false;
+	{
+		std::ofstream File{TemporaryFile, std::ios::binary | std::ios::trunc};
+		const std::vector<char> Alignment(GetBakedPixelsOffset(Header.NumGlyphs) - sizeof(Header) - Table.size() * sizeof(BakedGlyph), 0);
+		File.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+		File.write(reinterpret_cast<const char*>(Table.data()), Table.size() * sizeof(BakedGlyph));
+		File.write(Alignment.data(), Alignment.size());
+		File.write(reinterpret_cast<const char*>(Pixels.data()), Pixels.size());
+		Saved = static_cast<bool>(File);
+	}
+	std::error_code Error;
+	if (Saved)
+	{
+		std::filesystem::rename(TemporaryFile, OutputFile, Error);
+		Saved = !Error;
+	}
+	if (!Saved)
+	{
+		std::filesystem::remove(TemporaryFile, Error);
+		std::cerr << "Falha ao gravar o atlas de glifos: " << OutputFile << std::endl;
+	}
+
+	GlyphUpload Upload;
+	Upload.Width = AtlasSize;
+	Upload.Height = BakedHeight;
+	Upload.Pixels = std::move(Pixels);
+	if (BakedHeight > 0)
+	{
+		PendingUploads.push_back(std::move(Upload));
+	}
+
+	return Saved;
+}
+
+bool GlyphAtlas::LoadBaked(const std::string& AtlasFile)
+{
+	if (!IsValid() || !Glyphs.empty())
+	{
+		return false;
+	}
+
+	FileContents Contents = ReadWholeFile(AtlasFile);
+	if (!Contents.IsValid() || Contents.Size() < sizeof(BakedAtlasHeader))
+	{
+		return false;
+	}
+
+	BakedAtlasHeader Header;
+	std::memcpy(&Header, Contents.Data(), sizeof(Header));
+	if (std::memcmp(Header.Magic, BakedAtlasMagic, sizeof(Header.Magic)) != 0 || Header.Version != BakedAtlasVersion)
+	{
+		std::cerr << "Atlas de glifos invalido: " << AtlasFile << std::endl;
+		return false;
+	}
+
+	// Cozido com outra fonte ou outros parametros: precisa ser refeito
+	if (Header.FontHash != FontHash || Header.PixelHeight != PixelHeight || Header.SdfRange != GetSdfRange() ||
+		Header.AtlasSize != AtlasSize || Header.BakedHeight < 0 || Header.BakedHeight > AtlasSize)
+	{
+		return false;
+	}
+
+	const std::size_t PixelsOffset = GetBakedPixelsOffset(Header.NumGlyphs);
+	if (Contents.Size() < PixelsOffset + std::size_t(Header.BakedHeight) * AtlasSize)
+	{
+		std::cerr << "Atlas de glifos truncado: " << AtlasFile << std::endl;
+		return false;
+	}
+
+	const unsigned char* TableData = Contents.Data() + sizeof(Header);
+	for (std::uint32_t GlyphIndex = 0; GlyphIndex < Header.NumGlyphs; ++GlyphIndex)
+	{
+		BakedGlyph Baked;
+		std::memcpy(&Baked, TableData + std::size_t(GlyphIndex) * sizeof(BakedGlyph), sizeof(Baked));
+
+		GlyphInfo& Info = Glyphs[Baked.Codepoint];
+		Info.U0 = Baked.U0;
+		Info.V0 = Baked.V0;
+		Info.U1 = Baked.U1;
+		Info.V1 = Baked.V1;
+		Info.OffsetX = Baked.OffsetX;
+		Info.OffsetY = Baked.OffsetY;
+		Info.Width = Baked.Width;
+		Info.Height = Baked.Height;
+		Info.Advance = Baked.Advance;
+		Info.HasBitmap = Baked.HasBitmap != 0;
+	}
+	CurrentStats.NumBaked = static_cast<int>(Header.NumGlyphs);
+
+	ResetPacker(Header.BakedHeight);
+
+	// Os pixels vao para a textura direto do arquivo, que fica aberto junto com o atlas
+	BakedData = std::move(Contents);
+	if (Header.BakedHeight > 0)
+	{
+		GlyphUpload Upload;
+		Upload.Width = AtlasSize;
+		Upload.Height = Header.BakedHeight;
+		Upload.MappedPixels = BakedData.Data() + PixelsOffset;
+		PendingUploads.push_back(std::move(Upload));
+	}
+
+	return true;
+}
+
+float GlyphAtlas::GetSdfRange() const
+{
+	// Uma borda de 1/8 da altura cobre o contorno e um halo fino em volta
+	return std::max(2.0f, PixelHeight / 8.0f);
+}
+
+const GlyphInfo& GlyphAtlas::GetGlyph(int Codepoint)
+{
+	auto GlyphIt = Glyphs.find(Codepoint);
+	if (GlyphIt != Glyphs.end())
+	{
+		return GlyphIt->second;
+	}
+
+	GlyphInfo& Glyph = Glyphs[Codepoint];
+	if (!IsValid())
+	{
+		return Glyph;
+	}
+
+	const auto StartTime = std::chrono::steady_clock::now();
+
+	RasterizedGlyph Rasterized = RasterizeGlyph(Font, Scale, static_cast<int>(GetSdfRange()), Codepoint);
+	Glyph = Rasterized.Info;
+	if (Rasterized.Bitmap != nullptr)
+	{
+		stbrp_rect Rect{};
+		Rect.id = Codepoint;
+		Rect.w = Rasterized.Width + GlyphSpacing;
+		Rect.h = Rasterized.Height + GlyphSpacing;
+		if (stbrp_pack_rects(&Packer, &Rect, 1) && Rect.was_packed)
+		{
+			// O pacote cobre so as linhas abaixo da regiao cozida
+			Rect.y += PackOffsetY;
+
+			Glyph.U0 = float(Rect.x) / AtlasSize;
+			Glyph.V0 = float(Rect.y) / AtlasSize;
+			Glyph.U1 = float(Rect.x + Rasterized.Width) / AtlasSize;
+			Glyph.V1 = float(Rect.y + Rasterized.Height) / AtlasSize;
+			Glyph.HasBitmap = true;
+
+			GlyphUpload Upload;
+			Upload.X = Rect.x;
+			Upload.Y = Rect.y;
+			Upload.Width = Rasterized.Width;
+			Upload.Height = Rasterized.Height;
+			Upload.Pixels.assign(Rasterized.Bitmap, Rasterized.Bitmap + std::size_t(Rasterized.Width) * Rasterized.Height);
+			PendingUploads.push_back(std::move(Upload));
+		}
+		else
+		{
+			if (CurrentStats.NumRejected == 0)
+			{
+				std::cerr << "Atlas de glifos cheio (" << AtlasSize << "x" << AtlasSize << ")" << std::endl;
+			}
+			CurrentStats.NumRejected++;
+		}
+		stbtt_FreeSDF(Rasterized.Bitmap, nullptr);
+	}
+
+	CurrentStats.NumGlyphs++;
+	CurrentStats.RasterSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+
+	return Glyph;
+}
+
+float GlyphAtlas::GetKerning(int FirstCodepoint, int SecondCodepoint) const
+{
+	if (!IsValid())
+	{
+		return 0.0f;
+	}
+	return stbtt_GetCodepointKernAdvance(&Font, FirstCodepoint, SecondCodepoint) * Scale;
+}
+
+std::vector<GlyphUpload> GlyphAtlas::TakeUploads()
+{
+	std::vector<GlyphUpload> Uploads;
+	Uploads.swap(PendingUploads);
+	return Uploads;
+}
+
+int DecodeUtf8(const std::string& Text, std::size_t& Position)
+{
+	constexpr int Replacement = 0xFFFD;
+
+	const unsigned char Lead = static_cast<unsigned char>(Text[Position++]);
+	int NumContinuation = 0;
+	int Codepoint = 0;
+	if (Lead < 0x80)
+	{
+		return Lead;
+	}
+	else if ((Lead & 0xE0) == 0xC0)
+	{
+		NumContinuation = 1;
+		Codepoint = Lead & 0x1F;
+	}
+	else if ((Lead & 0xF0) == 0xE0)
+	{
+		NumContinuation = 2;
+		Codepoint = Lead & 0x0F;
+	}
+	else if ((Lead & 0xF8) == 0xF0)
+	{
+		NumContinuation = 3;
+		Codepoint = Lead & 0x07;
+	}
+	else
+	{
+		return Replacement;
+	}
+
+	for (int ByteIndex = 0; ByteIndex < NumContinuation; ++ByteIndex)
+	{
+		if (Position >= Text.size() || (static_cast<unsigned char>(Text[Position]) & 0xC0) != 0x80)
+		{
+			return Replacement;
+		}
+		Codepoint = (Codepoint << 6) | (static_cast<unsigned char>(Text[Position++]) & 0x3F);
+	}
+	return Codepoint;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <stb_rect_pack.h>
+#include <stb_truetype.h>
+
+#include "FileReader.h"
+
+// Um glifo no atlas. As medidas sao em pixels na altura de rasterizacao do atlas
+struct GlyphInfo
+{
+	float U0 = 0.0f;        // Retangulo no atlas, normalizado
+	float V0 = 0.0f;
+	float U1 = 0.0f;
+	float V1 = 0.0f;
+	float OffsetX = 0.0f;   // Canto superior esquerdo do bitmap em relacao a origem na linha de base
+	float OffsetY = 0.0f;   // Positivo para baixo, como no stb_truetype
+	float Width = 0.0f;     // Tamanho do bitmap, incluindo a borda do campo de distancia
+	float Height = 0.0f;
+	float Advance = 0.0f;
+	bool HasBitmap = false; // Espaco e glifos que nao couberam no atlas nao tem bitmap
+};
+
+// Bitmap de um glifo recem-rasterizado esperando ser copiado para a textura do atlas
+struct GlyphUpload
+{
+	int X = 0;
+	int Y = 0;
+	int Width = 0;
+	int Height = 0;
+	std::vector<unsigned char> Pixels;
+
+	// Atlas carregado de um arquivo: aponta direto para o arquivo mapeado, sem copia
+	const unsigned char* MappedPixels = nullptr;
+
+	const unsigned char* Data() const { return MappedPixels != nullptr ? MappedPixels : Pixels.data(); }
+};
+
+// Faixa de codepoints [First, Last] rasterizada de uma vez no cozimento do atlas
+struct CodepointRange
+{
+	int First = 0;
+	int Last = 0;
+};
+
+// Latim basico e suplemento Latin-1, suficientes para os nomes em portugues
+extern const std::vector<CodepointRange> DefaultGlyphRanges;
+
+// Atlas de glifos em campo de distancia com sinal (SDF). Os glifos sao rasterizados
+// com stb_truetype na primeira vez que aparecem e empacotados com stb_rect_pack em
+// um atlas de um canal. Faixas inteiras podem ser cozidas de antemao (Bake) em um
+// arquivo com os pixels e as metricas, carregado depois sem rasterizar nada; so os
+// glifos fora das faixas cozidas sao rasterizados sob demanda, no espaco que sobrou.
+// Nao usa OpenGL: os bitmaps novos ficam em TakeUploads() para a thread de
+// renderizacao copiar para a textura
+class GlyphAtlas
+{
+public:
+	struct Stats
+	{
+		int NumGlyphs = 0;
+		int NumRejected = 0;    // Glifos que nao couberam no atlas
+		int NumBaked = 0;       // Carregados prontos do arquivo cozido
+		double RasterSeconds = 0.0;
+	};
+
+	// PixelHeight e a altura da fonte no atlas; o SDF permite desenhar em outros tamanhos
+	bool Init(const std::string& FontFile, float PixelHeight, int AtlasSize);
+	bool IsValid() const { return FontData.IsValid() && Scale > 0.0f; }
+
+	// Init seguido de LoadBaked(CacheFile). Se o arquivo nao existir ou for de outra
+	// fonte ou tamanho, coze as faixas e grava o arquivo para as proximas execucoes
+	bool InitCached(const std::string& FontFile, const std::string& CacheFile, const std::vector<CodepointRange>& Ranges, float PixelHeight, int AtlasSize);
+
+	// Rasteriza em paralelo (JobSystem) todos os glifos das faixas, empacota tudo com
+	// uma unica chamada a stbrp_pack_rects e grava o atlas em OutputFile. Chamar logo
+	// depois de Init, com o atlas vazio
+	bool Bake(const std::vector<CodepointRange>& Ranges, const std::string& OutputFile);
+
+	// Carrega um atlas cozido. Falha se o arquivo foi gerado com outra fonte, altura
+	// ou tamanho de atlas. O arquivo fica mapeado e vai direto para a textura
+	bool LoadBaked(const std::string& AtlasFile);
+
+	// Linhas do topo do atlas ocupadas pelos glifos cozidos
+	int GetBakedHeight() const { return PackOffsetY; }
+
+	// Glifo do codepoint, rasterizado e empacotado se ainda nao existir
+	const GlyphInfo& GetGlyph(int Codepoint);
+	float GetKerning(int FirstCodepoint, int SecondCodepoint) const;
+
+	float GetPixelHeight() const { return PixelHeight; }
+	float GetAscent() const { return Ascent; }
+	float GetDescent() const { return Descent; }
+	int GetSize() const { return AtlasSize; }
+
+	// Distancia em pixels do atlas coberta pelo campo de cada lado do contorno
+	float GetSdfRange() const;
+
+	// Bitmaps rasterizados desde a ultima chamada
+	std::vector<GlyphUpload> TakeUploads();
+
+	Stats GetStats() const { return CurrentStats; }
+
+private:
+	// Pacote de glifos do stb_rect_pack, abaixo das linhas ja ocupadas
+	void ResetPacker(int OffsetY);
+
+	FileContents FontData;
+	std::uint64_t FontHash = 0;
+	stbtt_fontinfo Font{};
+	float Scale = 0.0f;
+	float PixelHeight = 0.0f;
+	float Ascent = 0.0f;
+	float Descent = 0.0f;
+
+	int AtlasSize = 0;
+	stbrp_context Packer{};
+	std::vector<stbrp_node> PackerNodes;
+	int PackOffsetY = 0;
+
+	// Arquivo cozido mapeado enquanto o atlas existir
+	FileContents BakedData;
+
+	std::unordered_map<int, GlyphInfo> Glyphs;
+	std::vector<GlyphUpload> PendingUploads;
+
+	Stats CurrentStats;
+};
+
+// Proximo codepoint de um texto UTF-8, avancando Position. Sequencias invalidas viram U+FFFD
+int DecodeUtf8(const std::string& Text, std::size_t& Position);
@@ -0,0 +1,418 @@
+#include "GpuCulling.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+#include <glm/ext.hpp>
+
+#include "Camera.h"
+#include "TileBatchRenderer.h"
+
+// Pontos de ligacao dos SSBOs em cull_comp.glsl
+constexpr GLuint CandidateBinding = 0;
+constexpr GLuint CommandBinding = 1;
+constexpr GLuint DrawDataBinding = 2;
+constexpr GLuint CountBinding = 3;
+constexpr GLuint VisibleIndexBinding = 4;
+
+// Tamanho dos grupos de trabalho dos compute shaders
+constexpr GLuint CullGroupSize = 64;
+constexpr GLuint HiZGroupSize = 8;
+
+bool GpuCulling::IsSupported()
+{
+	return GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_shader_image_load_store &&
+		GLEW_ARB_texture_storage && TileBatchRenderer::IsSupported();
+}
+
+void GpuCulling::Init(GLuint CullProgramId, GLuint HiZProgramId, int Width, int Height)
+{
+	CullProgram = CullProgramId;
+	HiZProgram = HiZProgramId;
+
+	glGenBuffers(1, &CandidateBuffer);
+	glGenBuffers(1, &CommandBuffer);
+	glGenBuffers(1, &DrawDataBuffer);
+	glGenBuffers(1, &CountBuffer);
+	glGenBuffers(1, &VisibleIndexBuffer);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, CountBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// Copia do depth buffer da janela
+	HiZWidth = Width;
+	HiZHeight = Height;
+	glGenTextures(1, &DepthTexture);
+	glBindTexture(GL_TEXTURE_2D, DepthTexture);
+	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT24, Width, Height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+	// Piramide Hi-Z: cada nivel guarda o maior depth da regiao 2x2 do nivel anterior
+	HiZLevels = 1 + static_cast<int>(std::floor(std::log2(std::max(Width, Height))));
+	glGenTextures(1, &HiZTexture);
+	glBindTexture(GL_TEXTURE_2D, HiZTexture);
+	glTexStorage2D(GL_TEXTURE_2D, HiZLevels, GL_R32F, Width, Height);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void GpuCulling::Destroy()
+{
+	glDeleteBuffers(1, &CandidateBuffer);
+	glDeleteBuffers(1, &CommandBuffer);
+	glDeleteBuffers(1, &DrawDataBuffer);
+	glDeleteBuffers(1, &CountBuffer);
+	glDeleteBuffers(1, &VisibleIndexBuffer);
+	glDeleteTextures(1, &DepthTexture);
+	glDeleteTextures(1, &HiZTexture);
+
+	CandidateBuffer = CommandBuffer = DrawDataBuffer = CountBuffer = VisibleIndexBuffer = 0;
+	DepthTexture = HiZTexture = 0;
+	HasHiZ = false;
+	CandidateData.clear();
+}
+
+void GpuCulling::SetCandidates(const std::vector<GpuCullCandidate>& Candidates)
+{
+	CandidateData = Candidates;
+	const std::size_t NumCandidates = std::max<std::size_t>(Candidates.size(), 1);
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, CandidateBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, NumCandidates * sizeof(GpuCullCandidate), Candidates.data(), GL_STATIC_DRAW);
+
+	// As saidas tem espaco para o pior caso, com todos os candidatos visiveis
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, CommandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, NumCandidates * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, DrawDataBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, NumCandidates * sizeof(TileDrawData), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, VisibleIndexBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, NumCandidates * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuCulling::Cull(const Frustum& ViewFrustum, const glm::dvec3& Eye, bool UseHiZ)
+{
+	if (CandidateData.empty())
+	{
+		return;
+	}
+
+	// Sem glMultiDrawElementsIndirectCount os comandos que sobram precisam estar
+	// zerados, entao o buffer de comandos inteiro e limpo junto com o contador
+	const GLuint Zero = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, CountBuffer);
+	glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &Zero);
+	if (!GLEW_ARB_indirect_parameters)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, CommandBuffer);
+		glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, &Zero);
+	}
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glUseProgram(CullProgram);
+
+	glm::vec3 EyeHigh;
+	glm::vec3 EyeLow;
+	SplitDouble(Eye, EyeHigh, EyeLow);
+
+	const bool ApplyHiZ = UseHiZ && HasHiZ;
+	glUniform1ui(glGetUniformLocation(CullProgram, "NumCandidates"), static_cast<GLuint>(CandidateData.size()));
+	glUniform4fv(glGetUniformLocation(CullProgram, "FrustumPlanes"), 6, glm::value_ptr(ViewFrustum.Planes[0]));
+	glUniform3fv(glGetUniformLocation(CullProgram, "EyeHigh"), 1, glm::value_ptr(EyeHigh));
+	glUniform3fv(glGetUniformLocation(CullProgram, "EyeLow"), 1, glm::value_ptr(EyeLow));
+	glUniform1i(glGetUniformLocation(CullProgram, "UseHiZ"), ApplyHiZ ? 1 : 0);
+
+	if (ApplyHiZ)
+	{
+		// O Hi-Z foi montado com a camera do frame anterior; o deslocamento do olho
+		// entre os frames e calculado em double
+		const glm::vec3 PreviousEyeOffset{Eye - HiZEye};
+		glUniformMatrix4fv(glGetUniformLocation(CullProgram, "PreviousViewProjection"), 1, GL_FALSE, glm::value_ptr(HiZViewProjection));
+		glUniform3fv(glGetUniformLocation(CullProgram, "PreviousEyeOffset"), 1, glm::value_ptr(PreviousEyeOffset));
+		glUniform2f(glGetUniformLocation(CullProgram, "HiZSize"), float(HiZWidth), float(HiZHeight));
+		glUniform1i(glGetUniformLocation(CullProgram, "HiZLevels"), HiZLevels);
+		glUniform1i(glGetUniformLocation(CullProgram, "HiZTexture"), 0);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, HiZTexture);
+	}
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CandidateBinding, CandidateBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CommandBinding, CommandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DrawDataBinding, DrawDataBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, CountBinding, CountBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VisibleIndexBinding, VisibleIndexBuffer);
+
+	const GLuint NumGroups = (static_cast<GLuint>(CandidateData.size()) + CullGroupSize - 1) / CullGroupSize;
+	glDispatchCompute(NumGroups, 1, 1);
+
+	// Os resultados serao lidos como comandos indiretos, parametros e SSBO
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+}
+
+void GpuCulling::BuildHiZ(const glm::mat4& ViewProjection, const glm::dvec3& Eye)
+{
+	// Copiar o depth buffer da janela para uma textura que pode ser amostrada
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+	glBindTexture(GL_TEXTURE_2D, DepthTexture);
+	glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, HiZWidth, HiZHeight);
+
+	BuildPyramid(ViewProjection, Eye);
+}
+
+void GpuCulling::BuildHiZFromDepth(const std::vector<float>& Depth, const glm::mat4& ViewProjection, const glm::dvec3& Eye)
+{
+	glBindTexture(GL_TEXTURE_2D, DepthTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, HiZWidth, HiZHeight, GL_DEPTH_COMPONENT, GL_FLOAT, Depth.data());
+
+	BuildPyramid(ViewProjection, Eye);
+}
+
+void GpuCulling::BuildPyramid(const glm::mat4& ViewProjection, const glm::dvec3& Eye)
+{
+	glUseProgram(HiZProgram);
+	glUniform1i(glGetUniformLocation(HiZProgram, "SourceTexture"), 0);
+	glActiveTexture(GL_TEXTURE0);
+
+	int SourceWidth = HiZWidth;
+	int SourceHeight = HiZHeight;
+	for (int Level = 0; Level < HiZLevels; ++Level)
+	{
+		const int DestinationWidth = std::max(1, HiZWidth >> Level);
+		const int DestinationHeight = std::max(1, HiZHeight >> Level);
+
+		// O nivel 0 e uma copia do depth; os outros reduzem o nivel anterior da propria piramide
+		glBindTexture(GL_TEXTURE_2D, Level == 0 ? DepthTexture : HiZTexture);
+		glUniform1i(glGetUniformLocation(HiZProgram, "SourceLevel"), Level - 1);
+		glUniform2i(glGetUniformLocation(HiZProgram, "SourceSize"), SourceWidth, SourceHeight);
+		glBindImageTexture(0, HiZTexture, Level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+		glDispatchCompute((DestinationWidth + HiZGroupSize - 1) / HiZGroupSize, (DestinationHeight + HiZGroupSize - 1) / HiZGroupSize, 1);
+		glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+
+		SourceWidth = DestinationWidth;
+		SourceHeight = DestinationHeight;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+
+	HiZViewProjection = ViewProjection;
+	HiZEye = Eye;
+	HasHiZ = true;
+}
+
+bool GpuCulling::IsOccludedOnCpu(const std::vector<std::vector<float>>& Pyramid, const glm::vec3& Center, float Radius, const glm::dvec3& Eye, bool& Ambiguous) const
+{
+	// Mesmos passos e a mesma aritmetica em float de IsOccluded em cull_comp.glsl
+	const glm::vec3 PreviousEyeOffset{Eye - HiZEye};
+	const glm::vec3 PreviousCenter = Center + PreviousEyeOffset;
+	if (glm::length(PreviousCenter) < Radius)
+	{
+		return false;
+	}
+
+	glm::vec2 MinUV{1.0f};
+	glm::vec2 MaxUV{0.0f};
+	float MinDepth = 1.0f;
+	for (int i = 0; i < 8; ++i)
+	{
+		const glm::vec3 Corner = PreviousCenter + Radius * glm::vec3{(i & 1) != 0 ? 1.0f : -1.0f, (i & 2) != 0 ? 1.0f : -1.0f, (i & 4) != 0 ? 1.0f : -1.0f};
+		const glm::vec4 Clip = HiZViewProjection * glm::vec4{Corner, 1.0f};
+		if (Clip.w <= 0.0f)
+		{
+			return false;
+		}
+
+		const glm::vec3 NDC = glm::vec3{Clip} / Clip.w;
+		MinUV = glm::min(MinUV, glm::vec2{NDC} * 0.5f + 0.5f);
+		MaxUV = glm::max(MaxUV, glm::vec2{NDC} * 0.5f + 0.5f);
+		MinDepth = std::min(MinDepth, NDC.z * 0.5f + 0.5f);
+	}
+
+	if (glm::any(glm::lessThan(MinUV, glm::vec2{0.0f})) || glm::any(glm::greaterThan(MaxUV, glm::vec2{1.0f})))
+	{
+		return false;
+	}
+
+	// Um retangulo encostado na borda pode sair dela por arredondamento
+	Ambiguous = glm::any(glm::lessThan(MinUV, glm::vec2{1e-5f})) || glm::any(glm::greaterThan(MaxUV, glm::vec2{1.0f - 1e-5f}));
+
+	const glm::vec2 SizeInPixels = (MaxUV - MinUV) * glm::vec2{float(HiZWidth), float(HiZHeight)};
+	const float LevelLog = std::log2(std::max(std::max(SizeInPixels.x, SizeInPixels.y), 1.0f));
+	const int Level = std::clamp(static_cast<int>(std::ceil(LevelLog)), 0, HiZLevels - 1);
+
+	// O nivel muda se o tamanho estiver quase numa potencia de dois
+	Ambiguous = Ambiguous || std::abs(LevelLog - std::round(LevelLog)) < 1e-3f;
+
+	// Amostragem GL_NEAREST_MIPMAP_NEAREST com GL_CLAMP_TO_EDGE
+	const int LevelWidth = std::max(1, HiZWidth >> Level);
+	const int LevelHeight = std::max(1, HiZHeight >> Level);
+	const std::vector<float>& Texels = Pyramid[Level];
+	auto Sample = [&](float U, float V)
+	{
+		const float X = U * LevelWidth;
+		const float Y = V * LevelHeight;
+		if (std::abs(X - std::round(X)) < 1e-3f || std::abs(Y - std::round(Y)) < 1e-3f)
+		{
+			Ambiguous = true;
+		}
+		const int TexelX = std::clamp(static_cast<int>(std::floor(X)), 0, LevelWidth - 1);
+		const int TexelY = std::clamp(static_cast<int>(std::floor(Y)), 0, LevelHeight - 1);
+		return Texels[std::size_t(TexelY) * LevelWidth + TexelX];
+	};
+
+	float MaxDepth = Sample(MinUV.x, MinUV.y);
+	MaxDepth = std::max(MaxDepth, Sample(MaxUV.x, MinUV.y));
+	MaxDepth = std::max(MaxDepth, Sample(MinUV.x, MaxUV.y));
+	MaxDepth = std::max(MaxDepth, Sample(MaxUV.x, MaxUV.y));
+
+	if (std::abs(MinDepth - MaxDepth) < 1e-5f)
+	{
+		Ambiguous = true;
+	}
+	return MinDepth > MaxDepth;
+}
+
+bool GpuCulling::ValidateAgainstCpu(const Frustum& ViewFrustum, const glm::dvec3& Eye, bool UseHiZ)
+{
+	const bool ApplyHiZ = UseHiZ && HasHiZ;
+	Cull(ViewFrustum, Eye, ApplyHiZ);
+
+	GLuint GpuCount = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, CountBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &GpuCount);
+
+	std::vector<GLuint> GpuVisible(GpuCount);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, VisibleIndexBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, GpuCount * sizeof(GLuint), GpuVisible.data());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	// A piramide inteira, nivel por nivel, para refazer o teste de oclusao
+	std::vector<std::vector<float>> Pyramid;
+	if (ApplyHiZ)
+	{
+		Pyramid.resize(HiZLevels);
+		glBindTexture(GL_TEXTURE_2D, HiZTexture);
+		glPixelStorei(GL_PACK_ALIGNMENT, 4);
+		for (int Level = 0; Level < HiZLevels; ++Level)
+		{
+			Pyramid[Level].resize(std::size_t(std::max(1, HiZWidth >> Level)) * std::max(1, HiZHeight >> Level));
+			glGetTexImage(GL_TEXTURE_2D, Level, GL_RED, GL_FLOAT, Pyramid[Level].data());
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+	}
+
+	// Referencia na CPU, com a mesma reconstrucao alto/baixo do centro relativo ao olho
+	glm::vec3 EyeHigh;
+	glm::vec3 EyeLow;
+	SplitDouble(Eye, EyeHigh, EyeLow);
+
+	std::vector<bool> CpuVisible(CandidateData.size());
+	std::vector<bool> Ambiguous(CandidateData.size());
+	int NumOccluded = 0;
+	for (std::size_t i = 0; i < CandidateData.size(); ++i)
+	{
+		const GpuCullCandidate& Candidate = CandidateData[i];
+		const glm::vec3 Center = (glm::vec3{Candidate.CenterHigh} - EyeHigh) + (glm::vec3{Candidate.CenterLow} - EyeLow);
+		const float Radius = Candidate.CenterHigh.w;
+		CpuVisible[i] = IsSphereInFrustum(ViewFrustum, Center, Radius);
+
+		// Esferas tangentes a um plano podem cair de qualquer lado por arredondamento
+		for (const glm::vec4& Plane : ViewFrustum.Planes)
+		{
+			const float Distance = glm::dot(glm::vec3{Plane}, Center) + Plane.w;
+			if (std::abs(Distance + Radius) < 1e-3f * std::max(1.0f, Radius))
+			{
+				Ambiguous[i] = true;
+			}
+		}
+
+		if (ApplyHiZ && CpuVisible[i])
+		{
+			bool OcclusionAmbiguous = false;
+			if (IsOccludedOnCpu(Pyramid, Center, Radius, Eye, OcclusionAmbiguous))
+			{
+				CpuVisible[i] = false;
+				++NumOccluded;
+			}
+			Ambiguous[i] = Ambiguous[i] || OcclusionAmbiguous;
+		}
+	}
+
+	std::vector<bool> GpuVisibleFlags(CandidateData.size());
+	int NumMismatches = 0;
+	for (GLuint Index : GpuVisible)
+	{
+		if (Index >= CandidateData.size() || GpuVisibleFlags[Index])
+		{
+			std::cerr << "Culling na GPU: indice invalido ou duplicado " << Index << std::endl;
+			++NumMismatches;
+			continue;
+		}
+		GpuVisibleFlags[Index] = true;
+	}
+
+	// Independente da copia do shader: um tile no frustum cuja caixa sai da tela do
+	// frame anterior nunca pode ser oculto pelo Hi-Z, senao aparece de repente quando
+	// a camera gira. Calculado em double
+	int NumEntering = 0;
+	if (ApplyHiZ)
+	{
+		const glm::dmat4 PreviousViewProjection{HiZViewProjection};
+		for (std::size_t i = 0; i < CandidateData.size(); ++i)
+		{
+			const GpuCullCandidate& Candidate = CandidateData[i];
+			const glm::dvec3 Center = glm::dvec3{Candidate.CenterHigh} + glm::dvec3{Candidate.CenterLow} - HiZEye;
+			const double Radius = Candidate.CenterHigh.w;
+			bool Inside = true;
+			for (int Corner = 0; Corner < 8 && Inside; ++Corner)
+			{
+				const glm::dvec3 Offset{(Corner & 1) != 0 ? 1.0 : -1.0, (Corner & 2) != 0 ? 1.0 : -1.0, (Corner & 4) != 0 ? 1.0 : -1.0};
+				const glm::dvec4 Clip = PreviousViewProjection * glm::dvec4{Center + Radius * Offset, 1.0};
+				Inside = Clip.w > 0.0 && std::abs(Clip.x) < Clip.w * (1.0 + 1e-4) && std::abs(Clip.y) < Clip.w * (1.0 + 1e-4);
+			}
+			const bool InFrustum = IsSphereInFrustum(ViewFrustum, (glm::vec3{Candidate.CenterHigh} - EyeHigh) + (glm::vec3{Candidate.CenterLow} - EyeLow), Candidate.CenterHigh.w);
+			if (!Inside && InFrustum && !Ambiguous[i])
+			{
+				++NumEntering;
+				if (!GpuVisibleFlags[i])
+				{
+					std::cerr << "Culling na GPU: candidato " << i << " fora da tela anterior foi oculto pelo Hi-Z" << std::endl;
+					++NumMismatches;
+				}
+			}
+		}
+	}
+
+	int NumCpuVisible = 0;
+	for (std::size_t i = 0; i < CandidateData.size(); ++i)
+	{
+		NumCpuVisible += CpuVisible[i] ? 1 : 0;
+		if (CpuVisible[i] != GpuVisibleFlags[i] && !Ambiguous[i])
+		{
+			std::cerr << "Culling na GPU diverge da CPU no candidato " << i
+				<< " (CPU: " << CpuVisible[i] << ", GPU: " << GpuVisibleFlags[i] << ")" << std::endl;
+			++NumMismatches;
+		}
+	}
+
+	std::cout << "Validacao do culling na GPU" << (ApplyHiZ ? " (frustum + Hi-Z): " : " (frustum): ") << GpuCount << " visiveis na GPU, "
+		<< NumCpuVisible << " na CPU";
+	if (ApplyHiZ)
+	{
+		std::cout << ", " << NumOccluded << " ocultos pelo Hi-Z, " << NumEntering << " fora da tela anterior";
+	}
+	std::cout << ", " << NumMismatches << " divergencia(s)" << std::endl;
+	return NumMismatches == 0;
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "Culling.h"
+
+// Um candidato ao culling na GPU (layout std430 de cull_comp.glsl). O centro fica
+// dividido em alto/baixo (SplitDouble) para o shader calcular a posicao relativa
+// ao olho sem precisar de double
+struct GpuCullCandidate
+{
+	glm::vec4 CenterHigh;   // xyz: centro, w: raio da esfera envolvente
+	glm::vec4 CenterLow;    // xyz: parte baixa do centro, w: nivel do tile
+	GLuint Count;
+	GLuint FirstIndex;
+	GLint BaseVertex;
+	GLuint Padding;
+};
+
+// Culling na GPU com compute shaders. Cada candidato e testado contra o frustum e
+// contra a piramide Hi-Z do depth do frame anterior; os sobreviventes sao
+// compactados com atomicos em um buffer de comandos indiretos e em um buffer de
+// dados por draw, prontos para TileBatchRenderer::SubmitIndirect
+class GpuCulling
+{
+public:
+	// Exige compute shaders, SSBO e image load/store (OpenGL 4.3)
+	static bool IsSupported();
+
+	void Init(GLuint CullProgramId, GLuint HiZProgramId, int Width, int Height);
+	void Destroy();
+
+	void SetCandidates(const std::vector<GpuCullCandidate>& Candidates);
+
+	// Troca os programas depois de recarregar os shaders
+	void SetPrograms(GLuint CullProgramId, GLuint HiZProgramId)
+	{
+		CullProgram = CullProgramId;
+		HiZProgram = HiZProgramId;
+	}
+
+	// Dispara o compute shader de culling. UseHiZ so tem efeito se ja existir uma
+	// piramide de um frame anterior
+	void Cull(const Frustum& ViewFrustum, const glm::dvec3& Eye, bool UseHiZ);
+
+	// Chamar depois de desenhar o frame: copia o depth buffer e monta a piramide
+	// Hi-Z que sera usada no culling do proximo frame
+	void BuildHiZ(const glm::mat4& ViewProjection, const glm::dvec3& Eye);
+
+	// Monta a piramide a partir de um depth calculado sem desenhar (Width x Height
+	// valores de 0 a 1, linha 0 embaixo), como se o frame tivesse sido desenhado com
+	// ViewProjection a partir de Eye
+	void BuildHiZFromDepth(const std::vector<float>& Depth, const glm::mat4& ViewProjection, const glm::dvec3& Eye);
+
+	// Roda o culling, le o resultado de volta e compara com o mesmo teste feito na
+	// CPU. Com UseHiZ a piramide tambem e lida de volta e o teste de oclusao e refeito
+	// sobre ela. Pensado para rodar no llvmpipe sem janela visivel
+	bool ValidateAgainstCpu(const Frustum& ViewFrustum, const glm::dvec3& Eye, bool UseHiZ);
+
+	GLuint GetCommandBuffer() const { return CommandBuffer; }
+	GLuint GetDrawDataBuffer() const { return DrawDataBuffer; }
+	GLuint GetCountBuffer() const { return CountBuffer; }
+	GLsizei GetMaxDraws() const { return static_cast<GLsizei>(CandidateData.size()); }
+
+private:
+	void BuildPyramid(const glm::mat4& ViewProjection, const glm::dvec3& Eye);
+
+	// Teste de oclusao de cull_comp.glsl sobre a piramide lida de volta. Ambiguous
+	// marca os casos em que arredondamentos diferentes podem mudar o resultado
+	bool IsOccludedOnCpu(const std::vector<std::vector<float>>& Pyramid, const glm::vec3& Center, float Radius, const glm::dvec3& Eye, bool& Ambiguous) const;
+
+	GLuint CullProgram = 0;
+	GLuint HiZProgram = 0;
+
+	GLuint CandidateBuffer = 0;
+	GLuint CommandBuffer = 0;
+	GLuint DrawDataBuffer = 0;
+	GLuint CountBuffer = 0;
+	GLuint VisibleIndexBuffer = 0;
+
+	GLuint DepthTexture = 0;
+	GLuint HiZTexture = 0;
+	int HiZWidth = 0;
+	int HiZHeight = 0;
+	int HiZLevels = 0;
+	bool HasHiZ = false;
+
+	glm::mat4 HiZViewProjection{1.0f};
+	glm::dvec3 HiZEye{0.0};
+
+	std::vector<GpuCullCandidate> CandidateData;
+};
@@ -0,0 +1,182 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "JobSystem.h"
+#include "AsyncIO.h"
+
+// Arquivos do tamanho de um tile de imagem comprimido
+const int NumFiles = 2000;
+const std::size_t FileSizes[] = {16 * 1024, 256 * 1024};
+
+// Pedidos em voo ao mesmo tempo: cada rodada envia todos e espera o Flush
+const int QueueDepths[] = {1, 8, 64, 256};
+
+struct RunResult
+{
+	double Seconds = 0.0;
+	double P50 = 0.0;
+	double P99 = 0.0;
+	std::uint64_t Bytes = 0;
+	int NumFailed = 0;
+};
+
+void PrintHeader(const std::string& Title)
+{
+	std::cout << std::endl;
+	std::cout << "==================" << std::endl;
+	std::cout << Title << std::endl;
+	std::cout << "==================" << std::endl;
+}
+
+std::vector<std::string> CreateFiles(const std::filesystem::path& Directory, std::size_t FileSize)
+{
+	std::filesystem::create_directories(Directory);
+	std::vector<char> Contents(FileSize, 'x');
+
+	std::vector<std::string> Paths;
+	for (int FileIndex = 0; FileIndex < NumFiles; ++FileIndex)
+	{
+		const std::filesystem::path FilePath = Directory / ("tile_" + std::to_string(FileIndex) + ".bin");
+		std::ofstream File{FilePath, std::ios::binary};
+		File.write(Contents.data(), Contents.size());
+		Paths.push_back(FilePath.string());
+	}
+	return Paths;
+}
+
+// Mantem ate QueueDepth leituras em voo, completando a fila a cada lote entregue
+RunResult ReadAll(const std::vector<std::string>& Paths, int QueueDepth)
+{
+	std::mutex LatencyMutex;
+	std::vector<double> Latencies;
+	std::atomic<std::uint64_t> Bytes{0};
+	std::atomic<int> NumFailed{0};
+	std::atomic<int> NumDone{0};
+
+	const auto Start = std::chrono::steady_clock::now();
+	std::size_t NextFile = 0;
+	int NumIssued = 0;
+	while (NumDone < NumFiles)
+	{
+		while (NextFile < Paths.size() && NumIssued - NumDone < QueueDepth)
+		{
+			const IOPriority Priority = NextFile % 4 == 0 ? IOPriority::High : IOPriority::Normal;
+			AsyncIO::Get().Read(Paths[NextFile++], Priority, [&](IOResult& Result)
+			{
+				Bytes += Result.Data.size();
+				NumFailed += Result.Error != 0 ? 1 : 0;
+				{
+					std::lock_guard<std::mutex> Lock{LatencyMutex};
+					Latencies.push_back(Result.LatencySeconds);
+				}
+				NumDone++;
+			});
+			++NumIssued;
+		}
+
+		AsyncIO::Get().DispatchCompletions();
+		std::this_thread::yield();
+	}
+	AsyncIO::Get().Flush();
+	const auto End = std::chrono::steady_clock::now();
+
+	std::sort(Latencies.begin(), Latencies.end());
+
+	RunResult Result;
+	Result.Seconds = std::chrono::duration<double>(End - Start).count();
+	Result.P50 = Latencies[Latencies.size() / 2];
+	Result.P99 = Latencies[Latencies.size() * 99 / 100];
+	Result.Bytes = Bytes;
+	Result.NumFailed = NumFailed;
+	return Result;
+}
+
+void Throughput(const std::vector<std::string>& Paths, std::size_t FileSize)
+{
+	PrintHeader("Leituras de " + std::to_string(FileSize / 1024) + " KB");
+	std::cout << std::setw(12) << "backend" << std::setw(8) << "fila" << std::setw(12) << "IOPS"
+		<< std::setw(10) << "MB/s" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << std::endl;
+
+	for (bool ForceThreadPool : {false, true})
+	{
+		for (int QueueDepth : QueueDepths)
+		{
+			AsyncIO::Get().Init(std::max(QueueDepth, 1), 4, ForceThreadPool);
+			const char* BackendName = AsyncIO::Get().GetBackend() == AsyncIO::Backend::IoUring ? "io_uring" : "pread";
+			if (!ForceThreadPool && AsyncIO::Get().GetBackend() != AsyncIO::Backend::IoUring)
+			{
+				AsyncIO::Get().Shutdown();
+				std::cout << std::setw(12) << "io_uring" << "  indisponivel" << std::endl;
+				break;
+			}
+
+			const RunResult Result = ReadAll(Paths, QueueDepth);
+			AsyncIO::Get().Shutdown();
+
+			std::cout << std::setw(12) << BackendName << std::setw(8) << QueueDepth
+				<< std::setw(12) << std::setprecision(0) << std::fixed << NumFiles / Result.Seconds
+				<< std::setw(10) << std::setprecision(1) << Result.Bytes / Result.Seconds / (1024.0 * 1024.0)
+				<< std::setw(12) << std::setprecision(1) << Result.P50 * 1e6
+				<< std::setw(12) << Result.P99 * 1e6
+				<< (Result.NumFailed > 0 ? "  (falhas)" : "") << std::endl;
+		}
+	}
+}
+
+void Cancellation(const std::vector<std::string>& Paths)
+{
+	PrintHeader("Cancelamento");
+
+	AsyncIO::Get().Init(64, 4);
+
+	// Envia tudo e cancela metade logo em seguida, como tiles que sairam da tela
+	std::vector<IORequestId> Ids;
+	for (const std::string& Path : Paths)
+	{
+		Ids.push_back(AsyncIO::Get().Read(Path, IOPriority::Low, nullptr));
+	}
+	int NumCancelRequests = 0;
+	for (std::size_t RequestIndex = 0; RequestIndex < Ids.size(); RequestIndex += 2)
+	{
+		NumCancelRequests += AsyncIO::Get().Cancel(Ids[RequestIndex]) ? 1 : 0;
+	}
+	AsyncIO::Get().Flush();
+
+	const AsyncIO::Stats Stats = AsyncIO::Get().GetStats();
+	AsyncIO::Get().Shutdown();
+
+	std::cout << "Pedidos: " << Ids.size() << " | cancelamentos aceitos: " << NumCancelRequests
+		<< " | cancelados: " << Stats.Cancelled << " | lidos: " << Stats.Completed << std::endl;
+}
+
+int main()
+{
+	JobSystem::Get().Init();
+
+	// Os arquivos acabaram de ser escritos, entao a leitura vem do cache de paginas:
+	// mede o custo do caminho de submissao e entrega, nao do disco
+	const std::filesystem::path Directory = std::filesystem::temp_directory_path() / "bluemarble_io_benchmark";
+	for (std::size_t FileSize : FileSizes)
+	{
+		const std::vector<std::string> Paths = CreateFiles(Directory, FileSize);
+		Throughput(Paths, FileSize);
+		if (FileSize == FileSizes[0])
+		{
+			Cancellation(Paths);
+		}
+	}
+	std::filesystem::remove_all(Directory);
+
+	JobSystem::Get().Shutdown();
+
+	return 0;
+}
@@ -0,0 +1,416 @@
+#include "ImagerySequence.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+#include <utility>
+
+#include "FileReader.h"
+
+namespace
+{
+	// Sempre cabem a imagem atual, a seguinte e uma chegando
+	constexpr int MinLayers = 3;
+
+	// Folga sobre o tempo medido ate uma imagem ficar pronta, e o peso de cada
+	// medida nova nas medias moveis
+	constexpr double PrefetchSafety = 1.5;
+	constexpr double AverageWeight = 0.25;
+
+	std::string_view Trim(std::string_view Text)
+	{
+		const std::size_t Begin = Text.find_first_not_of(" \t\r");
+		if (Begin == std::string_view::npos)
+		{
+			return {};
+		}
+		return Text.substr(Begin, Text.find_last_not_of(" \t\r") - Begin + 1);
+	}
+}
+
+std::vector<std::string> ImagerySequence::ReadSequenceFile(const std::string& ListFile)
+{
+	std::vector<std::string> Result;
+	const FileContents Contents = ReadWholeFile(ListFile);
+	if (!Contents.IsValid())
+	{
+		std::cerr << "Falha ao ler a lista de imagens: " << ListFile << std::endl;
+		return Result;
+	}
+
+	// Caminhos relativos partem da pasta da lista
+	const std::filesystem::path ListDirectory = std::filesystem::path{ListFile}.parent_path();
+	std::string_view Text = Contents.View();
+	while (!Text.empty())
+	{
+		const std::size_t LineEnd = Text.find('\n');
+		const std::string_view Line = Trim(Text.substr(0, LineEnd));
+		Text = LineEnd == std::string_view::npos ? std::string_view{} : Text.substr(LineEnd + 1);
+		if (Line.empty() || Line[0] == '#')
+		{
+			continue;
+		}
+
+		const std::filesystem::path Image{std::string{Line}};
+		Result.push_back((Image.is_relative() ? ListDirectory / Image : Image).string());
+	}
+	return Result;
+}
+
+bool ImagerySequence::Init(const std::vector<std::string>& NewFiles, const ImagerySettings& NewSettings)
+{
+	Files = NewFiles;
+	Settings = NewSettings;
+	if (Files.empty() || Settings.FrameSeconds <= 0.0)
+	{
+		return false;
+	}
+
+	// A transicao cabe dentro do tempo da imagem; com 0 a troca e seca
+	if (Settings.FadeSeconds < 0.0 || Settings.FadeSeconds > Settings.FrameSeconds)
+	{
+		Settings.FadeSeconds = std::clamp(Settings.FadeSeconds, 0.0, Settings.FrameSeconds);
+		std::cerr << "Transicao da sequencia de imagens limitada a " << Settings.FadeSeconds << " s" << std::endl;
+	}
+
+	// A primeira imagem define o tamanho das camadas e aparece desde o primeiro frame
+	const FileContents FirstFile = ReadWholeFile(Files[0]);
+	std::shared_ptr<TextureManager::DecodedImage> First = std::make_shared<TextureManager::DecodedImage>();
+	if (!FirstFile.IsValid() || !TextureManager::Decode(FirstFile.Data(), FirstFile.Size(), *First))
+	{
+		std::cerr << "Falha ao carregar a primeira imagem da sequencia: " << Files[0] << std::endl;
+		return false;
+	}
+	Width = First->Width;
+	Height = First->Height;
+	NumLevels = CountMipLevels(Width, Height);
+
+	const int NumLayers = std::clamp(static_cast<int>(Settings.BudgetBytes / ComputeTextureBytes(Width, Height)), MinLayers, std::max(Settings.MaxLayers, MinLayers));
+	glGenTextures(1, &ArrayTexture);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, ArrayTexture);
+	glTexStorage3D(GL_TEXTURE_2D_ARRAY, NumLevels, GL_RGB8, Width, Height, NumLayers);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	// glGenerateMipmap na textura array refaria todas as camadas; pela view so a nova
+	LayerViews.resize(NumLayers);
+	glGenTextures(NumLayers, LayerViews.data());
+	for (int Layer = 0; Layer < NumLayers; ++Layer)
+	{
+		glTextureView(LayerViews[Layer], GL_TEXTURE_2D, ArrayTexture, GL_RGB8, 0, NumLevels, Layer, 1);
+	}
+
+	Slots.assign(NumLayers, Slot{});
+	Queue.clear();
+	PendingUploads.clear();
+	Position = 0;
+	Time = 0.0;
+	AverageFrameSeconds = 0.0;
+	PrefetchDepth = NumLayers - 1;
+	CurrentStats = Stats{};
+	CurrentStats.NumFrames = static_cast<int>(Files.size());
+	CurrentStats.NumLayers = NumLayers;
+
+	UploadStrips({StripUpload{0, 0, Height, First, -1, true}});
+	Slots[0].State = SlotState::Ready;
+	Slots[0].Position = 0;
+	Queue.push_back(0);
+	return true;
+}
+
+void ImagerySequence::Destroy()
+{
+	for (const Slot& Each : Slots)
+	{
+		if (Each.State == SlotState::Loading)
+		{
+			AsyncIO::Get().Cancel(Each.Request);
+		}
+	}
+
+	// Os callbacks das leituras usam this
+	AsyncIO::Get().Flush();
+	DecodedFrames.clear();
+	PendingUploads.clear();
+	Slots.clear();
+	Queue.clear();
+
+	glDeleteTextures(static_cast<GLsizei>(LayerViews.size()), LayerViews.data());
+	LayerViews.clear();
+	glDeleteTextures(1, &ArrayTexture);
+	ArrayTexture = 0;
+}
+
+void ImagerySequence::Update(double DeltaTime)
+{
+	if (!IsValid())
+	{
+		return;
+	}
+
+	AverageFrameSeconds = AverageFrameSeconds > 0.0 ? AverageFrameSeconds + (DeltaTime - AverageFrameSeconds) * AverageWeight : DeltaTime;
+	CollectDecodedFrames();
+	ScheduleUploads();
+
+	// A transicao so comeca com a proxima imagem inteira a caminho da GPU; ate la a
+	// atual fica parada no inicio da transicao
+	const std::int64_t NumFrames = static_cast<std::int64_t>(Files.size());
+	const double FadeStart = Settings.FrameSeconds - Settings.FadeSeconds;
+	const bool HasNext = Settings.Loop || Position + 1 < NumFrames;
+	const bool NextReady = Queue.size() > 1 && Slots[Queue[1]].State == SlotState::Ready;
+	double NextTime = Time + DeltaTime;
+	if (NextTime > FadeStart && !NextReady)
+	{
+		NextTime = std::max(Time, FadeStart);
+		if (HasNext)
+		{
+			++CurrentStats.NumStalledFrames;
+		}
+	}
+	Time = NextTime;
+
+	// So passa para a seguinte quando ela ja esta toda enviada; a ultima imagem de
+	// uma sequencia sem repeticao nunca sai da fila. Sem transicao a espera acima
+	// deixa Time chegar a FrameSeconds, entao a condicao nao basta sozinha
+	if (Time >= Settings.FrameSeconds && NextReady)
+	{
+		Slots[Queue.front()] = Slot{};
+		Queue.pop_front();
+		++Position;
+		Time = std::min(Time - Settings.FrameSeconds, FadeStart);
+	}
+
+	// Pedir as imagens que faltam para a profundidade atual, em ordem de posicao
+	UpdatePrefetchDepth(DeltaTime);
+	while (static_cast<int>(Queue.size()) < 1 + PrefetchDepth)
+	{
+		const std::int64_t NewPosition = Position + static_cast<std::int64_t>(Queue.size());
+		if (!Settings.Loop && NewPosition >= NumFrames)
+		{
+			break;
+		}
+		const auto FreeSlot = std::find_if(Slots.begin(), Slots.end(), [](const Slot& Each) { return Each.State == SlotState::Free; });
+		if (FreeSlot == Slots.end())
+		{
+			break;
+		}
+		const int SlotIndex = static_cast<int>(FreeSlot - Slots.begin());
+		RequestFrame(SlotIndex, NewPosition);
+		Queue.push_back(SlotIndex);
+	}
+}
+
+std::vector<ImagerySequence::StripUpload> ImagerySequence::TakeStripUploads()
+{
+	std::vector<StripUpload> Uploads;
+	Uploads.swap(PendingUploads);
+	return Uploads;
+}
+
+ImageryDrawState ImagerySequence::GetDrawState() const
+{
+	ImageryDrawState State;
+	if (Queue.empty())
+	{
+		return State;
+	}
+
+	State.CurrentLayer = Queue.front();
+	State.NextLayer = Queue.size() > 1 ? Queue[1] : Queue.front();
+	const double FadeStart = Settings.FrameSeconds - Settings.FadeSeconds;
+	if (Settings.FadeSeconds > 0.0 && Time > FadeStart)
+	{
+		const double T = std::min((Time - FadeStart) / Settings.FadeSeconds, 1.0);
+		State.Blend = static_cast<float>(T * T * (3.0 - 2.0 * T));
+	}
+	return State;
+}
+
+void ImagerySequence::UploadStrips(const std::vector<StripUpload>& Uploads)
+{
+	if (Uploads.empty())
+	{
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, ArrayTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (const StripUpload& Upload : Uploads)
+	{
+		if (Upload.SourceLayer >= 0)
+		{
+			for (int Level = 0; Level < NumLevels; ++Level)
+			{
+				glCopyImageSubData(ArrayTexture, GL_TEXTURE_2D_ARRAY, Level, 0, 0, Upload.SourceLayer,
+					ArrayTexture, GL_TEXTURE_2D_ARRAY, Level, 0, 0, Upload.Layer,
+					std::max(Width >> Level, 1), std::max(Height >> Level, 1), 1);
+			}
+			continue;
+		}
+
+		const unsigned char* Rows = Upload.Image->Pixels.data() + std::size_t(Upload.Y) * Width * 3;
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, Upload.Y, Upload.Layer, Width, Upload.Height, 1, GL_RGB, GL_UNSIGNED_BYTE, Rows);
+		if (Upload.CompletesLayer)
+		{
+			glBindTexture(GL_TEXTURE_2D, LayerViews[Upload.Layer]);
+			glGenerateMipmap(GL_TEXTURE_2D);
+			glBindTexture(GL_TEXTURE_2D, 0);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void ImagerySequence::Bind(GLuint ProgramId, const ImageryDrawState& State) const
+{
+	glActiveTexture(GL_TEXTURE0 + ImageryTextureUnit);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, ArrayTexture);
+	glActiveTexture(GL_TEXTURE0);
+
+	glUniform1i(glGetUniformLocation(ProgramId, "ImagerySampler"), ImageryTextureUnit);
+	glUniform3f(glGetUniformLocation(ProgramId, "ImageryLayers"), float(State.CurrentLayer), float(State.NextLayer), State.Blend);
+}
+
+ImagerySequence::Stats ImagerySequence::GetStats() const
+{
+	Stats Result = CurrentStats;
+	Result.PrefetchDepth = PrefetchDepth;
+	return Result;
+}
+
+void ImagerySequence::RequestFrame(int SlotIndex, std::int64_t FramePosition)
+{
+	Slot& Target = Slots[SlotIndex];
+	Target.State = SlotState::Loading;
+	Target.Position = FramePosition;
+	Target.Image.reset();
+	Target.UploadedRows = 0;
+
+	// A seguinte e mais urgente que as adiantadas
+	const IOPriority Priority = FramePosition == Position + 1 ? IOPriority::Normal : IOPriority::Low;
+	const std::string& File = Files[static_cast<std::size_t>(FramePosition % static_cast<std::int64_t>(Files.size()))];
+	const auto RequestTime = std::chrono::steady_clock::now();
+	Target.Request = AsyncIO::Get().Read(File, Priority, [this, SlotIndex, FramePosition, RequestTime](IOResult& Result)
+	{
+		// Roda como job: a decodificacao fica fora da thread principal
+		DecodedFrame Frame;
+		Frame.SlotIndex = SlotIndex;
+		Frame.Position = FramePosition;
+		if (!Result.Cancelled)
+		{
+			std::shared_ptr<TextureManager::DecodedImage> Image = std::make_shared<TextureManager::DecodedImage>();
+			if (Result.Error != 0)
+			{
+				std::cerr << "Falha ao ler a imagem da sequencia: " << Result.Path << std::endl;
+			}
+			else if (TextureManager::Decode(Result.Data.data(), Result.Data.size(), *Image))
+			{
+				if (Image->Width == Width && Image->Height == Height)
+				{
+					Frame.Image = std::move(Image);
+				}
+				else
+				{
+					std::cerr << Result.Path << ": " << Image->Width << "x" << Image->Height << " difere da primeira imagem da sequencia" << std::endl;
+				}
+			}
+		}
+		Frame.Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - RequestTime).count();
+
+		std::lock_guard<std::mutex> Lock{DecodedMutex};
+		DecodedFrames.push_back(std::move(Frame));
+	});
+}
+
+void ImagerySequence::CollectDecodedFrames()
+{
+	std::vector<DecodedFrame> Frames;
+	{
+		std::lock_guard<std::mutex> Lock{DecodedMutex};
+		Frames.swap(DecodedFrames);
+	}
+
+	for (DecodedFrame& Frame : Frames)
+	{
+		Slot& Target = Slots[Frame.SlotIndex];
+		if (Target.State != SlotState::Loading || Target.Position != Frame.Position)
+		{
+			continue;
+		}
+		Target.State = SlotState::Decoded;
+		Target.Image = std::move(Frame.Image);
+		if (!Target.Image)
+		{
+			++CurrentStats.NumFailed;
+			continue;
+		}
+
+		const double Milliseconds = Frame.Seconds * 1000.0;
+		CurrentStats.DecodeMilliseconds = CurrentStats.NumDecoded > 0 ?
+			CurrentStats.DecodeMilliseconds + (Milliseconds - CurrentStats.DecodeMilliseconds) * AverageWeight : Milliseconds;
+		CurrentStats.MaxDecodeMilliseconds = std::max(CurrentStats.MaxDecodeMilliseconds, Milliseconds);
+		++CurrentStats.NumDecoded;
+	}
+}
+
+void ImagerySequence::ScheduleUploads()
+{
+	// As camadas sao enviadas em ordem de posicao, ate gastar os bytes do frame
+	const std::size_t RowBytes = std::size_t(Width) * 3;
+	std::size_t Budget = Settings.UploadBytesPerFrame;
+	for (std::size_t QueueIndex = 1; QueueIndex < Queue.size() && Budget > 0; ++QueueIndex)
+	{
+		Slot& Target = Slots[Queue[QueueIndex]];
+		if (Target.State == SlotState::Ready)
+		{
+			continue;
+		}
+		if (Target.State != SlotState::Decoded)
+		{
+			break;
+		}
+
+		if (!Target.Image)
+		{
+			// A imagem falhou: a camada recebe a anterior e a reproducao segue sem ela
+			PendingUploads.push_back(StripUpload{Queue[QueueIndex], 0, 0, nullptr, Queue[QueueIndex - 1], false});
+			Target.State = SlotState::Ready;
+			continue;
+		}
+
+		while (Target.UploadedRows < Height && Budget > 0)
+		{
+			const int NumRows = std::min(Height - Target.UploadedRows, std::max(1, static_cast<int>(Budget / RowBytes)));
+			Budget -= std::min(Budget, NumRows * RowBytes);
+			PendingUploads.push_back(StripUpload{Queue[QueueIndex], Target.UploadedRows, NumRows, Target.Image, -1, Target.UploadedRows + NumRows == Height});
+			Target.UploadedRows += NumRows;
+		}
+		if (Target.UploadedRows == Height)
+		{
+			// Os envios pendentes guardam a imagem ate serem executados
+			Target.State = SlotState::Ready;
+			Target.Image.reset();
+		}
+	}
+}
+
+void ImagerySequence::UpdatePrefetchDepth(double DeltaTime)
+{
+	if (CurrentStats.NumDecoded == 0 || DeltaTime <= 0.0)
+	{
+		// Ate a primeira medida, tudo o que cabe no anel
+		return;
+	}
+
+	// Tempo entre pedir uma imagem e ela poder aparecer: leitura e decodificacao mais
+	// os frames de envio. A imagem pedida agora na profundidade D e necessaria no
+	// inicio da transicao D - 1 imagens a frente
+	const double UploadFrames = std::ceil(double(Height) * Width * 3 / double(Settings.UploadBytesPerFrame));
+	const double LeadSeconds = (CurrentStats.DecodeMilliseconds * 1e-3 + UploadFrames * AverageFrameSeconds) * PrefetchSafety;
+	const int NeededDepth = static_cast<int>(std::ceil((LeadSeconds + Settings.FadeSeconds) / Settings.FrameSeconds));
+	PrefetchDepth = std::clamp(NeededDepth, 1, static_cast<int>(Slots.size()) - 1);
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "AsyncIO.h"
+#include "TextureManager.h"
+
+// Unidade de textura da sequencia de imagens, depois dos campos de nuvens
+constexpr GLuint ImageryTextureUnit = 7;
+
+struct ImagerySettings
+{
+	// Tempo de cada imagem na tela, incluindo a transicao para a seguinte no fim
+	double FrameSeconds = 2.0;
+	double FadeSeconds = 0.75;
+	bool Loop = true;
+
+	// Memoria de video do anel de camadas. Define quantas imagens cabem adiantadas,
+	// com no minimo tres (atual, seguinte e uma chegando)
+	std::size_t BudgetBytes = std::size_t{512} * 1024 * 1024;
+	int MaxLayers = 8;
+
+	// Bytes enviados por frame, em faixas de linhas, para que a chegada de uma
+	// imagem 8k nao pare um frame inteiro
+	std::size_t UploadBytesPerFrame = std::size_t{8} * 1024 * 1024;
+};
+
+// Camadas entre as quais o shader do globo interpola neste frame
+struct ImageryDrawState
+{
+	int CurrentLayer = 0;
+	int NextLayer = 0;
+	float Blend = 0.0f;
+};
+
+// Reproducao de uma sequencia de imagens do globo (por exemplo os 12 meses do Blue
+// Marble) em uma textura array usada como anel. As proximas imagens sao lidas pelo
+// AsyncIO e decodificadas nas threads de trabalho; quantas ficam adiantadas se
+// ajusta pelo tempo medido de leitura e decodificacao. Cada imagem decodificada vai
+// para a sua camada em faixas de linhas ao longo de alguns frames, e os mipmaps sao
+// gerados pela GPU por uma view da camada. Se a proxima imagem nao chegar a tempo a
+// atual continua na tela. Update, TakeStripUploads e GetDrawState rodam na thread
+// principal; UploadStrips e Bind na thread dona do contexto
+class ImagerySequence
+{
+public:
+	struct StripUpload
+	{
+		int Layer = 0;
+		int Y = 0;
+		int Height = 0;
+		std::shared_ptr<const TextureManager::DecodedImage> Image;
+		int SourceLayer = -1;       // Imagem que falhou: copia esta camada inteira
+		bool CompletesLayer = false;
+	};
+
+	struct Stats
+	{
+		int NumFrames = 0;
+		int NumLayers = 0;
+		int PrefetchDepth = 0;
+		int NumDecoded = 0;
+		int NumFailed = 0;
+		double DecodeMilliseconds = 0.0;    // Media movel, do pedido de leitura ao fim da decodificacao
+		double MaxDecodeMilliseconds = 0.0;
+		int NumStalledFrames = 0;           // Frames em que a proxima imagem ainda nao estava pronta
+	};
+
+	// Uma imagem por linha; linhas vazias e comecadas por # sao ignoradas
+	static std::vector<std::string> ReadSequenceFile(const std::string& ListFile);
+
+	// Le e envia a primeira imagem na hora; as outras precisam ter o mesmo tamanho.
+	// Precisa do contexto OpenGL
+	bool Init(const std::vector<std::string>& NewFiles, const ImagerySettings& NewSettings);
+
+	// Cancela as leituras e espera as decodificacoes em andamento
+	void Destroy();
+
+	// Avanca o relogio, recolhe as imagens decodificadas, pede as proximas e divide
+	// os envios do frame
+	void Update(double DeltaTime);
+
+	std::vector<StripUpload> TakeStripUploads();
+	ImageryDrawState GetDrawState() const;
+
+	void UploadStrips(const std::vector<StripUpload>& Uploads);
+	void Bind(GLuint ProgramId, const ImageryDrawState& State) const;
+
+	bool IsValid() const { return ArrayTexture != 0; }
+	Stats GetStats() const;
+
+private:
+	enum class SlotState
+	{
+		Free,
+		Loading,        // Lendo ou decodificando
+		Decoded,        // Esperando a vez de ser enviada
+		Ready,          // Todas as faixas ja estao no buffer de comandos
+	};
+
+	struct Slot
+	{
+		SlotState State = SlotState::Free;
+		std::int64_t Position = -1;     // Posicao na reproducao; a imagem e Position % NumFrames
+		std::shared_ptr<const TextureManager::DecodedImage> Image;  // Vazio se a imagem falhou
+		int UploadedRows = 0;
+		IORequestId Request = 0;
+	};
+
+	struct DecodedFrame
+	{
+		int SlotIndex = 0;
+		std::int64_t Position = 0;
+		std::shared_ptr<const TextureManager::DecodedImage> Image;
+		double Seconds = 0.0;
+	};
+
+	void RequestFrame(int SlotIndex, std::int64_t Position);
+	void CollectDecodedFrames();
+	void ScheduleUploads();
+	void UpdatePrefetchDepth(double DeltaTime);
+
+	std::vector<std::string> Files;
+	ImagerySettings Settings;
+	int Width = 0;
+	int Height = 0;
+	int NumLevels = 0;
+	GLuint ArrayTexture = 0;
+	std::vector<GLuint> LayerViews;     // Uma view 2D por camada, para gerar os mipmaps so dela
+
+	// Estado da thread principal. Queue guarda as camadas em ordem de posicao: a
+	// atual, a seguinte e as adiantadas
+	std::vector<Slot> Slots;
+	std::deque<int> Queue;
+	std::int64_t Position = 0;
+	double Time = 0.0;                  // Dentro da imagem atual
+	int PrefetchDepth = 1;
+	double AverageFrameSeconds = 0.0;   // Do programa, para estimar quanto o envio leva
+	std::vector<StripUpload> PendingUploads;
+
+	// Imagens decodificadas pelos jobs
+	mutable std::mutex DecodedMutex;
+	std::vector<DecodedFrame> DecodedFrames;
+
+	Stats CurrentStats;
+};
@@ -0,0 +1,144 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include "JobSystem.h"
+#include "GlobeTiles.h"
+#include "Culling.h"
+
+// Quantidades de threads testadas. Acima do numero de nucleos da maquina os
+// resultados mostram o custo de sobrescrever a CPU, nao escalabilidade
+const int ThreadCounts[] = {1, 2, 4, 8, 16, 32, 64};
+
+const int NumEmptyJobs = 200000;
+const int NumRepetitions = 5;
+
+const glm::dvec3 EllipsoidRadii{6378137.0, 6378137.0, 6356752.314245};
+
+// Menor tempo entre algumas repeticoes, em segundos
+double Measure(const std::function<void()>& Work)
+{
+	double Best = 1e30;
+	for (int Repetition = 0; Repetition < NumRepetitions; ++Repetition)
+	{
+		const auto Start = std::chrono::steady_clock::now();
+		Work();
+		const auto End = std::chrono::steady_clock::now();
+		Best = std::min(Best, std::chrono::duration<double>(End - Start).count());
+	}
+	return Best;
+}
+
+void PrintHeader(const char* Title)
+{
+	std::cout << std::endl;
+	std::cout << "==================" << std::endl;
+	std::cout << Title << std::endl;
+	std::cout << "==================" << std::endl;
+}
+
+void SchedulingOverhead()
+{
+	PrintHeader("Custo por job");
+	std::cout << std::setw(8) << "threads" << std::setw(16) << "Run+Wait ns" << std::setw(18) << "ParallelFor ns" << std::endl;
+
+	for (int NumThreads : ThreadCounts)
+	{
+		JobSystem::Get().Init(NumThreads - 1);
+
+		// Jobs vazios enviados pela thread principal e executados por todas
+		const double RunSeconds = Measure([]
+		{
+			JobCounter Counter;
+			for (int JobIndex = 0; JobIndex < NumEmptyJobs; ++JobIndex)
+			{
+				JobSystem::Get().Run(Counter, [] {});
+			}
+			JobSystem::Get().Wait(Counter);
+		});
+
+		// Um job por indice
+		const double ForSeconds = Measure([]
+		{
+			JobSystem::Get().ParallelFor(0, NumEmptyJobs, 1, [](int, int) {});
+		});
+
+		JobSystem::Get().Shutdown();
+
+		std::cout << std::setw(8) << NumThreads
+			<< std::setw(16) << std::setprecision(1) << std::fixed << RunSeconds * 1e9 / NumEmptyJobs
+			<< std::setw(18) << ForSeconds * 1e9 / NumEmptyJobs
+			<< (NumThreads > static_cast<int>(std::thread::hardware_concurrency()) ? "  (mais threads que nucleos)" : "")
+			<< std::endl;
+	}
+}
+
+void Scaling()
+{
+	PrintHeader("Escalabilidade");
+	std::cout << std::setw(8) << "threads" << std::setw(14) << "malhas ms" << std::setw(10) << "ganho"
+		<< std::setw(14) << "culling ms" << std::setw(10) << "ganho" << std::endl;
+
+	// Camera perto da superficie olhando para o horizonte, com muitos nos parcialmente visiveis
+	const GlobeQuadtree Quadtree = BuildGlobeQuadtree(8, EllipsoidRadii);
+	const glm::dvec3 Eye = glm::normalize(GeodeticToECEF(glm::radians(-15.0), glm::radians(-50.0), EllipsoidRadii)) * EllipsoidRadii.x * 1.05;
+	const glm::dmat4 View = glm::lookAt(Eye, glm::dvec3{0.0}, glm::dvec3{0.0, 0.0, 1.0});
+	const glm::dmat4 Projection = glm::perspective(glm::radians(60.0), 16.0 / 9.0, 1000.0, EllipsoidRadii.x * 4.0);
+	const Frustum ViewFrustum = ExtractFrustumPlanes(glm::mat4{Projection * View});
+
+	double BaseMeshSeconds = 0.0;
+	double BaseCullSeconds = 0.0;
+	for (int NumThreads : ThreadCounts)
+	{
+		JobSystem::Get().Init(NumThreads - 1);
+
+		const double MeshSeconds = Measure([]
+		{
+			BuildGlobeTiles(5, 32, EllipsoidRadii);
+		});
+
+		const double CullSeconds = Measure([&]
+		{
+			std::vector<int> VisibleTiles;
+			CullStats Stats;
+			for (int Frame = 0; Frame < 10; ++Frame)
+			{
+				VisibleTiles.clear();
+				CullGlobeQuadtree(Quadtree, ViewFrustum, Eye, EllipsoidRadii, true, VisibleTiles, Stats);
+			}
+		}) / 10.0;
+
+		JobSystem::Get().Shutdown();
+
+		if (NumThreads == 1)
+		{
+			BaseMeshSeconds = MeshSeconds;
+			BaseCullSeconds = CullSeconds;
+		}
+
+		std::cout << std::setw(8) << NumThreads
+			<< std::setw(14) << std::setprecision(3) << std::fixed << MeshSeconds * 1000.0
+			<< std::setw(9) << std::setprecision(2) << BaseMeshSeconds / MeshSeconds << "x"
+			<< std::setw(14) << std::setprecision(3) << CullSeconds * 1000.0
+			<< std::setw(9) << std::setprecision(2) << BaseCullSeconds / CullSeconds << "x"
+			<< std::endl;
+	}
+}
+
+int main()
+{
+	std::cout << "Nucleos: " << std::thread::hardware_concurrency() << std::endl;
+
+	SchedulingOverhead();
+	Scaling();
+
+	return 0;
+}
@@ -0,0 +1,248 @@
+#include "JobSystem.h"
+
+namespace
+{
+	// Indice da thread atual no agendador. -1 em threads que nao pertencem a ele
+	thread_local int CurrentThreadIndex = -1;
+
+	// Tentativas seguidas de encontrar trabalho antes de uma thread ociosa dormir
+	constexpr int SpinsBeforeSleep = 256;
+}
+
+bool JobSystem::WorkStealingQueue::Push(Job* NewJob)
+{
+	const std::int64_t B = Bottom.load(std::memory_order_relaxed);
+	const std::int64_t T = Top.load(std::memory_order_acquire);
+	if (B - T >= static_cast<std::int64_t>(Capacity))
+	{
+		return false;
+	}
+
+	Jobs[B & (Capacity - 1)].store(NewJob, std::memory_order_release);
+	std::atomic_thread_fence(std::memory_order_release);
+	Bottom.store(B + 1, std::memory_order_relaxed);
+	return true;
+}
+
+JobSystem::Job* JobSystem::WorkStealingQueue::Pop()
+{
+	const std::int64_t B = Bottom.load(std::memory_order_relaxed) - 1;
+	Bottom.store(B, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	std::int64_t T = Top.load(std::memory_order_relaxed);
+
+	if (T > B)
+	{
+		// Vazio
+		Bottom.store(B + 1, std::memory_order_relaxed);
+		return nullptr;
+	}
+
+	Job* PoppedJob = Jobs[B & (Capacity - 1)].load(std::memory_order_acquire);
+	if (T == B)
+	{
+		// Ultimo elemento: disputa com quem estiver roubando
+		if (!Top.compare_exchange_strong(T, T + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+		{
+			PoppedJob = nullptr;
+		}
+		Bottom.store(B + 1, std::memory_order_relaxed);
+	}
+	return PoppedJob;
+}
+
+JobSystem::Job* JobSystem::WorkStealingQueue::Steal()
+{
+	std::int64_t T = Top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const std::int64_t B = Bottom.load(std::memory_order_acquire);
+	if (T >= B)
+	{
+		return nullptr;
+	}
+
+	Job* StolenJob = Jobs[T & (Capacity - 1)].load(std::memory_order_acquire);
+	if (!Top.compare_exchange_strong(T, T + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		// Outra thread levou primeiro
+		return nullptr;
+	}
+	return StolenJob;
+}
+
+JobSystem& JobSystem::Get()
+{
+	static JobSystem Instance;
+	return Instance;
+}
+
+void JobSystem::Init(int NumWorkers)
+{
+	if (!Queues.empty())
+	{
+		return;
+	}
+
+	if (NumWorkers <= 0)
+	{
+		NumWorkers = std::max(1, static_cast<int>(std::thread::hardware_concurrency())) - 1;
+	}
+
+	StopRequested = false;
+	NumQueuedJobs = 0;
+	NumSleeping = 0;
+
+	for (int ThreadIndex = 0; ThreadIndex <= NumWorkers; ++ThreadIndex)
+	{
+		std::unique_ptr<ThreadData> Data{new ThreadData};
+		Data->JobPool.reset(new Job[WorkStealingQueue::Capacity]);
+		Queues.push_back(std::move(Data));
+	}
+
+	CurrentThreadIndex = 0;
+	for (int ThreadIndex = 1; ThreadIndex <= NumWorkers; ++ThreadIndex)
+	{
+		Workers.emplace_back(&JobSystem::WorkerLoop, this, ThreadIndex);
+	}
+}
+
+void JobSystem::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> Lock{SleepMutex};
+		StopRequested = true;
+	}
+	WakeWorkers.notify_all();
+
+	for (std::thread& Worker : Workers)
+	{
+		Worker.join();
+	}
+	Workers.clear();
+	Queues.clear();
+	CurrentThreadIndex = -1;
+}
+
+JobSystem::Job* JobSystem::AllocateJob()
+{
+	if (CurrentThreadIndex < 0 || CurrentThreadIndex >= GetNumThreads())
+	{
+		return nullptr;
+	}
+
+	ThreadData& Data = *Queues[CurrentThreadIndex];
+	Job& NewJob = Data.JobPool[Data.NextJob & (WorkStealingQueue::Capacity - 1)];
+	if (NewJob.InUse.load(std::memory_order_acquire))
+	{
+		return nullptr;
+	}
+
+	++Data.NextJob;
+	NewJob.InUse.store(true, std::memory_order_relaxed);
+	return &NewJob;
+}
+
+void JobSystem::Submit(Job* NewJob)
+{
+	if (!Queues[CurrentThreadIndex]->Queue.Push(NewJob))
+	{
+		// Deque cheio: executa aqui mesmo
+		ExecuteJob(NewJob);
+		return;
+	}
+
+	// Acorda uma thread se houver alguma dormindo. O mutex garante que ela ja esta
+	// em wait (e nao so prestes a entrar) quando o notify chega
+	NumQueuedJobs.fetch_add(1);
+	if (NumSleeping.load() > 0)
+	{
+		std::lock_guard<std::mutex> Lock{SleepMutex};
+		WakeWorkers.notify_one();
+	}
+}
+
+JobSystem::Job* JobSystem::FindJob(int ThreadIndex)
+{
+	const int NumThreads = GetNumThreads();
+
+	Job* FoundJob = nullptr;
+	if (ThreadIndex >= 0)
+	{
+		FoundJob = Queues[ThreadIndex]->Queue.Pop();
+	}
+
+	// Sem trabalho proprio: tenta roubar das outras comecando pela vizinha
+	for (int Offset = 1; !FoundJob && Offset <= NumThreads; ++Offset)
+	{
+		const int Victim = (ThreadIndex + Offset + NumThreads) % NumThreads;
+		if (Victim != ThreadIndex)
+		{
+			FoundJob = Queues[Victim]->Queue.Steal();
+		}
+	}
+
+	if (FoundJob)
+	{
+		NumQueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+	}
+	return FoundJob;
+}
+
+void JobSystem::ExecuteJob(Job* CurrentJob)
+{
+	JobCounter* Counter = CurrentJob->Counter;
+	CurrentJob->Execute(CurrentJob);
+
+	// Depois do decremento o contador pode deixar de existir; o job so e
+	// devolvido ao anel no fim
+	Counter->Pending.fetch_sub(1, std::memory_order_release);
+	CurrentJob->InUse.store(false, std::memory_order_release);
+}
+
+void JobSystem::Wait(JobCounter& Counter)
+{
+	while (!Counter.IsDone())
+	{
+		if (Job* NextJob = FindJob(CurrentThreadIndex))
+		{
+			ExecuteJob(NextJob);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void JobSystem::WorkerLoop(int ThreadIndex)
+{
+	CurrentThreadIndex = ThreadIndex;
+
+	int NumFailedSpins = 0;
+	while (!StopRequested.load(std::memory_order_relaxed))
+	{
+		if (Job* NextJob = FindJob(ThreadIndex))
+		{
+			ExecuteJob(NextJob);
+			NumFailedSpins = 0;
+			continue;
+		}
+
+		if (++NumFailedSpins < SpinsBeforeSleep)
+		{
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> Lock{SleepMutex};
+		NumSleeping.fetch_add(1);
+		WakeWorkers.wait(Lock, [this]
+		{
+			return StopRequested.load() || NumQueuedJobs.load() > 0;
+		});
+		NumSleeping.fetch_sub(1);
+		NumFailedSpins = 0;
+	}
+
+	CurrentThreadIndex = -1;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Contador de jobs pendentes. Run incrementa, o fim de cada job decrementa e
+// Wait so retorna quando chega a zero. Um job pode esperar outro contador,
+// entao dependencias sao expressas com Wait dentro do proprio job
+struct JobCounter
+{
+	std::atomic<int> Pending{0};
+
+	bool IsDone() const { return Pending.load(std::memory_order_acquire) == 0; }
+};
+
+// Agendador de jobs com roubo de trabalho. Cada thread de trabalho tem um deque
+// Chase-Lev proprio: empilha e desempilha no fundo sem travas, e as threads ociosas
+// roubam do topo dos deques das outras. A thread principal tambem tem um deque e
+// executa jobs enquanto espera em Wait
+class JobSystem
+{
+public:
+	static JobSystem& Get();
+
+	// Cria NumWorkers threads de trabalho alem da thread que chama Init, que passa
+	// a ser a thread principal do agendador. 0 usa um nucleo por thread
+	void Init(int NumWorkers = 0);
+
+	// Espera as threads de trabalho terminarem. Nao pode haver jobs pendentes
+	void Shutdown();
+
+	// Threads que executam jobs, incluindo a principal
+	int GetNumThreads() const { return static_cast<int>(Queues.size()); }
+
+	// Enfileira Func() e incrementa Counter. Fora das threads do agendador, ou
+	// sem Init, o job roda na hora
+	template <typename FuncType>
+	void Run(JobCounter& Counter, FuncType&& Func)
+	{
+		using StoredType = typename std::decay<FuncType>::type;
+		static_assert(sizeof(StoredType) <= Job::DataSize, "Capturas grandes demais para um job; capture por referencia");
+		static_assert(alignof(StoredType) <= alignof(std::max_align_t), "Alinhamento maior que o suportado em um job");
+
+		Job* NewJob = AllocateJob();
+		if (!NewJob)
+		{
+			Func();
+			return;
+		}
+
+		NewJob->Execute = [](Job* Self)
+		{
+			StoredType* Stored = reinterpret_cast<StoredType*>(Self->Data);
+			(*Stored)();
+			Stored->~StoredType();
+		};
+		NewJob->Counter = &Counter;
+		new (NewJob->Data) StoredType(std::forward<FuncType>(Func));
+
+		Counter.Pending.fetch_add(1, std::memory_order_relaxed);
+		Submit(NewJob);
+	}
+
+	// Executa outros jobs ate Counter zerar
+	void Wait(JobCounter& Counter);
+
+	// Divide [Begin, End) em fatias de ate Grain indices e chama Func(SliceBegin, SliceEnd)
+	// em paralelo, retornando quando todas terminarem. Grain <= 0 escolhe algumas
+	// fatias por thread
+	template <typename FuncType>
+	void ParallelFor(int Begin, int End, int Grain, const FuncType& Func)
+	{
+		const int Count = End - Begin;
+		if (Count <= 0)
+		{
+			return;
+		}
+		if (Grain <= 0)
+		{
+			Grain = std::max(1, Count / (GetNumThreads() * 4));
+		}
+		if (Count <= Grain || GetNumThreads() <= 1)
+		{
+			Func(Begin, End);
+			return;
+		}
+
+		JobCounter Counter;
+		for (int SliceBegin = Begin; SliceBegin < End; SliceBegin += Grain)
+		{
+			const int SliceEnd = std::min(End, SliceBegin + Grain);
+			Run(Counter, [&Func, SliceBegin, SliceEnd]
+			{
+				Func(SliceBegin, SliceEnd);
+			});
+		}
+		Wait(Counter);
+	}
+
+private:
+	// Duas linhas de cache por job, com as capturas guardadas no proprio job
+	struct alignas(64) Job
+	{
+		static constexpr std::size_t DataSize = 96;
+
+		void (*Execute)(Job*) = nullptr;
+		JobCounter* Counter = nullptr;
+		std::atomic<bool> InUse{false};
+		alignas(std::max_align_t) unsigned char Data[DataSize];
+	};
+
+	// Deque Chase-Lev de capacidade fixa (Le, Pop, Cohen e Zappa Nardelli, 2013)
+	class WorkStealingQueue
+	{
+	public:
+		static constexpr std::size_t Capacity = 1024;
+
+		bool Push(Job* NewJob);     // So a dona
+		Job* Pop();                 // So a dona
+		Job* Steal();               // Qualquer thread
+
+	private:
+		alignas(64) std::atomic<std::int64_t> Top{0};
+		alignas(64) std::atomic<std::int64_t> Bottom{0};
+		std::atomic<Job*> Jobs[Capacity];
+	};
+
+	// Jobs de cada thread, reaproveitados em anel. Se o proximo do anel ainda nao
+	// terminou, o novo job roda na hora em vez de ser enfileirado
+	struct ThreadData
+	{
+		WorkStealingQueue Queue;
+		std::unique_ptr<Job[]> JobPool;
+		std::size_t NextJob = 0;
+	};
+
+	JobSystem() = default;
+
+	Job* AllocateJob();
+	void Submit(Job* NewJob);
+	Job* FindJob(int ThreadIndex);
+	void ExecuteJob(Job* CurrentJob);
+	void WorkerLoop(int ThreadIndex);
+
+	std::vector<std::unique_ptr<ThreadData>> Queues;
+	std::vector<std::thread> Workers;
+
+	// Threads ociosas dormem aqui depois de varias tentativas de roubo sem sucesso
+	std::atomic<int> NumQueuedJobs{0};
+	std::atomic<int> NumSleeping{0};
+	std::atomic<bool> StopRequested{false};
+	std::mutex SleepMutex;
+	std::condition_variable WakeWorkers;
+};
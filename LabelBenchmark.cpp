@@ -0,0 +1,130 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/ext.hpp>
+
+#include "JobSystem.h"
+#include "LabelLayer.h"
+#include "Camera.h"
+
+// Raios do elipsoide WGS84 em metros
+const glm::dvec3 EllipsoidRadii{6378137.0, 6378137.0, 6356752.314245};
+
+const int DefaultNumLabels = 50000;
+const int NumFrames = 200;
+const glm::vec2 ViewportSize{1920.0f, 1080.0f};
+
+void PrintHeader(const std::string& Title)
+{
+	std::cout << std::endl;
+	std::cout << "==================" << std::endl;
+	std::cout << Title << std::endl;
+	std::cout << "==================" << std::endl;
+}
+
+// Nomes aleatorios com acentos, para exercitar a decodificacao UTF-8 e o atlas
+std::string RandomName(std::mt19937& Random)
+{
+	static const char* Syllables[] = {"ba", "ri", "to", "san", "ma", "lu", "\xC3\xA3o", "ni", "gua", "pe", "co", "\xC3\xA9", "ra", "vi", "la"};
+	std::uniform_int_distribution<int> NumSyllables{2, 5};
+	std::uniform_int_distribution<int> Syllable{0, int(std::size(Syllables)) - 1};
+
+	std::string Name;
+	const int Count = NumSyllables(Random);
+	for (int SyllableIndex = 0; SyllableIndex < Count; ++SyllableIndex)
+	{
+		Name += Syllables[Syllable(Random)];
+	}
+	Name[0] = static_cast<char>(std::toupper(static_cast<unsigned char>(Name[0])));
+	return Name;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 2)
+	{
+		std::cerr << "Uso: LabelBenchmark fonte.ttf [rotulos]" << std::endl;
+		return 1;
+	}
+	const int NumLabels = argc > 2 ? std::atoi(argv[2]) : DefaultNumLabels;
+
+	JobSystem::Get().Init();
+
+	LabelLayer Labels;
+	if (!Labels.Init(argv[1], EllipsoidRadii))
+	{
+		return 1;
+	}
+
+	// Pontos uniformes na esfera, prioridade com cauda longa como a populacao das cidades
+	std::mt19937 Random{42};
+	std::uniform_real_distribution<double> Uniform{0.0, 1.0};
+	const auto AddStart = std::chrono::steady_clock::now();
+	for (int LabelIndex = 0; LabelIndex < NumLabels; ++LabelIndex)
+	{
+		const double Latitude = glm::degrees(std::asin(2.0 * Uniform(Random) - 1.0));
+		const double Longitude = Uniform(Random) * 360.0 - 180.0;
+		const float Priority = static_cast<float>(1.0 / (Uniform(Random) + 1e-3));
+		Labels.Add(Latitude, Longitude, RandomName(Random), Priority, 0xFFFFFFFFu);
+	}
+	const double AddSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - AddStart).count();
+	const GlyphAtlas::Stats AtlasStats = Labels.GetAtlas().GetStats();
+
+	PrintHeader("Declutter de " + std::to_string(NumLabels) + " rotulos (" + std::to_string(JobSystem::Get().GetNumThreads()) + " threads)");
+	std::cout << "Diagramacao: " << std::fixed << std::setprecision(1) << AddSeconds * 1000.0 << " ms, "
+		<< AtlasStats.NumGlyphs << " glifos rasterizados em " << AtlasStats.RasterSeconds * 1000.0 << " ms" << std::endl;
+	std::cout << std::setw(12) << "altura" << std::setw(12) << "media ms" << std::setw(12) << "max ms"
+		<< std::setw(12) << "visiveis" << std::setw(12) << "cobertos" << std::setw(12) << "glifos" << std::endl;
+
+	// Do globo inteiro na tela ate perto da superficie
+	for (double DistanceInRadii : {3.0, 1.5, 1.1, 1.01})
+	{
+		Camera BenchmarkCamera;
+		BenchmarkCamera.AspectRatio = ViewportSize.x / ViewportSize.y;
+		BenchmarkCamera.Target = glm::dvec3{0.0};
+		BenchmarkCamera.Up = glm::dvec3{0.0, 0.0, 1.0};
+		BenchmarkCamera.FitClipPlanes((DistanceInRadii - 1.0) * EllipsoidRadii.x, EllipsoidRadii.x);
+
+		// O primeiro Update ordena os rotulos por prioridade; fica fora da medicao
+		BenchmarkCamera.Position = glm::dvec3{DistanceInRadii * EllipsoidRadii.x, 0.0, 0.0};
+		Labels.Update(BenchmarkCamera.GetViewProjection(), BenchmarkCamera.Position, ViewportSize);
+
+		double TotalSeconds = 0.0;
+		double MaxSeconds = 0.0;
+		LabelLayer::Stats LastStats;
+		for (int Frame = 0; Frame < NumFrames; ++Frame)
+		{
+			// Girar a camera em volta do eixo para o conjunto visivel mudar a cada frame
+			const double Angle = glm::radians(0.5 * Frame);
+			BenchmarkCamera.Position = glm::dvec3{std::cos(Angle), std::sin(Angle), 0.3} * DistanceInRadii * EllipsoidRadii.x / std::sqrt(1.09);
+			if (DistanceInRadii < 1.5)
+			{
+				// Perto da superficie a camera olha para o horizonte, nao para o centro
+				BenchmarkCamera.Target = BenchmarkCamera.Position + glm::dvec3{-std::sin(Angle), std::cos(Angle), 0.0};
+			}
+
+			Labels.Update(BenchmarkCamera.GetViewProjection(), BenchmarkCamera.Position, ViewportSize);
+			LastStats = Labels.GetStats();
+			TotalSeconds += LastStats.DeclutterSeconds;
+			MaxSeconds = std::max(MaxSeconds, LastStats.DeclutterSeconds);
+		}
+
+		std::cout << std::setw(12) << std::setprecision(2) << DistanceInRadii
+			<< std::setw(12) << std::setprecision(3) << TotalSeconds / NumFrames * 1000.0
+			<< std::setw(12) << MaxSeconds * 1000.0
+			<< std::setw(12) << LastStats.NumVisible
+			<< std::setw(12) << LastStats.NumDecluttered
+			<< std::setw(12) << LastStats.NumGlyphs << std::endl;
+	}
+
+	JobSystem::Get().Shutdown();
+
+	return 0;
+}
@@ -0,0 +1,199 @@
+#include "LabelLayer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include "GlobeTiles.h"
+#include "JobSystem.h"
+
+// Lado das celulas da grade de colisao em pixels; um rotulo tipico cobre poucas celulas
+constexpr float GridCellSize = 32.0f;
+
+// Espaco minimo entre dois rotulos aceitos, em pixels
+constexpr float LabelMargin = 2.0f;
+
+// Distancia entre o ponto e o inicio do texto, em alturas de texto
+constexpr float LabelOffset = 0.6f;
+
+// Ancora dos rotulos escondidos
+constexpr float HiddenAnchor = -1.0e9f;
+
+bool LabelLayer::Init(const std::string& FontFile, const glm::dvec3& EllipsoidRadii, float FontPixelHeight, int AtlasSize, const std::string& CacheFile)
+{
+	Radii = EllipsoidRadii;
+	Clear();
+	if (!CacheFile.empty())
+	{
+		return Atlas.InitCached(FontFile, CacheFile, DefaultGlyphRanges, FontPixelHeight, AtlasSize);
+	}
+	return Atlas.Init(FontFile, FontPixelHeight, AtlasSize);
+}
+
+std::uint32_t LabelLayer::Add(double Latitude, double Longitude, const std::string& Text, float Priority, std::uint32_t Color)
+{
+	Label NewLabel;
+	NewLabel.Position = GeodeticToECEF(glm::radians(Latitude), glm::radians(Longitude), Radii);
+	NewLabel.Normal = glm::vec3{GeodeticSurfaceNormal(NewLabel.Position, Radii)};
+	NewLabel.Priority = Priority;
+	NewLabel.Color = Color;
+	NewLabel.FirstGlyph = static_cast<std::uint32_t>(Glyphs.size());
+
+	// Diagramar uma linha com a origem no canto inferior esquerdo e y para cima
+	const float Baseline = -Atlas.GetDescent();
+	float PenX = 0.0f;
+	int PreviousCodepoint = 0;
+	for (std::size_t Position = 0; Position < Text.size();)
+	{
+		const int Codepoint = DecodeUtf8(Text, Position);
+		if (PreviousCodepoint != 0)
+		{
+			PenX += Atlas.GetKerning(PreviousCodepoint, Codepoint);
+		}
+
+		const GlyphInfo& Glyph = Atlas.GetGlyph(Codepoint);
+		if (Glyph.HasBitmap)
+		{
+			PlacedGlyph Placed;
+			Placed.Rect = glm::vec4{PenX + Glyph.OffsetX, Baseline - Glyph.OffsetY - Glyph.Height, Glyph.Width, Glyph.Height};
+			Placed.UVRect = glm::vec4{Glyph.U0, Glyph.V0, Glyph.U1, Glyph.V1};
+			Glyphs.push_back(Placed);
+		}
+
+		PenX += Glyph.Advance;
+		PreviousCodepoint = Codepoint;
+	}
+
+	NewLabel.NumGlyphs = static_cast<std::uint32_t>(Glyphs.size()) - NewLabel.FirstGlyph;
+	NewLabel.Size = glm::vec2{PenX, Atlas.GetAscent() - Atlas.GetDescent()};
+
+	const std::size_t Index = Labels.size();
+	Labels.push_back(NewLabel);
+	OrderDirty = true;
+	return static_cast<std::uint32_t>(Index);
+}
+
+void LabelLayer::Clear()
+{
+	Labels.clear();
+	Glyphs.clear();
+	SortedLabels.clear();
+	Instances.clear();
+	OrderDirty = false;
+}
+
+void LabelLayer::Update(const glm::mat4& ViewProjection, const glm::dvec3& Eye, const glm::vec2& ViewportSize)
+{
+	const auto StartTime = std::chrono::steady_clock::now();
+
+	CurrentStats = Stats{};
+	CurrentStats.NumCandidates = static_cast<int>(Labels.size());
+	Instances.clear();
+
+	if (OrderDirty)
+	{
+		// Copia ordenada para os dois lacos abaixo percorrerem a memoria em sequencia
+		SortedLabels = Labels;
+		std::stable_sort(SortedLabels.begin(), SortedLabels.end(), [](const Label& A, const Label& B)
+		{
+			return A.Priority > B.Priority;
+		});
+		OrderDirty = false;
+	}
+
+	// Projetar todos os candidatos em paralelo. A subtracao do olho e em double
+	const int NumLabels = static_cast<int>(SortedLabels.size());
+	ScreenAnchors.resize(NumLabels);
+	JobSystem::Get().ParallelFor(0, NumLabels, 2048, [this, &ViewProjection, &Eye, &ViewportSize](int SliceBegin, int SliceEnd)
+	{
+		for (int OrderIndex = SliceBegin; OrderIndex < SliceEnd; ++OrderIndex)
+		{
+			const Label& Candidate = SortedLabels[OrderIndex];
+			const glm::vec3 EyeRelative{Candidate.Position - Eye};
+
+			glm::vec2 Anchor{HiddenAnchor};
+			if (glm::dot(Candidate.Normal, -EyeRelative) > 0.0f)
+			{
+				const glm::vec4 Clip = ViewProjection * glm::vec4{EyeRelative, 1.0f};
+				if (Clip.w > 0.0f)
+				{
+					Anchor = (glm::vec2{Clip} / Clip.w * 0.5f + 0.5f) * ViewportSize;
+				}
+			}
+			ScreenAnchors[OrderIndex] = Anchor;
+		}
+	});
+
+	GridWidth = std::max(1, static_cast<int>(std::ceil(ViewportSize.x / GridCellSize)));
+	GridHeight = std::max(1, static_cast<int>(std::ceil(ViewportSize.y / GridCellSize)));
+	GridCells.resize(std::size_t(GridWidth) * GridHeight);
+	for (std::vector<glm::vec4>& Cell : GridCells)
+	{
+		Cell.clear();
+	}
+
+	// Aceitar em ordem de prioridade os que nao colidem com nenhum ja aceito
+	const float TextScale = TextHeight / Atlas.GetPixelHeight();
+	for (int OrderIndex = 0; OrderIndex < NumLabels; ++OrderIndex)
+	{
+		const glm::vec2 Anchor = ScreenAnchors[OrderIndex];
+		const Label& Candidate = SortedLabels[OrderIndex];
+		const glm::vec2 Size = Candidate.Size * TextScale;
+		const glm::vec2 Min{Anchor.x + TextHeight * LabelOffset, Anchor.y - Size.y * 0.5f};
+		const glm::vec2 Max = Min + Size;
+		if (Min.x < 0.0f || Min.y < 0.0f || Max.x > ViewportSize.x || Max.y > ViewportSize.y)
+		{
+			CurrentStats.NumHidden++;
+			continue;
+		}
+
+		const glm::vec4 Box{Min - LabelMargin, Max + LabelMargin};
+		const int CellMinX = std::max(0, static_cast<int>(Box.x / GridCellSize));
+		const int CellMinY = std::max(0, static_cast<int>(Box.y / GridCellSize));
+		const int CellMaxX = std::min(GridWidth - 1, static_cast<int>(Box.z / GridCellSize));
+		const int CellMaxY = std::min(GridHeight - 1, static_cast<int>(Box.w / GridCellSize));
+
+		bool Overlaps = false;
+		for (int CellY = CellMinY; CellY <= CellMaxY && !Overlaps; ++CellY)
+		{
+			for (int CellX = CellMinX; CellX <= CellMaxX && !Overlaps; ++CellX)
+			{
+				for (const glm::vec4& Other : GridCells[std::size_t(CellY) * GridWidth + CellX])
+				{
+					if (Box.x < Other.z && Other.x < Box.z && Box.y < Other.w && Other.y < Box.w)
+					{
+						Overlaps = true;
+						break;
+					}
+				}
+			}
+		}
+		if (Overlaps)
+		{
+			CurrentStats.NumDecluttered++;
+			continue;
+		}
+
+		for (int CellY = CellMinY; CellY <= CellMaxY; ++CellY)
+		{
+			for (int CellX = CellMinX; CellX <= CellMaxX; ++CellX)
+			{
+				GridCells[std::size_t(CellY) * GridWidth + CellX].push_back(Box);
+			}
+		}
+
+		for (std::uint32_t GlyphIndex = 0; GlyphIndex < Candidate.NumGlyphs; ++GlyphIndex)
+		{
+			const PlacedGlyph& Placed = Glyphs[Candidate.FirstGlyph + GlyphIndex];
+			LabelGlyphInstance Instance;
+			Instance.Rect = glm::vec4{Min + glm::vec2{Placed.Rect} * TextScale, glm::vec2{Placed.Rect.z, Placed.Rect.w} * TextScale};
+			Instance.UVRect = Placed.UVRect;
+			Instance.Color = Candidate.Color;
+			Instances.push_back(Instance);
+		}
+		CurrentStats.NumVisible++;
+	}
+
+	CurrentStats.NumGlyphs = static_cast<int>(Instances.size());
+	CurrentStats.DeclutterSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - StartTime).count();
+}
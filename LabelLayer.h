@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "GlyphAtlas.h"
+
+// Um glifo na tela, exatamente como fica no buffer de instancias da GPU
+struct LabelGlyphInstance
+{
+	glm::vec4 Rect;         // xy: canto inferior esquerdo em pixels, zw: tamanho em pixels
+	glm::vec4 UVRect;       // xy: canto superior esquerdo no atlas, zw: canto inferior direito
+	std::uint32_t Color;    // RGBA8, R no byte menos significativo
+};
+
+// Rotulos de texto presos a pontos do globo (nomes de cidades). A cada frame os
+// candidatos sao projetados na tela e, em ordem de prioridade, cada rotulo so e
+// aceito se o seu retangulo nao cobrir um rotulo ja aceito (declutter). Os glifos
+// dos aceitos viram instancias para um unico draw call. Nao usa OpenGL; os
+// bitmaps dos glifos novos saem em TakeGlyphUploads() para o LabelRenderer
+class LabelLayer
+{
+public:
+	struct Stats
+	{
+		int NumCandidates = 0;
+		int NumHidden = 0;          // Atras do horizonte ou fora da tela
+		int NumDecluttered = 0;     // Cobririam um rotulo de maior prioridade
+		int NumVisible = 0;
+		int NumGlyphs = 0;
+		double DeclutterSeconds = 0.0;
+	};
+
+	// Com CacheFile, o atlas das faixas padrao e carregado pronto desse arquivo (e
+	// cozido nele na primeira execucao); sem, todo glifo e rasterizado sob demanda
+	bool Init(const std::string& FontFile, const glm::dvec3& EllipsoidRadii, float FontPixelHeight = 32.0f, int AtlasSize = 1024, const std::string& CacheFile = {});
+
+	// Altura do texto na tela em pixels
+	void SetTextHeight(float PixelHeight) { TextHeight = PixelHeight; }
+
+	// Latitude e longitude em graus. Rotulos com maior Priority ganham as colisoes.
+	// O texto e diagramado aqui, entao os glifos novos sao rasterizados nesta chamada
+	std::uint32_t Add(double Latitude, double Longitude, const std::string& Text, float Priority, std::uint32_t Color);
+	void Clear();
+
+	std::size_t GetCount() const { return Labels.size(); }
+
+	// Projeta e faz o declutter de todos os rotulos. ViewProjection e relativa ao olho
+	// (Camera::GetViewProjection). As instancias ficam em GetInstances() ate a proxima chamada
+	void Update(const glm::mat4& ViewProjection, const glm::dvec3& Eye, const glm::vec2& ViewportSize);
+
+	const std::vector<LabelGlyphInstance>& GetInstances() const { return Instances; }
+
+	std::vector<GlyphUpload> TakeGlyphUploads() { return Atlas.TakeUploads(); }
+	const GlyphAtlas& GetAtlas() const { return Atlas; }
+
+	Stats GetStats() const { return CurrentStats; }
+
+private:
+	struct Label
+	{
+		glm::dvec3 Position;
+		glm::vec3 Normal;
+		float Priority = 0.0f;
+		std::uint32_t Color = 0;
+		std::uint32_t FirstGlyph = 0;
+		std::uint32_t NumGlyphs = 0;
+		glm::vec2 Size{0.0f};       // Largura e altura do texto em pixels do atlas
+	};
+
+	// Glifo posicionado em relacao a origem do rotulo (canto inferior esquerdo), em pixels do atlas
+	struct PlacedGlyph
+	{
+		glm::vec4 Rect;
+		glm::vec4 UVRect;
+	};
+
+	GlyphAtlas Atlas;
+	glm::dvec3 Radii{1.0};
+	float TextHeight = 14.0f;
+
+	std::vector<Label> Labels;
+	std::vector<PlacedGlyph> Glyphs;
+
+	// Rotulos em ordem decrescente de prioridade, refeito quando a lista muda
+	std::vector<Label> SortedLabels;
+	bool OrderDirty = false;
+
+	// Ancora de cada rotulo na tela (x negativo = escondido), na ordem de SortedLabels
+	std::vector<glm::vec2> ScreenAnchors;
+
+	// Grade uniforme com os retangulos aceitos no frame, para testar colisoes so com os vizinhos
+	std::vector<std::vector<glm::vec4>> GridCells;
+	int GridWidth = 0;
+	int GridHeight = 0;
+
+	std::vector<LabelGlyphInstance> Instances;
+
+	Stats CurrentStats;
+};
@@ -0,0 +1,100 @@
+#include "LabelRenderer.h"
+
+#include <algorithm>
+
+void LabelRenderer::Init(int AtlasSize, std::size_t InitialCapacity)
+{
+	// O atlas comeca vazio (distancia 0 = longe de qualquer glifo)
+	const std::vector<unsigned char> Empty(std::size_t(AtlasSize) * AtlasSize, 0);
+	glGenTextures(1, &AtlasTexture);
+	glBindTexture(GL_TEXTURE_2D, AtlasTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, AtlasSize, AtlasSize, 0, GL_RED, GL_UNSIGNED_BYTE, Empty.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	Capacity = std::max<std::size_t>(InitialCapacity, 1);
+
+	glGenVertexArrays(1, &VertexArray);
+	glGenBuffers(1, &InstanceBuffer);
+
+	glBindVertexArray(VertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, InstanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, Capacity * sizeof(LabelGlyphInstance), nullptr, GL_STREAM_DRAW);
+
+	// Os cantos do quad saem do gl_VertexID, entao todos os atributos sao por instancia
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(LabelGlyphInstance), reinterpret_cast<void*>(offsetof(LabelGlyphInstance, Rect)));
+	glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(LabelGlyphInstance), reinterpret_cast<void*>(offsetof(LabelGlyphInstance, UVRect)));
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(LabelGlyphInstance), reinterpret_cast<void*>(offsetof(LabelGlyphInstance, Color)));
+	glVertexAttribDivisor(0, 1);
+	glVertexAttribDivisor(1, 1);
+	glVertexAttribDivisor(2, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void LabelRenderer::Destroy()
+{
+	glDeleteTextures(1, &AtlasTexture);
+	glDeleteBuffers(1, &InstanceBuffer);
+	glDeleteVertexArrays(1, &VertexArray);
+	AtlasTexture = 0;
+	InstanceBuffer = 0;
+	VertexArray = 0;
+}
+
+void LabelRenderer::UploadGlyphs(const std::vector<GlyphUpload>& Uploads)
+{
+	if (Uploads.empty())
+	{
+		return;
+	}
+
+	glBindTexture(GL_TEXTURE_2D, AtlasTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	for (const GlyphUpload& Upload : Uploads)
+	{
+		glTexSubImage2D(GL_TEXTURE_2D, 0, Upload.X, Upload.Y, Upload.Width, Upload.Height, GL_RED, GL_UNSIGNED_BYTE, Upload.Data());
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void LabelRenderer::Draw(GLuint ProgramId, const LabelGlyphInstance* Instances, std::size_t NumInstances)
+{
+	if (NumInstances == 0)
+	{
+		return;
+	}
+
+	// O conjunto visivel muda a cada frame: o buffer e reespecificado inteiro (orphaning)
+	glBindBuffer(GL_ARRAY_BUFFER, InstanceBuffer);
+	while (Capacity < NumInstances)
+	{
+		Capacity *= 2;
+	}
+	glBufferData(GL_ARRAY_BUFFER, Capacity * sizeof(LabelGlyphInstance), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, NumInstances * sizeof(LabelGlyphInstance), Instances);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glUseProgram(ProgramId);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, AtlasTexture);
+	glUniform1i(glGetUniformLocation(ProgramId, "AtlasSampler"), 0);
+
+	glBindVertexArray(VertexArray);
+
+	// Um unico draw call para todos os glifos de todos os rotulos
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(NumInstances));
+
+	glBindVertexArray(0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(0);
+}
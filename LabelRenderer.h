@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "GlyphAtlas.h"
+#include "LabelLayer.h"
+
+// Parte OpenGL dos rotulos: a textura do atlas de glifos (um canal, SDF) e o buffer
+// de instancias com um quad por glifo. Todos os glifos visiveis saem em um unico
+// glDrawArraysInstanced. Roda na thread dona do contexto
+class LabelRenderer
+{
+public:
+	void Init(int AtlasSize, std::size_t InitialCapacity);
+	void Destroy();
+
+	// Copia para a textura os glifos rasterizados desde o ultimo envio
+	void UploadGlyphs(const std::vector<GlyphUpload>& Uploads);
+
+	// O bloco FrameBlock ja deve estar ligado (ver UniformBuffers.h)
+	void Draw(GLuint ProgramId, const LabelGlyphInstance* Instances, std::size_t NumInstances);
+
+private:
+	GLuint AtlasTexture = 0;
+	GLuint VertexArray = 0;
+	GLuint InstanceBuffer = 0;
+	std::size_t Capacity = 0;
+};
@@ -0,0 +1,133 @@
+#include "MarkerLayer.h"
+
+#include <algorithm>
+
+std::uint32_t PackMarkerColor(const glm::vec4& Color)
+{
+	const glm::uvec4 Bytes = glm::uvec4(glm::clamp(Color, 0.0f, 1.0f) * 255.0f + 0.5f);
+	return Bytes.r | (Bytes.g << 8) | (Bytes.b << 16) | (Bytes.a << 24);
+}
+
+void MarkerLayer::Init(std::size_t InitialCapacity)
+{
+	Capacity = std::max<std::size_t>(InitialCapacity, 1);
+	Markers.reserve(Capacity);
+
+	glGenVertexArrays(1, &VertexArray);
+	glGenBuffers(1, &InstanceBuffer);
+
+	glBindVertexArray(VertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, InstanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, Capacity * sizeof(Marker), nullptr, GL_DYNAMIC_DRAW);
+
+	// Os cantos do quad saem do gl_VertexID, entao todos os atributos sao por instancia
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Marker), reinterpret_cast<void*>(offsetof(Marker, Latitude)));
+	glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(Marker), reinterpret_cast<void*>(offsetof(Marker, Size)));
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Marker), reinterpret_cast<void*>(offsetof(Marker, Color)));
+	glVertexAttribDivisor(0, 1);
+	glVertexAttribDivisor(1, 1);
+	glVertexAttribDivisor(2, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void MarkerLayer::Destroy()
+{
+	glDeleteBuffers(1, &InstanceBuffer);
+	glDeleteVertexArrays(1, &VertexArray);
+	InstanceBuffer = 0;
+	VertexArray = 0;
+	Markers.clear();
+}
+
+std::uint32_t MarkerLayer::Add(const Marker& NewMarker)
+{
+	const std::size_t Index = Markers.size();
+	Markers.push_back(NewMarker);
+	if (Markers.size() > Capacity)
+	{
+		NeedsRealloc = true;
+	}
+	MarkDirty(Index, Index + 1);
+	return static_cast<std::uint32_t>(Index);
+}
+
+void MarkerLayer::Update(std::uint32_t Index, const Marker& NewMarker)
+{
+	Markers[Index] = NewMarker;
+	MarkDirty(Index, Index + 1);
+}
+
+void MarkerLayer::Clear()
+{
+	Markers.clear();
+	DirtyBegin = DirtyEnd = 0;
+}
+
+void MarkerLayer::MarkDirty(std::size_t Begin, std::size_t End)
+{
+	if (DirtyBegin == DirtyEnd)
+	{
+		DirtyBegin = Begin;
+		DirtyEnd = End;
+	}
+	else
+	{
+		DirtyBegin = std::min(DirtyBegin, Begin);
+		DirtyEnd = std::max(DirtyEnd, End);
+	}
+}
+
+void MarkerLayer::Upload()
+{
+	if (DirtyBegin == DirtyEnd && !NeedsRealloc)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, InstanceBuffer);
+
+	if (NeedsRealloc)
+	{
+		// Crescer o buffer geometricamente e reenviar tudo de uma vez
+		while (Capacity < Markers.size())
+		{
+			Capacity *= 2;
+		}
+		glBufferData(GL_ARRAY_BUFFER, Capacity * sizeof(Marker), nullptr, GL_DYNAMIC_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, Markers.size() * sizeof(Marker), Markers.data());
+		NeedsRealloc = false;
+	}
+	else
+	{
+		// Apenas o intervalo que mudou desde o ultimo envio
+		glBufferSubData(GL_ARRAY_BUFFER, DirtyBegin * sizeof(Marker), (DirtyEnd - DirtyBegin) * sizeof(Marker), Markers.data() + DirtyBegin);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	DirtyBegin = DirtyEnd = 0;
+}
+
+void MarkerLayer::Draw(GLuint ProgramId)
+{
+	if (Markers.empty())
+	{
+		return;
+	}
+
+	Upload();
+
+	glUseProgram(ProgramId);
+
+	glBindVertexArray(VertexArray);
+
+	// Um unico draw call para todos os marcadores
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(Markers.size()));
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Dados de um marcador, exatamente como ficam no buffer de instancias da GPU
+struct Marker
+{
+	float Latitude;         // Graus
+	float Longitude;        // Graus
+	float Size;             // Diametro em pixels
+	std::uint32_t Color;    // RGBA8, R no byte menos significativo
+};
+
+std::uint32_t PackMarkerColor(const glm::vec4& Color);
+
+// Camada de marcadores geograficos (cidades, estacoes...). Todos os marcadores
+// ficam em um unico buffer de instancias e sao desenhados com um unico
+// glDrawArraysInstanced. A conversao de lat/lon para ECEF acontece no vertex shader.
+class MarkerLayer
+{
+public:
+	void Init(std::size_t InitialCapacity);
+	void Destroy();
+
+	// Retorna o indice do marcador, que permanece valido ate o proximo Clear()
+	std::uint32_t Add(const Marker& NewMarker);
+	void Update(std::uint32_t Index, const Marker& NewMarker);
+	void Clear();
+
+	const Marker& GetMarker(std::uint32_t Index) const { return Markers[Index]; }
+	std::size_t GetCount() const { return Markers.size(); }
+	const std::vector<Marker>& GetMarkers() const { return Markers; }
+
+	// Envia para a GPU apenas o intervalo de marcadores que mudou
+	void Upload();
+
+	// Os blocos FrameBlock e ObjectBlock ja devem estar ligados (ver UniformBuffers.h)
+	void Draw(GLuint ProgramId);
+
+private:
+	void MarkDirty(std::size_t Begin, std::size_t End);
+
+	std::vector<Marker> Markers;
+	GLuint VertexArray = 0;
+	GLuint InstanceBuffer = 0;
+	std::size_t Capacity = 0;
+	std::size_t DirtyBegin = 0;
+	std::size_t DirtyEnd = 0;
+	bool NeedsRealloc = false;
+};
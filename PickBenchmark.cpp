@@ -0,0 +1,156 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+#include "GlobeTiles.h"
+#include "Picking.h"
+
+// Raios do elipsoide WGS84 em metros
+const glm::dvec3 EllipsoidRadii{6378137.0, 6378137.0, 6356752.314245};
+
+const int DefaultNumMarkers = 1000000;
+const int NumQueries = 10000;
+const int NumCheckedQueries = 200;
+const double PickRadiusPixels = 4.0;
+const glm::dvec2 ViewportSize{1920.0, 1080.0};
+
+void PrintHeader(const std::string& Title)
+{
+	std::cout << std::endl;
+	std::cout << "==================" << std::endl;
+	std::cout << Title << std::endl;
+	std::cout << "==================" << std::endl;
+}
+
+// Referencia por forca bruta: o mesmo criterio do MarkerPicker, testando todos os marcadores
+int PickBruteForce(const std::vector<Marker>& Markers, const PickView& View, const glm::dvec2& Cursor, double PixelRadius)
+{
+	const PickRay Ray = ComputePickRay(View, Cursor);
+	double Distance = 0.0;
+	if (!IntersectEllipsoid(Ray, EllipsoidRadii, Distance))
+	{
+		return -1;
+	}
+	const double PixelAngle = glm::length(ComputePickRay(View, Cursor + glm::dvec2{1.0, 0.0}).Direction - Ray.Direction);
+
+	int BestIndex = -1;
+	double BestDistance = PixelRadius;
+	for (std::size_t MarkerIndex = 0; MarkerIndex < Markers.size(); ++MarkerIndex)
+	{
+		const Marker& Current = Markers[MarkerIndex];
+		const glm::dvec3 Position = GeodeticToECEF(glm::radians(double(Current.Latitude)), glm::radians(double(Current.Longitude)), EllipsoidRadii);
+		if (glm::dot(GeodeticSurfaceNormal(Position, EllipsoidRadii), View.Eye - Position) < 0.0)
+		{
+			continue;
+		}
+		const double Angle = glm::length(glm::normalize(Position - View.Eye) - Ray.Direction);
+		const double EdgeDistance = Angle / PixelAngle - Current.Size * 0.5;
+		if (EdgeDistance < BestDistance || (BestIndex < 0 && EdgeDistance <= BestDistance))
+		{
+			BestDistance = EdgeDistance;
+			BestIndex = static_cast<int>(MarkerIndex);
+		}
+	}
+	return BestIndex;
+}
+
+int main(int argc, char* argv[])
+{
+	const int NumMarkers = argc > 1 ? std::atoi(argv[1]) : DefaultNumMarkers;
+
+	JobSystem::Get().Init();
+
+	// Pontos uniformes na esfera, com tamanhos de marcador variados
+	std::mt19937 Random{42};
+	std::uniform_real_distribution<double> Uniform{0.0, 1.0};
+	std::vector<Marker> Markers(NumMarkers);
+	for (Marker& NewMarker : Markers)
+	{
+		NewMarker.Latitude = static_cast<float>(glm::degrees(std::asin(2.0 * Uniform(Random) - 1.0)));
+		NewMarker.Longitude = static_cast<float>(Uniform(Random) * 360.0 - 180.0);
+		NewMarker.Size = static_cast<float>(4.0 + 12.0 * Uniform(Random));
+		NewMarker.Color = 0xFFFFFFFFu;
+	}
+
+	MarkerPicker Picker;
+	const auto BuildStart = std::chrono::steady_clock::now();
+	Picker.Build(Markers, EllipsoidRadii);
+	const double BuildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - BuildStart).count();
+
+	PrintHeader("Picking com " + std::to_string(NumMarkers) + " marcadores (" + std::to_string(JobSystem::Get().GetNumThreads()) + " threads)");
+	std::cout << "Construcao da k-d tree: " << std::fixed << std::setprecision(1) << BuildSeconds * 1000.0 << " ms" << std::endl;
+	std::cout << std::setw(12) << "altura" << std::setw(12) << "media us" << std::setw(12) << "max us" << std::setw(14) << "lote us/cons"
+		<< std::setw(12) << "no globo" << std::setw(12) << "marcador" << std::setw(12) << "diferencas" << std::endl;
+
+	// Do globo inteiro na tela ate perto da superficie
+	std::uniform_real_distribution<double> CursorX{0.0, ViewportSize.x};
+	std::uniform_real_distribution<double> CursorY{0.0, ViewportSize.y};
+	for (double DistanceInRadii : {3.0, 1.5, 1.1, 1.01})
+	{
+		Camera BenchmarkCamera;
+		BenchmarkCamera.AspectRatio = ViewportSize.x / ViewportSize.y;
+		BenchmarkCamera.Position = glm::dvec3{DistanceInRadii * EllipsoidRadii.x, 0.0, 0.0};
+		BenchmarkCamera.Target = glm::dvec3{0.0};
+		BenchmarkCamera.Up = glm::dvec3{0.0, 0.0, 1.0};
+		BenchmarkCamera.FitClipPlanes((DistanceInRadii - 1.0) * EllipsoidRadii.x, EllipsoidRadii.x);
+		const PickView View = MakePickView(BenchmarkCamera, ViewportSize);
+
+		std::vector<glm::dvec2> Cursors(NumQueries);
+		for (glm::dvec2& Cursor : Cursors)
+		{
+			Cursor = glm::dvec2{CursorX(Random), CursorY(Random)};
+		}
+
+		// Consultas isoladas, como o clique
+		double TotalSeconds = 0.0;
+		double MaxSeconds = 0.0;
+		int NumGlobeHits = 0;
+		int NumMarkerHits = 0;
+		std::vector<PickResult> Results(NumQueries);
+		for (int QueryIndex = 0; QueryIndex < NumQueries; ++QueryIndex)
+		{
+			const auto QueryStart = std::chrono::steady_clock::now();
+			Results[QueryIndex] = Picker.Pick(View, Cursors[QueryIndex], PickRadiusPixels);
+			const double QuerySeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - QueryStart).count();
+			TotalSeconds += QuerySeconds;
+			MaxSeconds = std::max(MaxSeconds, QuerySeconds);
+			NumGlobeHits += Results[QueryIndex].HitGlobe ? 1 : 0;
+			NumMarkerHits += Results[QueryIndex].MarkerIndex >= 0 ? 1 : 0;
+		}
+
+		// As mesmas consultas em lote, como o acompanhamento de varios cursores
+		std::vector<PickResult> BatchResults;
+		const auto BatchStart = std::chrono::steady_clock::now();
+		Picker.PickBatch(View, Cursors, PickRadiusPixels, BatchResults);
+		const double BatchSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - BatchStart).count();
+
+		// Conferir uma amostra contra a forca bruta
+		int NumMismatches = 0;
+		for (int QueryIndex = 0; QueryIndex < NumCheckedQueries; ++QueryIndex)
+		{
+			const int Expected = PickBruteForce(Markers, View, Cursors[QueryIndex], PickRadiusPixels);
+			const PickResult& Result = Results[QueryIndex];
+			NumMismatches += Result.MarkerIndex == Expected && BatchResults[QueryIndex].MarkerIndex == Expected ? 0 : 1;
+		}
+
+		std::cout << std::setw(12) << std::setprecision(2) << DistanceInRadii
+			<< std::setw(12) << std::setprecision(2) << TotalSeconds / NumQueries * 1e6
+			<< std::setw(12) << MaxSeconds * 1e6
+			<< std::setw(14) << BatchSeconds / NumQueries * 1e6
+			<< std::setw(12) << NumGlobeHits
+			<< std::setw(12) << NumMarkerHits
+			<< std::setw(12) << NumMismatches << std::endl;
+	}
+
+	JobSystem::Get().Shutdown();
+
+	return 0;
+}
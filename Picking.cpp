@@ -0,0 +1,216 @@
+#include "Picking.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "GlobeTiles.h"
+#include "JobSystem.h"
+
+// Menor cosseno do angulo de incidencia considerado ao converter pixels em metros.
+// Perto do limbo a superficie fica quase paralela ao raio e um pixel cobre muito chao
+constexpr double MinIncidenceCosine = 0.05;
+
+PickView MakePickView(const Camera& View, const glm::dvec2& ViewportSize)
+{
+	PickView NewView;
+	NewView.InverseViewProjection = glm::inverse(View.GetViewProjectionPrecise());
+	NewView.Eye = View.Position;
+	NewView.ViewportSize = ViewportSize;
+	return NewView;
+}
+
+PickRay ComputePickRay(const PickView& View, const glm::dvec2& Cursor)
+{
+	const glm::dvec2 Ndc{2.0 * Cursor.x / View.ViewportSize.x - 1.0, 1.0 - 2.0 * Cursor.y / View.ViewportSize.y};
+	const glm::dvec4 FarPoint = View.InverseViewProjection * glm::dvec4{Ndc, 1.0, 1.0};
+
+	// A matriz e relativa ao olho: o ponto desprojetado ja e a direcao a partir dele
+	PickRay Ray;
+	Ray.Origin = View.Eye;
+	Ray.Direction = glm::normalize(glm::dvec3{FarPoint} / FarPoint.w);
+	return Ray;
+}
+
+bool IntersectEllipsoid(const PickRay& Ray, const glm::dvec3& Radii, double& Distance)
+{
+	// No espaco escalado pelos raios o elipsoide vira a esfera unitaria
+	const glm::dvec3 Origin = Ray.Origin / Radii;
+	const glm::dvec3 Direction = Ray.Direction / Radii;
+	const double A = glm::dot(Direction, Direction);
+	const double B = 2.0 * glm::dot(Origin, Direction);
+	const double C = glm::dot(Origin, Origin) - 1.0;
+	const double Discriminant = B * B - 4.0 * A * C;
+	if (Discriminant < 0.0 || B >= 0.0)
+	{
+		return false;
+	}
+
+	// Forma estavel das raizes: evita a subtracao de numeros quase iguais quando
+	// a camera esta longe
+	const double Q = -0.5 * (B - std::sqrt(Discriminant));
+	Distance = std::min(Q / A, C / Q);
+	return Distance >= 0.0;
+}
+
+glm::dvec2 SurfaceToGeodetic(const glm::dvec3& Position, const glm::dvec3& Radii)
+{
+	const glm::dvec3 Normal = Position / (Radii * Radii);
+	return glm::degrees(glm::dvec2{std::atan2(Normal.z, std::hypot(Normal.x, Normal.y)), std::atan2(Position.y, Position.x)});
+}
+
+void MarkerPicker::Build(const std::vector<Marker>& Markers, const glm::dvec3& EllipsoidRadii)
+{
+	Radii = EllipsoidRadii;
+	MaxHalfSize = 0.0f;
+
+	Nodes.resize(Markers.size());
+	JobSystem::Get().ParallelFor(0, static_cast<int>(Markers.size()), 4096, [this, &Markers](int SliceBegin, int SliceEnd)
+	{
+		for (int MarkerIndex = SliceBegin; MarkerIndex < SliceEnd; ++MarkerIndex)
+		{
+			const Marker& Source = Markers[MarkerIndex];
+			Node& NewNode = Nodes[MarkerIndex];
+			NewNode.Position = GeodeticToECEF(glm::radians(double(Source.Latitude)), glm::radians(double(Source.Longitude)), Radii);
+			NewNode.HalfSize = Source.Size * 0.5f;
+			NewNode.MarkerIndex = static_cast<std::uint32_t>(MarkerIndex);
+			NewNode.SplitAxis = 0;
+		}
+	});
+	for (const Marker& Source : Markers)
+	{
+		MaxHalfSize = std::max(MaxHalfSize, Source.Size * 0.5f);
+	}
+
+	BuildRange(0, Nodes.size());
+}
+
+void MarkerPicker::BuildRange(std::size_t Begin, std::size_t End)
+{
+	if (End - Begin <= 1)
+	{
+		return;
+	}
+
+	// Divide no eixo de maior extensao, pela mediana
+	glm::dvec3 Min{Nodes[Begin].Position};
+	glm::dvec3 Max{Nodes[Begin].Position};
+	for (std::size_t NodeIndex = Begin + 1; NodeIndex < End; ++NodeIndex)
+	{
+		Min = glm::min(Min, Nodes[NodeIndex].Position);
+		Max = glm::max(Max, Nodes[NodeIndex].Position);
+	}
+	const glm::dvec3 Extent = Max - Min;
+	const int Axis = Extent.x >= Extent.y && Extent.x >= Extent.z ? 0 : Extent.y >= Extent.z ? 1 : 2;
+
+	const std::size_t Middle = Begin + (End - Begin) / 2;
+	std::nth_element(Nodes.begin() + Begin, Nodes.begin() + Middle, Nodes.begin() + End, [Axis](const Node& First, const Node& Second)
+	{
+		return First.Position[Axis] < Second.Position[Axis];
+	});
+	Nodes[Middle].SplitAxis = static_cast<std::uint8_t>(Axis);
+
+	// As duas metades nao se tocam; as grandes vao para outras threads
+	if (End - Begin > 65536)
+	{
+		JobCounter Counter;
+		JobSystem::Get().Run(Counter, [this, Begin, Middle] { BuildRange(Begin, Middle); });
+		BuildRange(Middle + 1, End);
+		JobSystem::Get().Wait(Counter);
+	}
+	else
+	{
+		BuildRange(Begin, Middle);
+		BuildRange(Middle + 1, End);
+	}
+}
+
+PickResult MarkerPicker::Pick(const PickView& View, const glm::dvec2& Cursor, double PixelRadius) const
+{
+	PickResult Result;
+	const PickRay Ray = ComputePickRay(View, Cursor);
+	double Distance = 0.0;
+	if (!IntersectEllipsoid(Ray, Radii, Distance))
+	{
+		return Result;
+	}
+
+	Result.HitGlobe = true;
+	Result.Position = Ray.Origin + Ray.Direction * Distance;
+	const glm::dvec2 LatLon = SurfaceToGeodetic(Result.Position, Radii);
+	Result.Latitude = LatLon.x;
+	Result.Longitude = LatLon.y;
+	if (Nodes.empty())
+	{
+		return Result;
+	}
+
+	// Angulo coberto por um pixel ao redor do cursor e metros no chao por pixel,
+	// alongados pela inclinacao da superficie
+	const double PixelAngle = glm::length(ComputePickRay(View, Cursor + glm::dvec2{1.0, 0.0}).Direction - Ray.Direction);
+	const double IncidenceCosine = std::max(std::abs(glm::dot(GeodeticSurfaceNormal(Result.Position, Radii), Ray.Direction)), MinIncidenceCosine);
+	const double MetersPerPixel = PixelAngle * Distance / IncidenceCosine;
+
+	// Busca na k-d tree com pilha explicita, subarvore mais proxima primeiro. O
+	// criterio e a distancia em pixels do cursor a borda do marcador como ele aparece
+	// na tela (negativa dentro dele, para o centro mais proximo ganhar); a cada
+	// marcador melhor o raio de busca encolhe
+	double BestDistance = PixelRadius;
+	double SearchRadius = (BestDistance + MaxHalfSize) * MetersPerPixel;
+	std::pair<std::size_t, std::size_t> Stack[64];
+	int StackSize = 0;
+	Stack[StackSize++] = {0, Nodes.size()};
+	while (StackSize > 0)
+	{
+		const auto [Begin, End] = Stack[--StackSize];
+		if (Begin >= End)
+		{
+			continue;
+		}
+
+		const std::size_t Middle = Begin + (End - Begin) / 2;
+		const Node& Current = Nodes[Middle];
+		const glm::dvec3 Offset = Result.Position - Current.Position;
+		if (glm::dot(Offset, Offset) <= SearchRadius * SearchRadius)
+		{
+			const double Angle = glm::length(glm::normalize(Current.Position - View.Eye) - Ray.Direction);
+			const double EdgeDistance = Angle / PixelAngle - Current.HalfSize;
+			if (EdgeDistance <= BestDistance && (Result.MarkerIndex < 0 || EdgeDistance < BestDistance) &&
+				glm::dot(GeodeticSurfaceNormal(Current.Position, Radii), View.Eye - Current.Position) >= 0.0)
+			{
+				BestDistance = EdgeDistance;
+				SearchRadius = std::max(BestDistance + MaxHalfSize, 0.0) * MetersPerPixel;
+				Result.MarkerIndex = static_cast<int>(Current.MarkerIndex);
+				Result.MarkerDistance = std::max(EdgeDistance, 0.0);
+			}
+		}
+
+		if (End - Begin == 1)
+		{
+			continue;
+		}
+		const double SplitDistance = Offset[Current.SplitAxis];
+		const std::pair<std::size_t, std::size_t> Left{Begin, Middle};
+		const std::pair<std::size_t, std::size_t> Right{Middle + 1, End};
+		const bool QueryOnLeft = SplitDistance < 0.0;
+		if (SplitDistance * SplitDistance <= SearchRadius * SearchRadius)
+		{
+			Stack[StackSize++] = QueryOnLeft ? Right : Left;
+		}
+		Stack[StackSize++] = QueryOnLeft ? Left : Right;
+	}
+
+	return Result;
+}
+
+void MarkerPicker::PickBatch(const PickView& View, const std::vector<glm::dvec2>& Cursors, double PixelRadius, std::vector<PickResult>& Results) const
+{
+	Results.resize(Cursors.size());
+	JobSystem::Get().ParallelFor(0, static_cast<int>(Cursors.size()), 64, [this, &View, &Cursors, PixelRadius, &Results](int SliceBegin, int SliceEnd)
+	{
+		for (int CursorIndex = SliceBegin; CursorIndex < SliceEnd; ++CursorIndex)
+		{
+			Results[CursorIndex] = Pick(View, Cursors[CursorIndex], PixelRadius);
+		}
+	});
+}
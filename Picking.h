@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Camera.h"
+#include "MarkerLayer.h"
+
+// Raio em coordenadas ECEF (metros), com Direction normalizada
+struct PickRay
+{
+	glm::dvec3 Origin{0.0};
+	glm::dvec3 Direction{0.0, 0.0, 1.0};
+};
+
+// Estado da camera usado pelas consultas, com a inversa da ViewProjection relativa
+// ao olho ja calculada. O cursor e medido em pixels a partir do canto superior
+// esquerdo, como no GLFW
+struct PickView
+{
+	glm::dmat4 InverseViewProjection{1.0};
+	glm::dvec3 Eye{0.0};
+	glm::dvec2 ViewportSize{1.0};
+};
+
+PickView MakePickView(const Camera& View, const glm::dvec2& ViewportSize);
+
+struct PickResult
+{
+	bool HitGlobe = false;
+	glm::dvec3 Position{0.0};       // Ponto do elipsoide sob o cursor (ECEF)
+	double Latitude = 0.0;          // Graus
+	double Longitude = 0.0;
+	int MarkerIndex = -1;           // Marcador sob o cursor, -1 se nenhum
+	double MarkerDistance = 0.0;    // Distancia do cursor a borda do marcador, em pixels
+};
+
+// Desprojeta o cursor pela inversa da ViewProjection
+PickRay ComputePickRay(const PickView& View, const glm::dvec2& Cursor);
+
+// Distancia ate a primeira interseccao do raio com o elipsoide; falso se o raio nao
+// o atinge. A origem deve estar fora do elipsoide
+bool IntersectEllipsoid(const PickRay& Ray, const glm::dvec3& Radii, double& Distance);
+
+// Latitude e longitude geodesicas (graus) de um ponto sobre a superficie do elipsoide
+glm::dvec2 SurfaceToGeodetic(const glm::dvec3& Position, const glm::dvec3& Radii);
+
+// Selecao de pontos do globo e de marcadores pelo cursor. Os marcadores ficam em
+// uma k-d tree das posicoes ECEF; a consulta intersecta o raio do cursor com o
+// elipsoide em double e procura os marcadores perto do ponto atingido, com o raio
+// de busca convertido de pixels para metros naquela distancia. Nao usa OpenGL e as
+// consultas sao somente leitura, entao podem rodar em paralelo
+class MarkerPicker
+{
+public:
+	// Reconstroi a arvore. Chamar de novo quando os marcadores mudarem de lugar
+	void Build(const std::vector<Marker>& Markers, const glm::dvec3& EllipsoidRadii);
+
+	// PixelRadius e a tolerancia em volta da borda de cada marcador
+	PickResult Pick(const PickView& View, const glm::dvec2& Cursor, double PixelRadius) const;
+
+	// Varias consultas de uma vez, distribuidas entre as threads do JobSystem
+	void PickBatch(const PickView& View, const std::vector<glm::dvec2>& Cursors, double PixelRadius, std::vector<PickResult>& Results) const;
+
+	std::size_t GetCount() const { return Nodes.size(); }
+
+private:
+	// Os nos ficam na ordem da arvore implicita: a mediana de [Begin, End) e o no
+	// e as metades a esquerda e a direita sao as subarvores
+	struct Node
+	{
+		glm::dvec3 Position;
+		float HalfSize;             // Raio do marcador desenhado, em pixels
+		std::uint32_t MarkerIndex;
+		std::uint8_t SplitAxis;
+	};
+
+	void BuildRange(std::size_t Begin, std::size_t End);
+
+	glm::dvec3 Radii{1.0};
+	std::vector<Node> Nodes;
+	float MaxHalfSize = 0.0f;
+};
@@ -0,0 +1,194 @@
+#include "PolylineLayer.h"
+
+#include <algorithm>
+
+#include "GeoData.h"
+#include "GlobeTiles.h"
+#include "JobSystem.h"
+
+const std::array<double, PolylineLayer::NumLevels> PolylineLayer::LevelTolerances = {16000.0, 4000.0, 1000.0, 250.0, 60.0, 0.0};
+
+void PolylineLayer::Init(const glm::dvec3& EllipsoidRadii)
+{
+	Radii = EllipsoidRadii;
+
+	glGenVertexArrays(1, &VertexArray);
+	glGenBuffers(1, &PointBuffer);
+	glGenBuffers(1, &CommandBuffer);
+
+	// Cada instancia e um segmento: os atributos 0-3 leem quatro pontos seguidos do
+	// mesmo buffer (anterior, inicio, fim, seguinte), deslocados de um ponto por instancia
+	glBindVertexArray(VertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, PointBuffer);
+	for (GLuint Attribute = 0; Attribute < 4; ++Attribute)
+	{
+		glEnableVertexAttribArray(Attribute);
+		glVertexAttribPointer(Attribute, 2, GL_FLOAT, GL_FALSE, sizeof(PolylinePoint), reinterpret_cast<void*>(Attribute * sizeof(PolylinePoint) + offsetof(PolylinePoint, Latitude)));
+		glVertexAttribDivisor(Attribute, 1);
+	}
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(PolylinePoint), reinterpret_cast<void*>(sizeof(PolylinePoint) + offsetof(PolylinePoint, Color)));
+	glVertexAttribDivisor(4, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void PolylineLayer::Destroy()
+{
+	glDeleteBuffers(1, &PointBuffer);
+	glDeleteBuffers(1, &CommandBuffer);
+	glDeleteVertexArrays(1, &VertexArray);
+	PointBuffer = 0;
+	CommandBuffer = 0;
+	VertexArray = 0;
+	SourcePoints.clear();
+	SourceErrors.clear();
+	Polylines.clear();
+}
+
+void PolylineLayer::Add(const std::vector<glm::dvec2>& LatLon, std::uint32_t Color, const float* Errors)
+{
+	if (LatLon.size() < 2)
+	{
+		return;
+	}
+
+	Polyline NewPolyline;
+	NewPolyline.FirstPoint = SourcePoints.size();
+	NewPolyline.NumPoints = LatLon.size();
+	NewPolyline.Color = Color;
+	NewPolyline.IsClosed = LatLon.size() > 3 && LatLon.front() == LatLon.back();
+	NewPolyline.HasErrors = Errors != nullptr;
+	Polylines.push_back(NewPolyline);
+
+	SourcePoints.insert(SourcePoints.end(), LatLon.begin(), LatLon.end());
+	if (Errors)
+	{
+		SourceErrors.insert(SourceErrors.end(), Errors, Errors + LatLon.size());
+	}
+	else
+	{
+		SourceErrors.resize(SourcePoints.size(), 0.0f);
+	}
+}
+
+void PolylineLayer::Build()
+{
+	// Os dados vetoriais ja trazem os erros do Douglas-Peucker; o resto (a grade de
+	// coordenadas) e calculado aqui, em paralelo por polilinha
+	JobSystem::Get().ParallelFor(0, static_cast<int>(Polylines.size()), 16, [this](int SliceBegin, int SliceEnd)
+	{
+		std::vector<glm::dvec3> Positions;
+		for (int PolylineIndex = SliceBegin; PolylineIndex < SliceEnd; ++PolylineIndex)
+		{
+			Polyline& Line = Polylines[PolylineIndex];
+			if (Line.HasErrors)
+			{
+				continue;
+			}
+			Positions.clear();
+			for (std::size_t PointIndex = 0; PointIndex < Line.NumPoints; ++PointIndex)
+			{
+				const glm::dvec2& LatLon = SourcePoints[Line.FirstPoint + PointIndex];
+				Positions.push_back(GeodeticToECEF(glm::radians(LatLon.x), glm::radians(LatLon.y), Radii));
+			}
+			const std::vector<float> LineErrors = ComputeSimplificationErrors(Positions);
+			std::copy(LineErrors.begin(), LineErrors.end(), SourceErrors.begin() + Line.FirstPoint);
+			Line.HasErrors = true;
+		}
+	});
+
+	CurrentStats = Stats{};
+	CurrentStats.NumPolylines = static_cast<int>(Polylines.size());
+	CurrentStats.NumPoints = static_cast<int>(SourcePoints.size());
+
+	// Todos os niveis no mesmo buffer. Cada polilinha ganha um ponto extra em cada
+	// ponta para a primeira e a ultima instancia terem vizinhos: o proprio ponto
+	// (ponta reta) ou, em aneis fechados, o ponto do outro lado do fechamento
+	std::vector<PolylinePoint> Points;
+	std::vector<DrawCommand> Commands;
+	std::vector<std::size_t> Kept;
+	for (int Level = 0; Level < NumLevels; ++Level)
+	{
+		FirstCommand[Level] = Commands.size();
+		for (const Polyline& Line : Polylines)
+		{
+			Kept.clear();
+			for (std::size_t PointIndex = 0; PointIndex < Line.NumPoints; ++PointIndex)
+			{
+				if (SourceErrors[Line.FirstPoint + PointIndex] >= LevelTolerances[Level])
+				{
+					Kept.push_back(Line.FirstPoint + PointIndex);
+				}
+			}
+			if (Kept.size() < (Line.IsClosed ? 4u : 2u))
+			{
+				continue;
+			}
+
+			auto AddPoint = [this, &Points, &Line](std::size_t SourceIndex)
+			{
+				const glm::dvec2& LatLon = SourcePoints[SourceIndex];
+				Points.push_back(PolylinePoint{static_cast<float>(LatLon.x), static_cast<float>(LatLon.y), Line.Color});
+			};
+
+			const GLuint BaseInstance = static_cast<GLuint>(Points.size());
+			AddPoint(Line.IsClosed ? Kept[Kept.size() - 2] : Kept.front());
+			for (std::size_t SourceIndex : Kept)
+			{
+				AddPoint(SourceIndex);
+			}
+			AddPoint(Line.IsClosed ? Kept[1] : Kept.back());
+
+			const GLuint NumSegments = static_cast<GLuint>(Kept.size() - 1);
+			Commands.push_back(DrawCommand{4, NumSegments, 0, BaseInstance});
+			CurrentStats.NumSegments[Level] += NumSegments;
+		}
+		NumCommands[Level] = Commands.size() - FirstCommand[Level];
+	}
+
+	// A ultima instancia le tres pontos depois do seu inicio; sobra folga no fim do buffer
+	Points.resize(Points.size() + 3, PolylinePoint{0.0f, 0.0f, 0u});
+
+	glBindBuffer(GL_ARRAY_BUFFER, PointBuffer);
+	glBufferData(GL_ARRAY_BUFFER, Points.size() * sizeof(PolylinePoint), Points.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, CommandBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, Commands.size() * sizeof(DrawCommand), Commands.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+int PolylineLayer::SelectLevel(double MaxErrorMeters) const
+{
+	for (int Level = 0; Level < NumLevels; ++Level)
+	{
+		if (LevelTolerances[Level] <= MaxErrorMeters)
+		{
+			return Level;
+		}
+	}
+	return NumLevels - 1;
+}
+
+void PolylineLayer::Draw(GLuint ProgramId, int Level, float LineWidth)
+{
+	if (NumCommands[Level] == 0)
+	{
+		return;
+	}
+
+	glUseProgram(ProgramId);
+	glUniform1f(glGetUniformLocation(ProgramId, "LineWidth"), LineWidth);
+
+	glBindVertexArray(VertexArray);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, CommandBuffer);
+
+	// Todas as polilinhas do nivel em um unico draw call
+	glMultiDrawArraysIndirect(GL_TRIANGLE_STRIP, reinterpret_cast<const void*>(FirstCommand[Level] * sizeof(DrawCommand)), static_cast<GLsizei>(NumCommands[Level]), 0);
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindVertexArray(0);
+	glUseProgram(0);
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Um vertice de polilinha, exatamente como fica no buffer da GPU
+struct PolylinePoint
+{
+	float Latitude;         // Graus
+	float Longitude;        // Graus
+	std::uint32_t Color;    // RGBA8 da polilinha, R no byte menos significativo
+};
+
+// Camada de linhas sobre o globo (costas, fronteiras, grade de coordenadas). Cada
+// segmento e uma instancia que le do mesmo buffer os pontos anterior, inicial,
+// final e seguinte; o vertex shader projeta os quatro e extruda o segmento na tela
+// com a largura em pixels e juncoes em miter. As polilinhas sao simplificadas de
+// antemao em NumLevels niveis e cada nivel e desenhado com um unico
+// glMultiDrawArraysIndirect (um comando por polilinha). Os erros de simplificacao
+// vem prontos do arquivo de dados vetoriais; so as polilinhas sem eles (a grade de
+// coordenadas) passam pelo Douglas-Peucker em Build
+class PolylineLayer
+{
+public:
+	static constexpr int NumLevels = 6;
+
+	// Tolerancia de cada nivel em metros, do mais grosseiro ao completo
+	static const std::array<double, NumLevels> LevelTolerances;
+
+	struct Stats
+	{
+		int NumPolylines = 0;
+		int NumPoints = 0;
+		std::array<int, NumLevels> NumSegments{};
+	};
+
+	void Init(const glm::dvec3& EllipsoidRadii);
+	void Destroy();
+
+	// Latitude e longitude em graus. Se o ultimo ponto repetir o primeiro o anel e
+	// fechado e a juncao do fechamento tambem recebe miter. Errors, se houver, tem um
+	// erro de simplificacao por ponto (GeoDataFile::GetSimplificationErrors)
+	void Add(const std::vector<glm::dvec2>& LatLon, std::uint32_t Color, const float* Errors = nullptr);
+
+	// Simplifica as polilinhas que ainda nao tem erros e envia os niveis para a GPU
+	void Build();
+
+	// Nivel mais grosseiro cuja tolerancia nao passa de MaxErrorMeters
+	int SelectLevel(double MaxErrorMeters) const;
+
+	// Os blocos FrameBlock e ObjectBlock ja devem estar ligados (ver UniformBuffers.h)
+	void Draw(GLuint ProgramId, int Level, float LineWidth);
+
+	Stats GetStats() const { return CurrentStats; }
+
+private:
+	// Comando de glMultiDrawArraysIndirect
+	struct DrawCommand
+	{
+		GLuint Count;
+		GLuint InstanceCount;
+		GLuint First;
+		GLuint BaseInstance;
+	};
+
+	struct Polyline
+	{
+		std::size_t FirstPoint = 0;
+		std::size_t NumPoints = 0;
+		std::uint32_t Color = 0;
+		bool IsClosed = false;
+		bool HasErrors = false;
+	};
+
+	glm::dvec3 Radii{1.0};
+
+	std::vector<glm::dvec2> SourcePoints;
+	std::vector<float> SourceErrors;
+	std::vector<Polyline> Polylines;
+
+	GLuint VertexArray = 0;
+	GLuint PointBuffer = 0;
+	GLuint CommandBuffer = 0;
+	std::array<std::size_t, NumLevels> FirstCommand{};
+	std::array<std::size_t, NumLevels> NumCommands{};
+
+	Stats CurrentStats;
+};
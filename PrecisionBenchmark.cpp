@@ -0,0 +1,145 @@
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "JobSystem.h"
+#include "GlobeTiles.h"
+#include "Camera.h"
+
+// Raios do elipsoide WGS84 em metros
+const glm::dvec3 EllipsoidRadii{6378137.0, 6378137.0, 6356752.314245};
+
+// Mesmos tiles do programa (GlobeTileLevel e GlobeTileResolution em main.cpp)
+const int GlobeTileLevel = 3;
+const int GlobeTileResolution = 16;
+
+const glm::dvec2 ViewportSize{1920.0, 1080.0};
+const int NumVertices = 64;
+const int NumEyes = 256;
+
+// Deslocamento maximo do olho entre as amostras, em metros: um passo pequeno de
+// camera, do tamanho do que a animacao move em um frame perto do chao
+const double EyeStepMeters = 0.01;
+
+// Acima disto em qualquer altitude o caminho do globo e considerado regressao
+const double MaxJitterPixels = 0.05;
+
+void PrintHeader(const std::string& Title)
+{
+	std::cout << std::endl;
+	std::cout << "==================" << std::endl;
+	std::cout << Title << std::endl;
+	std::cout << "==================" << std::endl;
+}
+
+// Formas de levar um vertice para o espaco relativo ao olho em float
+enum class EyeRelativeMethod
+{
+	Direct,         // float(Vertice) - float(Olho)
+	TileCenter,     // Centro do tile relativo ao olho (double) + offset do vertice no tile
+	HighLow,        // globe_vert.glsl: partes altas e baixas subtraidas separadamente
+};
+
+// A mesma aritmetica em float que a GPU faria para cada metodo
+glm::vec3 ComputeEyeOffset(EyeRelativeMethod Method, const glm::dvec3& Vertex, const glm::vec3& VertexHigh, const glm::vec3& VertexLow, const glm::dvec3& TileCenter, const glm::dvec3& Eye)
+{
+	switch (Method)
+	{
+	case EyeRelativeMethod::Direct:
+		return glm::vec3{Vertex} - glm::vec3{Eye};
+	case EyeRelativeMethod::TileCenter:
+		return glm::vec3{TileCenter - Eye} + glm::vec3{Vertex - TileCenter};
+	case EyeRelativeMethod::HighLow:
+	default:
+		{
+			glm::vec3 EyeHigh;
+			glm::vec3 EyeLow;
+			SplitDouble(Eye, EyeHigh, EyeLow);
+			const glm::vec3 HighDifference = VertexHigh - EyeHigh;
+			const glm::vec3 LowDifference = VertexLow - EyeLow;
+			return HighDifference + LowDifference;
+		}
+	}
+}
+
+glm::dvec2 ToPixels(const glm::dvec4& Clip)
+{
+	return (glm::dvec2{Clip} / Clip.w * 0.5 + 0.5) * ViewportSize;
+}
+
+int main()
+{
+	JobSystem::Get().Init();
+
+	const std::vector<GlobeTile> Tiles = BuildGlobeTiles(GlobeTileLevel, GlobeTileResolution, EllipsoidRadii);
+
+	// Vertices fixos espalhados pelos tiles
+	std::mt19937 Random{42};
+	std::uniform_int_distribution<std::size_t> PickTile{0, Tiles.size() - 1};
+	std::uniform_int_distribution<std::size_t> PickVertex{0, Tiles[0].Vertices.size() - 1};
+	std::uniform_real_distribution<double> EyeStep{-EyeStepMeters, EyeStepMeters};
+	std::vector<std::pair<std::size_t, std::size_t>> Samples(NumVertices);
+	for (auto& [TileIndex, VertexIndex] : Samples)
+	{
+		TileIndex = PickTile(Random);
+		VertexIndex = PickVertex(Random);
+	}
+
+	PrintHeader("Jitter na tela de vertices do globo com o olho deslocado ate " + std::to_string(int(EyeStepMeters * 1000.0)) + " mm");
+	std::cout << std::setw(12) << "altitude m" << std::setw(16) << "direto px" << std::setw(16) << "centro tile px" << std::setw(16) << "alto/baixo px" << std::endl;
+
+	const EyeRelativeMethod Methods[] = {EyeRelativeMethod::Direct, EyeRelativeMethod::TileCenter, EyeRelativeMethod::HighLow};
+	bool Passed = true;
+	for (double Altitude : {1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0})
+	{
+		double MaxJitter[3] = {0.0, 0.0, 0.0};
+		for (const auto& [TileIndex, VertexIndex] : Samples)
+		{
+			const GlobeTile& Tile = Tiles[TileIndex];
+			const TileVertex& Stored = Tile.Vertices[VertexIndex];
+			const glm::dvec3 Vertex = glm::dvec3{Stored.Position} + glm::dvec3{Stored.PositionLow};
+
+			// Olho a Altitude metros acima, afastado o mesmo tanto, olhando para o vertice a 45 graus
+			const glm::dvec3 Normal = GeodeticSurfaceNormal(Vertex, EllipsoidRadii);
+			const glm::dvec3 Axis = std::abs(Normal.z) < 0.9 ? glm::dvec3{0.0, 0.0, 1.0} : glm::dvec3{1.0, 0.0, 0.0};
+			const glm::dvec3 Tangent = glm::normalize(glm::cross(Normal, Axis));
+			const glm::dvec3 BaseEye = Vertex + (Normal + Tangent) * Altitude;
+
+			for (int EyeIndex = 0; EyeIndex < NumEyes; ++EyeIndex)
+			{
+				Camera View;
+				View.AspectRatio = ViewportSize.x / ViewportSize.y;
+				View.Position = BaseEye + glm::dvec3{EyeStep(Random), EyeStep(Random), EyeStep(Random)};
+				View.Target = Vertex;
+				View.Up = Normal;
+				View.FitClipPlanes(Altitude, EllipsoidRadii.x);
+
+				// Referencia: tudo em double
+				const glm::dvec2 Expected = ToPixels(View.GetViewProjectionPrecise() * glm::dvec4{Vertex - View.Position, 1.0});
+				const glm::mat4 ViewProjection = View.GetViewProjection();
+				for (int MethodIndex = 0; MethodIndex < 3; ++MethodIndex)
+				{
+					const glm::vec3 EyeOffset = ComputeEyeOffset(Methods[MethodIndex], Vertex, Stored.Position, Stored.PositionLow, Tile.Center, View.Position);
+					const glm::dvec2 Projected = ToPixels(glm::dvec4{ViewProjection * glm::vec4{EyeOffset, 1.0f}});
+					MaxJitter[MethodIndex] = std::max(MaxJitter[MethodIndex], glm::length(Projected - Expected));
+				}
+			}
+		}
+
+		Passed = Passed && MaxJitter[2] <= MaxJitterPixels;
+		std::cout << std::setw(12) << std::fixed << std::setprecision(0) << Altitude << std::setprecision(4)
+			<< std::setw(16) << MaxJitter[0] << std::setw(16) << MaxJitter[1] << std::setw(16) << MaxJitter[2] << std::endl;
+	}
+
+	std::cout << std::endl << (Passed ? "OK" : "FALHOU") << ": jitter maximo aceito " << MaxJitterPixels << " px no caminho alto/baixo" << std::endl;
+
+	JobSystem::Get().Shutdown();
+
+	return Passed ? 0 : 1;
+}
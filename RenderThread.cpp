@@ -0,0 +1,179 @@
+#include "RenderThread.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include <GLFW/glfw3.h>
+
+namespace
+{
+	// Tamanho minimo de cada bloco do buffer de comandos
+	constexpr std::size_t CommandBlockSize = 64 * 1024;
+}
+
+RenderCommandBuffer::~RenderCommandBuffer()
+{
+	Reset();
+}
+
+void* RenderCommandBuffer::AllocateBytes(std::size_t Size, std::size_t Alignment)
+{
+	while (CurrentBlock < Blocks.size())
+	{
+		Block& Current = Blocks[CurrentBlock];
+		const std::uintptr_t Base = reinterpret_cast<std::uintptr_t>(Current.Data.get());
+		const std::uintptr_t Address = (Base + Current.Used + Alignment - 1) & ~(std::uintptr_t(Alignment) - 1);
+		const std::size_t End = static_cast<std::size_t>(Address - Base) + Size;
+		if (End <= Current.Size)
+		{
+			Current.Used = End;
+			return reinterpret_cast<void*>(Address);
+		}
+
+		// Nao coube: segue para o proximo bloco ja alocado ou cria um novo
+		++CurrentBlock;
+	}
+
+	Block NewBlock;
+	NewBlock.Size = std::max(CommandBlockSize, Size + Alignment);
+	NewBlock.Data.reset(new unsigned char[NewBlock.Size]);
+	Blocks.push_back(std::move(NewBlock));
+	CurrentBlock = Blocks.size() - 1;
+	return AllocateBytes(Size, Alignment);
+}
+
+void RenderCommandBuffer::Execute()
+{
+	for (CommandHeader* Command = FirstCommand; Command; Command = Command->Next)
+	{
+		// Depois de Execute o objeto ja foi destruido; so o cabecalho e lido em seguida
+		Command->Execute(Command->Payload);
+	}
+	FirstCommand = nullptr;
+	LastCommand = nullptr;
+	Reset();
+}
+
+void RenderCommandBuffer::Reset()
+{
+	for (CommandHeader* Command = FirstCommand; Command; Command = Command->Next)
+	{
+		Command->Discard(Command->Payload);
+	}
+	FirstCommand = nullptr;
+	LastCommand = nullptr;
+
+	for (Block& Current : Blocks)
+	{
+		Current.Used = 0;
+	}
+	CurrentBlock = 0;
+}
+
+std::size_t RenderCommandBuffer::GetUsedBytes() const
+{
+	std::size_t UsedBytes = 0;
+	for (const Block& Current : Blocks)
+	{
+		UsedBytes += Current.Used;
+	}
+	return UsedBytes;
+}
+
+void RenderThread::Start(GLFWwindow* NewWindow)
+{
+	Window = NewWindow;
+	StopRequested = false;
+
+	// Um contexto so pode estar corrente em uma thread por vez
+	glfwMakeContextCurrent(nullptr);
+	Thread = std::thread{&RenderThread::Run, this};
+}
+
+void RenderThread::Stop()
+{
+	if (!Thread.joinable())
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock{WakeMutex};
+		StopRequested = true;
+	}
+	WakeRenderThread.notify_one();
+	Thread.join();
+
+	// Comandos gravados depois do ultimo Submit nao sao mais executados
+	GetCommandBuffer().Reset();
+
+	glfwMakeContextCurrent(Window);
+}
+
+void RenderThread::Submit()
+{
+	const std::uint64_t Frame = SubmittedFrame.load(std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> Lock{WakeMutex};
+		SubmittedFrame.store(Frame + 1, std::memory_order_release);
+	}
+	WakeRenderThread.notify_one();
+
+	// O proximo buffer a ser gravado e o do frame anterior a este
+	const auto WaitStart = std::chrono::steady_clock::now();
+	WaitForCompleted(Frame);
+	LastSubmitWait = std::chrono::duration<double>(std::chrono::steady_clock::now() - WaitStart).count();
+}
+
+void RenderThread::WaitIdle()
+{
+	WaitForCompleted(SubmittedFrame.load(std::memory_order_relaxed));
+}
+
+void RenderThread::WaitForCompleted(std::uint64_t Frame)
+{
+	if (CompletedFrame.load(std::memory_order_acquire) >= Frame)
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> Lock{WakeMutex};
+	WakeMainThread.wait(Lock, [this, Frame]
+	{
+		return CompletedFrame.load(std::memory_order_acquire) >= Frame;
+	});
+}
+
+void RenderThread::Run()
+{
+	glfwMakeContextCurrent(Window);
+
+	while (true)
+	{
+		const std::uint64_t Frame = CompletedFrame.load(std::memory_order_relaxed);
+		if (SubmittedFrame.load(std::memory_order_acquire) == Frame)
+		{
+			// Nada pendente: dorme ate o proximo Submit. Pedidos de parada so sao
+			// atendidos com a fila vazia para nao perder frames ja enviados
+			std::unique_lock<std::mutex> Lock{WakeMutex};
+			WakeRenderThread.wait(Lock, [this, Frame]
+			{
+				return StopRequested || SubmittedFrame.load(std::memory_order_acquire) != Frame;
+			});
+			if (SubmittedFrame.load(std::memory_order_acquire) == Frame)
+			{
+				break;
+			}
+		}
+
+		Buffers[Frame % 2].Execute();
+
+		{
+			std::lock_guard<std::mutex> Lock{WakeMutex};
+			CompletedFrame.store(Frame + 1, std::memory_order_release);
+		}
+		WakeMainThread.notify_one();
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
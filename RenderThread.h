@@ -0,0 +1,151 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+struct GLFWwindow;
+
+// Sequencia de comandos de um frame gravada pela thread principal e executada
+// pela thread de renderizacao. Cada comando e uma funcao guardada no proprio
+// buffer (cabecalho + objeto), sem alocacao por comando; os blocos de memoria
+// sao reaproveitados de um frame para o outro
+class RenderCommandBuffer
+{
+public:
+	RenderCommandBuffer() = default;
+	RenderCommandBuffer(const RenderCommandBuffer&) = delete;
+	RenderCommandBuffer& operator=(const RenderCommandBuffer&) = delete;
+	~RenderCommandBuffer();
+
+	// Grava um comando. Tudo o que a funcao capturar por referencia precisa
+	// continuar vivo ate a thread de renderizacao executar o frame
+	template <typename FuncType>
+	void Push(FuncType&& Func)
+	{
+		using CommandType = typename std::decay<FuncType>::type;
+
+		// Espaco extra para alinhar o objeto logo depois do cabecalho
+		void* Memory = AllocateBytes(sizeof(CommandHeader) + alignof(CommandType) + sizeof(CommandType), alignof(CommandHeader));
+		CommandHeader* Header = static_cast<CommandHeader*>(Memory);
+		Header->Execute = [](void* Payload)
+		{
+			CommandType* Command = static_cast<CommandType*>(Payload);
+			(*Command)();
+			Command->~CommandType();
+		};
+		Header->Discard = [](void* Payload)
+		{
+			static_cast<CommandType*>(Payload)->~CommandType();
+		};
+		Header->Next = nullptr;
+
+		const std::uintptr_t Address = reinterpret_cast<std::uintptr_t>(Header + 1);
+		Header->Payload = reinterpret_cast<void*>((Address + alignof(CommandType) - 1) & ~(std::uintptr_t(alignof(CommandType)) - 1));
+		new (Header->Payload) CommandType(std::forward<FuncType>(Func));
+
+		if (LastCommand)
+		{
+			LastCommand->Next = Header;
+		}
+		else
+		{
+			FirstCommand = Header;
+		}
+		LastCommand = Header;
+	}
+
+	// Copia dados do frame (tiles visiveis, matrizes...) para dentro do buffer.
+	// O ponteiro vale ate o frame ser executado
+	template <typename T>
+	T* Allocate(std::size_t Count)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Somente dados simples podem ir no buffer de comandos");
+		return static_cast<T*>(AllocateBytes(sizeof(T) * Count, alignof(T)));
+	}
+
+	// Executa os comandos na ordem em que foram gravados e esvazia o buffer
+	void Execute();
+
+	// Descarta os comandos sem executa-los
+	void Reset();
+
+	std::size_t GetUsedBytes() const;
+
+private:
+	struct CommandHeader
+	{
+		void (*Execute)(void*);
+		void (*Discard)(void*);
+		CommandHeader* Next;
+		void* Payload;
+	};
+
+	struct Block
+	{
+		std::unique_ptr<unsigned char[]> Data;
+		std::size_t Size = 0;
+		std::size_t Used = 0;
+	};
+
+	void* AllocateBytes(std::size_t Size, std::size_t Alignment);
+
+	std::vector<Block> Blocks;
+	std::size_t CurrentBlock = 0;
+	CommandHeader* FirstCommand = nullptr;
+	CommandHeader* LastCommand = nullptr;
+};
+
+// Thread dona do contexto OpenGL. A thread principal grava o frame N+1 em um
+// buffer enquanto a de renderizacao executa o frame N do outro; a troca entre os
+// dois e feita so com contadores atomicos de frames enviados e concluidos
+class RenderThread
+{
+public:
+	// Libera o contexto da janela na thread atual e o torna corrente na nova thread
+	void Start(GLFWwindow* Window);
+
+	// Executa o que estiver pendente, encerra a thread e devolve o contexto para a thread atual
+	void Stop();
+
+	// Buffer que a thread principal deve gravar neste frame
+	RenderCommandBuffer& GetCommandBuffer() { return Buffers[SubmittedFrame.load(std::memory_order_relaxed) % 2]; }
+
+	// Envia o buffer gravado. Espera a thread de renderizacao terminar o frame
+	// anterior, que usa o buffer a ser gravado em seguida
+	void Submit();
+
+	// Espera a thread de renderizacao terminar todos os frames enviados
+	void WaitIdle();
+
+	// Tempo que a thread principal ficou parada em Submit no ultimo frame, em segundos
+	double GetLastSubmitWait() const { return LastSubmitWait; }
+
+private:
+	void Run();
+	void WaitForCompleted(std::uint64_t Frame);
+
+	GLFWwindow* Window = nullptr;
+	std::thread Thread;
+
+	RenderCommandBuffer Buffers[2];
+	std::atomic<std::uint64_t> SubmittedFrame{0};
+	std::atomic<std::uint64_t> CompletedFrame{0};
+	std::atomic<bool> StopRequested{false};
+
+	// So para dormir enquanto espera; nenhum dos lados segura o mutex durante a
+	// gravacao ou a execucao dos comandos
+	std::mutex WakeMutex;
+	std::condition_variable WakeRenderThread;
+	std::condition_variable WakeMainThread;
+
+	double LastSubmitWait = 0.0;
+};
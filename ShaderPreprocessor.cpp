@@ -0,0 +1,246 @@
+#include "ShaderPreprocessor.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+
+#define STB_INCLUDE_IMPLEMENTATION
+#define STB_INCLUDE_LINE_GLSL
+#include <stb_include.h>
+
+#include "FileReader.h"
+
+// Limite de aninhamento dos includes; passar dele indica um include circular
+constexpr int MaxIncludeDepth = 16;
+
+// FNV-1a de 64 bits
+static std::uint64_t HashBytes(std::uint64_t Hash, std::string_view Bytes)
+{
+	for (char Byte : Bytes)
+	{
+		Hash ^= static_cast<unsigned char>(Byte);
+		Hash *= 0x100000001b3ull;
+	}
+	return Hash;
+}
+
+// Nomes dos arquivos em linhas '#include "nome"', com as mesmas regras do stb_include
+static std::vector<std::string> FindIncludes(std::string_view Text)
+{
+	std::vector<std::string> Includes;
+
+	std::size_t LineBegin = 0;
+	while (LineBegin < Text.size())
+	{
+		std::size_t LineEnd = Text.find_first_of("\r\n", LineBegin);
+		if (LineEnd == std::string_view::npos)
+		{
+			LineEnd = Text.size();
+		}
+		std::string_view Line = Text.substr(LineBegin, LineEnd - LineBegin);
+
+		auto SkipSpaces = [&Line]()
+		{
+			const std::size_t First = Line.find_first_not_of(" \t");
+			Line.remove_prefix(First == std::string_view::npos ? Line.size() : First);
+		};
+
+		SkipSpaces();
+		if (!Line.empty() && Line.front() == '#')
+		{
+			Line.remove_prefix(1);
+			SkipSpaces();
+			if (Line.size() > 7 && Line.substr(0, 7) == "include" && (Line[7] == ' ' || Line[7] == '\t'))
+			{
+				Line.remove_prefix(7);
+				SkipSpaces();
+				const std::size_t NameEnd = Line.find('"', 1);
+				if (!Line.empty() && Line.front() == '"' && NameEnd != std::string_view::npos)
+				{
+					Includes.emplace_back(Line.substr(1, NameEnd - 1));
+				}
+			}
+		}
+
+		LineBegin = LineEnd + 1;
+	}
+
+	return Includes;
+}
+
+// Coloca os defines na linha seguinte ao #version (que precisa ser a primeira
+// diretiva) e restaura a numeracao das linhas do arquivo principal com #line
+static void InjectDefines(std::string& Text, const std::string& DefineBlock)
+{
+	if (DefineBlock.empty())
+	{
+		return;
+	}
+
+	std::size_t InsertAt = 0;
+	int NextLine = 1;
+
+	std::size_t LineBegin = 0;
+	int LineNumber = 1;
+	while (LineBegin < Text.size())
+	{
+		const std::size_t LineEnd = std::min(Text.find('\n', LineBegin), Text.size());
+		const std::size_t First = Text.find_first_not_of(" \t", LineBegin);
+		if (First < LineEnd && Text.compare(First, 8, "#version") == 0)
+		{
+			InsertAt = std::min(LineEnd + 1, Text.size());
+			NextLine = LineNumber + 1;
+			if (LineEnd == Text.size())
+			{
+				Text.push_back('\n');
+				++InsertAt;
+			}
+			break;
+		}
+		LineBegin = LineEnd + 1;
+		++LineNumber;
+	}
+
+	Text.insert(InsertAt, DefineBlock + "#line " + std::to_string(NextLine) + " 0\n");
+}
+
+ShaderPreprocessor& ShaderPreprocessor::Get()
+{
+	static ShaderPreprocessor Instance;
+	return Instance;
+}
+
+void ShaderPreprocessor::SetIncludeDirectory(const std::string& Directory)
+{
+	if (Directory != IncludeDirectory)
+	{
+		IncludeDirectory = Directory;
+		Clear();
+	}
+}
+
+const ShaderSource* ShaderPreprocessor::Preprocess(const std::string& FilePath, const std::vector<std::string>& Defines)
+{
+	// A mesma combinacao de defines em outra ordem gera a mesma chave
+	std::vector<std::string> SortedDefines = Defines;
+	std::sort(SortedDefines.begin(), SortedDefines.end());
+	SortedDefines.erase(std::unique(SortedDefines.begin(), SortedDefines.end()), SortedDefines.end());
+
+	std::string DefineBlock;
+	for (const std::string& Define : SortedDefines)
+	{
+		DefineBlock += "#define " + Define + "\n";
+	}
+
+	const std::string Key = FilePath + '\n' + DefineBlock;
+
+	auto CachedIt = Cache.find(Key);
+	if (CachedIt != Cache.end())
+	{
+		const std::uint64_t CurrentHash = HashDependencies(CachedIt->second.Dependencies, DefineBlock);
+		if (CurrentHash != 0 && CurrentHash == CachedIt->second.Hash)
+		{
+			CurrentStats.NumCacheHits++;
+			return &CachedIt->second;
+		}
+	}
+
+	ShaderSource Source;
+	if (!CollectDependencies(FilePath, Source.Dependencies, 0))
+	{
+		return nullptr;
+	}
+
+	Source.Hash = HashDependencies(Source.Dependencies, DefineBlock);
+	if (Source.Hash == 0)
+	{
+		return nullptr;
+	}
+
+	const FileContents Contents = ReadWholeFile(FilePath);
+	if (!Contents.IsValid())
+	{
+		return nullptr;
+	}
+
+	// O stb_include recebe strings C modificaveis
+	std::string Text{Contents.View()};
+	std::string IncludePath = IncludeDirectory;
+	std::string FileName = FilePath;
+	char Error[256] = {};
+	char* Expanded = stb_include_string(Text.data(), nullptr, IncludePath.data(), FileName.data(), Error);
+	if (Expanded == nullptr)
+	{
+		std::cerr << "Falha ao expandir " << FilePath << ": " << Error << std::endl;
+		return nullptr;
+	}
+	Source.Text = Expanded;
+	std::free(Expanded);
+
+	InjectDefines(Source.Text, DefineBlock);
+
+	CurrentStats.NumExpanded++;
+
+	ShaderSource& Entry = Cache[Key];
+	Entry = std::move(Source);
+	return &Entry;
+}
+
+void ShaderPreprocessor::Clear()
+{
+	Cache.clear();
+	CurrentStats = Stats{};
+}
+
+bool ShaderPreprocessor::CollectDependencies(const std::string& FilePath, std::vector<std::string>& Dependencies, int Depth) const
+{
+	if (Depth > MaxIncludeDepth)
+	{
+		std::cerr << "Includes aninhados demais (circular?) em " << FilePath << std::endl;
+		return false;
+	}
+
+	const FileContents Contents = ReadWholeFile(FilePath);
+	if (!Contents.IsValid())
+	{
+		return false;
+	}
+
+	if (std::find(Dependencies.begin(), Dependencies.end(), FilePath) == Dependencies.end())
+	{
+		Dependencies.push_back(FilePath);
+	}
+
+	for (const std::string& Include : FindIncludes(Contents.View()))
+	{
+		if (!CollectDependencies(IncludeDirectory + "/" + Include, Dependencies, Depth + 1))
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+std::uint64_t ShaderPreprocessor::HashDependencies(const std::vector<std::string>& Dependencies, const std::string& DefineBlock) const
+{
+	std::uint64_t Hash = 0xcbf29ce484222325ull;
+	for (const std::string& Dependency : Dependencies)
+	{
+		const FileContents Contents = ReadWholeFile(Dependency);
+		if (!Contents.IsValid())
+		{
+			return 0;
+		}
+
+		// O nome entra no hash para um include trocado por outro de mesmo conteudo
+		Hash = HashBytes(Hash, Dependency);
+		Hash = HashBytes(Hash, std::string_view{"\0", 1});
+		Hash = HashBytes(Hash, Contents.View());
+		Hash = HashBytes(Hash, std::string_view{"\0", 1});
+	}
+	Hash = HashBytes(Hash, DefineBlock);
+
+	return Hash != 0 ? Hash : 1;
+}
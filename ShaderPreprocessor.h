@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Resultado da expansao de um shader com uma combinacao de defines
+struct ShaderSource
+{
+	std::string Text;                        // Codigo expandido, pronto para glShaderSource
+	std::uint64_t Hash = 0;                  // Hash do conteudo de todas as dependencias e dos defines
+	std::vector<std::string> Dependencies;   // O arquivo principal seguido dos includes, sem repeticao
+};
+
+// Expande #include "arquivo" (com stb_include, relativo ao diretorio de includes)
+// e injeta #defines logo depois do #version. O resultado fica em cache por arquivo
+// e conjunto de defines; enquanto nenhuma dependencia mudar de conteudo o mesmo
+// ShaderSource (com o mesmo Hash) e devolvido sem ser processado de novo
+class ShaderPreprocessor
+{
+public:
+	struct Stats
+	{
+		int NumExpanded = 0;
+		int NumCacheHits = 0;
+	};
+
+	static ShaderPreprocessor& Get();
+
+	void SetIncludeDirectory(const std::string& Directory);
+
+	// Cada define e "NOME" ou "NOME VALOR". A ordem nao importa. Retorna nullptr se
+	// o arquivo ou algum include nao puder ser lido. O ponteiro vale ate a proxima
+	// chamada que expandir o mesmo arquivo com os mesmos defines, ou ate Clear
+	const ShaderSource* Preprocess(const std::string& FilePath, const std::vector<std::string>& Defines = {});
+
+	void Clear();
+
+	Stats GetStats() const { return CurrentStats; }
+
+private:
+	ShaderPreprocessor() = default;
+
+	// Lista o arquivo e os includes, recursivamente, na ordem em que aparecem
+	bool CollectDependencies(const std::string& FilePath, std::vector<std::string>& Dependencies, int Depth) const;
+
+	// Hash do conteudo atual das dependencias, 0 se alguma nao puder ser lida
+	std::uint64_t HashDependencies(const std::vector<std::string>& Dependencies, const std::string& DefineBlock) const;
+
+	std::string IncludeDirectory = "shaders";
+	std::unordered_map<std::string, ShaderSource> Cache;
+	Stats CurrentStats;
+};
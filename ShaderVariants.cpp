@@ -0,0 +1,419 @@
+#include "ShaderVariants.h"
+
+#include <algorithm>
+#include <bitset>
+#include <chrono>
+#include <iostream>
+
+#include "ShaderPreprocessor.h"
+#include "UniformBuffers.h"
+
+// Compilacoes de aquecimento em andamento ao mesmo tempo no driver
+constexpr std::size_t MaxParallelCompiles = 4;
+
+static double SecondsSince(std::chrono::steady_clock::time_point Start)
+{
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+}
+
+static void PrintShaderLog(GLuint ShaderId, const std::string& FilePath)
+{
+	GLint Result = GL_TRUE;
+	glGetShaderiv(ShaderId, GL_COMPILE_STATUS, &Result);
+	if (Result == GL_TRUE)
+	{
+		return;
+	}
+
+	GLint InfoLogLength = 0;
+	glGetShaderiv(ShaderId, GL_INFO_LOG_LENGTH, &InfoLogLength);
+	if (InfoLogLength > 0)
+	{
+		std::string ShaderInfoLog(InfoLogLength, '\0');
+		glGetShaderInfoLog(ShaderId, InfoLogLength, nullptr, &ShaderInfoLog[0]);
+		std::cout << "Erro no shader " << FilePath << std::endl;
+		std::cout << ShaderInfoLog << std::endl;
+	}
+}
+
+bool ShaderVariantSet::IsParallelCompileSupported()
+{
+	return GLEW_ARB_parallel_shader_compile || GLEW_KHR_parallel_shader_compile;
+}
+
+void ShaderVariantSet::Init(const std::string& VertexShaderFile, const std::string& FragmentShaderFile, const std::vector<std::string>& FeatureDefines)
+{
+	VertexFile = VertexShaderFile;
+	FragmentFile = FragmentShaderFile;
+	Features = FeatureDefines;
+
+	ParallelCompile = IsParallelCompileSupported();
+	if (GLEW_ARB_parallel_shader_compile)
+	{
+		// Deixar o driver escolher quantas threads usar
+		glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+	}
+	else if (GLEW_KHR_parallel_shader_compile)
+	{
+		glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+	}
+}
+
+void ShaderVariantSet::Destroy()
+{
+	for (auto& [Mask, Target] : Variants)
+	{
+		glDeleteShader(Target.VertexShader);
+		glDeleteShader(Target.FragmentShader);
+		glDeleteProgram(Target.PendingProgram);
+		glDeleteProgram(Target.Program);
+	}
+	Variants.clear();
+	WarmUpQueue.clear();
+	Compiling.clear();
+	CurrentStats = Stats{};
+}
+
+GLuint ShaderVariantSet::Precompile(std::uint32_t Mask)
+{
+	Variant& Target = Variants[Mask];
+	if (Target.State == VariantState::Queued)
+	{
+		StartCompile(Mask, Target);
+	}
+	if (Target.PendingProgram != 0)
+	{
+		Compiling.erase(std::remove(Compiling.begin(), Compiling.end(), Mask), Compiling.end());
+		FinishCompile(Mask, Target);
+	}
+	return Target.Program;
+}
+
+void ShaderVariantSet::Prefetch(std::uint32_t Mask)
+{
+	if (Variants.find(Mask) == Variants.end())
+	{
+		Variants[Mask] = Variant{};
+		WarmUpQueue.push_back(Mask);
+	}
+}
+
+void ShaderVariantSet::Update(double BudgetSeconds)
+{
+	const auto Start = std::chrono::steady_clock::now();
+
+	// Recolher o que o driver terminou de compilar
+	for (std::size_t CompileIndex = 0; CompileIndex < Compiling.size();)
+	{
+		Variant& Target = Variants[Compiling[CompileIndex]];
+		if (IsCompileDone(Target))
+		{
+			const bool FirstCompile = Target.State == VariantState::Compiling;
+			FinishCompile(Compiling[CompileIndex], Target);
+			CurrentStats.NumWarmedUp += FirstCompile && Target.State == VariantState::Ready ? 1 : 0;
+			Compiling[CompileIndex] = Compiling.back();
+			Compiling.pop_back();
+		}
+		else
+		{
+			++CompileIndex;
+		}
+	}
+
+	// Iniciar as proximas. Sem compilacao paralela cada uma termina aqui mesmo, entao
+	// o orcamento e conferido entre uma e outra
+	while (!WarmUpQueue.empty() && Compiling.size() < MaxParallelCompiles && SecondsSince(Start) < BudgetSeconds)
+	{
+		const std::uint32_t Mask = WarmUpQueue.front();
+		WarmUpQueue.pop_front();
+
+		Variant& Target = Variants[Mask];
+		if (Target.State != VariantState::Queued)
+		{
+			continue;
+		}
+
+		StartCompile(Mask, Target);
+		if (Target.PendingProgram != 0 && !ParallelCompile)
+		{
+			Compiling.erase(std::remove(Compiling.begin(), Compiling.end(), Mask), Compiling.end());
+			FinishCompile(Mask, Target);
+			CurrentStats.NumWarmedUp += Target.State == VariantState::Ready ? 1 : 0;
+		}
+	}
+}
+
+void ShaderVariantSet::Reload()
+{
+	for (auto& [Mask, Target] : Variants)
+	{
+		if (Target.State == VariantState::Queued)
+		{
+			continue;
+		}
+
+		// Hash e o das fontes da ultima compilacao iniciada, pronta ou nao
+		const std::uint64_t Hash = HashSources(Mask, nullptr, nullptr);
+		if (Hash == 0 || Hash == Target.Hash)
+		{
+			continue;
+		}
+
+		// Uma compilacao em andamento ficou com as fontes antigas
+		if (Target.PendingProgram != 0)
+		{
+			Compiling.erase(std::remove(Compiling.begin(), Compiling.end(), Mask), Compiling.end());
+			glDeleteShader(Target.VertexShader);
+			glDeleteShader(Target.FragmentShader);
+			glDeleteProgram(Target.PendingProgram);
+			Target.VertexShader = 0;
+			Target.FragmentShader = 0;
+			Target.PendingProgram = 0;
+		}
+
+		if (Target.State == VariantState::Ready)
+		{
+			StartCompile(Mask, Target);
+		}
+		else
+		{
+			Target.State = VariantState::Queued;
+			WarmUpQueue.push_front(Mask);
+		}
+	}
+}
+
+GLuint ShaderVariantSet::GetProgram(std::uint32_t Mask)
+{
+	auto VariantIt = Variants.find(Mask);
+	if (VariantIt != Variants.end() && VariantIt->second.State == VariantState::Ready)
+	{
+		return VariantIt->second.Program;
+	}
+
+	// Passar a variante para o inicio da fila de aquecimento
+	if ((VariantIt == Variants.end() || VariantIt->second.State == VariantState::Queued) &&
+		(WarmUpQueue.empty() || WarmUpQueue.front() != Mask))
+	{
+		Variants[Mask];
+		WarmUpQueue.push_front(Mask);
+	}
+
+	// A variante pronta com mais recursos entre os pedidos
+	GLuint FallbackProgram = 0;
+	std::size_t FallbackFeatures = 0;
+	for (const auto& [OtherMask, Other] : Variants)
+	{
+		const std::size_t NumFeatures = std::bitset<32>(OtherMask).count();
+		if (Other.State == VariantState::Ready && (OtherMask & ~Mask) == 0 && (FallbackProgram == 0 || NumFeatures > FallbackFeatures))
+		{
+			FallbackProgram = Other.Program;
+			FallbackFeatures = NumFeatures;
+		}
+	}
+
+	Variant& Target = Variants[Mask];
+	if (FallbackProgram != 0)
+	{
+		CurrentStats.NumFallbacks++;
+		return FallbackProgram;
+	}
+	if (Target.State == VariantState::Failed)
+	{
+		return GetLastResortProgram(Mask);
+	}
+
+	// Nenhuma alternativa: o frame espera a compilacao
+	const auto Start = std::chrono::steady_clock::now();
+	Precompile(Mask);
+	const double HitchSeconds = SecondsSince(Start);
+
+	CurrentStats.NumHitches++;
+	CurrentStats.MaxHitchSeconds = std::max(CurrentStats.MaxHitchSeconds, HitchSeconds);
+	CurrentStats.TotalHitchSeconds += HitchSeconds;
+
+	std::string DefineList;
+	for (const std::string& Define : GetDefines(Mask))
+	{
+		DefineList += " " + Define;
+	}
+	std::cout << "Travamento: variante de " << FragmentFile << " [" << DefineList << " ] compilada no primeiro uso em "
+		<< HitchSeconds * 1000.0 << " ms" << std::endl;
+
+	return Target.State == VariantState::Ready ? Target.Program : GetLastResortProgram(Mask);
+}
+
+GLuint ShaderVariantSet::GetLastResortProgram(std::uint32_t Mask)
+{
+	// Qualquer variante pronta, mesmo com recursos que nao foram pedidos: a que tiver
+	// menos recursos a mais e, entre essas, mais recursos em comum
+	GLuint FallbackProgram = 0;
+	std::size_t FallbackExtra = 0;
+	std::size_t FallbackShared = 0;
+	for (const auto& [OtherMask, Other] : Variants)
+	{
+		const std::size_t NumExtra = std::bitset<32>(OtherMask & ~Mask).count();
+		const std::size_t NumShared = std::bitset<32>(OtherMask & Mask).count();
+		if (Other.State == VariantState::Ready &&
+			(FallbackProgram == 0 || NumExtra < FallbackExtra || (NumExtra == FallbackExtra && NumShared > FallbackShared)))
+		{
+			FallbackProgram = Other.Program;
+			FallbackExtra = NumExtra;
+			FallbackShared = NumShared;
+		}
+	}
+
+	// Por ultimo a variante sem recursos, compilada na hora se preciso
+	if (FallbackProgram == 0 && Mask != 0 && Variants[0].State != VariantState::Failed)
+	{
+		Precompile(0);
+		FallbackProgram = Variants[0].State == VariantState::Ready ? Variants[0].Program : 0;
+	}
+
+	CurrentStats.NumFallbacks += FallbackProgram != 0 ? 1 : 0;
+	return FallbackProgram;
+}
+
+std::vector<std::string> ShaderVariantSet::GetDefines(std::uint32_t Mask) const
+{
+	std::vector<std::string> Defines;
+	for (std::size_t Bit = 0; Bit < Features.size(); ++Bit)
+	{
+		if (Mask & (1u << Bit))
+		{
+			Defines.push_back(Features[Bit]);
+		}
+	}
+	return Defines;
+}
+
+std::uint64_t ShaderVariantSet::HashSources(std::uint32_t Mask, const std::string** VertexText, const std::string** FragmentText) const
+{
+	// O preprocessador guarda o texto expandido; so o que mudou e lido de novo
+	const std::vector<std::string> Defines = GetDefines(Mask);
+	const ShaderSource* VertexSource = ShaderPreprocessor::Get().Preprocess(VertexFile, Defines);
+	const ShaderSource* FragmentSource = ShaderPreprocessor::Get().Preprocess(FragmentFile, Defines);
+	if (VertexSource == nullptr || FragmentSource == nullptr)
+	{
+		return 0;
+	}
+
+	if (VertexText != nullptr)
+	{
+		*VertexText = &VertexSource->Text;
+	}
+	if (FragmentText != nullptr)
+	{
+		*FragmentText = &FragmentSource->Text;
+	}
+	return VertexSource->Hash ^ (FragmentSource->Hash + 0x9e3779b97f4a7c15ull + (VertexSource->Hash << 6) + (VertexSource->Hash >> 2));
+}
+
+void ShaderVariantSet::StartCompile(std::uint32_t Mask, Variant& Target)
+{
+	const std::string* VertexText = nullptr;
+	const std::string* FragmentText = nullptr;
+	const std::uint64_t Hash = HashSources(Mask, &VertexText, &FragmentText);
+	if (Hash == 0)
+	{
+		if (Target.State == VariantState::Queued)
+		{
+			Target.State = VariantState::Failed;
+		}
+		return;
+	}
+	Target.Hash = Hash;
+
+	Target.VertexShader = glCreateShader(GL_VERTEX_SHADER);
+	const char* VertexSourcePtr = VertexText->c_str();
+	glShaderSource(Target.VertexShader, 1, &VertexSourcePtr, nullptr);
+	glCompileShader(Target.VertexShader);
+
+	Target.FragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	const char* FragmentSourcePtr = FragmentText->c_str();
+	glShaderSource(Target.FragmentShader, 1, &FragmentSourcePtr, nullptr);
+	glCompileShader(Target.FragmentShader);
+
+	// Com compilacao paralela nada aqui espera o driver; o estado de compilacao so
+	// e consultado depois que GL_COMPLETION_STATUS indicar que terminou
+	Target.PendingProgram = glCreateProgram();
+	glAttachShader(Target.PendingProgram, Target.VertexShader);
+	glAttachShader(Target.PendingProgram, Target.FragmentShader);
+	glLinkProgram(Target.PendingProgram);
+
+	if (Target.State == VariantState::Queued)
+	{
+		Target.State = VariantState::Compiling;
+	}
+	Compiling.push_back(Mask);
+}
+
+bool ShaderVariantSet::IsCompileDone(const Variant& Target) const
+{
+	if (!ParallelCompile)
+	{
+		return true;
+	}
+
+	GLint Done = GL_FALSE;
+	glGetProgramiv(Target.PendingProgram, GL_COMPLETION_STATUS_ARB, &Done);
+	return Done == GL_TRUE;
+}
+
+void ShaderVariantSet::FinishCompile(std::uint32_t Mask, Variant& Target)
+{
+	GLint Result = GL_FALSE;
+	glGetProgramiv(Target.PendingProgram, GL_LINK_STATUS, &Result);
+
+	glDetachShader(Target.PendingProgram, Target.VertexShader);
+	glDetachShader(Target.PendingProgram, Target.FragmentShader);
+
+	if (Result == GL_TRUE)
+	{
+		// Ligar os blocos uniformes aos pontos de ligacao compartilhados
+		BindUniformBlocks(Target.PendingProgram);
+
+		// Troca entre frames: o proximo GetProgram ja devolve o programa novo
+		if (Target.Program != 0)
+		{
+			glDeleteProgram(Target.Program);
+		}
+		else
+		{
+			CurrentStats.NumReady++;
+		}
+		Target.Program = Target.PendingProgram;
+		Target.State = VariantState::Ready;
+	}
+	else
+	{
+		PrintShaderLog(Target.VertexShader, VertexFile);
+		PrintShaderLog(Target.FragmentShader, FragmentFile);
+
+		GLint InfoLogLength = 0;
+		glGetProgramiv(Target.PendingProgram, GL_INFO_LOG_LENGTH, &InfoLogLength);
+		if (InfoLogLength > 0)
+		{
+			std::string ProgramInfoLog(InfoLogLength, '\0');
+			glGetProgramInfoLog(Target.PendingProgram, InfoLogLength, nullptr, &ProgramInfoLog[0]);
+			std::cout << "Erro ao linkar a variante " << Mask << std::endl;
+			std::cout << ProgramInfoLog << std::endl;
+		}
+		glDeleteProgram(Target.PendingProgram);
+
+		if (Target.Program != 0)
+		{
+			std::cout << "Mantendo o programa anterior da variante " << Mask << std::endl;
+		}
+		else
+		{
+			Target.State = VariantState::Failed;
+		}
+	}
+
+	glDeleteShader(Target.VertexShader);
+	glDeleteShader(Target.FragmentShader);
+	Target.VertexShader = 0;
+	Target.FragmentShader = 0;
+	Target.PendingProgram = 0;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Permutacoes de um par vertex/fragment shader. Cada bit da mascara de recursos
+// liga um #define (FeatureDefines[bit]) e cada mascara vira um programa proprio,
+// compilado na primeira vez que e pedido. O aquecimento compila em segundo plano,
+// dentro de um orcamento por frame, as mascaras previstas para os proximos frames.
+// Com GL_ARB_parallel_shader_compile o driver compila nas suas proprias threads e
+// o programa so e usado quando GL_COMPLETION_STATUS indicar que terminou.
+// Todos os metodos chamam OpenGL e rodam na thread dona do contexto
+class ShaderVariantSet
+{
+public:
+	struct Stats
+	{
+		int NumReady = 0;
+		int NumWarmedUp = 0;            // Prontas antes do primeiro uso
+		int NumHitches = 0;             // Compiladas com o frame esperando
+		int NumFallbacks = 0;           // Frames desenhados com uma variante mais simples
+		double MaxHitchSeconds = 0.0;
+		double TotalHitchSeconds = 0.0;
+	};
+
+	static bool IsParallelCompileSupported();
+
+	void Init(const std::string& VertexShaderFile, const std::string& FragmentShaderFile, const std::vector<std::string>& FeatureDefines);
+	void Destroy();
+
+	// Compila e espera, para as variantes necessarias ja no carregamento
+	GLuint Precompile(std::uint32_t Mask);
+
+	// Coloca a variante na fila de aquecimento, se ainda nao existir
+	void Prefetch(std::uint32_t Mask);
+
+	// Uma vez por frame: recolhe as compilacoes que terminaram e inicia as da fila
+	// enquanto o tempo gasto couber em BudgetSeconds
+	void Update(double BudgetSeconds);
+
+	// Programa da variante. Se ela ainda nao estiver pronta, usa a variante pronta
+	// com o maior subconjunto dos recursos e adianta a compilacao; sem nenhuma,
+	// compila na hora e registra o travamento. Se a variante nao compilar, usa
+	// qualquer outra pronta ou a sem recursos; 0 so quando nenhuma compila
+	GLuint GetProgram(std::uint32_t Mask);
+
+	// Confere as fontes de todas as variantes ja compiladas e recompila as que
+	// mudaram. A variante continua usando o programa anterior ate o novo linkar;
+	// se a compilacao falhar o anterior fica
+	void Reload();
+
+	std::vector<std::string> GetDefines(std::uint32_t Mask) const;
+
+	Stats GetStats() const { return CurrentStats; }
+
+private:
+	enum class VariantState
+	{
+		Queued,
+		Compiling,
+		Ready,
+		Failed,
+	};
+
+	struct Variant
+	{
+		VariantState State = VariantState::Queued;
+		GLuint Program = 0;             // Em uso
+		std::uint64_t Hash = 0;         // Das fontes do programa em uso ou em compilacao
+
+		// Compilacao em andamento (primeira ou recarga)
+		GLuint PendingProgram = 0;
+		GLuint VertexShader = 0;
+		GLuint FragmentShader = 0;
+	};
+
+	// Hash das fontes atuais da variante, 0 se alguma nao puder ser expandida
+	std::uint64_t HashSources(std::uint32_t Mask, const std::string** VertexText, const std::string** FragmentText) const;
+
+	// Para uma variante que falhou e sem subconjunto pronto
+	GLuint GetLastResortProgram(std::uint32_t Mask);
+
+	void StartCompile(std::uint32_t Mask, Variant& Target);
+	bool IsCompileDone(const Variant& Target) const;
+	void FinishCompile(std::uint32_t Mask, Variant& Target);
+
+	std::string VertexFile;
+	std::string FragmentFile;
+	std::vector<std::string> Features;
+	bool ParallelCompile = false;
+
+	std::unordered_map<std::uint32_t, Variant> Variants;
+	std::deque<std::uint32_t> WarmUpQueue;
+	std::vector<std::uint32_t> Compiling;
+
+	Stats CurrentStats;
+};
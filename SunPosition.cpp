@@ -0,0 +1,51 @@
+#include "SunPosition.h"
+
+#include <chrono>
+#include <cmath>
+
+#include <glm/ext.hpp>
+
+// Data juliana da epoca Unix e da epoca J2000.0 (2000-01-01 12:00)
+constexpr double UnixEpochJulianDate = 2440587.5;
+constexpr double J2000JulianDate = 2451545.0;
+constexpr double SecondsPerDay = 86400.0;
+
+double GetCurrentUnixTime()
+{
+	return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+double UnixTimeToJulianDate(double UnixTime)
+{
+	return UnixEpochJulianDate + UnixTime / SecondsPerDay;
+}
+
+SunPosition ComputeSunPosition(double JulianDate)
+{
+	const double Days = JulianDate - J2000JulianDate;
+
+	// Longitude media e anomalia media do sol, e a longitude ecliptica com os dois
+	// primeiros termos da equacao do centro
+	const double MeanLongitude = std::fmod(280.460 + 0.9856474 * Days, 360.0);
+	const double MeanAnomaly = glm::radians(std::fmod(357.528 + 0.9856003 * Days, 360.0));
+	const double EclipticLongitude = glm::radians(MeanLongitude + 1.915 * std::sin(MeanAnomaly) + 0.020 * std::sin(2.0 * MeanAnomaly));
+	const double Obliquity = glm::radians(23.439 - 0.0000004 * Days);
+
+	// Ascensao reta e declinacao no equador celeste
+	const double SinLongitude = std::sin(EclipticLongitude);
+	const double RightAscension = std::atan2(std::cos(Obliquity) * SinLongitude, std::cos(EclipticLongitude));
+	const double Declination = std::asin(std::sin(Obliquity) * SinLongitude);
+
+	// O tempo sideral medio de Greenwich gira o equador celeste para o ECEF
+	const double GreenwichSiderealTime = glm::radians(std::fmod(280.46061837 + 360.98564736629 * Days, 360.0));
+	const double SubsolarLongitude = std::remainder(RightAscension - GreenwichSiderealTime, glm::two_pi<double>());
+
+	SunPosition Sun;
+	Sun.SubsolarLatitude = glm::degrees(Declination);
+	Sun.SubsolarLongitude = glm::degrees(SubsolarLongitude);
+	Sun.Direction = glm::dvec3{
+		std::cos(Declination) * std::cos(SubsolarLongitude),
+		std::cos(Declination) * std::sin(SubsolarLongitude),
+		std::sin(Declination)};
+	return Sun;
+}
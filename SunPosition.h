@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+// Posicao do sol vista da Terra em um instante
+struct SunPosition
+{
+	double SubsolarLatitude = 0.0;      // Graus; ponto da superficie com o sol no zenite
+	double SubsolarLongitude = 0.0;
+	glm::dvec3 Direction{1.0, 0.0, 0.0}; // Direcao do sol em ECEF, normalizada
+};
+
+// Segundos desde 1970-01-01 00:00 UTC pelo relogio do sistema
+double GetCurrentUnixTime();
+
+double UnixTimeToJulianDate(double UnixTime);
+
+// Efemeride de baixa precisao do Astronomical Almanac: erro em torno de 0.01 grau
+// (cerca de 1 km no ponto subsolar) entre 1950 e 2050. Algumas funcoes
+// trigonometricas, cabe com folga em um microssegundo por frame. Tempo UTC tomado
+// como UT1 e TT; as diferencas somam menos de 0.001 grau
+SunPosition ComputeSunPosition(double JulianDate);
@@ -0,0 +1,505 @@
+#include "TextureManager.h"
+
+#include "AsyncIO.h"
+
+#include <iostream>
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb_image_resize.h>
+
+// Os drivers costumam armazenar GL_RGB8 alinhado em 4 bytes por texel
+constexpr std::size_t BytesPerTexel = 4;
+
+// Abaixo desta resolucao nao vale a pena continuar descartando mips
+constexpr int MinDegradedSize = 256;
+
+// So restauramos mips se sobrar esta fracao do orcamento, para nao ficar
+// descartando e restaurando a mesma textura a cada frame
+constexpr double RestoreHeadroom = 0.9;
+
+static int MipSize(int Size, int Level)
+{
+	return std::max(1, Size >> Level);
+}
+
+int CountMipLevels(int Width, int Height)
+{
+	int NumLevels = 1;
+	while (Width > 1 || Height > 1)
+	{
+		Width = std::max(1, Width / 2);
+		Height = std::max(1, Height / 2);
+		++NumLevels;
+	}
+	return NumLevels;
+}
+
+std::size_t ComputeTextureBytes(int Width, int Height)
+{
+	std::size_t Bytes = 0;
+	const int NumLevels = CountMipLevels(Width, Height);
+	for (int Level = 0; Level < NumLevels; ++Level)
+	{
+		Bytes += std::size_t(MipSize(Width, Level)) * MipSize(Height, Level) * BytesPerTexel;
+	}
+	return Bytes;
+}
+
+TextureManager& TextureManager::Get()
+{
+	static TextureManager Instance;
+	return Instance;
+}
+
+void TextureManager::SetBudget(std::size_t NewBudgetBytes)
+{
+	BudgetBytes = NewBudgetBytes;
+}
+
+void TextureManager::SetEvictAfterFrames(std::uint64_t NumFrames)
+{
+	EvictAfterFrames = NumFrames;
+}
+
+GLuint TextureManager::Load(const char* TextureFile)
+{
+	std::cout << "Carregando Textura " << TextureFile << std::endl;
+
+	stbi_set_flip_vertically_on_load(true);
+
+	int TextureWidth = 0;
+	int TextureHeight = 0;
+	int NumberOfComponents = 0;
+	unsigned char* TextureData = stbi_load(TextureFile, &TextureWidth, &TextureHeight, &NumberOfComponents, 3);
+
+	assert(TextureData);
+
+	GLuint TextureId = Create(TextureData, TextureWidth, TextureHeight, TextureFile);
+
+	stbi_image_free(TextureData);
+
+	return TextureId;
+}
+
+bool TextureManager::Decode(const unsigned char* FileData, std::size_t FileSize, DecodedImage& Image)
+{
+	// A opcao de inverter e por thread, entao nao interfere com Load em outra thread
+	stbi_set_flip_vertically_on_load_thread(true);
+
+	int NumberOfComponents = 0;
+	unsigned char* Pixels = stbi_load_from_memory(FileData, static_cast<int>(FileSize), &Image.Width, &Image.Height, &NumberOfComponents, 3);
+	if (!Pixels)
+	{
+		std::cerr << "Falha ao decodificar a imagem: " << stbi_failure_reason() << std::endl;
+		return false;
+	}
+
+	Image.Pixels.assign(Pixels, Pixels + std::size_t(Image.Width) * Image.Height * 3);
+	stbi_image_free(Pixels);
+	return true;
+}
+
+GLuint TextureManager::Create(const unsigned char* Pixels, int Width, int Height, const std::string& TextureFile)
+{
+	if (MaxTextureSize == 0)
+	{
+		glGetIntegerv(GL_MAX_TEXTURE_SIZE, &MaxTextureSize);
+	}
+
+	// Gerar identificador da textura
+	GLuint TextureId;
+	glGenTextures(1, &TextureId);
+
+	TextureEntry& Entry = Entries[TextureId];
+	Entry.File = TextureFile;
+	Entry.Width = Width;
+	Entry.Height = Height;
+	Entry.LastUsedFrame = CurrentFrame;
+	Entry.DroppedMips = ChooseDroppedMips(Width, Height, 0);
+
+	if (Entry.DroppedMips > 0)
+	{
+		std::cout << "Textura reduzida em " << Entry.DroppedMips << " mip(s) para caber no orcamento: "
+			<< MipSize(Width, Entry.DroppedMips) << "x" << MipSize(Height, Entry.DroppedMips) << std::endl;
+	}
+
+	// Reduzida na CPU antes de enviar, assim a imagem completa nunca chega a GPU
+	UploadReduced(TextureId, Entry, Pixels, Width, Height);
+
+	EnforceBudget();
+
+	return TextureId;
+}
+
+void TextureManager::Release(GLuint TextureId)
+{
+	auto It = Entries.find(TextureId);
+	if (It != Entries.end())
+	{
+		ResidentBytes -= It->second.Bytes;
+		Entries.erase(It);
+	}
+	glDeleteTextures(1, &TextureId);
+}
+
+bool TextureManager::Replace(GLuint TextureId, const DecodedImage& Image)
+{
+	auto It = Entries.find(TextureId);
+	if (It == Entries.end() || Image.Pixels.empty())
+	{
+		return false;
+	}
+
+	// A imagem nova pode ter outra resolucao; o corte de mips e refeito do zero
+	TextureEntry& Entry = It->second;
+	Entry.Width = Image.Width;
+	Entry.Height = Image.Height;
+	Entry.DroppedMips = ChooseDroppedMips(Image.Width, Image.Height, 0);
+	Entry.LastUsedFrame = CurrentFrame;
+	Entry.PendingReload = 0;
+	Entry.ReloadFailed = false;
+	UploadReduced(TextureId, Entry, Image.Pixels.data(), Image.Width, Image.Height);
+
+	EnforceBudget();
+	return true;
+}
+
+std::vector<GLuint> TextureManager::FindByFile(const std::string& TextureFile) const
+{
+	std::vector<GLuint> TextureIds;
+	for (const auto& [TextureId, Entry] : Entries)
+	{
+		if (Entry.File == TextureFile)
+		{
+			TextureIds.push_back(TextureId);
+		}
+	}
+	return TextureIds;
+}
+
+void TextureManager::BeginFrame()
+{
+	++CurrentFrame;
+	ApplyReloads();
+	EnforceBudget();
+	RestoreOne();
+}
+
+void TextureManager::Touch(GLuint TextureId)
+{
+	auto It = Entries.find(TextureId);
+	if (It == Entries.end())
+	{
+		return;
+	}
+
+	TextureEntry& Entry = It->second;
+	Entry.LastUsedFrame = CurrentFrame;
+
+	if (!Entry.IsResident && Entry.PendingReload == 0 && !Entry.ReloadFailed)
+	{
+		std::cout << "Recarregando textura despejada: " << Entry.File << std::endl;
+		Reload(TextureId, Entry, ChooseDroppedMips(Entry.Width, Entry.Height, Entry.DroppedMips));
+	}
+}
+
+void TextureManager::Bind(GLenum TextureUnit, GLuint TextureId)
+{
+	Touch(TextureId);
+	glActiveTexture(TextureUnit);
+	glBindTexture(GL_TEXTURE_2D, TextureId);
+}
+
+TextureManager::Stats TextureManager::GetStats() const
+{
+	Stats Result;
+	Result.ResidentBytes = ResidentBytes;
+	Result.BudgetBytes = BudgetBytes;
+	Result.NumTextures = static_cast<int>(Entries.size());
+	for (const auto& Pair : Entries)
+	{
+		if (!Pair.second.IsResident)
+		{
+			++Result.NumEvicted;
+		}
+		else if (Pair.second.DroppedMips > 0)
+		{
+			++Result.NumDegraded;
+		}
+	}
+	return Result;
+}
+
+void TextureManager::EnforceBudget()
+{
+	while (ResidentBytes > BudgetBytes)
+	{
+		// Procurar a textura amostrada ha mais tempo que ainda pode encolher
+		GLuint VictimId = 0;
+		TextureEntry* Victim = nullptr;
+		for (auto& Pair : Entries)
+		{
+			TextureEntry& Entry = Pair.second;
+			if (!Entry.IsResident)
+			{
+				continue;
+			}
+
+			const bool CanEvict = !Entry.File.empty() && CurrentFrame - Entry.LastUsedFrame > EvictAfterFrames;
+			const bool CanDrop = Entry.NumLevels > 1 &&
+				std::max(MipSize(Entry.Width, Entry.DroppedMips), MipSize(Entry.Height, Entry.DroppedMips)) > MinDegradedSize;
+			if (!CanEvict && !CanDrop)
+			{
+				continue;
+			}
+
+			if (Victim == nullptr ||
+				Entry.LastUsedFrame < Victim->LastUsedFrame ||
+				(Entry.LastUsedFrame == Victim->LastUsedFrame && Entry.Bytes > Victim->Bytes))
+			{
+				VictimId = Pair.first;
+				Victim = &Entry;
+			}
+		}
+
+		if (Victim == nullptr)
+		{
+			std::cerr << "Orcamento de textura excedido e nada mais pode ser liberado: "
+				<< ResidentBytes / (1024 * 1024) << " MB de " << BudgetBytes / (1024 * 1024) << " MB" << std::endl;
+			break;
+		}
+
+		if (!Victim->File.empty() && CurrentFrame - Victim->LastUsedFrame > EvictAfterFrames)
+		{
+			Evict(VictimId, *Victim);
+		}
+		else if (!DropTopMip(VictimId, *Victim))
+		{
+			break;
+		}
+	}
+}
+
+void TextureManager::RestoreOne()
+{
+	// Restaura no maximo um nivel por frame, comecando pela textura usada mais recentemente
+	GLuint CandidateId = 0;
+	TextureEntry* Candidate = nullptr;
+	for (auto& Pair : Entries)
+	{
+		TextureEntry& Entry = Pair.second;
+		if (!Entry.IsResident || Entry.DroppedMips == 0 || Entry.File.empty() || Entry.PendingReload != 0 || Entry.ReloadFailed)
+		{
+			continue;
+		}
+		if (Candidate == nullptr || Entry.LastUsedFrame > Candidate->LastUsedFrame)
+		{
+			CandidateId = Pair.first;
+			Candidate = &Entry;
+		}
+	}
+
+	if (Candidate == nullptr || CurrentFrame - Candidate->LastUsedFrame > 1)
+	{
+		return;
+	}
+
+	const int NewDroppedMips = Candidate->DroppedMips - 1;
+	const std::size_t NewBytes = ComputeTextureBytes(MipSize(Candidate->Width, NewDroppedMips), MipSize(Candidate->Height, NewDroppedMips));
+	if (ResidentBytes - Candidate->Bytes + NewBytes <= BudgetBytes * RestoreHeadroom &&
+		MipSize(Candidate->Width, NewDroppedMips) <= MaxTextureSize &&
+		MipSize(Candidate->Height, NewDroppedMips) <= MaxTextureSize)
+	{
+		std::cout << "Restaurando mip de " << Candidate->File << std::endl;
+		Reload(CandidateId, *Candidate, NewDroppedMips);
+	}
+}
+
+bool TextureManager::DropTopMip(GLuint TextureId, TextureEntry& Entry)
+{
+	// O nivel 1 ja esta na GPU, basta le-lo de volta e promove-lo a nivel 0
+	const int NewWidth = MipSize(Entry.Width, Entry.DroppedMips + 1);
+	const int NewHeight = MipSize(Entry.Height, Entry.DroppedMips + 1);
+	std::vector<unsigned char> Pixels(std::size_t(NewWidth) * NewHeight * 3);
+
+	glBindTexture(GL_TEXTURE_2D, TextureId);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glGetTexImage(GL_TEXTURE_2D, 1, GL_RGB, GL_UNSIGNED_BYTE, Pixels.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Um mip restaurado que ainda esteja a caminho ja nao cabe
+	++Entry.DroppedMips;
+	Entry.PendingReload = 0;
+	Upload(TextureId, Entry, Pixels.data(), NewWidth, NewHeight);
+
+	std::cout << "Descartando mip do topo de " << (Entry.File.empty() ? "textura" : Entry.File)
+		<< ": " << NewWidth << "x" << NewHeight << std::endl;
+	return true;
+}
+
+void TextureManager::Evict(GLuint TextureId, TextureEntry& Entry)
+{
+	std::cout << "Despejando textura " << Entry.File << std::endl;
+
+	// Mantemos o identificador valido com um texel cinza ate a proxima amostragem
+	const unsigned char Placeholder[3] = {128, 128, 128};
+	Upload(TextureId, Entry, Placeholder, 1, 1);
+	Entry.IsResident = false;
+	Entry.PendingReload = 0;
+}
+
+void TextureManager::Reload(GLuint TextureId, TextureEntry& Entry, int DroppedMips)
+{
+	if (Entry.File.empty())
+	{
+		return;
+	}
+
+	// Leitura, decodificacao e reducao ficam fora da thread do OpenGL; uma imagem 16k
+	// leva segundos para decodificar
+	const std::uint64_t Serial = NextReloadSerial++;
+	Entry.PendingReload = Serial;
+	AsyncIO::Get().Read(Entry.File, IOPriority::Normal, [this, TextureId, Serial, DroppedMips](IOResult& Result)
+	{
+		FinishedReload Finished;
+		Finished.TextureId = TextureId;
+		Finished.Serial = Serial;
+		Finished.DroppedMips = DroppedMips;
+
+		DecodedImage Image;
+		if (Result.Error == 0 && !Result.Cancelled && Decode(Result.Data.data(), Result.Data.size(), Image))
+		{
+			Finished.Width = Image.Width;
+			Finished.Height = Image.Height;
+			Finished.Image.Width = MipSize(Image.Width, DroppedMips);
+			Finished.Image.Height = MipSize(Image.Height, DroppedMips);
+			if (DroppedMips > 0)
+			{
+				Finished.Image.Pixels.resize(std::size_t(Finished.Image.Width) * Finished.Image.Height * 3);
+				stbir_resize_uint8(Image.Pixels.data(), Image.Width, Image.Height, 0,
+					Finished.Image.Pixels.data(), Finished.Image.Width, Finished.Image.Height, 0, 3);
+			}
+			else
+			{
+				Finished.Image.Pixels = std::move(Image.Pixels);
+			}
+		}
+
+		std::lock_guard<std::mutex> Lock{FinishedMutex};
+		FinishedReloads.push_back(std::move(Finished));
+	});
+}
+
+void TextureManager::ApplyReloads()
+{
+	std::vector<FinishedReload> Reloads;
+	{
+		std::lock_guard<std::mutex> Lock{FinishedMutex};
+		Reloads.swap(FinishedReloads);
+	}
+
+	for (FinishedReload& Finished : Reloads)
+	{
+		auto It = Entries.find(Finished.TextureId);
+		if (It == Entries.end() || It->second.PendingReload != Finished.Serial)
+		{
+			continue;
+		}
+
+		TextureEntry& Entry = It->second;
+		Entry.PendingReload = 0;
+		if (Finished.Image.Pixels.empty())
+		{
+			std::cerr << "Falha ao recarregar a textura: " << Entry.File << std::endl;
+			Entry.ReloadFailed = true;
+			continue;
+		}
+
+		Entry.Width = Finished.Width;
+		Entry.Height = Finished.Height;
+		Entry.DroppedMips = Finished.DroppedMips;
+		Upload(Finished.TextureId, Entry, Finished.Image.Pixels.data(), Finished.Image.Width, Finished.Image.Height);
+	}
+}
+
+int TextureManager::ChooseDroppedMips(int Width, int Height, int MinDroppedMips) const
+{
+	int DroppedMips = MinDroppedMips;
+	const int MaxDroppedMips = CountMipLevels(Width, Height) - 1;
+	while (DroppedMips < MaxDroppedMips)
+	{
+		const int LevelWidth = MipSize(Width, DroppedMips);
+		const int LevelHeight = MipSize(Height, DroppedMips);
+		const bool FitsHardware = MaxTextureSize == 0 || (LevelWidth <= MaxTextureSize && LevelHeight <= MaxTextureSize);
+		const bool FitsBudget = ComputeTextureBytes(LevelWidth, LevelHeight) <= BudgetBytes ||
+			std::max(LevelWidth, LevelHeight) <= MinDegradedSize;
+		if (FitsHardware && FitsBudget)
+		{
+			break;
+		}
+		++DroppedMips;
+	}
+	return DroppedMips;
+}
+
+void TextureManager::Upload(GLuint TextureId, TextureEntry& Entry, const unsigned char* Pixels, int Width, int Height)
+{
+	const int OldNumLevels = Entry.NumLevels;
+	const int NewNumLevels = CountMipLevels(Width, Height);
+
+	// Habilitar a textura para ser modificada
+	glBindTexture(GL_TEXTURE_2D, TextureId);
+
+	// Copiar a textura para a memoria de video (GPU)
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, Width, Height, 0, GL_RGB, GL_UNSIGNED_BYTE, Pixels);
+
+	// Liberar os niveis que sobraram da resolucao anterior
+	for (int Level = NewNumLevels; Level < OldNumLevels; ++Level)
+	{
+		glTexImage2D(GL_TEXTURE_2D, Level, GL_RGB, 0, 0, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, NewNumLevels - 1);
+
+	// Filtros de magnificacao e minificacao
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+
+	// Configurar Texture Wrapping
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	// Gerar o mipmap a partir da textura
+	glGenerateMipmap(GL_TEXTURE_2D);
+
+	// Desligar a textura ja copiada na GPU
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	ResidentBytes -= Entry.Bytes;
+	Entry.Bytes = ComputeTextureBytes(Width, Height);
+	Entry.NumLevels = NewNumLevels;
+	Entry.IsResident = true;
+	ResidentBytes += Entry.Bytes;
+}
+
+void TextureManager::UploadReduced(GLuint TextureId, TextureEntry& Entry, const unsigned char* Pixels, int Width, int Height)
+{
+	if (Entry.DroppedMips > 0)
+	{
+		const int ReducedWidth = MipSize(Width, Entry.DroppedMips);
+		const int ReducedHeight = MipSize(Height, Entry.DroppedMips);
+		std::vector<unsigned char> Reduced(std::size_t(ReducedWidth) * ReducedHeight * 3);
+		stbir_resize_uint8(Pixels, Width, Height, 0, Reduced.data(), ReducedWidth, ReducedHeight, 0, 3);
+		Upload(TextureId, Entry, Reduced.data(), ReducedWidth, ReducedHeight);
+	}
+	else
+	{
+		Upload(TextureId, Entry, Pixels, Width, Height);
+	}
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Niveis da cadeia completa de mipmaps de uma textura
+int CountMipLevels(int Width, int Height);
+
+// Bytes estimados de uma textura GL_RGB8 com todos os mipmaps. Os drivers costumam
+// alinhar cada texel em 4 bytes
+std::size_t ComputeTextureBytes(int Width, int Height);
+
+// Gerenciador global da memoria de textura. Contabiliza os bytes de cada textura
+// criada (incluindo a cadeia de mipmaps) e mantem o total dentro de um orcamento
+// de VRAM. Quando o orcamento estoura, descarta os mips do topo ou despeja as
+// texturas amostradas ha mais tempo (LRU), recarregando-as quando voltam a ser usadas.
+// Os recarregamentos sao lidos pelo AsyncIO e decodificados nas threads de trabalho;
+// ate terminarem a textura continua com a resolucao menor que ja tinha
+class TextureManager
+{
+public:
+	struct Stats
+	{
+		std::size_t ResidentBytes = 0;
+		std::size_t BudgetBytes = 0;
+		int NumTextures = 0;
+		int NumEvicted = 0;
+		int NumDegraded = 0;
+	};
+
+	// Pixels RGB de uma imagem decodificada fora da thread do OpenGL
+	struct DecodedImage
+	{
+		std::vector<unsigned char> Pixels;
+		int Width = 0;
+		int Height = 0;
+	};
+
+	static TextureManager& Get();
+
+	// Decodifica um arquivo de imagem ja lido para a memoria. Nao usa OpenGL e
+	// pode ser chamado de qualquer thread, por exemplo no callback do AsyncIO
+	static bool Decode(const unsigned char* FileData, std::size_t FileSize, DecodedImage& Image);
+
+	// Orcamento de memoria de video em bytes
+	void SetBudget(std::size_t BudgetBytes);
+
+	// Quantos frames sem amostragem ate a textura poder ser despejada inteira
+	void SetEvictAfterFrames(std::uint64_t NumFrames);
+
+	// Decodifica o arquivo e cria a textura respeitando o orcamento
+	GLuint Load(const char* TextureFile);
+
+	// Cria a textura a partir de pixels RGB ja decodificados. Se TextureFile nao
+	// for vazio, o arquivo e usado para recarregar a textura depois de despejada
+	GLuint Create(const unsigned char* Pixels, int Width, int Height, const std::string& TextureFile);
+
+	void Release(GLuint TextureId);
+
+	// Troca o conteudo da textura por uma imagem ja decodificada mantendo o mesmo
+	// identificador, entao quem ja usa TextureId passa a amostrar a imagem nova.
+	// Chamar entre frames, na thread do OpenGL
+	bool Replace(GLuint TextureId, const DecodedImage& Image);
+
+	// Texturas criadas a partir do arquivo (o caminho usado em Load ou Create)
+	std::vector<GLuint> FindByFile(const std::string& TextureFile) const;
+
+	// Avanca o carimbo de frame, envia os recarregamentos que terminaram e aplica o
+	// orcamento. Chamar uma vez por frame
+	void BeginFrame();
+
+	// Marca a textura como amostrada no frame atual, pedindo o recarregamento se tiver
+	// sido despejada
+	void Touch(GLuint TextureId);
+
+	// glActiveTexture + Touch + glBindTexture
+	void Bind(GLenum TextureUnit, GLuint TextureId);
+
+	Stats GetStats() const;
+
+private:
+	struct TextureEntry
+	{
+		std::string File;
+		int Width = 0;          // Resolucao original da imagem
+		int Height = 0;
+		int DroppedMips = 0;    // Quantos niveis do topo foram descartados
+		int NumLevels = 0;      // Niveis de mipmap atualmente alocados
+		bool IsResident = false;
+		bool ReloadFailed = false;      // Nao tenta de novo ate a imagem ser trocada por Replace
+		std::uint64_t PendingReload = 0;    // Numero do recarregamento em andamento, 0 se nenhum
+		std::uint64_t LastUsedFrame = 0;
+		std::size_t Bytes = 0;
+	};
+
+	// Imagem recarregada nas threads de trabalho, ja reduzida em DroppedMips niveis.
+	// Pixels vazio se a leitura ou a decodificacao falhou
+	struct FinishedReload
+	{
+		GLuint TextureId = 0;
+		std::uint64_t Serial = 0;
+		int DroppedMips = 0;
+		int Width = 0;          // Resolucao original da imagem
+		int Height = 0;
+		DecodedImage Image;
+	};
+
+	TextureManager() = default;
+
+	void EnforceBudget();
+	void RestoreOne();
+	void ApplyReloads();
+	bool DropTopMip(GLuint TextureId, TextureEntry& Entry);
+	void Evict(GLuint TextureId, TextureEntry& Entry);
+	void Reload(GLuint TextureId, TextureEntry& Entry, int DroppedMips);
+	int ChooseDroppedMips(int Width, int Height, int MinDroppedMips) const;
+	void Upload(GLuint TextureId, TextureEntry& Entry, const unsigned char* Pixels, int Width, int Height);
+	void UploadReduced(GLuint TextureId, TextureEntry& Entry, const unsigned char* Pixels, int Width, int Height);
+
+	std::unordered_map<GLuint, TextureEntry> Entries;
+	std::size_t BudgetBytes = std::size_t{512} * 1024 * 1024;
+	std::size_t ResidentBytes = 0;
+	std::uint64_t EvictAfterFrames = 120;
+	std::uint64_t CurrentFrame = 1;
+	GLint MaxTextureSize = 0;
+
+	// Recarregamentos terminados pelos jobs, enviados em BeginFrame. Cada pedido tem
+	// um numero proprio para que um resultado atrasado nao sobrescreva uma textura
+	// que mudou (ou foi liberada e teve o identificador reaproveitado) no meio tempo
+	std::uint64_t NextReloadSerial = 1;
+	std::mutex FinishedMutex;
+	std::vector<FinishedReload> FinishedReloads;
+};
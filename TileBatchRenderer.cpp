@@ -0,0 +1,206 @@
+#include "TileBatchRenderer.h"
+
+#include <algorithm>
+#include <cassert>
+
+// Ponto de ligacao do SSBO com os dados por draw (binding = 0 em globe_vert.glsl)
+constexpr GLuint DrawDataBinding = 0;
+
+bool TileBatchRenderer::IsSupported()
+{
+	return GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_storage_buffer_object && GLEW_ARB_shader_draw_parameters;
+}
+
+static void SetupVertexArray(GLuint VertexArray, GLuint VertexBuffer, GLuint IndexBuffer)
+{
+	glBindVertexArray(VertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBuffer);
+
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glEnableVertexAttribArray(3);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(TileVertex), reinterpret_cast<void*>(offsetof(TileVertex, Position)));
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(TileVertex), reinterpret_cast<void*>(offsetof(TileVertex, Normal)));
+	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(TileVertex), reinterpret_cast<void*>(offsetof(TileVertex, UV)));
+	glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(TileVertex), reinterpret_cast<void*>(offsetof(TileVertex, PositionLow)));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+void TileBatchRenderer::Init(std::size_t InitialVertexCapacity, std::size_t InitialIndexCapacity)
+{
+	VertexCapacity = std::max<std::size_t>(InitialVertexCapacity, 1);
+	IndexCapacity = std::max<std::size_t>(InitialIndexCapacity, 1);
+
+	glGenVertexArrays(1, &VertexArray);
+	glGenBuffers(1, &VertexBuffer);
+	glGenBuffers(1, &IndexBuffer);
+	glGenBuffers(1, &IndirectBuffer);
+	glGenBuffers(1, &DrawDataBuffer);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, VertexCapacity * sizeof(TileVertex), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, IndexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, IndexCapacity * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	SetupVertexArray(VertexArray, VertexBuffer, IndexBuffer);
+}
+
+void TileBatchRenderer::Destroy()
+{
+	glDeleteBuffers(1, &VertexBuffer);
+	glDeleteBuffers(1, &IndexBuffer);
+	glDeleteBuffers(1, &IndirectBuffer);
+	glDeleteBuffers(1, &DrawDataBuffer);
+	glDeleteVertexArrays(1, &VertexArray);
+
+	VertexArray = VertexBuffer = IndexBuffer = IndirectBuffer = DrawDataBuffer = 0;
+	VertexCount = IndexCount = VertexCapacity = IndexCapacity = DrawCapacity = 0;
+	Commands.clear();
+	DrawData.clear();
+}
+
+void TileBatchRenderer::GrowArena(std::size_t MinVertexCapacity, std::size_t MinIndexCapacity)
+{
+	std::size_t NewVertexCapacity = VertexCapacity;
+	std::size_t NewIndexCapacity = IndexCapacity;
+	while (NewVertexCapacity < MinVertexCapacity)
+	{
+		NewVertexCapacity *= 2;
+	}
+	while (NewIndexCapacity < MinIndexCapacity)
+	{
+		NewIndexCapacity *= 2;
+	}
+
+	// Copiar o conteudo da arena antiga para os novos buffers direto na GPU
+	GLuint NewBuffers[2];
+	glGenBuffers(2, NewBuffers);
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, NewBuffers[0]);
+	glBufferData(GL_COPY_WRITE_BUFFER, NewVertexCapacity * sizeof(TileVertex), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, VertexBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, VertexCount * sizeof(TileVertex));
+
+	glBindBuffer(GL_COPY_WRITE_BUFFER, NewBuffers[1]);
+	glBufferData(GL_COPY_WRITE_BUFFER, NewIndexCapacity * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_READ_BUFFER, IndexBuffer);
+	glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, IndexCount * sizeof(GLuint));
+
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+	glDeleteBuffers(1, &VertexBuffer);
+	glDeleteBuffers(1, &IndexBuffer);
+	VertexBuffer = NewBuffers[0];
+	IndexBuffer = NewBuffers[1];
+	VertexCapacity = NewVertexCapacity;
+	IndexCapacity = NewIndexCapacity;
+
+	SetupVertexArray(VertexArray, VertexBuffer, IndexBuffer);
+}
+
+TileMeshHandle TileBatchRenderer::AddMesh(const std::vector<TileVertex>& Vertices, const std::vector<GLuint>& Indices)
+{
+	if (VertexCount + Vertices.size() > VertexCapacity || IndexCount + Indices.size() > IndexCapacity)
+	{
+		GrowArena(VertexCount + Vertices.size(), IndexCount + Indices.size());
+	}
+
+	TileMeshHandle Mesh;
+	Mesh.FirstIndex = static_cast<GLuint>(IndexCount);
+	Mesh.IndexCount = static_cast<GLuint>(Indices.size());
+	Mesh.BaseVertex = static_cast<GLint>(VertexCount);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, VertexCount * sizeof(TileVertex), Vertices.size() * sizeof(TileVertex), Vertices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, IndexBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, IndexCount * sizeof(GLuint), Indices.size() * sizeof(GLuint), Indices.data());
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	VertexCount += Vertices.size();
+	IndexCount += Indices.size();
+
+	return Mesh;
+}
+
+void TileBatchRenderer::BeginFrame()
+{
+	Commands.clear();
+	DrawData.clear();
+}
+
+void TileBatchRenderer::AddDraw(const TileMeshHandle& Mesh, const TileDrawData& NewDrawData)
+{
+	DrawElementsIndirectCommand Command;
+	Command.Count = Mesh.IndexCount;
+	Command.InstanceCount = 1;
+	Command.FirstIndex = Mesh.FirstIndex;
+	Command.BaseVertex = Mesh.BaseVertex;
+	Command.BaseInstance = 0;
+
+	Commands.push_back(Command);
+	DrawData.push_back(NewDrawData);
+}
+
+void TileBatchRenderer::SubmitIndirect(GLuint CommandBuffer, GLuint DrawDataBuffer, GLuint CountBuffer, GLsizei MaxDraws)
+{
+	if (MaxDraws == 0)
+	{
+		return;
+	}
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, CommandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DrawDataBinding, DrawDataBuffer);
+	glBindVertexArray(VertexArray);
+
+	if (GLEW_ARB_indirect_parameters)
+	{
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, CountBuffer);
+		glMultiDrawElementsIndirectCountARB(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, MaxDraws, 0);
+		glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+	}
+	else
+	{
+		glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, MaxDraws, 0);
+	}
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DrawDataBinding, 0);
+}
+
+void TileBatchRenderer::Submit()
+{
+	if (Commands.empty())
+	{
+		return;
+	}
+
+	// Os dois buffers sao reescritos a cada frame. Realocar com glBufferData
+	// deixa o driver descartar a copia anterior sem esperar a GPU terminar de usa-la
+	DrawCapacity = std::max(DrawCapacity, Commands.size());
+
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, IndirectBuffer);
+	glBufferData(GL_DRAW_INDIRECT_BUFFER, DrawCapacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, Commands.size() * sizeof(DrawElementsIndirectCommand), Commands.data());
+
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, DrawDataBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, DrawCapacity * sizeof(TileDrawData), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, DrawData.size() * sizeof(TileDrawData), DrawData.data());
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DrawDataBinding, DrawDataBuffer);
+
+	glBindVertexArray(VertexArray);
+
+	// Todos os tiles em uma unica chamada, o custo na CPU nao depende do numero de tiles
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, static_cast<GLsizei>(Commands.size()), 0);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "GlobeTiles.h"
+
+// Layout exigido pelo glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand
+{
+	GLuint Count;
+	GLuint InstanceCount;
+	GLuint FirstIndex;
+	GLint BaseVertex;
+	GLuint BaseInstance;
+};
+
+// Onde a malha de um tile ficou dentro da arena compartilhada
+struct TileMeshHandle
+{
+	GLuint FirstIndex = 0;
+	GLuint IndexCount = 0;
+	GLint BaseVertex = 0;
+};
+
+// Dados por draw, lidos no vertex shader atraves do gl_DrawID (layout std430)
+struct TileDrawData
+{
+	glm::vec4 Center;   // xyz: centro do tile relativo ao olho, w: nivel do tile
+};
+
+// Desenha todos os tiles do globo com um unico glMultiDrawElementsIndirect.
+// As malhas ficam em uma arena de vertices/indices compartilhada, os comandos
+// de desenho em um buffer indireto e os dados por tile em um SSBO indexado por gl_DrawID
+class TileBatchRenderer
+{
+public:
+	// Exige multi draw indirect, SSBO e gl_DrawID (OpenGL 4.3 + ARB_shader_draw_parameters)
+	static bool IsSupported();
+
+	void Init(std::size_t InitialVertexCapacity, std::size_t InitialIndexCapacity);
+	void Destroy();
+
+	TileMeshHandle AddMesh(const std::vector<TileVertex>& Vertices, const std::vector<GLuint>& Indices);
+
+	// Limpa a lista de draws do frame
+	void BeginFrame();
+	void AddDraw(const TileMeshHandle& Mesh, const TileDrawData& DrawData);
+
+	// Envia os comandos e os dados por draw e desenha tudo. O programa e as
+	// texturas ja devem estar ativos
+	void Submit();
+
+	// Desenha a partir de buffers gerados na GPU (ver GpuCulling). CountBuffer guarda
+	// o numero de draws; sem ARB_indirect_parameters os MaxDraws comandos sao
+	// enviados e os que sobraram precisam estar zerados
+	void SubmitIndirect(GLuint CommandBuffer, GLuint DrawDataBuffer, GLuint CountBuffer, GLsizei MaxDraws);
+
+	std::size_t GetDrawCount() const { return Commands.size(); }
+
+private:
+	void GrowArena(std::size_t MinVertexCapacity, std::size_t MinIndexCapacity);
+
+	GLuint VertexArray = 0;
+	GLuint VertexBuffer = 0;
+	GLuint IndexBuffer = 0;
+	GLuint IndirectBuffer = 0;
+	GLuint DrawDataBuffer = 0;
+
+	std::size_t VertexCount = 0;
+	std::size_t IndexCount = 0;
+	std::size_t VertexCapacity = 0;
+	std::size_t IndexCapacity = 0;
+	std::size_t DrawCapacity = 0;
+
+	std::vector<DrawElementsIndirectCommand> Commands;
+	std::vector<TileDrawData> DrawData;
+};
@@ -0,0 +1,155 @@
+#include "UniformBuffers.h"
+
+#include <iostream>
+#include <cstring>
+
+void BindUniformBlocks(GLuint ProgramId)
+{
+	const GLuint FrameBlockIndex = glGetUniformBlockIndex(ProgramId, "FrameBlock");
+	if (FrameBlockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(ProgramId, FrameBlockIndex, FrameBlockBinding);
+	}
+
+	const GLuint ObjectBlockIndex = glGetUniformBlockIndex(ProgramId, "ObjectBlock");
+	if (ObjectBlockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(ProgramId, ObjectBlockIndex, ObjectBlockBinding);
+	}
+
+	const GLuint AtmosphereBlockIndex = glGetUniformBlockIndex(ProgramId, "AtmosphereBlock");
+	if (AtmosphereBlockIndex != GL_INVALID_INDEX)
+	{
+		glUniformBlockBinding(ProgramId, AtmosphereBlockIndex, AtmosphereBlockBinding);
+	}
+}
+
+static std::size_t AlignUp(std::size_t Value, std::size_t Alignment)
+{
+	return (Value + Alignment - 1) / Alignment * Alignment;
+}
+
+void UniformRingBuffer::Init(std::size_t BytesPerFrame)
+{
+	// glBindBufferRange exige offsets alinhados a GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+	GLint OffsetAlignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &OffsetAlignment);
+	Alignment = OffsetAlignment > 0 ? OffsetAlignment : 256;
+
+	RegionSize = AlignUp(BytesPerFrame, Alignment);
+	const std::size_t TotalSize = RegionSize * NumFramesInFlight;
+
+	glGenBuffers(1, &Buffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, Buffer);
+
+	if (GLEW_ARB_buffer_storage)
+	{
+		const GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_UNIFORM_BUFFER, TotalSize, nullptr, Flags);
+		MappedData = static_cast<unsigned char*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, TotalSize, Flags));
+	}
+	else
+	{
+		std::cout << "ARB_buffer_storage nao suportado, uniform buffers serao atualizados com glBufferSubData" << std::endl;
+		glBufferData(GL_UNIFORM_BUFFER, TotalSize, nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
+
+void UniformRingBuffer::Destroy()
+{
+	for (GLsync& Fence : Fences)
+	{
+		if (Fence)
+		{
+			glDeleteSync(Fence);
+			Fence = nullptr;
+		}
+	}
+
+	if (MappedData)
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, Buffer);
+		glUnmapBuffer(GL_UNIFORM_BUFFER);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		MappedData = nullptr;
+	}
+
+	glDeleteBuffers(1, &Buffer);
+	Buffer = 0;
+
+	for (const auto& [Binding, OverflowBuffer] : OverflowBuffers)
+	{
+		glDeleteBuffers(1, &OverflowBuffer);
+	}
+	OverflowBuffers.clear();
+}
+
+void UniformRingBuffer::BeginFrame()
+{
+	GLsync& Fence = Fences[CurrentRegion];
+	if (Fence)
+	{
+		// Normalmente o fence ja foi sinalizado; so esperamos se a CPU estiver
+		// mais de NumFramesInFlight frames a frente da GPU
+		GLenum WaitResult = glClientWaitSync(Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		while (WaitResult == GL_TIMEOUT_EXPIRED)
+		{
+			WaitResult = glClientWaitSync(Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+		}
+		glDeleteSync(Fence);
+		Fence = nullptr;
+	}
+
+	WriteOffset = 0;
+}
+
+void UniformRingBuffer::EndFrame()
+{
+	Fences[CurrentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	CurrentRegion = (CurrentRegion + 1) % NumFramesInFlight;
+}
+
+GLintptr UniformRingBuffer::Push(GLuint Binding, const void* Data, std::size_t Size)
+{
+	if (WriteOffset + Size > RegionSize)
+	{
+		// Escrever alem da regiao atingiria a do frame que a GPU pode estar lendo.
+		// glBufferData troca o armazenamento do buffer avulso, entao os desenhos ja
+		// enviados continuam com os dados antigos
+		if (!OverflowReported)
+		{
+			std::cerr << "Regiao do anel de uniform buffers cheia (" << RegionSize << " bytes por frame), "
+				<< "usando buffers avulsos; aumente BytesPerFrame" << std::endl;
+			OverflowReported = true;
+		}
+
+		GLuint& OverflowBuffer = OverflowBuffers[Binding];
+		if (OverflowBuffer == 0)
+		{
+			glGenBuffers(1, &OverflowBuffer);
+		}
+		glBindBuffer(GL_UNIFORM_BUFFER, OverflowBuffer);
+		glBufferData(GL_UNIFORM_BUFFER, Size, Data, GL_STREAM_DRAW);
+		glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		glBindBufferBase(GL_UNIFORM_BUFFER, Binding, OverflowBuffer);
+		return -1;
+	}
+
+	const GLintptr Offset = CurrentRegion * RegionSize + WriteOffset;
+	WriteOffset = AlignUp(WriteOffset + Size, Alignment);
+
+	if (MappedData)
+	{
+		std::memcpy(MappedData + Offset, Data, Size);
+	}
+	else
+	{
+		glBindBuffer(GL_UNIFORM_BUFFER, Buffer);
+		glBufferSubData(GL_UNIFORM_BUFFER, Offset, Size, Data);
+	}
+
+	glBindBufferRange(GL_UNIFORM_BUFFER, Binding, Buffer, Offset, Size);
+	return Offset;
+}
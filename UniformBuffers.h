@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <unordered_map>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Pontos de ligacao dos blocos uniformes usados por todos os shaders
+constexpr GLuint FrameBlockBinding = 0;
+constexpr GLuint ObjectBlockBinding = 1;
+constexpr GLuint AtmosphereBlockBinding = 2;
+
+// Bloco "FrameBlock" (std140), atualizado uma vez por frame. Declarado para os
+// shaders em shaders/include/uniform_blocks.glsl
+struct FrameUniforms
+{
+	glm::mat4 View;
+	glm::mat4 Projection;
+	glm::mat4 ViewProjection;
+	glm::vec4 CameraPosition;   // Mundo
+	glm::vec4 SunDirection;     // Mundo, normalizada
+	glm::vec4 EllipsoidRadii;
+	glm::vec2 ViewportSize;
+	float Time;                 // Segundos desde o inicio
+	float DeltaTime;
+};
+
+// Bloco "ObjectBlock" (std140), um por objeto desenhado
+struct ObjectUniforms
+{
+	glm::mat4 Model;
+	glm::mat4 ModelViewProjection;      // Relativa ao olho, sem a translacao da camera
+	glm::vec4 CameraPosition;           // Camera no espaco do objeto (parte alta)
+	glm::vec4 CameraPositionLow;        // Parte baixa, ver SplitDouble em Camera.h
+};
+
+// Liga os blocos FrameBlock, ObjectBlock e AtmosphereBlock do programa aos pontos de
+// ligacao padrao
+void BindUniformBlocks(GLuint ProgramId);
+
+// Anel de uniform buffer com uma regiao por frame em voo. Com ARB_buffer_storage
+// o buffer fica mapeado de forma persistente e os dados sao copiados direto para
+// ele; cada regiao e protegida por um fence para a CPU nunca sobrescrever dados
+// que a GPU ainda esta lendo. Os objetos ligam seus dados com glBindBufferRange
+class UniformRingBuffer
+{
+public:
+	static constexpr int NumFramesInFlight = 3;
+
+	void Init(std::size_t BytesPerFrame);
+	void Destroy();
+
+	// Espera a GPU liberar a regiao do frame atual
+	void BeginFrame();
+
+	// Protege a regiao do frame com um fence e avanca para a proxima
+	void EndFrame();
+
+	// Copia os dados para o anel e liga o intervalo ao ponto de ligacao. Se a regiao
+	// do frame encher, os dados vao para um buffer avulso do ponto de ligacao,
+	// atualizado com glBufferData, e o retorno e -1
+	GLintptr Push(GLuint Binding, const void* Data, std::size_t Size);
+
+	template<typename T>
+	GLintptr Push(GLuint Binding, const T& Data)
+	{
+		return Push(Binding, &Data, sizeof(T));
+	}
+
+	bool IsPersistent() const { return MappedData != nullptr; }
+
+private:
+	GLuint Buffer = 0;
+	unsigned char* MappedData = nullptr;
+	std::size_t RegionSize = 0;
+	std::size_t Alignment = 256;
+	std::size_t WriteOffset = 0;
+	int CurrentRegion = 0;
+	std::array<GLsync, NumFramesInFlight> Fences{};
+
+	// Buffers usados quando a regiao do frame enche, um por ponto de ligacao
+	std::unordered_map<GLuint, GLuint> OverflowBuffers;
+	bool OverflowReported = false;
+};
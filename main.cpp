@@ -2,7 +2,13 @@
 #include <iostream>
 #include <cassert>
 #include <array>
-#include <fstream>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <mutex>
 
 #include <GL/glew.h>
 
@@ -11,29 +17,176 @@
 #include <glm/glm.hpp>
 #include <glm/ext.hpp>
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+#include "TextureManager.h"
+#include "MarkerLayer.h"
+#include "GlobeTiles.h"
+#include "TileBatchRenderer.h"
+#include "UniformBuffers.h"
+#include "Camera.h"
+#include "Culling.h"
+#include "GpuCulling.h"
+#include "FrameScheduler.h"
+#include "RenderThread.h"
+#include "JobSystem.h"
+#include "AsyncIO.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderVariants.h"
+#include "FileWatcher.h"
+#include "LabelLayer.h"
+#include "LabelRenderer.h"
+#include "PolylineLayer.h"
+#include "GeoData.h"
+#include "Picking.h"
+#include "SunPosition.h"
+#include "Atmosphere.h"
+#include "CloudLayer.h"
+#include "ImagerySequence.h"
 
 const int Width = 800;
 const int Height = 600;
+const std::size_t TextureBudgetBytes = std::size_t{512} * 1024 * 1024;
 
-std::string ReadFile(const char *FilePath)
+// Raios do elipsoide WGS84 em metros
+const glm::dvec3 EllipsoidRadii{6378137.0, 6378137.0, 6356752.314245};
+
+// Distancia inicial da camera ao centro da Terra, em raios equatoriais
+const double CameraDistanceInRadii = 3.0;
+
+// Nivel do quadtree usado para os tiles do globo e segmentos por lado de cada tile
+const int GlobeTileLevel = 3;
+const int GlobeTileResolution = 16;
+
+// Ritmo padrao do loop: quadros por segundo, vsync e passos fixos de simulacao por segundo
+const double DefaultTargetFrameRate = 60.0;
+const int DefaultSwapInterval = 1;
+const double SimulationRate = 120.0;
+
+// Velocidade de rotacao da camera em torno do eixo da Terra, em graus por segundo
+const double CameraOrbitSpeed = 4.0;
+
+// Altura dos nomes das cidades na tela e da fonte rasterizada no atlas, em pixels
+const float LabelTextHeight = 14.0f;
+const float LabelFontPixelHeight = 32.0f;
+const int LabelAtlasSize = 1024;
+
+// Grade de coordenadas sobre o globo: espacamento das linhas e passo dos pontos em
+// graus, e largura das linhas em pixels
+const double GraticuleSpacing = 30.0;
+const double GraticuleStep = 1.0;
+const float GraticuleLineWidth = 1.5f;
+
+// Erro de simplificacao aceito nas polilinhas, em pixels na tela
+const double PolylineMaxErrorPixels = 0.5;
+
+// Linhas e pontos do arquivo de dados vetoriais (--geodata): largura das linhas e
+// diametro dos pontos em pixels
+const float GeoDataLineWidth = 2.0f;
+const float GeoDataPointSize = 6.0f;
+
+// Tolerancia em pixels em volta dos marcadores para o cursor e aumento do marcador
+// sob ele
+const double PickRadiusPixels = 4.0;
+const float HoveredMarkerScale = 1.5f;
+
+// Tempo que um arquivo alterado precisa ficar sem mudar antes de ser recarregado
+const double AssetReloadDebounce = 0.2;
+
+// Espaco no anel de uniform buffers para os blocos de um frame
+const std::size_t UniformBytesPerFrame = 64 * 1024;
+
+// Recursos opcionais do shader do globo, um bit por #define de globe_frag.glsl
+enum GlobeShaderFeature : std::uint32_t
 {
-	std::string FileContents;
-	std::cout << "Lendo arquivo: " << FilePath << std::endl;
-	if (std::ifstream FileStream{FilePath, std::ios::in})
+	GlobeLighting = 1u << 0,
+	GlobeShowTileLevels = 1u << 1,
+	GlobeImagerySequence = 1u << 2,
+};
+const std::vector<std::string> GlobeShaderFeatureDefines = {"GLOBE_LIGHTING", "SHOW_TILE_LEVELS", "IMAGERY_SEQUENCE"};
+
+// Largura do terminador em cosseno do angulo com o sol (TerminatorWidth em lighting.glsl)
+const double GlobeTerminatorWidth = 0.1;
+
+// Tempo por frame para compilar variantes de shader previstas e quanto a frente
+// a posicao da camera e extrapolada para preve-las
+const double ShaderWarmUpBudget = 0.002;
+const double ShaderPredictionSeconds = 2.0;
+
+// Segundos no relogio do sol por segundo real. 1 acompanha a hora UTC atual; com
+// valores como 3600 da para ver o terminador andar
+const double SunTimeScale = 1.0;
+
+// Tabelas de espalhamento da atmosfera, calculadas na primeira execucao, e a
+// exposicao que leva a radiancia do ceu para a tela
+const char* AtmosphereCacheFile = "atmosphere.lut";
+const float AtmosphereExposure = 12.0f;
+
+// Nuvens: segundos entre dois campos completos e tiles comecados por frame. Os dois
+// juntos definem quanto da CPU a animacao usa
+const double CloudKeyframeSeconds = 8.0;
+const int CloudMaxTilesPerFrame = 4;
+
+// Sequencia de imagens (--imagery): segundos de cada imagem na tela, incluindo a
+// transicao para a seguinte
+const double ImageryFrameSeconds = 2.0;
+const double ImageryFadeSeconds = 0.75;
+
+// Recursos do shader do globo vistos de CameraPosition. A iluminacao so e ligada
+// quando parte do lado noturno aparece: a calota visivel tem meio angulo
+// acos(R / d) em torno da direcao da camera, e o ponto mais escuro dela fica esse
+// angulo alem do angulo entre a camera e o sol
+std::uint32_t SelectGlobeFeatures(const glm::dvec3& CameraPosition, const glm::dvec3& SunDirection, bool ShowTileLevels, bool ShowImagery)
+{
+	const double Radius = EllipsoidRadii.z;
+	const double Distance = glm::length(CameraPosition);
+	const double CapAngle = Distance > Radius ? std::acos(Radius / Distance) : 0.0;
+	const double SunAngle = std::acos(glm::clamp(glm::dot(CameraPosition / Distance, SunDirection), -1.0, 1.0));
+	const double DarkestCosine = std::cos(std::min(glm::pi<double>(), SunAngle + CapAngle));
+
+	std::uint32_t Features = 0;
+	if (DarkestCosine < GlobeTerminatorWidth)
 	{
-		// Ler dentro do FileContents o conteudo do arquivo apontado por FilePath
-		FileContents.assign(std::istreambuf_iterator<char>(FileStream), std::istreambuf_iterator<char>());
+		Features |= GlobeLighting;
 	}
-	else
+	if (ShowTileLevels)
+	{
+		Features |= GlobeShowTileLevels;
+	}
+	if (ShowImagery)
 	{
-		std::cerr << "Falha ao abrir o arquivo: " << FilePath << std::endl;
+		Features |= GlobeImagerySequence;
 	}
-	return FileContents;
+	return Features;
+}
+
+// Depth do elipsoide visto pela camera, como o depth buffer de um frame so com o
+// globo (linha 0 embaixo, 1 onde nao ha globo). Usado para montar o Hi-Z na validacao
+// do culling sem desenhar nada
+std::vector<float> ComputeEllipsoidDepth(const Camera& View, int DepthWidth, int DepthHeight)
+{
+	const PickView Pick = MakePickView(View, glm::dvec2{DepthWidth, DepthHeight});
+	const glm::dmat4 ViewProjection = View.GetViewProjectionPrecise();
+	std::vector<float> Depth(std::size_t(DepthWidth) * DepthHeight, 1.0f);
+	JobSystem::Get().ParallelFor(0, DepthHeight, 0, [&](int RowBegin, int RowEnd)
+	{
+		for (int Row = RowBegin; Row < RowEnd; ++Row)
+		{
+			for (int Column = 0; Column < DepthWidth; ++Column)
+			{
+				// O cursor conta as linhas de cima para baixo
+				const PickRay Ray = ComputePickRay(Pick, glm::dvec2{Column + 0.5, DepthHeight - (Row + 0.5)});
+				double Distance = 0.0;
+				if (IntersectEllipsoid(Ray, EllipsoidRadii, Distance))
+				{
+					const glm::dvec4 Clip = ViewProjection * glm::dvec4{Ray.Direction * Distance, 1.0};
+					Depth[std::size_t(Row) * DepthWidth + Column] = static_cast<float>(glm::clamp(Clip.z / Clip.w * 0.5 + 0.5, 0.0, 1.0));
+				}
+			}
+		}
+	});
+	return Depth;
 }
 
-void CheckShader(GLuint ShaderId)
+bool CheckShader(GLuint ShaderId)
 {
 	// ShaderId tem que ser um identificador de um shader ja compilado
 
@@ -56,42 +209,14 @@ void CheckShader(GLuint ShaderId)
 
 			std::cout << "Erro no shader" << std::endl;
 			std::cout << ShaderInfoLog << std::endl;
-
-			assert(false);
 		}
 	}
+
+	return Result == GL_TRUE;
 }
 
-GLuint LoadShaders(const char *VertexShaderFile, const char *FragmentShaderFile)
+bool CheckProgram(GLuint ProgramId)
 {
-	std::string VertexShaderSource = ReadFile(VertexShaderFile);
-	std::string FragmentShaderSource = ReadFile(FragmentShaderFile);
-
-	assert(!VertexShaderSource.empty());
-	assert(!FragmentShaderSource.empty());
-
-	// Criar identificadores do Vertex e Fragment Shaders
-	GLuint VertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-	GLuint FragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-
-	std::cout << "Compilando: " << VertexShaderFile << std::endl;
-	const char *VertexShaderSourcePtr = VertexShaderSource.c_str();
-	glShaderSource(VertexShaderId, 1, &VertexShaderSourcePtr, nullptr);
-	glCompileShader(VertexShaderId);
-	CheckShader(VertexShaderId);
-
-	std::cout << "Compilando " << FragmentShaderFile << std::endl;
-	const char *FragmentShaderSourcePtr = FragmentShaderSource.c_str();
-	glShaderSource(FragmentShaderId, 1, &FragmentShaderSourcePtr, nullptr);
-	glCompileCommandListNV(FragmentShaderId);
-	CheckShader(FragmentShaderId);
-
-	std::cout << "Linkando o programa" << std::endl;
-	GLuint ProgramId = glCreateProgram();
-	glAttachShader(ProgramId, VertexShaderId);
-	glAttachShader(ProgramId, FragmentShaderId);
-	glLinkProgram(ProgramId);
-	
 	// Verificar o programa
 	GLint Result = GL_TRUE;
 	glGetProgramiv(ProgramId, GL_LINK_STATUS, &Result);
@@ -109,60 +234,165 @@ GLuint LoadShaders(const char *VertexShaderFile, const char *FragmentShaderFile)
 
 			std::cout << "Erro ao linkar o programa" << std::endl;
 			std::cout << ProgramInfoLog << std::endl;
-
-			assert(false);
 		}
 	}
 
+	return Result == GL_TRUE;
+}
+
+// Programas ja linkados, pela combinacao dos hashes dos estagios. Uma permutacao
+// cujos arquivos e defines nao mudaram reaproveita o programa sem recompilar
+std::unordered_map<std::uint64_t, GLuint> ProgramCache;
+
+std::uint64_t CombineHashes(std::uint64_t First, std::uint64_t Second)
+{
+	return First ^ (Second + 0x9e3779b97f4a7c15ull + (First << 6) + (First >> 2));
+}
+
+GLuint CompileShader(GLenum ShaderType, const char* ShaderFile, const ShaderSource& Source)
+{
+	GLuint ShaderId = glCreateShader(ShaderType);
+
+	std::cout << "Compilando " << ShaderFile << std::endl;
+	const char* ShaderSourcePtr = Source.Text.c_str();
+	glShaderSource(ShaderId, 1, &ShaderSourcePtr, nullptr);
+	glCompileShader(ShaderId);
+	if (!CheckShader(ShaderId))
+	{
+		glDeleteShader(ShaderId);
+		return 0;
+	}
+
+	return ShaderId;
+}
+
+// Tira o programa do cache e o destroi
+void ReleaseProgram(GLuint ProgramId)
+{
+	for (auto It = ProgramCache.begin(); It != ProgramCache.end();)
+	{
+		It = It->second == ProgramId ? ProgramCache.erase(It) : std::next(It);
+	}
+	glDeleteProgram(ProgramId);
+}
+
+GLuint LoadShaders(const char *VertexShaderFile, const char *FragmentShaderFile, const std::vector<std::string>& Defines = {})
+{
+	// Expandir os #include e injetar os defines; o resultado fica em cache
+	const ShaderSource* VertexShaderSource = ShaderPreprocessor::Get().Preprocess(VertexShaderFile, Defines);
+	const ShaderSource* FragmentShaderSource = ShaderPreprocessor::Get().Preprocess(FragmentShaderFile, Defines);
+
+	if (VertexShaderSource == nullptr || FragmentShaderSource == nullptr)
+	{
+		return 0;
+	}
+
+	const std::uint64_t ProgramHash = CombineHashes(VertexShaderSource->Hash, FragmentShaderSource->Hash);
+	auto CachedIt = ProgramCache.find(ProgramHash);
+	if (CachedIt != ProgramCache.end())
+	{
+		return CachedIt->second;
+	}
+
+	// Criar identificadores do Vertex e Fragment Shaders
+	GLuint VertexShaderId = CompileShader(GL_VERTEX_SHADER, VertexShaderFile, *VertexShaderSource);
+	GLuint FragmentShaderId = CompileShader(GL_FRAGMENT_SHADER, FragmentShaderFile, *FragmentShaderSource);
+	if (VertexShaderId == 0 || FragmentShaderId == 0)
+	{
+		glDeleteShader(VertexShaderId);
+		glDeleteShader(FragmentShaderId);
+		return 0;
+	}
+
+	std::cout << "Linkando o programa" << std::endl;
+	GLuint ProgramId = glCreateProgram();
+	glAttachShader(ProgramId, VertexShaderId);
+	glAttachShader(ProgramId, FragmentShaderId);
+	glLinkProgram(ProgramId);
+
+	const bool Linked = CheckProgram(ProgramId);
+
 	glDetachShader(ProgramId, VertexShaderId);
 	glDetachShader(ProgramId, FragmentShaderId);
 
 	glDeleteShader(VertexShaderId);
 	glDeleteShader(FragmentShaderId);
 
+	if (!Linked)
+	{
+		glDeleteProgram(ProgramId);
+		return 0;
+	}
+
+	// Ligar os blocos uniformes aos pontos de ligacao compartilhados
+	BindUniformBlocks(ProgramId);
+
+	ProgramCache[ProgramHash] = ProgramId;
 	return ProgramId;
 }
 
-GLuint LoadTexture(const char* TextureFile)
+GLuint LoadComputeShader(const char* ComputeShaderFile, const std::vector<std::string>& Defines = {})
 {
-	std::cout << "Carregando Textura " << TextureFile << std::endl;
+	const ShaderSource* ComputeShaderSource = ShaderPreprocessor::Get().Preprocess(ComputeShaderFile, Defines);
 
-	stbi_set_flip_vertically_on_load(true);
-
-	int TextureWidth = 0;
-	int TextureHeight = 0;
-	int NumberOfComponents = 0;
-	unsigned char* TextureData = stbi_load(TextureFile, &TextureWidth, &TextureHeight, &NumberOfComponents, 3);
-
-	assert(TextureData);
+	if (ComputeShaderSource == nullptr)
+	{
+		return 0;
+	}
 
-	// Gerar identificador da textura
-	GLuint TextureId;
-	glGenTextures(1, &TextureId);
+	auto CachedIt = ProgramCache.find(ComputeShaderSource->Hash);
+	if (CachedIt != ProgramCache.end())
+	{
+		return CachedIt->second;
+	}
 
-	// Habilitar a textura para ser modificada
-	glBindTexture(GL_TEXTURE_2D, TextureId);
-	
-	// Copiar a textura para a memoria de video (GPU)
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, TextureWidth, TextureHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, TextureData);
+	GLuint ComputeShaderId = CompileShader(GL_COMPUTE_SHADER, ComputeShaderFile, *ComputeShaderSource);
+	if (ComputeShaderId == 0)
+	{
+		return 0;
+	}
 
-	// Filtros de magnificacao e minificacao
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	std::cout << "Linkando o programa" << std::endl;
+	GLuint ProgramId = glCreateProgram();
+	glAttachShader(ProgramId, ComputeShaderId);
+	glLinkProgram(ProgramId);
+	const bool Linked = CheckProgram(ProgramId);
 
-	// Configurar Texture Wrapping
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+	glDetachShader(ProgramId, ComputeShaderId);
+	glDeleteShader(ComputeShaderId);
 
-	// Gerar o mipmap a partir da textura
-	glGenerateMipmap(GL_TEXTURE_2D);
+	if (!Linked)
+	{
+		glDeleteProgram(ProgramId);
+		return 0;
+	}
 
-	// Desligar a textura ja copiada na GPU
-	glBindTexture(GL_TEXTURE_2D, 0);
+	ProgramCache[ComputeShaderSource->Hash] = ProgramId;
+	return ProgramId;
+}
 
-	stbi_image_free(TextureData);
+// Troca o programa pelo recarregado. LoadShaders devolve o mesmo programa do cache
+// quando nenhuma fonte mudou, entao so os programas afetados sao recompilados. Com
+// erro de compilacao (NewProgramId 0) o programa anterior continua em uso
+void SwapProgram(GLuint& ProgramId, GLuint NewProgramId, const char* ShaderFile)
+{
+	if (NewProgramId == 0)
+	{
+		std::cout << "Mantendo o programa anterior de " << ShaderFile << std::endl;
+	}
+	else if (NewProgramId != ProgramId)
+	{
+		ReleaseProgram(ProgramId);
+		ProgramId = NewProgramId;
+		std::cout << "Programa recarregado: " << ShaderFile << std::endl;
+	}
+}
 
-	return TextureId;
+GLuint LoadTexture(const char* TextureFile)
+{
+	// A textura fica registrada no TextureManager, que contabiliza a memoria
+	// usada e pode descartar mips ou despejar a textura se o orcamento estourar
+	return TextureManager::Get().Load(TextureFile);
 }
 
 struct Vertex
@@ -172,12 +402,66 @@ struct Vertex
 	glm::vec2 UV;
 };
 
-int main()
+int main(int argc, char* argv[])
 {
+	// --validate-gpu-culling compara o culling na GPU com a referencia na CPU e encerra.
+	// Pode rodar sem GPU dedicada, por exemplo com LIBGL_ALWAYS_SOFTWARE=1 (llvmpipe)
+	// --fps N limita a taxa de quadros (0 = sem limite) e --vsync N define o swap interval.
+	// --font arquivo.ttf liga os nomes das cidades; o atlas de glifos fica em arquivo.ttf.glyphs
+	// --geodata arquivo.geodata desenha os dados vetoriais gerados pelo GeoConverter
+	// --imagery lista.txt reproduz as imagens da lista (uma por linha) no lugar da imagem fixa
+	bool ValidateGpuCulling = false;
+	std::string LabelFontFile;
+	std::string GeoDataFileName;
+	std::string ImageryListFile;
+	FrameScheduler::Settings SchedulerSettings;
+	SchedulerSettings.TargetFrameRate = DefaultTargetFrameRate;
+	SchedulerSettings.SwapInterval = DefaultSwapInterval;
+	SchedulerSettings.SimulationRate = SimulationRate;
+	for (int ArgIndex = 1; ArgIndex < argc; ++ArgIndex)
+	{
+		const std::string Argument{argv[ArgIndex]};
+		if (Argument == "--validate-gpu-culling")
+		{
+			ValidateGpuCulling = true;
+		}
+		else if (Argument == "--fps" && ArgIndex + 1 < argc)
+		{
+			SchedulerSettings.TargetFrameRate = std::atof(argv[++ArgIndex]);
+		}
+		else if (Argument == "--vsync" && ArgIndex + 1 < argc)
+		{
+			SchedulerSettings.SwapInterval = std::atoi(argv[++ArgIndex]);
+		}
+		else if (Argument == "--font" && ArgIndex + 1 < argc)
+		{
+			LabelFontFile = argv[++ArgIndex];
+		}
+		else if (Argument == "--geodata" && ArgIndex + 1 < argc)
+		{
+			GeoDataFileName = argv[++ArgIndex];
+		}
+		else if (Argument == "--imagery" && ArgIndex + 1 < argc)
+		{
+			ImageryListFile = argv[++ArgIndex];
+		}
+	}
+
+	// Threads de trabalho para culling, geracao de malhas e carregamentos. A thread
+	// principal participa dos jobs enquanto espera por eles
+	JobSystem::Get().Init();
+
+	// Leituras de arquivos em segundo plano (io_uring no Linux, pool de threads nos demais)
+	AsyncIO::Get().Init();
+
 	// Inicializar a biblioteca GLFW
 	assert(glfwInit() == GLFW_TRUE);
 
-	// Criar uma janela
+	// Criar uma janela. A validacao do culling so precisa do contexto
+	if (ValidateGpuCulling)
+	{
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 	GLFWwindow *Window = glfwCreateWindow(Width, Height, "Blue Marble", nullptr, nullptr);
 	assert(Window);
 
@@ -199,9 +483,314 @@ int main()
 	std::cout << "OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
 	std::cout << "GLSL Version: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
 
+	// Ler e decodificar a textura da Terra em segundo plano enquanto os shaders e
+	// as malhas sao preparados. So o envio para a GPU fica na thread do OpenGL
+	const char* EarthTextureFile = "textures/earth_2k.jpg";
+	TextureManager::DecodedImage EarthImage;
+	AsyncIO::Get().Read(EarthTextureFile, IOPriority::High, [&EarthImage](IOResult& Result)
+	{
+		if (Result.Error == 0 && !Result.Cancelled)
+		{
+			TextureManager::Decode(Result.Data.data(), Result.Data.size(), EarthImage);
+		}
+	});
+
 	GLuint ProgramId = LoadShaders("shaders/triangle_vert.glsl", "shaders/triangle_frag.glsl");
+	assert(ProgramId != 0);
+
+	// Orcamento de memoria de video para as texturas
+	TextureManager::Get().SetBudget(TextureBudgetBytes);
+
+	GLuint MarkerProgramId = LoadShaders("shaders/marker_vert.glsl", "shaders/marker_frag.glsl");
+	assert(MarkerProgramId != 0);
+
+	// Marcadores de algumas cidades. Todos ficam em um unico buffer de instancias
+	MarkerLayer Markers;
+	Markers.Init(1024);
+	Markers.Add(Marker{-23.55f, -46.63f, 12.0f, PackMarkerColor(glm::vec4{1.0f, 0.8f, 0.0f, 1.0f})});	// Sao Paulo
+	Markers.Add(Marker{-22.91f, -43.17f, 12.0f, PackMarkerColor(glm::vec4{1.0f, 0.8f, 0.0f, 1.0f})});	// Rio de Janeiro
+	Markers.Add(Marker{-15.79f, -47.88f, 12.0f, PackMarkerColor(glm::vec4{1.0f, 0.8f, 0.0f, 1.0f})});	// Brasilia
+	Markers.Add(Marker{ 38.72f,  -9.14f, 12.0f, PackMarkerColor(glm::vec4{0.0f, 0.8f, 1.0f, 1.0f})});	// Lisboa
+	Markers.Add(Marker{ 40.71f, -74.01f, 12.0f, PackMarkerColor(glm::vec4{0.0f, 0.8f, 1.0f, 1.0f})});	// Nova York
+	Markers.Add(Marker{ 35.68f, 139.69f, 12.0f, PackMarkerColor(glm::vec4{0.0f, 0.8f, 1.0f, 1.0f})});	// Toquio
+
+	// Nomes das cidades, com a populacao como prioridade no declutter
+	LabelLayer Labels;
+	LabelRenderer LabelDrawer;
+	GLuint LabelProgramId = 0;
+	const bool UseLabels = !LabelFontFile.empty() && Labels.Init(LabelFontFile, EllipsoidRadii, LabelFontPixelHeight, LabelAtlasSize, LabelFontFile + ".glyphs");
+	if (UseLabels)
+	{
+		LabelProgramId = LoadShaders("shaders/label_vert.glsl", "shaders/label_frag.glsl");
+		assert(LabelProgramId != 0);
+		LabelDrawer.Init(LabelAtlasSize, 4096);
+
+		Labels.SetTextHeight(LabelTextHeight);
+		const std::uint32_t LabelColor = PackMarkerColor(glm::vec4{1.0f});
+		Labels.Add(-23.55, -46.63, u8"S\u00e3o Paulo", 12.3f, LabelColor);
+		Labels.Add(-22.91, -43.17, "Rio de Janeiro", 6.7f, LabelColor);
+		Labels.Add(-15.79, -47.88, u8"Bras\u00edlia", 3.0f, LabelColor);
+		Labels.Add( 38.72,  -9.14, "Lisboa", 0.5f, LabelColor);
+		Labels.Add( 40.71, -74.01, "Nova York", 8.3f, LabelColor);
+		Labels.Add( 35.68, 139.69, u8"T\u00f3quio", 14.0f, LabelColor);
+	}
+
+	// O globo em tiles precisa de multi draw indirect. Sem suporte desenhamos o mapa plano
+	const bool UseGlobe = TileBatchRenderer::IsSupported();
+	ShaderVariantSet GlobeVariants;
+	std::vector<GlobeTile> GlobeTiles;
+	std::vector<TileMeshHandle> GlobeMeshes;
+	GlobeQuadtree Quadtree;
+	TileBatchRenderer GlobeBatch;
+	PolylineLayer Graticule;
+	PolylineLayer VectorLines;
+	GLuint PolylineProgramId = 0;
+	Atmosphere EarthAtmosphere;
+	GLuint SkyProgramId = 0;
+	CloudLayer Clouds;
+	ImagerySequence Imagery;
+	if (UseGlobe)
+	{
+		// As permutacoes do shader do globo sao compiladas sob demanda
+		GlobeVariants.Init("shaders/globe_vert.glsl", "shaders/globe_frag.glsl", GlobeShaderFeatureDefines);
+
+		// Todas as malhas dos tiles ficam na mesma arena de vertices e indices
+		GlobeTiles = BuildGlobeTiles(GlobeTileLevel, GlobeTileResolution, EllipsoidRadii);
+		GlobeBatch.Init(GlobeTiles.size() * GlobeTiles[0].Vertices.size(), GlobeTiles.size() * GlobeTiles[0].Indices.size());
+		for (const GlobeTile& Tile : GlobeTiles)
+		{
+			GlobeMeshes.push_back(GlobeBatch.AddMesh(Tile.Vertices, Tile.Indices));
+		}
+
+		// Hierarquia de volumes usada para descartar tiles fora da tela ou atras do horizonte
+		Quadtree = BuildGlobeQuadtree(GlobeTileLevel, EllipsoidRadii);
+	}
+
+	// Culling por tile na GPU, alternado com o culling na CPU pela tecla G
+	const bool GpuCullingSupported = UseGlobe && GpuCulling::IsSupported();
+	bool UseGpuCulling = false;
+	bool ToggleKeyWasDown = false;
+	GLuint CullProgramId = 0;
+	GLuint HiZProgramId = 0;
+	GpuCulling GpuCuller;
+	if (GpuCullingSupported)
+	{
+		CullProgramId = LoadComputeShader("shaders/cull_comp.glsl");
+		HiZProgramId = LoadComputeShader("shaders/hiz_comp.glsl");
+		assert(CullProgramId != 0 && HiZProgramId != 0);
+
+		int FramebufferWidth = 0;
+		int FramebufferHeight = 0;
+		glfwGetFramebufferSize(Window, &FramebufferWidth, &FramebufferHeight);
+		GpuCuller.Init(CullProgramId, HiZProgramId, FramebufferWidth, FramebufferHeight);
+
+		// Os candidatos sao fixos; o shader calcula a posicao relativa ao olho a cada frame
+		std::vector<GpuCullCandidate> Candidates;
+		for (std::size_t TileIndex = 0; TileIndex < GlobeTiles.size(); ++TileIndex)
+		{
+			const GlobeTile& Tile = GlobeTiles[TileIndex];
+			glm::vec3 CenterHigh;
+			glm::vec3 CenterLow;
+			SplitDouble(Tile.Center, CenterHigh, CenterLow);
+
+			GpuCullCandidate Candidate;
+			Candidate.CenterHigh = glm::vec4{CenterHigh, float(Tile.Radius)};
+			Candidate.CenterLow = glm::vec4{CenterLow, float(Tile.Level)};
+			Candidate.Count = GlobeMeshes[TileIndex].IndexCount;
+			Candidate.FirstIndex = GlobeMeshes[TileIndex].FirstIndex;
+			Candidate.BaseVertex = GlobeMeshes[TileIndex].BaseVertex;
+			Candidate.Padding = 0;
+			Candidates.push_back(Candidate);
+		}
+		GpuCuller.SetCandidates(Candidates);
+	}
+	else
+	{
+		std::cout << "Multi draw indirect nao suportado, desenhando o mapa plano" << std::endl;
+	}
 
-	GLuint TextureId = LoadTexture("textures/earth_2k.jpg");
+	// Camera em precisao dupla. Com o globo o mundo e o proprio ECEF em metros
+	Camera MainCamera;
+	MainCamera.AspectRatio = static_cast<double>(Width) / Height;
+	if (UseGlobe)
+	{
+		const double CameraDistance = CameraDistanceInRadii * EllipsoidRadii.x;
+		MainCamera.Position = glm::normalize(GeodeticToECEF(glm::radians(-15.0), glm::radians(-50.0), EllipsoidRadii)) * CameraDistance;
+		MainCamera.Target = glm::dvec3{0.0};
+		MainCamera.Up = glm::dvec3{0.0, 0.0, 1.0};
+		MainCamera.FitClipPlanes(CameraDistance - EllipsoidRadii.x, EllipsoidRadii.x);
+	}
+
+	if (ValidateGpuCulling)
+	{
+		// Algumas alturas diferentes para exercitar tiles inteiros, cortados e fora da
+		// tela. Em cada uma o culling roda so com o frustum; depois o Hi-Z e montado com
+		// o depth do elipsoide visto da camera e o culling roda de novo com a camera
+		// girada um pouco, como no frame seguinte, com os tiles do outro lado ocultos
+		bool ValidationPassed = GpuCullingSupported;
+		if (GpuCullingSupported)
+		{
+			int FramebufferWidth = 0;
+			int FramebufferHeight = 0;
+			glfwGetFramebufferSize(Window, &FramebufferWidth, &FramebufferHeight);
+			for (double DistanceInRadii : {CameraDistanceInRadii, 1.5, 1.05, 1.001})
+			{
+				Camera ValidationCamera = MainCamera;
+				ValidationCamera.Position = glm::normalize(MainCamera.Position) * DistanceInRadii * EllipsoidRadii.x;
+				ValidationCamera.FitClipPlanes((DistanceInRadii - 1.0) * EllipsoidRadii.x, EllipsoidRadii.x);
+				ValidationPassed = GpuCuller.ValidateAgainstCpu(ExtractFrustumPlanes(ValidationCamera.GetViewProjection()), ValidationCamera.Position, false) && ValidationPassed;
+
+				GpuCuller.BuildHiZFromDepth(ComputeEllipsoidDepth(ValidationCamera, FramebufferWidth, FramebufferHeight), ValidationCamera.GetViewProjection(), ValidationCamera.Position);
+				// Um passo pequeno, como entre dois frames, e um giro grande que traz para
+				// o frustum tiles que estavam fora da tela quando o Hi-Z foi montado
+				for (double RotationDegrees : {0.5, 20.0})
+				{
+					Camera NextCamera = ValidationCamera;
+					NextCamera.Position = glm::dvec3{glm::rotate(glm::identity<glm::dmat4>(), glm::radians(RotationDegrees), glm::dvec3{0.0, 0.0, 1.0}) * glm::dvec4{ValidationCamera.Position, 1.0}};
+					ValidationPassed = GpuCuller.ValidateAgainstCpu(ExtractFrustumPlanes(NextCamera.GetViewProjection()), NextCamera.Position, true) && ValidationPassed;
+				}
+			}
+		}
+		else
+		{
+			std::cerr << "Culling na GPU nao suportado por este contexto OpenGL" << std::endl;
+		}
+
+		glfwTerminate();
+		AsyncIO::Get().Shutdown();
+		JobSystem::Get().Shutdown();
+		return ValidationPassed ? 0 : 1;
+	}
+
+	// Camadas e efeitos do globo que a validacao do culling nao usa
+	if (UseGlobe)
+	{
+		// Meridianos e paralelos, desenhados pela mesma camada que recebera costas e fronteiras
+		PolylineProgramId = LoadShaders("shaders/polyline_vert.glsl", "shaders/polyline_frag.glsl");
+		assert(PolylineProgramId != 0);
+		Graticule.Init(EllipsoidRadii);
+		const std::uint32_t GraticuleColor = PackMarkerColor(glm::vec4{1.0f, 1.0f, 1.0f, 0.35f});
+		for (double Longitude = -180.0; Longitude < 180.0; Longitude += GraticuleSpacing)
+		{
+			std::vector<glm::dvec2> Meridian;
+			for (double Latitude = -90.0; Latitude <= 90.0; Latitude += GraticuleStep)
+			{
+				Meridian.push_back(glm::dvec2{Latitude, Longitude});
+			}
+			Graticule.Add(Meridian, GraticuleColor);
+		}
+		for (double Latitude = -90.0 + GraticuleSpacing; Latitude < 90.0; Latitude += GraticuleSpacing)
+		{
+			std::vector<glm::dvec2> Parallel;
+			for (double Longitude = -180.0; Longitude <= 180.0; Longitude += GraticuleStep)
+			{
+				Parallel.push_back(glm::dvec2{Latitude, Longitude});
+			}
+			Graticule.Add(Parallel, GraticuleColor);
+		}
+		Graticule.Build();
+
+		// Dados vetoriais: o arquivo e mapeado e so as coordenadas sao decodificadas.
+		// Linhas e poligonos vao para a camada de polilinhas e pontos viram marcadores
+		VectorLines.Init(EllipsoidRadii);
+		GeoDataFile VectorData;
+		if (!GeoDataFileName.empty() && VectorData.Load(GeoDataFileName))
+		{
+			const std::uint32_t LineColor = PackMarkerColor(glm::vec4{1.0f, 0.55f, 0.1f, 0.9f});
+			const std::uint32_t PointColor = PackMarkerColor(glm::vec4{0.3f, 1.0f, 0.4f, 1.0f});
+			std::vector<glm::dvec2> LatLon;
+			for (std::uint32_t FeatureIndex = 0; FeatureIndex < VectorData.GetNumFeatures(); ++FeatureIndex)
+			{
+				const GeoFeature& Feature = VectorData.GetFeature(FeatureIndex);
+				for (std::uint32_t PartIndex = Feature.FirstPart; PartIndex < Feature.FirstPart + Feature.NumParts; ++PartIndex)
+				{
+					if (!VectorData.DecodePart(PartIndex, LatLon))
+					{
+						continue;
+					}
+					if (Feature.Type != GeoFeatureType::Point)
+					{
+						VectorLines.Add(LatLon, LineColor, VectorData.GetSimplificationErrors(PartIndex));
+						continue;
+					}
+					for (const glm::dvec2& Point : LatLon)
+					{
+						Markers.Add(Marker{float(Point.x), float(Point.y), GeoDataPointSize, PointColor});
+					}
+				}
+			}
+			std::cout << GeoDataFileName << ": " << VectorData.GetNumFeatures() << " feicoes, " << VectorData.GetNumPoints() << " pontos" << std::endl;
+		}
+		VectorLines.Build();
+
+		// Ceu e perspectiva aerea. As tabelas levam alguns segundos para calcular e
+		// ficam em disco; nas execucoes seguintes so sao lidas
+		SkyProgramId = LoadShaders("shaders/sky_vert.glsl", "shaders/sky_frag.glsl");
+		assert(SkyProgramId != 0);
+		EarthAtmosphere.InitCached(AtmosphereParameters{}, AtmosphereCacheFile, EllipsoidRadii, AtmosphereExposure);
+		const Atmosphere::Stats AtmosphereStats = EarthAtmosphere.GetStats();
+		std::cout << "Tabelas da atmosfera " << (AtmosphereStats.LoadedFromCache ? "lidas" : "calculadas") << " em "
+			<< AtmosphereStats.Seconds * 1000.0 << " ms" << std::endl;
+
+		// Os dois primeiros campos de nuvens sao calculados aqui; os seguintes em tiles
+		// durante a animacao
+		CloudSettings CloudConfig;
+		CloudConfig.KeyframeSeconds = CloudKeyframeSeconds;
+		CloudConfig.MaxTilesPerFrame = CloudMaxTilesPerFrame;
+		Clouds.Init(CloudConfig);
+		std::cout << "Nuvens (" << GetCloudNoiseBackendName(GetCloudNoiseBackend()) << ") iniciadas em "
+			<< Clouds.GetStats().InitSeconds * 1000.0 << " ms" << std::endl;
+
+		// A primeira imagem da sequencia e carregada aqui; as seguintes sao lidas e
+		// decodificadas em segundo plano durante a reproducao
+		if (!ImageryListFile.empty())
+		{
+			ImagerySettings ImageryConfig;
+			ImageryConfig.FrameSeconds = ImageryFrameSeconds;
+			ImageryConfig.FadeSeconds = ImageryFadeSeconds;
+			if (Imagery.Init(ImagerySequence::ReadSequenceFile(ImageryListFile), ImageryConfig))
+			{
+				const ImagerySequence::Stats ImageryStats = Imagery.GetStats();
+				std::cout << ImageryListFile << ": " << ImageryStats.NumFrames << " imagens, " << ImageryStats.NumLayers << " camadas no anel" << std::endl;
+			}
+		}
+	}
+
+	// Selecao pelo cursor. A thread principal guarda a sua copia dos marcadores
+	// porque a camada passa a ser alterada so pela thread de renderizacao
+	const std::vector<Marker> PickableMarkers = Markers.GetMarkers();
+	MarkerPicker Picker;
+	Picker.Build(PickableMarkers, EllipsoidRadii);
+	int HoveredMarker = -1;
+	bool PickButtonWasDown = false;
+
+	// Esperar a textura e envia-la para a GPU. Se a leitura falhou, tenta o caminho sincrono
+	AsyncIO::Get().Flush();
+	GLuint TextureId = EarthImage.Pixels.empty() ? LoadTexture(EarthTextureFile) :
+		TextureManager::Get().Create(EarthImage.Pixels.data(), EarthImage.Width, EarthImage.Height, EarthTextureFile);
+	EarthImage = TextureManager::DecodedImage{};
+
+	// Luzes das cidades no lado noturno. Ate a imagem chegar, ou se o arquivo nao
+	// existir, um texel preto deixa a noite so escurecida. A leitura nao bloqueia o
+	// inicio: a imagem decodificada e trocada pela thread de renderizacao no loop
+	const char* NightTextureFile = "textures/earth_night_2k.jpg";
+	const unsigned char NightPlaceholder[3] = {0, 0, 0};
+	GLuint NightTextureId = TextureManager::Get().Create(NightPlaceholder, 1, 1, "");
+	std::mutex NightImageMutex;
+	TextureManager::DecodedImage NightImage;
+	AsyncIO::Get().Read(NightTextureFile, IOPriority::Normal, [&NightImageMutex, &NightImage](IOResult& Result)
+	{
+		TextureManager::DecodedImage Image;
+		if (Result.Error == 0 && !Result.Cancelled && TextureManager::Decode(Result.Data.data(), Result.Data.size(), Image))
+		{
+			std::lock_guard<std::mutex> Lock{NightImageMutex};
+			NightImage = std::move(Image);
+		}
+		else
+		{
+			std::cerr << "Sem luzes noturnas: nao foi possivel ler " << Result.Path << std::endl;
+		}
+	});
 
 	/*
 		T0
@@ -225,23 +814,7 @@ int main()
 	};
 
 	// Model
-	glm::mat4 ModelMatrix = glm::identity<glm::mat4>();
-
-	// View Matrix
-	glm::vec3 Eye{0, 0, 5};
-	glm::vec3 Center{0, 0, 0};
-	glm::vec3 Up{0, 1, 0};
-	glm::mat4 ViewMatrix = glm::lookAt(Eye, Center, Up);
-
-	// Projection Matrix
-	constexpr float FoV = glm::radians(45.0f);
-	const float AspectRatio = Width / Height;
-	const float Near = 0.001f;
-	const float Far = 1000.f;
-	glm::mat4 ProjectionMatrix = glm::perspective(FoV, AspectRatio, Near, Far);
-
-	// ModelViewProjection
-	glm::mat4 ModelViewProjection = ProjectionMatrix * ViewMatrix * ModelMatrix;
+	glm::dmat4 ModelMatrix = glm::identity<glm::dmat4>();
 
 	// Copiar os v�rtices do triangulo para a memoria da GPU
 	GLuint VertexBuffer;
@@ -255,64 +828,613 @@ int main()
 	// Copiar os dados para a mem�ria de v�deo
 	glBufferData(GL_ARRAY_BUFFER, sizeof(Quad), Quad.data(), GL_STATIC_DRAW);
 
+	// Blocos uniformes por frame e por objeto, com tres frames em voo
+	UniformRingBuffer UniformRing;
+	UniformRing.Init(UniformBytesPerFrame);
+
+	// Sol pela hora UTC, recalculado a cada frame
+	const double StartUnixTime = GetCurrentUnixTime();
+	SunPosition Sun = ComputeSunPosition(UnixTimeToJulianDate(StartUnixTime));
+
+	// A variante do globo do primeiro frame e compilada ainda no carregamento. As
+	// seguintes sao previstas durante o voo e aquecidas entre os frames
+	bool ShowTileLevels = false;
+	bool TileLevelKeyWasDown = false;
+	glm::dvec3 PreviousCameraPosition = MainCamera.Position;
+	if (UseGlobe)
+	{
+		GlobeVariants.Precompile(SelectGlobeFeatures(MainCamera.Position, Sun.Direction, ShowTileLevels, Imagery.IsValid()));
+	}
+
 	// Definir a cor de fundo
 	glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 
+	// Tiles visiveis do frame e as contagens do ultimo frame, mostradas no titulo da janela
+	std::vector<int> VisibleTiles;
+	CullStats LastCullStats;
+
+	// Estado da simulacao: angulo da orbita da camera no passo anterior e no atual.
+	// A renderizacao interpola entre os dois, entao a animacao fica suave com
+	// qualquer taxa de quadros
+	const glm::dvec3 OrbitStartPosition = MainCamera.Position;
+	double PreviousOrbitAngle = 0.0;
+	double OrbitAngle = 0.0;
+
+	FrameScheduler Scheduler;
+	Scheduler.Init(SchedulerSettings);
+
+	const double StartTime = glfwGetTime();
+
+	// Tile visivel pronto para o lote: a malha e o centro ja relativo ao olho
+	struct GlobeDraw
+	{
+		TileMeshHandle Mesh;
+		TileDrawData Data;
+	};
+
+	// A partir daqui o contexto OpenGL pertence a thread de renderizacao. A thread
+	// principal trata eventos, simulacao e culling e so grava comandos
+	RenderThread Renderer;
+	Renderer.Start(Window);
+
+	// Recarregar shaders e texturas editados com o programa rodando. As texturas
+	// sao lidas e decodificadas fora das threads principal e de renderizacao
+	FileWatcher AssetWatcher;
+	AssetWatcher.Start({"shaders", "textures"}, AssetReloadDebounce);
+	std::mutex ReloadedImagesMutex;
+	std::vector<std::pair<std::string, TextureManager::DecodedImage>> ReloadedImages;
+
 	// Entrar no loop de eventos da aplicacao
 	while (!glfwWindowShouldClose(Window))
 	{
-		// glClear vai limpar o framebuffer. GL_COLOR_BUFFER_BIT diz para limpar o buffer de cor. Ap�s limpar ir� preencher com a cor configurada no glClearColor
-		glClear(GL_COLOR_BUFFER_BIT);
+		// Processar todos os eventos da fila de eventos do GLFW
+		// Podem ser eventos como: teclado, mouse, gamepad...
+		glfwPollEvents();
+
+		// Entregar ao JobSystem os callbacks das leituras que terminaram
+		AsyncIO::Get().DispatchCompletions();
+
+		// Rodar os passos fixos de simulacao que couberam no tempo do ultimo frame
+		const int NumTicks = Scheduler.BeginFrame();
+		for (int Tick = 0; Tick < NumTicks; ++Tick)
+		{
+			PreviousOrbitAngle = OrbitAngle;
+			OrbitAngle += glm::radians(CameraOrbitSpeed) * Scheduler.GetTickDuration();
+		}
+		if (UseGlobe)
+		{
+			const double Angle = glm::mix(PreviousOrbitAngle, OrbitAngle, Scheduler.GetInterpolationAlpha());
+			MainCamera.Position = glm::dvec3{glm::rotate(glm::identity<glm::dmat4>(), Angle, glm::dvec3{0.0, 0.0, 1.0}) * glm::dvec4{OrbitStartPosition, 1.0}};
+		}
+
+		// Todas as matrizes enviadas para a GPU sao relativas ao olho (sem translacao)
+		const double CurrentTime = glfwGetTime();
+		const glm::mat4 ViewProjection = MainCamera.GetViewProjection();
+		Sun = ComputeSunPosition(UnixTimeToJulianDate(StartUnixTime + (CurrentTime - StartTime) * SunTimeScale));
+
+		FrameUniforms Frame;
+		Frame.View = MainCamera.GetViewRotation();
+		Frame.Projection = MainCamera.GetProjection();
+		Frame.ViewProjection = ViewProjection;
+		Frame.CameraPosition = glm::vec4{glm::vec3{MainCamera.Position}, 1.0f};
+		Frame.SunDirection = glm::vec4{glm::vec3{Sun.Direction}, 0.0f};
+		Frame.EllipsoidRadii = glm::vec4{EllipsoidRadii, 0.0f};
+		Frame.ViewportSize = glm::vec2{Width, Height};
+		Frame.Time = static_cast<float>(CurrentTime - StartTime);
+		Frame.DeltaTime = static_cast<float>(Scheduler.GetFrameTime());
+
+		RenderCommandBuffer& Commands = Renderer.GetCommandBuffer();
+
+		Commands.Push([&UniformRing, Frame]
+		{
+			// glClear vai limpar o framebuffer. GL_COLOR_BUFFER_BIT diz para limpar o buffer de cor. Apos limpar ira preencher com a cor configurada no glClearColor
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+			// Avancar o carimbo de uso das texturas e aplicar o orcamento de memoria
+			TextureManager::Get().BeginFrame();
+
+			// Esperar a GPU liberar a regiao do anel e enviar os dados do frame
+			UniformRing.BeginFrame();
+			UniformRing.Push(FrameBlockBinding, Frame);
+		});
+
+		// Arquivos alterados em disco
+		bool ShadersChanged = false;
+		for (const std::string& ChangedFile : AssetWatcher.TakeChanges())
+		{
+			const std::string Extension = std::filesystem::path{ChangedFile}.extension().string();
+			if (ChangedFile.rfind("shaders/", 0) == 0)
+			{
+				ShadersChanged = true;
+			}
+			else if (Extension == ".jpg" || Extension == ".png")
+			{
+				AsyncIO::Get().Read(ChangedFile, IOPriority::Normal, [&ReloadedImagesMutex, &ReloadedImages](IOResult& Result)
+				{
+					TextureManager::DecodedImage Image;
+					if (Result.Error == 0 && !Result.Cancelled && TextureManager::Decode(Result.Data.data(), Result.Data.size(), Image))
+					{
+						std::lock_guard<std::mutex> Lock{ReloadedImagesMutex};
+						ReloadedImages.emplace_back(Result.Path, std::move(Image));
+					}
+					else
+					{
+						std::cerr << "Falha ao recarregar a textura: " << Result.Path << std::endl;
+					}
+				});
+			}
+		}
 
-		// Ativar o programa de shader
-		glUseProgram(ProgramId);
+		if (ShadersChanged)
+		{
+			// LoadShaders devolve o programa do cache quando as fontes nao mudaram,
+			// entao so os programas que dependem dos arquivos alterados sao refeitos
+			Commands.Push([&ProgramId, &MarkerProgramId, &LabelProgramId, &PolylineProgramId, &SkyProgramId, &CullProgramId, &HiZProgramId, &GlobeVariants, &GpuCuller, UseGlobe, UseLabels, GpuCullingSupported]
+			{
+				SwapProgram(ProgramId, LoadShaders("shaders/triangle_vert.glsl", "shaders/triangle_frag.glsl"), "shaders/triangle_vert.glsl");
+				SwapProgram(MarkerProgramId, LoadShaders("shaders/marker_vert.glsl", "shaders/marker_frag.glsl"), "shaders/marker_vert.glsl");
+				if (UseLabels)
+				{
+					SwapProgram(LabelProgramId, LoadShaders("shaders/label_vert.glsl", "shaders/label_frag.glsl"), "shaders/label_vert.glsl");
+				}
+				if (UseGlobe)
+				{
+					GlobeVariants.Reload();
+					SwapProgram(PolylineProgramId, LoadShaders("shaders/polyline_vert.glsl", "shaders/polyline_frag.glsl"), "shaders/polyline_vert.glsl");
+					SwapProgram(SkyProgramId, LoadShaders("shaders/sky_vert.glsl", "shaders/sky_frag.glsl"), "shaders/sky_vert.glsl");
+				}
+				if (GpuCullingSupported)
+				{
+					SwapProgram(CullProgramId, LoadComputeShader("shaders/cull_comp.glsl"), "shaders/cull_comp.glsl");
+					SwapProgram(HiZProgramId, LoadComputeShader("shaders/hiz_comp.glsl"), "shaders/hiz_comp.glsl");
+					GpuCuller.SetPrograms(CullProgramId, HiZProgramId);
+				}
+			});
+		}
 
-		GLint ModelViewProjectionLocation = glGetUniformLocation(ProgramId, "ModelViewProjection");
-		glUniformMatrix4fv(ModelViewProjectionLocation, 1, GL_FALSE, glm::value_ptr(ModelViewProjection));
+		{
+			// A textura noturna substitui o texel preto quando termina de decodificar.
+			// A nova textura leva o nome do arquivo, entao tambem recarrega se for editada
+			TextureManager::DecodedImage Image;
+			{
+				std::lock_guard<std::mutex> Lock{NightImageMutex};
+				Image = std::move(NightImage);
+				NightImage = TextureManager::DecodedImage{};
+			}
+			if (!Image.Pixels.empty())
+			{
+				Commands.Push([&NightTextureId, NightTextureFile, Image = std::move(Image)]
+				{
+					const GLuint LoadedTextureId = TextureManager::Get().Create(Image.Pixels.data(), Image.Width, Image.Height, NightTextureFile);
+					TextureManager::Get().Release(NightTextureId);
+					NightTextureId = LoadedTextureId;
+					std::cout << "Luzes noturnas carregadas: " << NightTextureFile << std::endl;
+				});
+			}
+		}
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, TextureId);
+		{
+			// Imagens que terminaram de decodificar vao para as texturas existentes
+			std::vector<std::pair<std::string, TextureManager::DecodedImage>> Images;
+			{
+				std::lock_guard<std::mutex> Lock{ReloadedImagesMutex};
+				Images.swap(ReloadedImages);
+			}
+			if (!Images.empty())
+			{
+				Commands.Push([Images = std::move(Images)]
+				{
+					for (const auto& [TextureFile, Image] : Images)
+					{
+						for (GLuint ReloadedTextureId : TextureManager::Get().FindByFile(TextureFile))
+						{
+							TextureManager::Get().Replace(ReloadedTextureId, Image);
+						}
+						std::cout << "Textura recarregada: " << TextureFile << std::endl;
+					}
+				});
+			}
+		}
 
-		GLint TextureSamplerLoc = glGetUniformLocation(ProgramId, "TextureSampler");
-		glUniform1i(TextureSamplerLoc, 0);
+		// A tecla G alterna entre o culling na CPU e na GPU
+		const bool ToggleKeyDown = glfwGetKey(Window, GLFW_KEY_G) == GLFW_PRESS;
+		if (ToggleKeyDown && !ToggleKeyWasDown && GpuCullingSupported)
+		{
+			UseGpuCulling = !UseGpuCulling;
+			LastCullStats = CullStats{};
+			if (UseGpuCulling)
+			{
+				glfwSetWindowTitle(Window, "Blue Marble - culling na GPU");
+			}
+		}
+		ToggleKeyWasDown = ToggleKeyDown;
 
-		glEnableVertexAttribArray(0);
-		glEnableVertexAttribArray(1);
-		glEnableVertexAttribArray(2);
+		// A tecla T tinge os tiles pelo nivel do quadtree
+		const bool TileLevelKeyDown = glfwGetKey(Window, GLFW_KEY_T) == GLFW_PRESS;
+		if (TileLevelKeyDown && !TileLevelKeyWasDown)
+		{
+			ShowTileLevels = !ShowTileLevels;
+		}
+		TileLevelKeyWasDown = TileLevelKeyDown;
 
-		// Diz para o OpenGL que o VertexBuffer vai ser o buffer ativo no momento
-		glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+		// Marcador sob o cursor fica maior; o clique mostra o ponto do globo atingido
+		{
+			double CursorX = 0.0;
+			double CursorY = 0.0;
+			int WindowWidth = 0;
+			int WindowHeight = 0;
+			glfwGetCursorPos(Window, &CursorX, &CursorY);
+			glfwGetWindowSize(Window, &WindowWidth, &WindowHeight);
+			PickResult Pick;
+			if (WindowWidth > 0 && WindowHeight > 0)
+			{
+				Pick = Picker.Pick(MakePickView(MainCamera, glm::dvec2{WindowWidth, WindowHeight}), glm::dvec2{CursorX, CursorY}, PickRadiusPixels);
+			}
+
+			if (Pick.MarkerIndex != HoveredMarker)
+			{
+				if (HoveredMarker >= 0)
+				{
+					const Marker Restored = PickableMarkers[HoveredMarker];
+					Commands.Push([&Markers, Index = std::uint32_t(HoveredMarker), Restored] { Markers.Update(Index, Restored); });
+				}
+				if (Pick.MarkerIndex >= 0)
+				{
+					Marker Enlarged = PickableMarkers[Pick.MarkerIndex];
+					Enlarged.Size *= HoveredMarkerScale;
+					Commands.Push([&Markers, Index = std::uint32_t(Pick.MarkerIndex), Enlarged] { Markers.Update(Index, Enlarged); });
+				}
+				HoveredMarker = Pick.MarkerIndex;
+			}
+
+			const bool PickButtonDown = glfwGetMouseButton(Window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS;
+			if (PickButtonDown && !PickButtonWasDown && Pick.HitGlobe)
+			{
+				std::cout << "Clique em " << Pick.Latitude << ", " << Pick.Longitude;
+				if (Pick.MarkerIndex >= 0)
+				{
+					std::cout << " - marcador " << Pick.MarkerIndex;
+				}
+				std::cout << std::endl;
+			}
+			PickButtonWasDown = PickButtonDown;
+		}
 
-		// Informa ao OpenGL onde, dentro do VertexBuffer se encontrarao os vertices
-		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
-		glVertexAttribPointer(1, 3, GL_FLOAT, GL_TRUE, sizeof(Vertex), reinterpret_cast<void *>(offsetof(Vertex, Color)));
-		glVertexAttribPointer(2, 2, GL_FLOAT, GL_TRUE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, UV)));
+		if (UseGlobe)
+		{
+			const Frustum ViewFrustum = ExtractFrustumPlanes(ViewProjection);
+			const glm::dvec3 EyePosition = MainCamera.Position;
+
+			// Descartar na CPU os tiles fora do frustum ou escondidos pelo horizonte.
+			// Roda aqui, em paralelo com a submissao do frame anterior
+			GlobeDraw* Draws = nullptr;
+			std::size_t NumDraws = 0;
+			if (!UseGpuCulling)
+			{
+				CullStats Stats;
+				VisibleTiles.clear();
+				CullGlobeQuadtree(Quadtree, ViewFrustum, MainCamera.Position, EllipsoidRadii, true, VisibleTiles, Stats);
+
+				if (Stats.Visible != LastCullStats.Visible || Stats.FrustumCulled != LastCullStats.FrustumCulled ||
+					Stats.HorizonCulled != LastCullStats.HorizonCulled)
+				{
+					const std::string Title = "Blue Marble - tiles visiveis: " + std::to_string(Stats.Visible) +
+						", fora do frustum: " + std::to_string(Stats.FrustumCulled) +
+						", atras do horizonte: " + std::to_string(Stats.HorizonCulled);
+					glfwSetWindowTitle(Window, Title.c_str());
+					LastCullStats = Stats;
+				}
+
+				// O centro de cada tile vai relativo ao olho, subtraido em double
+				NumDraws = VisibleTiles.size();
+				Draws = Commands.Allocate<GlobeDraw>(NumDraws);
+				for (std::size_t DrawIndex = 0; DrawIndex < NumDraws; ++DrawIndex)
+				{
+					const int TileIndex = VisibleTiles[DrawIndex];
+					const GlobeTile& Tile = GlobeTiles[TileIndex];
+					Draws[DrawIndex] = GlobeDraw{GlobeMeshes[TileIndex], TileDrawData{glm::vec4{MainCamera.ToEyeRelative(Tile.Center), float(Tile.Level)}}};
+				}
+			}
+
+			// O globo e os marcadores compartilham os mesmos dados de objeto. A posicao
+			// do olho vai dividida em alto/baixo para os marcadores calculados no shader
+			ObjectUniforms GlobeObject;
+			GlobeObject.Model = glm::mat4{ModelMatrix};
+			GlobeObject.ModelViewProjection = ViewProjection;
+			glm::vec3 EyeHigh;
+			glm::vec3 EyeLow;
+			SplitDouble(MainCamera.Position, EyeHigh, EyeLow);
+			GlobeObject.CameraPosition = glm::vec4{EyeHigh, 1.0f};
+			GlobeObject.CameraPositionLow = glm::vec4{EyeLow, 0.0f};
+
+			// Variante do shader para este frame e a prevista para a posicao da camera
+			// alguns segundos a frente, extrapolada pela velocidade atual
+			const double FrameTime = Scheduler.GetFrameTime();
+			const glm::dvec3 CameraVelocity = FrameTime > 0.0 ? (MainCamera.Position - PreviousCameraPosition) / FrameTime : glm::dvec3{0.0};
+			const glm::dvec3 PredictedCameraPosition = MainCamera.Position + CameraVelocity * ShaderPredictionSeconds;
+			const std::uint32_t GlobeFeatures = SelectGlobeFeatures(MainCamera.Position, Sun.Direction, ShowTileLevels, Imagery.IsValid());
+			const std::uint32_t PredictedGlobeFeatures = SelectGlobeFeatures(PredictedCameraPosition, Sun.Direction, ShowTileLevels, Imagery.IsValid());
+
+			// Relogio das nuvens e os tiles do proximo campo, calculados nas threads de
+			// trabalho enquanto o frame e gravado
+			Clouds.Update(FrameTime);
+			const CloudDrawState CloudState = Clouds.GetDrawState();
+
+			// Relogio da sequencia de imagens, as proximas pedidas e as faixas enviadas neste frame
+			Imagery.Update(FrameTime);
+			const ImageryDrawState ImageryState = Imagery.GetDrawState();
+
+			// Nivel das polilinhas pelo tamanho de um pixel no chao abaixo da camera
+			const double Altitude = std::max(glm::length(MainCamera.Position) - EllipsoidRadii.z, 1.0);
+			const double PixelMeters = Altitude * 2.0 * std::tan(MainCamera.FieldOfView * 0.5) / Height;
+			const int PolylineLevel = Graticule.SelectLevel(PixelMeters * PolylineMaxErrorPixels);
+
+			Commands.Push([&UniformRing, &GlobeBatch, &GpuCuller, &Markers, &GlobeVariants, &MarkerProgramId, &Graticule, &VectorLines, &PolylineProgramId, &NightTextureId,
+				&EarthAtmosphere, &SkyProgramId, &Clouds, &Imagery, TextureId, CloudUploads = Clouds.TakeTileUploads(), CloudState,
+				ImageryUploads = Imagery.TakeStripUploads(), ImageryState,
+				PolylineLevel, UseGpuCulling, ViewFrustum, ViewProjection, EyePosition, GlobeObject, Draws, NumDraws, GlobeFeatures, PredictedGlobeFeatures]
+			{
+				// Tiles de nuvens terminados desde o ultimo frame, no campo que ainda nao aparece
+				Clouds.UploadTiles(CloudUploads);
+				Imagery.UploadStrips(ImageryUploads);
+
+				// Aquecer a variante prevista e a da tecla T, que pode ser ligada a qualquer momento
+				GlobeVariants.Prefetch(PredictedGlobeFeatures);
+				GlobeVariants.Prefetch(GlobeFeatures ^ GlobeShowTileLevels);
+				const GLuint GlobeProgramId = GlobeVariants.GetProgram(GlobeFeatures);
+
+				// Sem nenhuma variante do shader do globo que compile so o ceu e desenhado
+				glEnable(GL_DEPTH_TEST);
+				if (GlobeProgramId != 0)
+				{
+					if (UseGpuCulling)
+					{
+						// Frustum + Hi-Z do frame anterior, compactando os comandos na GPU
+						GpuCuller.Cull(ViewFrustum, EyePosition, true);
+					}
+					else
+					{
+						// Todos os tiles visiveis com um unico glMultiDrawElementsIndirect
+						GlobeBatch.BeginFrame();
+						for (std::size_t DrawIndex = 0; DrawIndex < NumDraws; ++DrawIndex)
+						{
+							GlobeBatch.AddDraw(Draws[DrawIndex].Mesh, Draws[DrawIndex].Data);
+						}
+					}
+
+					UniformRing.Push(ObjectBlockBinding, GlobeObject);
+
+					glUseProgram(GlobeProgramId);
+
+					// A sequencia de imagens substitui a imagem fixa
+					if (GlobeFeatures & GlobeImagerySequence)
+					{
+						Imagery.Bind(GlobeProgramId, ImageryState);
+					}
+					else
+					{
+						TextureManager::Get().Bind(GL_TEXTURE0, TextureId);
+
+						GLint GlobeTextureSamplerLoc = glGetUniformLocation(GlobeProgramId, "TextureSampler");
+						glUniform1i(GlobeTextureSamplerLoc, 0);
+					}
+
+					// A textura noturna so e amostrada pela variante com iluminacao
+					if (GlobeFeatures & GlobeLighting)
+					{
+						TextureManager::Get().Bind(GL_TEXTURE1, NightTextureId);
+						glUniform1i(glGetUniformLocation(GlobeProgramId, "NightSampler"), 1);
+					}
+
+					// Tabelas da atmosfera para a perspectiva aerea e os dois campos de nuvens
+					EarthAtmosphere.Bind(GlobeProgramId);
+					Clouds.Bind(GlobeProgramId, CloudState);
+
+					if (UseGpuCulling)
+					{
+						GlobeBatch.SubmitIndirect(GpuCuller.GetCommandBuffer(), GpuCuller.GetDrawDataBuffer(), GpuCuller.GetCountBuffer(), GpuCuller.GetMaxDraws());
+					}
+					else
+					{
+						GlobeBatch.Submit();
+					}
+				}
+
+				// Ceu nos pixels que o globo nao cobriu: o triangulo fica na profundidade 1,
+				// que so passa com GL_LEQUAL contra o depth limpo
+				glDepthFunc(GL_LEQUAL);
+				glDepthMask(GL_FALSE);
+				glUseProgram(SkyProgramId);
+				EarthAtmosphere.Bind(SkyProgramId);
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+				glDepthMask(GL_TRUE);
+				glDepthFunc(GL_LESS);
+
+				glUseProgram(0);
+				glDisable(GL_DEPTH_TEST);
+
+				if (UseGpuCulling && GlobeProgramId != 0)
+				{
+					// O depth do globo vira a piramide Hi-Z usada no culling do proximo frame
+					GpuCuller.BuildHiZ(ViewProjection, EyePosition);
+				}
+
+				// Cada camada de linhas com um unico glMultiDrawArraysIndirect e todos os
+				// marcadores com um unico draw call instanciado por cima
+				glEnable(GL_BLEND);
+				glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+				Graticule.Draw(PolylineProgramId, PolylineLevel, GraticuleLineWidth);
+				VectorLines.Draw(PolylineProgramId, PolylineLevel, GeoDataLineWidth);
+				Markers.Draw(MarkerProgramId);
+				glDisable(GL_BLEND);
+
+				// Compilar variantes previstas com o que sobrar do orcamento
+				GlobeVariants.Update(ShaderWarmUpBudget);
+			});
+
+			if (UseLabels)
+			{
+				// Declutter na thread principal; so os glifos aceitos vao para a GPU
+				Labels.Update(ViewProjection, MainCamera.Position, glm::vec2{Width, Height});
+				const std::vector<LabelGlyphInstance>& LabelInstances = Labels.GetInstances();
+				LabelGlyphInstance* FrameInstances = Commands.Allocate<LabelGlyphInstance>(LabelInstances.size());
+				std::copy(LabelInstances.begin(), LabelInstances.end(), FrameInstances);
+
+				Commands.Push([&LabelDrawer, &LabelProgramId, GlyphUploads = Labels.TakeGlyphUploads(), FrameInstances, NumInstances = LabelInstances.size()]
+				{
+					LabelDrawer.UploadGlyphs(GlyphUploads);
+
+					glEnable(GL_BLEND);
+					glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+					LabelDrawer.Draw(LabelProgramId, FrameInstances, NumInstances);
+					glDisable(GL_BLEND);
+				});
+			}
+		}
+		else
+		{
+			ObjectUniforms MapObject;
+			MapObject.Model = glm::mat4{ModelMatrix};
+			MapObject.ModelViewProjection = ViewProjection * MainCamera.GetModelRTE(ModelMatrix);
+			MapObject.CameraPosition = glm::vec4{glm::vec3{MainCamera.Position}, 1.0f};
+			MapObject.CameraPositionLow = glm::vec4{0.0f};
 
-		// Diz ao OpenGL para desenhar o tri�ngulo com os dados armazenados no VertexBuffer
-		glDrawArrays(GL_TRIANGLES, 0, Quad.size());
+			Commands.Push([&UniformRing, &ProgramId, &NightTextureId, TextureId, VertexBuffer, NumVertices = GLsizei(Quad.size()), MapObject]
+			{
+				UniformRing.Push(ObjectBlockBinding, MapObject);
 
-		// Reverter o estado
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glDisableVertexAttribArray(0);
-		glDisableVertexAttribArray(1);
-		glDisableVertexAttribArray(2);
+				// Ativar o programa de shader
+				glUseProgram(ProgramId);
 
-		// Desabilitar o programa ativo
-		glUseProgram(0);
+				TextureManager::Get().Bind(GL_TEXTURE0, TextureId);
 
-		// Processar todos os eventos da fila de eventos do GLFW
-		// Podem ser eventos como: teclado, mouse, gamepad...
-		glfwPollEvents();
+				GLint TextureSamplerLoc = glGetUniformLocation(ProgramId, "TextureSampler");
+				glUniform1i(TextureSamplerLoc, 0);
 
-		// Enviar o conteudo do framebuffer da janela para ser desenhado na tela
-		glfwSwapBuffers(Window);
+				TextureManager::Get().Bind(GL_TEXTURE1, NightTextureId);
+				glUniform1i(glGetUniformLocation(ProgramId, "NightSampler"), 1);
+
+				glEnableVertexAttribArray(0);
+				glEnableVertexAttribArray(1);
+				glEnableVertexAttribArray(2);
+
+				// Diz para o OpenGL que o VertexBuffer vai ser o buffer ativo no momento
+				glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+
+				// Informa ao OpenGL onde, dentro do VertexBuffer se encontrarao os vertices
+				glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
+				glVertexAttribPointer(1, 3, GL_FLOAT, GL_TRUE, sizeof(Vertex), reinterpret_cast<void *>(offsetof(Vertex, Color)));
+				glVertexAttribPointer(2, 2, GL_FLOAT, GL_TRUE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, UV)));
+
+				// Diz ao OpenGL para desenhar o triangulo com os dados armazenados no VertexBuffer
+				glDrawArrays(GL_TRIANGLES, 0, NumVertices);
+
+				// Reverter o estado
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+				glDisableVertexAttribArray(0);
+				glDisableVertexAttribArray(1);
+				glDisableVertexAttribArray(2);
+
+				// Desabilitar o programa ativo
+				glUseProgram(0);
+			});
+		}
+
+		Commands.Push([&UniformRing, Window]
+		{
+			// Proteger a regiao do anel usada neste frame com um fence
+			UniformRing.EndFrame();
+
+			// Enviar o conteudo do framebuffer da janela para ser desenhado na tela
+			glfwSwapBuffers(Window);
+		});
+
+		PreviousCameraPosition = MainCamera.Position;
+
+		// Entregar o frame para a thread de renderizacao e seguir para o proximo
+		Renderer.Submit();
+
+		// Segurar o frame ate o prazo da taxa alvo em vez de renderizar sem parar
+		Scheduler.EndFrame();
 	}
 
+	// Terminar os frames pendentes e trazer o contexto de volta para a limpeza
+	AssetWatcher.Stop();
+	Renderer.Stop();
+	Scheduler.Shutdown();
+	UniformRing.Destroy();
+
 	// Desalocar o VertexBuffer
 	glDeleteBuffers(1, &VertexBuffer);
 
+	// Desalocar o globo
+	if (GpuCullingSupported)
+	{
+		GpuCuller.Destroy();
+		ReleaseProgram(CullProgramId);
+		ReleaseProgram(HiZProgramId);
+	}
+	if (UseGlobe)
+	{
+		const ShaderVariantSet::Stats VariantStats = GlobeVariants.GetStats();
+		std::cout << "Variantes do globo: " << VariantStats.NumReady << " prontas, " << VariantStats.NumWarmedUp << " aquecidas, "
+			<< VariantStats.NumHitches << " travamentos (max " << VariantStats.MaxHitchSeconds * 1000.0 << " ms), "
+			<< VariantStats.NumFallbacks << " frames com variante simplificada" << std::endl;
+
+		const PolylineLayer::Stats GraticuleStats = Graticule.GetStats();
+		std::cout << "Grade: " << GraticuleStats.NumPolylines << " linhas, " << GraticuleStats.NumPoints << " pontos, segmentos por nivel:";
+		for (int SegmentCount : GraticuleStats.NumSegments)
+		{
+			std::cout << " " << SegmentCount;
+		}
+		std::cout << std::endl;
+
+		GlobeBatch.Destroy();
+		GlobeVariants.Destroy();
+		Graticule.Destroy();
+		VectorLines.Destroy();
+		glDeleteProgram(PolylineProgramId);
+		const CloudLayer::Stats CloudStats = Clouds.GetStats();
+		std::cout << "Nuvens: " << CloudStats.NumKeyframes << " campos em " << CloudStats.NumTiles << " tiles ("
+			<< CloudStats.TileMilliseconds << " ms por tile), " << CloudStats.NumStalledFrames << " frames esperando o proximo campo" << std::endl;
+
+		if (Imagery.IsValid())
+		{
+			const ImagerySequence::Stats ImageryStats = Imagery.GetStats();
+			std::cout << "Imagens: " << ImageryStats.NumDecoded << " decodificadas (" << ImageryStats.DecodeMilliseconds << " ms em media, "
+				<< ImageryStats.MaxDecodeMilliseconds << " ms no pior caso), " << ImageryStats.NumFailed << " falhas, " << ImageryStats.PrefetchDepth
+				<< " adiantadas, " << ImageryStats.NumStalledFrames << " frames esperando a proxima imagem" << std::endl;
+		}
+
+		EarthAtmosphere.Destroy();
+		glDeleteProgram(SkyProgramId);
+		Clouds.Destroy();
+		Imagery.Destroy();
+	}
+
+	// Desalocar os marcadores
+	Markers.Destroy();
+	glDeleteProgram(MarkerProgramId);
+
+	if (UseLabels)
+	{
+		const LabelLayer::Stats LabelStats = Labels.GetStats();
+		std::cout << "Rotulos: " << LabelStats.NumVisible << " de " << LabelStats.NumCandidates << " visiveis, "
+			<< Labels.GetAtlas().GetStats().NumGlyphs << " glifos no atlas" << std::endl;
+
+		LabelDrawer.Destroy();
+		glDeleteProgram(LabelProgramId);
+	}
+
+	// Desalocar as texturas
+	TextureManager::Get().Release(TextureId);
+	TextureManager::Get().Release(NightTextureId);
+
 	// Encerrar a biblioteca GLFW
 	glfwTerminate();
 
+	AsyncIO::Get().Shutdown();
+	JobSystem::Get().Shutdown();
+
 	return 0;
 }
\ No newline at end of file
@@ -0,0 +1,151 @@
+// Culling dos tiles na GPU: frustum + Hi-Z do frame anterior, com compactacao dos visiveis
+#version 430 core
+
+layout (local_size_x = 64) in;
+
+struct Candidate
+{
+	vec4 CenterHigh;    // xyz: centro, w: raio
+	vec4 CenterLow;     // xyz: parte baixa do centro, w: nivel do tile
+	uint Count;
+	uint FirstIndex;
+	int BaseVertex;
+	uint Padding;
+};
+
+struct DrawCommand
+{
+	uint Count;
+	uint InstanceCount;
+	uint FirstIndex;
+	int BaseVertex;
+	uint BaseInstance;
+};
+
+layout (std430, binding = 0) readonly buffer CandidateBlock
+{
+	Candidate Candidates[];
+};
+
+layout (std430, binding = 1) writeonly buffer CommandBlock
+{
+	DrawCommand Commands[];
+};
+
+// Mesmo layout de TileDrawData, lido por globe_vert.glsl atraves do gl_DrawID
+layout (std430, binding = 2) writeonly buffer DrawDataBlock
+{
+	vec4 DrawCenters[];
+};
+
+layout (std430, binding = 3) buffer CountBlock
+{
+	uint DrawCount;
+};
+
+layout (std430, binding = 4) writeonly buffer VisibleIndexBlock
+{
+	uint VisibleIndices[];
+};
+
+uniform uint NumCandidates;
+uniform vec4 FrustumPlanes[6];
+uniform vec3 EyeHigh;
+uniform vec3 EyeLow;
+
+uniform bool UseHiZ;
+uniform sampler2D HiZTexture;
+uniform mat4 PreviousViewProjection;
+uniform vec3 PreviousEyeOffset;
+uniform vec2 HiZSize;
+uniform int HiZLevels;
+
+bool IsInsideFrustum(vec3 Center, float Radius)
+{
+	for (int i = 0; i < 6; ++i)
+	{
+		if (dot(FrustumPlanes[i].xyz, Center) + FrustumPlanes[i].w < -Radius)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+bool IsOccluded(vec3 Center, float Radius)
+{
+	// Centro relativo ao olho do frame em que o Hi-Z foi gerado
+	vec3 PreviousCenter = Center + PreviousEyeOffset;
+	if (length(PreviousCenter) < Radius)
+	{
+		return false;
+	}
+
+	// Retangulo na tela e menor profundidade da caixa que envolve a esfera
+	vec2 MinUV = vec2(1.0);
+	vec2 MaxUV = vec2(0.0);
+	float MinDepth = 1.0;
+	for (int i = 0; i < 8; ++i)
+	{
+		vec3 Corner = PreviousCenter + Radius * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+		vec4 Clip = PreviousViewProjection * vec4(Corner, 1.0);
+		if (Clip.w <= 0.0)
+		{
+			return false;
+		}
+
+		vec3 NDC = Clip.xyz / Clip.w;
+		MinUV = min(MinUV, NDC.xy * 0.5 + 0.5);
+		MaxUV = max(MaxUV, NDC.xy * 0.5 + 0.5);
+		MinDepth = min(MinDepth, NDC.z * 0.5 + 0.5);
+	}
+
+	// Fora da tela do frame anterior, mesmo que em parte, o Hi-Z nao sabe o que havia
+	// ali; as bordas da piramide costumam ter o globo perto e ocultariam o tile
+	if (any(lessThan(MinUV, vec2(0.0))) || any(greaterThan(MaxUV, vec2(1.0))))
+	{
+		return false;
+	}
+
+	// Escolher o nivel em que o retangulo cobre no maximo 2x2 texels
+	vec2 SizeInPixels = (MaxUV - MinUV) * HiZSize;
+	float Level = ceil(log2(max(max(SizeInPixels.x, SizeInPixels.y), 1.0)));
+	Level = clamp(Level, 0.0, float(HiZLevels - 1));
+
+	float MaxDepth = textureLod(HiZTexture, MinUV, Level).r;
+	MaxDepth = max(MaxDepth, textureLod(HiZTexture, vec2(MaxUV.x, MinUV.y), Level).r);
+	MaxDepth = max(MaxDepth, textureLod(HiZTexture, vec2(MinUV.x, MaxUV.y), Level).r);
+	MaxDepth = max(MaxDepth, textureLod(HiZTexture, MaxUV, Level).r);
+
+	return MinDepth > MaxDepth;
+}
+
+void main()
+{
+	uint Index = gl_GlobalInvocationID.x;
+	if (Index >= NumCandidates)
+	{
+		return;
+	}
+
+	Candidate C = Candidates[Index];
+
+	// Subtracao em duas partes para manter a precisao na escala da Terra
+	vec3 Center = (C.CenterHigh.xyz - EyeHigh) + (C.CenterLow.xyz - EyeLow);
+	float Radius = C.CenterHigh.w;
+
+	if (!IsInsideFrustum(Center, Radius))
+	{
+		return;
+	}
+
+	if (UseHiZ && IsOccluded(Center, Radius))
+	{
+		return;
+	}
+
+	uint Slot = atomicAdd(DrawCount, 1u);
+	Commands[Slot] = DrawCommand(C.Count, 1u, C.FirstIndex, C.BaseVertex, 0u);
+	DrawCenters[Slot] = vec4(Center, C.CenterLow.w);
+	VisibleIndices[Slot] = Index;
+}
@@ -0,0 +1,59 @@
+// Fragment shader dos tiles do globo. Variantes (ver ShaderVariants.h):
+//   GLOBE_LIGHTING    escurece o lado noturno e acende as luzes das cidades; o lado
+//                     do dia fica igual ao sem luz
+//   SHOW_TILE_LEVELS  tinge cada tile com uma cor pelo nivel do quadtree
+//   IMAGERY_SEQUENCE  troca a imagem fixa pela sequencia de imagens (--imagery)
+// Todas as variantes tem nuvens e sao vistas atraves da atmosfera (perspectiva aerea)
+#version 430 core
+
+#include "include/uniform_blocks.glsl"
+#include "include/lighting.glsl"
+#include "include/atmosphere.glsl"
+#include "include/clouds.glsl"
+
+#ifdef IMAGERY_SEQUENCE
+#include "include/imagery.glsl"
+#else
+uniform sampler2D TextureSampler;
+#endif
+uniform sampler2D NightSampler;
+
+in vec3 Normal;
+in vec2 UV;
+in vec3 EyeOffset;     // Posicao relativa a camera
+#ifdef SHOW_TILE_LEVELS
+flat in int TileLevel;
+#endif
+
+out vec4 OutColor;
+
+void main()
+{
+	// As nuvens ficam por cima da imagem e recebem a mesma luz; a noite tapam as luzes das cidades
+	float Cloud = GetCloudCoverage(UV);
+#ifdef IMAGERY_SEQUENCE
+	vec3 TextureColor = mix(GetImageryColor(UV), vec3(1.0), Cloud);
+#else
+	vec3 TextureColor = mix(texture(TextureSampler, UV).rgb, vec3(1.0), Cloud);
+#endif
+	vec3 SunDirection = Frame.SunDirection.xyz;
+	vec3 Camera = ToAtmosphereModel(Frame.CameraPosition.xyz);
+	vec3 Point = ToAtmosphereModel(Frame.CameraPosition.xyz + EyeOffset);
+
+#ifdef GLOBE_LIGHTING
+	// Depois do por do sol o chao ainda recebe a luz do ceu por algum tempo
+	vec3 DayColor = TextureColor;
+	vec3 SkyLight = ToneMapAtmosphere(GetSkyIrradiance(length(Point), dot(normalize(Point), SunDirection)) / Pi);
+	TextureColor = ApplySunLighting(DayColor, texture(NightSampler, UV).rgb * (1.0 - Cloud), Normal, SunDirection);
+	TextureColor += DayColor * SkyLight * (1.0 - GetDaylight(Normal, SunDirection));
+#endif
+
+#ifdef SHOW_TILE_LEVELS
+	const vec3 LevelColors[4] = vec3[4](vec3(1.0, 0.3, 0.3), vec3(0.3, 1.0, 0.3), vec3(0.3, 0.3, 1.0), vec3(1.0, 1.0, 0.3));
+	TextureColor = mix(TextureColor, LevelColors[TileLevel % 4], 0.35);
+#endif
+
+	vec3 Transmittance;
+	vec3 Inscattered = GetSkyRadianceToPoint(Camera, Point, SunDirection, Transmittance);
+	OutColor = vec4(TextureColor * Transmittance + ToneMapAtmosphere(Inscattered), 1.0);
+}
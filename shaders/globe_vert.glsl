@@ -0,0 +1,47 @@
+// Vertex shader dos tiles do globo desenhados com glMultiDrawElementsIndirect
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : require
+
+layout (location = 0) in vec3 InPosition;
+layout (location = 1) in vec3 InNormal;
+layout (location = 2) in vec2 InUV;
+layout (location = 3) in vec3 InPositionLow;
+
+// Dados por tile, um elemento por comando de desenho
+struct TileDrawData
+{
+	vec4 Center;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBlock
+{
+	TileDrawData Draws[];
+};
+
+#include "include/uniform_blocks.glsl"
+
+out vec3 Normal;
+out vec2 UV;
+out vec3 EyeOffset;
+#ifdef SHOW_TILE_LEVELS
+flat out int TileLevel;
+#endif
+
+void main()
+{
+	TileDrawData Draw = Draws[gl_DrawIDARB];
+
+	Normal = InNormal;
+	UV = InUV;
+#ifdef SHOW_TILE_LEVELS
+	TileLevel = int(Draw.Center.w);
+#endif
+
+	// Posicao relativa ao olho emulando a subtracao em double: as partes altas do
+	// vertice e do olho quase se cancelam sem erro e as baixas corrigem o resto.
+	// precise impede o compilador de reagrupar as somas
+	precise vec3 HighDifference = InPosition - Object.CameraPosition.xyz;
+	precise vec3 LowDifference = InPositionLow - Object.CameraPositionLow.xyz;
+	EyeOffset = HighDifference + LowDifference;
+	gl_Position = Object.ModelViewProjection * vec4(EyeOffset, 1.0);
+}
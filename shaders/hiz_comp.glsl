@@ -0,0 +1,50 @@
+// Monta um nivel da piramide Hi-Z guardando o maior depth da regiao do nivel anterior
+#version 430 core
+
+layout (local_size_x = 8, local_size_y = 8) in;
+
+uniform sampler2D SourceTexture;
+uniform int SourceLevel;        // -1 para copiar direto da textura de depth
+uniform ivec2 SourceSize;
+
+layout (r32f, binding = 0) writeonly uniform image2D Destination;
+
+void main()
+{
+	ivec2 Position = ivec2(gl_GlobalInvocationID.xy);
+	ivec2 DestinationSize = imageSize(Destination);
+	if (any(greaterThanEqual(Position, DestinationSize)))
+	{
+		return;
+	}
+
+	if (SourceLevel < 0)
+	{
+		imageStore(Destination, Position, vec4(texelFetch(SourceTexture, Position, 0).r));
+		return;
+	}
+
+	// Com tamanho impar o ultimo texel tambem cobre a linha/coluna que sobrou
+	ivec2 Begin = Position * 2;
+	ivec2 End = Begin + ivec2(1);
+	if (Position.x == DestinationSize.x - 1 && (SourceSize.x & 1) != 0)
+	{
+		End.x += 1;
+	}
+	if (Position.y == DestinationSize.y - 1 && (SourceSize.y & 1) != 0)
+	{
+		End.y += 1;
+	}
+	End = min(End, SourceSize - ivec2(1));
+
+	float MaxDepth = 0.0;
+	for (int y = Begin.y; y <= End.y; ++y)
+	{
+		for (int x = Begin.x; x <= End.x; ++x)
+		{
+			MaxDepth = max(MaxDepth, texelFetch(SourceTexture, ivec2(x, y), SourceLevel).r);
+		}
+	}
+
+	imageStore(Destination, Position, vec4(MaxDepth));
+}
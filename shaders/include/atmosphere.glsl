@@ -0,0 +1,248 @@
+// Leitura das tabelas de espalhamento atmosferico pre-calculadas (ver Atmosphere.h),
+// como GetSkyRadiance e GetSkyRadianceToPoint da implementacao de referencia de
+// Bruneton (2017). Distancias em km no modelo esferico da atmosfera; as posicoes do
+// mundo passam por ToAtmosphereModel
+
+// Parametros fixos da atmosfera (AtmosphereUniforms em Atmosphere.h)
+layout (std140) uniform AtmosphereBlock
+{
+	vec4 RayleighScattering;    // w = MiePhaseG
+	vec4 MieScattering;         // w = SunAngularRadius
+	vec4 SolarIrradiance;       // w = Exposure
+	vec4 ModelScale;
+	ivec4 ScatteringSize;       // Nu, MuS, Mu, R
+	float BottomRadius;
+	float TopRadius;
+	float MuSMin;
+	float Padding;
+} Atmosphere;
+
+uniform sampler2D TransmittanceSampler;
+uniform sampler3D ScatteringSampler;
+uniform sampler2D IrradianceSampler;
+
+const float Pi = 3.14159265358979;
+
+// Posicao do mundo (metros, elipsoide) no modelo (km, esfera de raio BottomRadius)
+vec3 ToAtmosphereModel(vec3 WorldPosition)
+{
+	return WorldPosition * Atmosphere.ModelScale.xyz;
+}
+
+// Radiancia para a tela: exposicao e curva exponencial
+vec3 ToneMapAtmosphere(vec3 Radiance)
+{
+	return 1.0 - exp(-Radiance * Atmosphere.SolarIrradiance.w);
+}
+
+float ClampCosine(float Mu)
+{
+	return clamp(Mu, -1.0, 1.0);
+}
+
+float SafeSqrt(float Value)
+{
+	return sqrt(max(Value, 0.0));
+}
+
+float GetTextureCoordFromUnitRange(float X, int Size)
+{
+	return 0.5 / float(Size) + X * (1.0 - 1.0 / float(Size));
+}
+
+float DistanceToTopAtmosphereBoundary(float R, float Mu)
+{
+	float Discriminant = R * R * (Mu * Mu - 1.0) + Atmosphere.TopRadius * Atmosphere.TopRadius;
+	return max(-R * Mu + SafeSqrt(Discriminant), 0.0);
+}
+
+bool RayIntersectsGround(float R, float Mu)
+{
+	return Mu < 0.0 && R * R * (Mu * Mu - 1.0) + Atmosphere.BottomRadius * Atmosphere.BottomRadius >= 0.0;
+}
+
+float RayleighPhaseFunction(float Nu)
+{
+	return 3.0 / (16.0 * Pi) * (1.0 + Nu * Nu);
+}
+
+float MiePhaseFunction(float G, float Nu)
+{
+	float K = 3.0 / (8.0 * Pi) * (1.0 - G * G) / (2.0 + G * G);
+	return K * (1.0 + Nu * Nu) / pow(1.0 + G * G - 2.0 * G * Nu, 1.5);
+}
+
+vec3 GetTransmittanceToTopAtmosphereBoundary(float R, float Mu)
+{
+	float H = sqrt(Atmosphere.TopRadius * Atmosphere.TopRadius - Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+	float Rho = SafeSqrt(R * R - Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+	float D = DistanceToTopAtmosphereBoundary(R, Mu);
+	float DMin = Atmosphere.TopRadius - R;
+	float DMax = Rho + H;
+	ivec2 Size = textureSize(TransmittanceSampler, 0);
+	vec2 UV = vec2(GetTextureCoordFromUnitRange((D - DMin) / (DMax - DMin), Size.x), GetTextureCoordFromUnitRange(Rho / H, Size.y));
+	return texture(TransmittanceSampler, UV).rgb;
+}
+
+// Transmitancia ate a distancia D ao longo do raio, pela razao de duas leituras
+vec3 GetTransmittance(float R, float Mu, float D, bool IntersectsGround)
+{
+	float RD = clamp(sqrt(D * D + 2.0 * R * Mu * D + R * R), Atmosphere.BottomRadius, Atmosphere.TopRadius);
+	float MuD = ClampCosine((R * Mu + D) / RD);
+	if (IntersectsGround)
+	{
+		return min(GetTransmittanceToTopAtmosphereBoundary(RD, -MuD) / GetTransmittanceToTopAtmosphereBoundary(R, -Mu), vec3(1.0));
+	}
+	return min(GetTransmittanceToTopAtmosphereBoundary(R, Mu) / GetTransmittanceToTopAtmosphereBoundary(RD, MuD), vec3(1.0));
+}
+
+vec4 GetScatteringTextureUvwz(float R, float Mu, float MuS, float Nu, bool IntersectsGround)
+{
+	float H = sqrt(Atmosphere.TopRadius * Atmosphere.TopRadius - Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+	float Rho = SafeSqrt(R * R - Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+	float UR = GetTextureCoordFromUnitRange(Rho / H, Atmosphere.ScatteringSize.w);
+
+	int HalfMuSize = Atmosphere.ScatteringSize.z / 2;
+	float RMu = R * Mu;
+	float Discriminant = RMu * RMu - R * R + Atmosphere.BottomRadius * Atmosphere.BottomRadius;
+	float UMu;
+	if (IntersectsGround)
+	{
+		float D = -RMu - SafeSqrt(Discriminant);
+		float DMin = R - Atmosphere.BottomRadius;
+		float DMax = Rho;
+		UMu = 0.5 - 0.5 * GetTextureCoordFromUnitRange(DMax == DMin ? 0.0 : (D - DMin) / (DMax - DMin), HalfMuSize);
+	}
+	else
+	{
+		float D = -RMu + SafeSqrt(Discriminant + H * H);
+		float DMin = Atmosphere.TopRadius - R;
+		float DMax = Rho + H;
+		UMu = 0.5 + 0.5 * GetTextureCoordFromUnitRange((D - DMin) / (DMax - DMin), HalfMuSize);
+	}
+
+	float D = DistanceToTopAtmosphereBoundary(Atmosphere.BottomRadius, MuS);
+	float DMin = Atmosphere.TopRadius - Atmosphere.BottomRadius;
+	float DMax = H;
+	float A = (D - DMin) / (DMax - DMin);
+	float AMax = (DistanceToTopAtmosphereBoundary(Atmosphere.BottomRadius, Atmosphere.MuSMin) - DMin) / (DMax - DMin);
+	float UMuS = GetTextureCoordFromUnitRange(max(1.0 - A / AMax, 0.0) / (1.0 + A), Atmosphere.ScatteringSize.y);
+
+	return vec4((Nu + 1.0) * 0.5, UMuS, UMu, UR);
+}
+
+// Espalhamento combinado: Rayleigh e multiplo em RGB, Mie vermelho no alfa. O eixo
+// nu fica dividido em fatias na largura da textura 3D e e interpolado a mao
+vec4 GetCombinedScattering(float R, float Mu, float MuS, float Nu, bool IntersectsGround)
+{
+	vec4 Uvwz = GetScatteringTextureUvwz(R, Mu, MuS, Nu, IntersectsGround);
+	float NuSize = float(Atmosphere.ScatteringSize.x);
+	float TexCoordX = Uvwz.x * (NuSize - 1.0);
+	float TexX = floor(TexCoordX);
+	float Lerp = TexCoordX - TexX;
+	vec3 Uvw0 = vec3((TexX + Uvwz.y) / NuSize, Uvwz.z, Uvwz.w);
+	vec3 Uvw1 = vec3((TexX + 1.0 + Uvwz.y) / NuSize, Uvwz.z, Uvwz.w);
+	return mix(texture(ScatteringSampler, Uvw0), texture(ScatteringSampler, Uvw1), Lerp);
+}
+
+// Mie simples em RGB a partir do vermelho, na proporcao do Rayleigh
+vec3 GetExtrapolatedSingleMieScattering(vec4 Scattering)
+{
+	if (Scattering.r <= 0.0)
+	{
+		return vec3(0.0);
+	}
+	return Scattering.rgb * Scattering.a / Scattering.r * (Atmosphere.RayleighScattering.r / Atmosphere.MieScattering.r) *
+		(Atmosphere.MieScattering.rgb / Atmosphere.RayleighScattering.rgb);
+}
+
+vec3 GetPhasedScattering(vec4 Scattering, float Nu)
+{
+	return Scattering.rgb * RayleighPhaseFunction(Nu) + GetExtrapolatedSingleMieScattering(Scattering) * MiePhaseFunction(Atmosphere.RayleighScattering.w, Nu);
+}
+
+// Radiancia do ceu ao longo de um raio que nao atinge o chao. Camera e ViewRay no
+// modelo; Transmittance e a do raio ate o espaco, para o disco do sol
+vec3 GetSkyRadiance(vec3 Camera, vec3 ViewRay, vec3 SunDirection, out vec3 Transmittance)
+{
+	float R = max(length(Camera), Atmosphere.BottomRadius);
+	float RMu = dot(Camera, ViewRay);
+	float TopDiscriminant = RMu * RMu - R * R + Atmosphere.TopRadius * Atmosphere.TopRadius;
+
+	// Camera no espaco: avancar ate a entrada na atmosfera, se o raio passar por ela
+	if (R > Atmosphere.TopRadius)
+	{
+		float DistanceToTop = -RMu - SafeSqrt(TopDiscriminant);
+		if (TopDiscriminant < 0.0 || DistanceToTop <= 0.0)
+		{
+			Transmittance = vec3(1.0);
+			return vec3(0.0);
+		}
+		Camera += ViewRay * DistanceToTop;
+		R = Atmosphere.TopRadius;
+		RMu += DistanceToTop;
+	}
+
+	float Mu = RMu / R;
+	float MuS = dot(Camera, SunDirection) / R;
+	float Nu = dot(ViewRay, SunDirection);
+	bool IntersectsGround = RayIntersectsGround(R, Mu);
+
+	Transmittance = IntersectsGround ? vec3(0.0) : GetTransmittanceToTopAtmosphereBoundary(R, Mu);
+	return GetPhasedScattering(GetCombinedScattering(R, Mu, MuS, Nu, IntersectsGround), Nu);
+}
+
+// Radiancia espalhada entre a camera e um ponto do chao (perspectiva aerea):
+// o espalhamento ate o infinito na camera menos o do ponto, atenuado
+vec3 GetSkyRadianceToPoint(vec3 Camera, vec3 Point, vec3 SunDirection, out vec3 Transmittance)
+{
+	vec3 ViewRay = normalize(Point - Camera);
+	float R = max(length(Camera), Atmosphere.BottomRadius);
+	float RMu = dot(Camera, ViewRay);
+	float TopDiscriminant = RMu * RMu - R * R + Atmosphere.TopRadius * Atmosphere.TopRadius;
+	if (R > Atmosphere.TopRadius)
+	{
+		float DistanceToTop = -RMu - SafeSqrt(TopDiscriminant);
+		if (DistanceToTop > 0.0)
+		{
+			Camera += ViewRay * DistanceToTop;
+			R = Atmosphere.TopRadius;
+			RMu += DistanceToTop;
+		}
+	}
+
+	float Mu = RMu / R;
+	float MuS = dot(Camera, SunDirection) / R;
+	float Nu = dot(ViewRay, SunDirection);
+	float D = length(Point - Camera);
+	bool IntersectsGround = RayIntersectsGround(R, Mu);
+
+	Transmittance = GetTransmittance(R, Mu, D, IntersectsGround);
+	vec4 Scattering = GetCombinedScattering(R, Mu, MuS, Nu, IntersectsGround);
+
+	float RP = clamp(sqrt(D * D + 2.0 * R * Mu * D + R * R), Atmosphere.BottomRadius, Atmosphere.TopRadius);
+	float MuP = (R * Mu + D) / RP;
+	float MuSP = (R * MuS + D * Nu) / RP;
+	vec4 ScatteringP = GetCombinedScattering(RP, MuP, MuSP, Nu, IntersectsGround);
+	Scattering = max(Scattering - Transmittance.rgbr * ScatteringP, vec4(0.0));
+
+	// Sem o Mie perto do por do sol, onde a extrapolacao a partir do vermelho falha
+	Scattering.a *= smoothstep(0.0, 0.01, MuS);
+	return GetPhasedScattering(Scattering, Nu);
+}
+
+// Irradiancia da luz do ceu (sem o sol direto) num plano horizontal
+vec3 GetSkyIrradiance(float R, float MuS)
+{
+	ivec2 Size = textureSize(IrradianceSampler, 0);
+	vec2 UV = vec2(GetTextureCoordFromUnitRange(MuS * 0.5 + 0.5, Size.x),
+		GetTextureCoordFromUnitRange((R - Atmosphere.BottomRadius) / (Atmosphere.TopRadius - Atmosphere.BottomRadius), Size.y));
+	return texture(IrradianceSampler, UV).rgb;
+}
+
+// Radiancia do disco do sol fora da atmosfera
+vec3 GetSolarRadiance()
+{
+	float AngularRadius = Atmosphere.MieScattering.w;
+	return Atmosphere.SolarIrradiance.rgb / (Pi * AngularRadius * AngularRadius);
+}
@@ -0,0 +1,17 @@
+// Nuvens animadas (ver CloudLayer.h): dois campos de cobertura equiretangulares no
+// UV do globo, misturados pelo tempo entre eles e deslocados para leste
+
+uniform sampler2D CloudSampler0;
+uniform sampler2D CloudSampler1;
+uniform float CloudBlend;
+uniform float CloudDrift;
+
+// Mesmo com cobertura total um pouco do chao aparece
+const float CloudOpacity = 0.9;
+
+// Cobertura de 0 a 1 no ponto do globo
+float GetCloudCoverage(vec2 UV)
+{
+	vec2 CloudUV = vec2(UV.x - CloudDrift, UV.y);
+	return mix(texture(CloudSampler0, CloudUV).r, texture(CloudSampler1, CloudUV).r, CloudBlend) * CloudOpacity;
+}
@@ -0,0 +1,17 @@
+// Conversoes entre coordenadas geodesicas e ECEF sobre o elipsoide
+
+// Converte latitude/longitude (graus) em coordenadas ECEF sobre o elipsoide de raios Radii
+vec3 GeodeticToECEF(vec2 LatLon, vec3 Radii)
+{
+	vec2 Radians = radians(LatLon);
+	vec3 Normal = vec3(cos(Radians.x) * cos(Radians.y), cos(Radians.x) * sin(Radians.y), sin(Radians.x));
+	vec3 K = Radii * Radii * Normal;
+	float Gamma = sqrt(dot(K, Normal));
+	return K / Gamma;
+}
+
+// Normal da superficie do elipsoide em um ponto ECEF
+vec3 GeodeticSurfaceNormal(vec3 Position, vec3 Radii)
+{
+	return normalize(Position / (Radii * Radii));
+}
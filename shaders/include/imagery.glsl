@@ -0,0 +1,12 @@
+// Sequencia de imagens do globo (ver ImagerySequence.h): camadas de uma textura
+// array no UV do globo, com a transicao entre a imagem atual e a seguinte
+
+uniform sampler2DArray ImagerySampler;
+uniform vec3 ImageryLayers;    // Camada atual, camada seguinte e peso da seguinte
+
+vec3 GetImageryColor(vec2 UV)
+{
+	vec3 Current = texture(ImagerySampler, vec3(UV, ImageryLayers.x)).rgb;
+	vec3 Next = texture(ImagerySampler, vec3(UV, ImageryLayers.y)).rgb;
+	return mix(Current, Next, ImageryLayers.z);
+}
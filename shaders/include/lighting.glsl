@@ -0,0 +1,21 @@
+// Iluminacao do sol sobre as imagens do globo, com as luzes das cidades no lado noturno
+
+// Brilho que sobra no lado noturno e largura da transicao no terminador
+const float NightBrightness = 0.15;
+const float TerminatorWidth = 0.1;
+const float NightLightsIntensity = 1.0;
+
+// 0 na noite, 1 no dia, com a transicao suave no terminador
+float GetDaylight(vec3 Normal, vec3 SunDirection)
+{
+	return smoothstep(-TerminatorWidth, TerminatorWidth, dot(normalize(Normal), SunDirection));
+}
+
+// DayColor e NightLights vem das duas texturas no mesmo UV. Sem a textura noturna
+// NightLights e preto e o lado da noite so escurece
+vec3 ApplySunLighting(vec3 DayColor, vec3 NightLights, vec3 Normal, vec3 SunDirection)
+{
+	float Daylight = GetDaylight(Normal, SunDirection);
+	vec3 NightColor = DayColor * NightBrightness + NightLights * NightLightsIntensity;
+	return mix(NightColor, DayColor, Daylight);
+}
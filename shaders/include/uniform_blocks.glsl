@@ -0,0 +1,24 @@
+// Blocos uniformes compartilhados por todos os shaders (ver UniformBuffers.h)
+
+// Dados do frame, compartilhados por todos os objetos
+layout (std140) uniform FrameBlock
+{
+	mat4 View;
+	mat4 Projection;
+	mat4 ViewProjection;
+	vec4 CameraPosition;
+	vec4 SunDirection;
+	vec4 EllipsoidRadii;
+	vec2 ViewportSize;
+	float Time;
+	float DeltaTime;
+} Frame;
+
+// Dados por objeto, ligados com glBindBufferRange
+layout (std140) uniform ObjectBlock
+{
+	mat4 Model;
+	mat4 ModelViewProjection;
+	vec4 CameraPosition;
+	vec4 CameraPositionLow;
+} Object;
@@ -0,0 +1,25 @@
+// Texto a partir do campo de distancia: borda suave em qualquer escala e um halo
+// escuro em volta para o rotulo continuar legivel sobre o mapa
+#version 330 core
+
+uniform sampler2D AtlasSampler;
+
+in vec2 UV;
+in vec4 Color;
+
+out vec4 OutColor;
+
+// O contorno fica em 0.5; o halo vai ate HaloEdge
+const float HaloEdge = 0.3;
+
+void main()
+{
+	float Distance = texture(AtlasSampler, UV).r;
+	float Smoothing = max(fwidth(Distance), 1.0 / 255.0);
+
+	float TextAlpha = smoothstep(0.5 - Smoothing, 0.5 + Smoothing, Distance);
+	float HaloAlpha = smoothstep(HaloEdge - Smoothing, HaloEdge + Smoothing, Distance);
+
+	vec3 RGB = mix(vec3(0.0), Color.rgb, TextAlpha);
+	OutColor = vec4(RGB, Color.a * HaloAlpha);
+}
@@ -0,0 +1,24 @@
+// Um quad por glifo: os atributos sao por instancia e os cantos saem do gl_VertexID
+#version 330 core
+
+layout (location = 0) in vec4 InRect;
+layout (location = 1) in vec4 InUVRect;
+layout (location = 2) in vec4 InColor;
+
+#include "include/uniform_blocks.glsl"
+
+out vec2 UV;
+out vec4 Color;
+
+void main()
+{
+	vec2 Corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+	Color = InColor;
+
+	// A linha 0 do bitmap e o topo do glifo
+	UV = vec2(mix(InUVRect.x, InUVRect.z, Corner.x), mix(InUVRect.w, InUVRect.y, Corner.y));
+
+	// Retangulo em pixels da janela, origem no canto inferior esquerdo
+	vec2 Pixel = InRect.xy + Corner * InRect.zw;
+	gl_Position = vec4(Pixel / Frame.ViewportSize * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,19 @@
+// Desenha cada marcador como um circulo com borda suave
+#version 330 core
+
+in vec4 Color;
+in vec2 Corner;
+
+out vec4 OutColor;
+
+void main()
+{
+	float Distance = length(Corner);
+	if (Distance > 1.0)
+	{
+		discard;
+	}
+
+	float Alpha = 1.0 - smoothstep(0.8, 1.0, Distance);
+	OutColor = vec4(Color.rgb, Color.a * Alpha);
+}
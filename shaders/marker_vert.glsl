@@ -0,0 +1,36 @@
+// Um quad por marcador: os atributos sao por instancia e os cantos saem do gl_VertexID
+#version 330 core
+
+layout (location = 0) in vec2 InLatLon;
+layout (location = 1) in float InSize;
+layout (location = 2) in vec4 InColor;
+
+#include "include/uniform_blocks.glsl"
+#include "include/geodesy.glsl"
+
+out vec4 Color;
+out vec2 Corner;
+
+void main()
+{
+	Corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+	Color = InColor;
+
+	vec3 Position = GeodeticToECEF(InLatLon, Frame.EllipsoidRadii.xyz);
+
+	// Marcadores do outro lado do globo ficam fora do volume de recorte
+	vec3 Normal = GeodeticSurfaceNormal(Position, Frame.EllipsoidRadii.xyz);
+	if (dot(Normal, Object.CameraPosition.xyz - Position) < 0.0)
+	{
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+		return;
+	}
+
+	// A matriz e relativa ao olho: subtrair a camera em duas partes (alta e baixa)
+	// preserva a precisao na escala real da Terra
+	vec3 EyeRelative = (Position - Object.CameraPosition.xyz) - Object.CameraPositionLow.xyz;
+
+	// Deslocar o canto em espaco de tela para o marcador ter tamanho fixo em pixels
+	gl_Position = Object.ModelViewProjection * vec4(EyeRelative, 1.0);
+	gl_Position.xy += Corner * InSize / Frame.ViewportSize * gl_Position.w;
+}
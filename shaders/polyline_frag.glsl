@@ -0,0 +1,13 @@
+// Linha com borda suave: Side vai de -1 a 1 atravessando a largura da linha
+#version 330 core
+
+in vec4 Color;
+in float Side;
+
+out vec4 OutColor;
+
+void main()
+{
+	float Alpha = clamp((1.0 - abs(Side)) / max(fwidth(Side), 1e-4), 0.0, 1.0);
+	OutColor = vec4(Color.rgb, Color.a * Alpha);
+}
@@ -0,0 +1,98 @@
+// Um segmento de polilinha por instancia, extrudado em espaco de tela. Os atributos
+// leem do mesmo buffer os pontos anterior, inicial, final e seguinte; os quatro
+// cantos do segmento saem do gl_VertexID
+#version 330 core
+
+layout (location = 0) in vec2 InPrevious;
+layout (location = 1) in vec2 InStart;
+layout (location = 2) in vec2 InEnd;
+layout (location = 3) in vec2 InNext;
+layout (location = 4) in vec4 InColor;
+
+#include "include/uniform_blocks.glsl"
+#include "include/geodesy.glsl"
+
+// Largura da linha em pixels
+uniform float LineWidth;
+
+out vec4 Color;
+out float Side;
+
+// Limite do comprimento do miter, em larguras de linha, para cantos muito fechados
+const float MiterLimit = 2.0;
+
+vec3 ToECEF(vec2 LatLon)
+{
+	return GeodeticToECEF(LatLon, Frame.EllipsoidRadii.xyz);
+}
+
+bool IsBehindHorizon(vec3 Position)
+{
+	vec3 Normal = GeodeticSurfaceNormal(Position, Frame.EllipsoidRadii.xyz);
+	return dot(Normal, Object.CameraPosition.xyz - Position) < 0.0;
+}
+
+// A matriz e relativa ao olho, como nos marcadores
+vec4 ToClip(vec3 Position)
+{
+	vec3 EyeRelative = (Position - Object.CameraPosition.xyz) - Object.CameraPositionLow.xyz;
+	return Object.ModelViewProjection * vec4(EyeRelative, 1.0);
+}
+
+vec2 ToScreen(vec4 Clip)
+{
+	return Clip.xy / Clip.w * Frame.ViewportSize * 0.5;
+}
+
+void main()
+{
+	// x: 0 no inicio e 1 no fim do segmento; y: lado da linha
+	vec2 Corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+	Side = Corner.y * 2.0 - 1.0;
+	Color = InColor;
+
+	vec3 Start = ToECEF(InStart);
+	vec3 End = ToECEF(InEnd);
+	vec4 ClipStart = ToClip(Start);
+	vec4 ClipEnd = ToClip(End);
+
+	// Segmentos inteiros atras do horizonte ou da camera somem. Um segmento que cruza
+	// o horizonte fica: a corda passa por dentro do elipsoide e o excesso cai sobre o globo
+	if ((IsBehindHorizon(Start) && IsBehindHorizon(End)) || ClipStart.w <= 0.0 || ClipEnd.w <= 0.0)
+	{
+		gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+		return;
+	}
+
+	vec2 ScreenStart = ToScreen(ClipStart);
+	vec2 ScreenEnd = ToScreen(ClipEnd);
+	vec2 Segment = ScreenEnd - ScreenStart;
+	vec2 Direction = dot(Segment, Segment) > 1e-8 ? normalize(Segment) : vec2(1.0, 0.0);
+	vec2 Normal = vec2(-Direction.y, Direction.x);
+
+	// Juncao com o segmento vizinho desta ponta. Nas pontas da polilinha o vizinho e
+	// o proprio ponto e a ponta fica reta
+	bool AtEnd = Corner.x > 0.5;
+	vec4 ClipNeighbor = ToClip(ToECEF(AtEnd ? InNext : InPrevious));
+	vec2 Offset = Normal;
+	if (ClipNeighbor.w > 0.0)
+	{
+		vec2 Neighbor = ToScreen(ClipNeighbor);
+		vec2 NeighborSegment = AtEnd ? Neighbor - ScreenEnd : ScreenStart - Neighbor;
+		if (dot(NeighborSegment, NeighborSegment) > 1e-8)
+		{
+			vec2 NeighborDirection = normalize(NeighborSegment);
+			vec2 MiterSum = Normal + vec2(-NeighborDirection.y, NeighborDirection.x);
+			if (dot(MiterSum, MiterSum) > 1e-6)
+			{
+				vec2 Miter = normalize(MiterSum);
+				Offset = Miter / max(dot(Miter, Normal), 1.0 / MiterLimit);
+			}
+		}
+	}
+
+	// Meio pixel a mais de cada lado para a borda suave do fragment shader
+	float HalfWidth = LineWidth * 0.5 + 0.5;
+	gl_Position = AtEnd ? ClipEnd : ClipStart;
+	gl_Position.xy += Offset * Side * HalfWidth / (Frame.ViewportSize * 0.5) * gl_Position.w;
+}
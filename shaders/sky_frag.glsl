@@ -0,0 +1,26 @@
+// Ceu visto de qualquer altura, com o disco do sol, pelas tabelas de espalhamento
+#version 330 core
+
+#include "include/uniform_blocks.glsl"
+#include "include/atmosphere.glsl"
+
+in vec3 ViewRay;
+
+out vec4 OutColor;
+
+void main()
+{
+	// A direcao passa pela mesma escala do elipsoide que o globo, para o limbo bater
+	vec3 Camera = ToAtmosphereModel(Frame.CameraPosition.xyz);
+	vec3 Ray = normalize(ToAtmosphereModel(ViewRay));
+	vec3 SunDirection = Frame.SunDirection.xyz;
+
+	vec3 Transmittance;
+	vec3 Radiance = GetSkyRadiance(Camera, Ray, SunDirection, Transmittance);
+	if (dot(Ray, SunDirection) > cos(Atmosphere.MieScattering.w))
+	{
+		Radiance += Transmittance * GetSolarRadiance();
+	}
+
+	OutColor = vec4(ToneMapAtmosphere(Radiance), 1.0);
+}
@@ -0,0 +1,19 @@
+// Triangulo que cobre a tela inteira no plano do fundo; os cantos saem do gl_VertexID
+#version 330 core
+
+#include "include/uniform_blocks.glsl"
+
+out vec3 ViewRay;
+
+void main()
+{
+	vec2 Position = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 4.0 - 1.0;
+
+	// Direcao do pixel no mundo. A ViewProjection e relativa ao olho, entao o ponto
+	// desprojetado ja e a direcao a partir da camera
+	vec4 WorldPoint = inverse(Frame.ViewProjection) * vec4(Position, 0.0, 1.0);
+	ViewRay = WorldPoint.xyz / WorldPoint.w;
+
+	// Profundidade 1: so passa no teste GL_LEQUAL onde o globo nao desenhou
+	gl_Position = vec4(Position, 1.0, 1.0);
+}
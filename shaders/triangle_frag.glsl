@@ -1,18 +1,30 @@
 // Todos os calculos realizados aqui sao pensados por pixels
 #version 330 core
 
+#include "include/uniform_blocks.glsl"
+#include "include/lighting.glsl"
+
 uniform sampler2D TextureSampler;
+uniform sampler2D NightSampler;
 
 in vec3 Color;
 in vec2 UV;
 
 out vec4 OutColor;
 
+const float Pi = 3.14159265358979;
+
 void main()
 {
 	float ColorIntensity = 1.0;
 	vec3 TextureColor = texture(TextureSampler, UV).rgb;
-	vec3 FinalColor = ColorIntensity * TextureColor;
+
+	// O mapa plano e equiretangular: a normal geodesica sai direto da latitude e
+	// longitude do UV
+	float Latitude = (UV.y - 0.5) * Pi;
+	float Longitude = (UV.x - 0.5) * 2.0 * Pi;
+	vec3 Normal = vec3(cos(Latitude) * cos(Longitude), cos(Latitude) * sin(Longitude), sin(Latitude));
+	vec3 FinalColor = ColorIntensity * ApplySunLighting(TextureColor, texture(NightSampler, UV).rgb, Normal, Frame.SunDirection.xyz);
 
 	OutColor = vec4(FinalColor, 1.0);
-}
\ No newline at end of file
+}
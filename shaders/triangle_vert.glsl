@@ -5,7 +5,7 @@ layout (location = 0) in vec3 InPosition;
 layout (location = 1) in vec3 InColor;
 layout (location = 2) in vec2 InUV;
 
-uniform mat4 ModelViewProjection;
+#include "include/uniform_blocks.glsl"
 
 out vec3 Color;
 out vec2 UV;
@@ -14,5 +14,5 @@ void main()
 {
 	Color = InColor;
 	UV = InUV;
-	gl_Position = ModelViewProjection * vec4(InPosition, 1.0);
-}
\ No newline at end of file
+	gl_Position = Object.ModelViewProjection * vec4(InPosition, 1.0);
+}